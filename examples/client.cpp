@@ -0,0 +1,203 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+// Client for metafsimple-server: reads reports from standard input, one
+// report per line, sends them to server in batches keeping several requests
+// in flight, and prints station, report type, error and number of warnings
+// for each report in input order.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "metafsimple.hpp"
+#include "metafsimple_serialize.hpp"
+#include "server_protocol.hpp"
+
+using namespace metafsimple;
+
+struct Options {
+    std::size_t batchSize = 256;
+    std::size_t depth = 4;
+    bool quiet = false;
+    const char *path = nullptr;
+};
+
+// Limits number of requests sent but not yet answered
+class Window {
+   public:
+    explicit Window(std::size_t size) : available(size) {}
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return available > 0; });
+        available--;
+    }
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            available++;
+        }
+        cv.notify_one();
+    }
+
+   private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t available;
+};
+
+// Sends batches read from standard input; returns number of requests sent
+std::uint64_t sendRequests(int fd, const Options &options, Window &window) {
+    std::uint64_t id = 0;
+    std::vector<std::string> batch;
+    std::string frame;
+    bool end = false;
+    while (!end) {
+        batch.clear();
+        std::string line;
+        while (batch.size() < options.batchSize) {
+            if (!std::getline(std::cin, line)) {
+                end = true;
+                break;
+            }
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) batch.push_back(std::move(line));
+        }
+        if (batch.empty()) break;
+        protocol::beginFrame(frame);
+        Encoder e(frame);
+        e.writeUnsigned(id);
+        e.writeUnsigned(batch.size());
+        for (const auto &report : batch) e(report);
+        window.acquire();
+        if (!protocol::writeFrame(fd, frame)) {
+            std::cerr << "Cannot send request\n";
+            break;
+        }
+        id++;
+    }
+    shutdown(fd, SHUT_WR);
+    return id;
+}
+
+std::string_view toStr(Report::Type type) {
+    switch (type) {
+        case Report::Type::METAR:
+            return "METAR";
+        case Report::Type::SPECI:
+            return "SPECI";
+        case Report::Type::TAF:
+            return "TAF";
+        default:
+            return "ERROR";
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (auto i = 1; i < argc; i++) {
+        const std::string_view arg(argv[i]);
+        if (arg == "-b" && i + 1 < argc) {
+            options.batchSize = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "-d" && i + 1 < argc) {
+            options.depth = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "-q") {
+            options.quiet = true;
+        } else if (!options.path && arg[0] != '-') {
+            options.path = argv[i];
+        } else {
+            options.path = nullptr;
+            break;
+        }
+    }
+    if (!options.path) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [-b BATCH_SIZE] [-d REQUESTS_IN_FLIGHT] [-q]"
+                     " SOCKET_PATH\n"
+                  << "Reports are read from standard input, one per line\n";
+        return 2;
+    }
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(options.path) >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long\n";
+        return 2;
+    }
+    std::strcpy(addr.sun_path, options.path);
+    const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 ||
+        connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+        std::cerr << "Cannot connect to " << options.path << ": "
+                  << std::strerror(errno) << '\n';
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    Window window(options.depth);
+    std::uint64_t requestsSent = 0;
+    std::thread sender(
+        [&]() { requestsSent = sendRequests(fd, options, window); });
+
+    // Receive responses while requests are still being sent
+    std::uint64_t expectedId = 0, reports = 0, errors = 0;
+    bool protocolError = false;
+    std::string frame, data;
+    while (protocol::readFrame(fd, frame)) {
+        window.release();
+        Decoder d(frame);
+        const auto id = d.readUnsigned();
+        const auto count = d.readUnsigned();
+        if (d.failed() || id != expectedId++) {
+            protocolError = true;
+            break;
+        }
+        for (auto i = 0u; i < count; i++) {
+            d(data);
+            const auto simple = deserialize(data);
+            if (d.failed() || !simple.has_value()) {
+                protocolError = true;
+                break;
+            }
+            reports++;
+            if (simple->report.error != Report::Error::NO_ERROR) errors++;
+            if (!options.quiet) {
+                std::cout << simple->station.icaoCode << '\t'
+                          << toStr(simple->report.type) << '\t'
+                          << static_cast<int>(simple->report.error) << '\t'
+                          << simple->report.warnings.size() << '\n';
+            }
+        }
+        if (protocolError) break;
+    }
+    // Unblock sender if it waits for a response which will never arrive
+    shutdown(fd, SHUT_RDWR);
+    for (auto i = 0u; i < options.depth; i++) window.release();
+    sender.join();
+    close(fd);
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cerr << reports << " reports (" << errors << " with errors) in "
+              << elapsed.count() << " s\n";
+    if (protocolError || expectedId != requestsSent) {
+        std::cerr << "Protocol error or connection closed by server\n";
+        return 1;
+    }
+    return 0;
+}
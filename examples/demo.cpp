@@ -1799,8 +1799,7 @@ std::string toStr(const Forecast & forecast) {
     return result.str();
 }
 
-std::string demo(const std::string& report) {
-    const auto simple = simplify(report);
+std::string demo(const std::string& report, const Simple& simple) {
     std::ostringstream result;
     result << newReport;
 
@@ -1827,6 +1826,10 @@ std::string demo(const std::string& report) {
     return result.str();
 }
 
+std::string demo(const std::string& report) {
+    return demo(report, simplify(report));
+}
+
 #ifdef __EMSCRIPTEN__
 
 #include <emscripten/bind.h>
@@ -1834,7 +1837,7 @@ std::string demo(const std::string& report) {
 using namespace emscripten;
 
 EMSCRIPTEN_BINDINGS(WasmDemo) {
-    function("demo", &demo);
+    function("demo", select_overload<std::string(const std::string&)>(&demo));
 }
 
 /*
@@ -1847,17 +1850,484 @@ int main(int argc, char** argv) {
 */
 #else
 
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "metafsimple_flat.hpp"
+
+// Command-line tool: simplifies reports from files, directories or standard
+// input (one report per line) using multiple threads
+
+enum class OutputFormat { TEXT, JSONL, CSV, BINARY };
+
+struct Options {
+    OutputFormat format = OutputFormat::TEXT;
+    unsigned int jobs = 1;
+    StationFilter filter;
+    bool stats = false;
+    std::vector<std::string> inputs;
+};
+
+// Processing stages, used for timing statistics
+enum Stage { READ, TRIAGE, PARSE, COLLATE, FORMAT, WRITE, STAGE_COUNT };
+
+static const char* const stageNames[STAGE_COUNT] = {
+    "read", "triage", "parse", "collate", "format", "write"};
+
+struct Stats {
+    std::size_t reports = 0;
+    std::size_t filtered = 0;
+    std::size_t errors = 0;
+    std::size_t warnings = 0;
+    std::chrono::steady_clock::duration stageTime[STAGE_COUNT] = {};
+
+    Stats& operator+=(const Stats& s) {
+        reports += s.reports;
+        filtered += s.filtered;
+        errors += s.errors;
+        warnings += s.warnings;
+        for (auto i = 0; i < STAGE_COUNT; i++) stageTime[i] += s.stageTime[i];
+        return *this;
+    }
+};
+
+// Integer fields of the flat record in output order for JSONL and CSV
+static const std::pair<const char*, int32_t metafsimple_record::*>
+    recordFields[] = {
+        {"report_day", &metafsimple_record::report_day},
+        {"report_hour", &metafsimple_record::report_hour},
+        {"report_minute", &metafsimple_record::report_minute},
+        {"applicable_from_day", &metafsimple_record::applicable_from_day},
+        {"applicable_from_hour", &metafsimple_record::applicable_from_hour},
+        {"applicable_until_day", &metafsimple_record::applicable_until_day},
+        {"applicable_until_hour", &metafsimple_record::applicable_until_hour},
+        {"wind_direction_deg", &metafsimple_record::wind_direction_deg},
+        {"wind_var_from_deg", &metafsimple_record::wind_var_from_deg},
+        {"wind_var_to_deg", &metafsimple_record::wind_var_to_deg},
+        {"wind_speed_kt", &metafsimple_record::wind_speed_kt},
+        {"gust_speed_kt", &metafsimple_record::gust_speed_kt},
+        {"visibility_m", &metafsimple_record::visibility_m},
+        {"ceiling_ft", &metafsimple_record::ceiling_ft},
+        {"vertical_visibility_ft", &metafsimple_record::vertical_visibility_ft},
+        {"sky_condition", &metafsimple_record::sky_condition},
+        {"temperature_tenth_c", &metafsimple_record::temperature_tenth_c},
+        {"dew_point_tenth_c", &metafsimple_record::dew_point_tenth_c},
+        {"relative_humidity", &metafsimple_record::relative_humidity},
+        {"pressure_tenth_hpa", &metafsimple_record::pressure_tenth_hpa}};
+
+std::string_view reportTypeName(int32_t type) {
+    switch (type) {
+        case METAFSIMPLE_REPORT_METAR:
+            return "METAR";
+        case METAFSIMPLE_REPORT_SPECI:
+            return "SPECI";
+        case METAFSIMPLE_REPORT_TAF:
+            return "TAF";
+        default:
+            return "ERROR";
+    }
+}
+
+void appendJsonString(std::string& out, std::string_view s) {
+    out += '\"';
+    for (const auto c : s) {
+        switch (c) {
+            case '\"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += ' ';
+                    break;
+                }
+                out += c;
+        }
+    }
+    out += '\"';
+}
+
+void appendCsvString(std::string& out, std::string_view s) {
+    out += '\"';
+    for (const auto c : s) {
+        if (c == '\"') out += '\"';
+        out += c;
+    }
+    out += '\"';
+}
+
+void formatJsonl(std::string& out,
+                 const std::string& report,
+                 const metafsimple_record& r) {
+    out += "{\"icao\":";
+    appendJsonString(out, r.icao);
+    out += ",\"type\":\"";
+    out += reportTypeName(r.report_type);
+    out += "\",\"error\":" + std::to_string(r.error);
+    out += ",\"flags\":" + std::to_string(r.flags);
+    for (const auto& f : recordFields) {
+        out += ",\"";
+        out += f.first;
+        out += "\":";
+        const auto value = r.*f.second;
+        out += (value == METAFSIMPLE_NO_VALUE) ? "null"s
+                                               : std::to_string(value);
+    }
+    out += ",\"precipitation_mask\":" + std::to_string(r.precipitation_mask);
+    out += ",\"weather_mask\":" + std::to_string(r.weather_mask);
+    out += ",\"trends\":" + std::to_string(r.trend_count);
+    out += ",\"warnings\":" + std::to_string(r.warning_count);
+    out += ",\"report\":";
+    appendJsonString(out, report);
+    out += "}\n";
+}
+
+std::string csvHeader() {
+    std::string header = "icao,type,error,flags";
+    for (const auto& f : recordFields) {
+        header += ',';
+        header += f.first;
+    }
+    header += ",precipitation_mask,weather_mask,trends,warnings,report\n";
+    return header;
+}
+
+void formatCsv(std::string& out,
+               const std::string& report,
+               const metafsimple_record& r) {
+    out += r.icao;
+    out += ',';
+    out += reportTypeName(r.report_type);
+    out += ',' + std::to_string(r.error) + ',' + std::to_string(r.flags);
+    for (const auto& f : recordFields) {
+        out += ',';
+        const auto value = r.*f.second;
+        if (value != METAFSIMPLE_NO_VALUE) out += std::to_string(value);
+    }
+    out += ',' + std::to_string(r.precipitation_mask);
+    out += ',' + std::to_string(r.weather_mask);
+    out += ',' + std::to_string(r.trend_count);
+    out += ',' + std::to_string(r.warning_count) + ',';
+    appendCsvString(out, report);
+    out += '\n';
+}
+
+// Simplify report and append formatted result to output
+void process(const std::string& report,
+             const Options& options,
+             std::string& out,
+             Stats& stats) {
+    using clock = std::chrono::steady_clock;
+    auto t = clock::now();
+    const auto elapsed = [&t](std::chrono::steady_clock::duration& d) {
+        const auto now = clock::now();
+        d += now - t;
+        t = now;
+    };
+
+    if (!options.filter.empty()) {
+        const auto icao = triage(report).icaoCode;
+        elapsed(stats.stageTime[TRIAGE]);
+        if (icao.empty() || !options.filter.allows(icao)) {
+            stats.filtered++;
+            return;
+        }
+    }
+    const auto parseResult = metaf::Parser::parse(report);
+    elapsed(stats.stageTime[PARSE]);
+    const auto simple = simplify(parseResult);
+    elapsed(stats.stageTime[COLLATE]);
+
+    stats.reports++;
+    if (simple.report.error != Report::Error::NO_ERROR) stats.errors++;
+    stats.warnings += simple.report.warnings.size();
+
+    metafsimple_record record;
+    switch (options.format) {
+        case OutputFormat::TEXT:
+            out += demo(report, simple);
+            break;
+        case OutputFormat::JSONL:
+            flatten(simple, record);
+            formatJsonl(out, report, record);
+            break;
+        case OutputFormat::CSV:
+            flatten(simple, record);
+            formatCsv(out, report, record);
+            break;
+        case OutputFormat::BINARY:
+            flatten(simple, record);
+            out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+            break;
+    }
+    elapsed(stats.stageTime[FORMAT]);
+}
+
+// Reads lines from the list of files in order, or from standard input if the
+// list is empty; empty lines are skipped
+class LineReader {
+   public:
+    LineReader(const std::vector<std::string>& files) : files(files) {}
+    // Reads up to count lines; returns false if no lines left
+    bool read(std::vector<std::string>& lines, std::size_t count);
+    bool failed() const { return error; }
+
+   private:
+    const std::vector<std::string>& files;
+    std::size_t nextFile = 0;
+    std::ifstream file;
+    bool error = false;
+
+    std::istream* stream();
+};
+
+std::istream* LineReader::stream() {
+    if (files.empty()) return std::cin ? &std::cin : nullptr;
+    while (!file.is_open() || !file) {
+        if (nextFile >= files.size()) return nullptr;
+        file = std::ifstream(files[nextFile]);
+        if (!file) {
+            std::cerr << "Cannot open " << files[nextFile] << newLine;
+            error = true;
+        }
+        nextFile++;
+    }
+    return &file;
+}
+
+bool LineReader::read(std::vector<std::string>& lines, std::size_t count) {
+    lines.clear();
+    std::string line;
+    while (lines.size() < count) {
+        auto s = stream();
+        if (!s) break;
+        if (!std::getline(*s, line)) continue;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos) continue;
+        lines.push_back(std::move(line));
+    }
+    return !lines.empty();
+}
+
+// Adds path to file list; directories are expanded recursively in name order
+bool addInput(const std::string& path, std::vector<std::string>& files) {
+    struct stat st;
+    if (stat(path.c_str(), &st)) {
+        std::cerr << "Cannot access " << path << newLine;
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return true;
+    }
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        std::cerr << "Cannot open directory " << path << newLine;
+        return false;
+    }
+    std::vector<std::string> entries;
+    while (const auto entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        entries.push_back(path + '/' + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    bool result = true;
+    for (const auto& e : entries) result = addInput(e, files) && result;
+    return result;
+}
+
+void usage(const char* name) {
+    std::cerr
+        << "Usage: " << name << " [options] [file|directory ...]\n"
+        << "Simplifies METAR, SPECI and TAF reports, one report per line.\n"
+        << "Reads standard input if no files or directories are specified.\n"
+        << "Options:\n"
+        << "  -f, --format FORMAT     output format: text (default), jsonl,\n"
+        << "                          csv or binary (metafsimple_record)\n"
+        << "  -j, --jobs N            number of worker threads\n"
+        << "  -s, --stations CODES    only process reports from stations in\n"
+        << "                          comma-separated list of ICAO codes\n"
+        << "      --stats             print statistics to standard error\n"
+        << "  -h, --help              print this message\n";
+}
+
+bool parseStations(std::string_view list, StationFilter& filter) {
+    while (!list.empty()) {
+        const auto end = std::min(list.find(','), list.length());
+        const auto code = IcaoCode(list.substr(0, end));
+        if (code.empty()) return false;
+        filter.add(code);
+        list.remove_prefix(std::min(end + 1, list.length()));
+    }
+    return true;
+}
+
+// Returns 0 if options are parsed, -1 if the program should exit with no
+// error, or exit code otherwise
+int parseOptions(int argc, char** argv, Options& options) {
+    options.jobs = std::max(std::thread::hardware_concurrency(), 1u);
+    bool inputError = false;
+    for (auto i = 1; i < argc; i++) {
+        const std::string_view arg(argv[i]);
+        const bool hasValue = (i + 1 < argc);
+        if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return -1;
+        }
+        if (arg == "--stats") {
+            options.stats = true;
+            continue;
+        }
+        if ((arg == "-f" || arg == "--format") && hasValue) {
+            const std::string_view f(argv[++i]);
+            if (f == "text") {
+                options.format = OutputFormat::TEXT;
+            } else if (f == "jsonl") {
+                options.format = OutputFormat::JSONL;
+            } else if (f == "csv") {
+                options.format = OutputFormat::CSV;
+            } else if (f == "binary") {
+                options.format = OutputFormat::BINARY;
+            } else {
+                std::cerr << "Unknown output format: " << f << newLine;
+                return 2;
+            }
+            continue;
+        }
+        if ((arg == "-j" || arg == "--jobs") && hasValue) {
+            const auto jobs = std::atoi(argv[++i]);
+            if (jobs < 1) {
+                std::cerr << "Invalid number of jobs: " << argv[i] << newLine;
+                return 2;
+            }
+            options.jobs = jobs;
+            continue;
+        }
+        if ((arg == "-s" || arg == "--stations") && hasValue) {
+            if (!parseStations(argv[++i], options.filter)) {
+                std::cerr << "Invalid station list: " << argv[i] << newLine;
+                return 2;
+            }
+            continue;
+        }
+        if (arg.length() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown or incomplete option: " << arg << newLine;
+            usage(argv[0]);
+            return 2;
+        }
+        if (!addInput(argv[i], options.inputs)) inputError = true;
+    }
+    if (inputError) return 2;
+    return 0;
+}
+
+void printStats(const Stats& stats, std::chrono::steady_clock::duration total) {
+    using seconds = std::chrono::duration<double>;
+    const auto totalSeconds =
+        std::chrono::duration_cast<seconds>(total).count();
+    const auto rate = totalSeconds ? stats.reports / totalSeconds : 0.0;
+    std::cerr << "Reports: " << stats.reports << " (" << rate << " per second)"
+              << newLine;
+    std::cerr << "Filtered out: " << stats.filtered << newLine;
+    std::cerr << "Reports with errors: " << stats.errors << newLine;
+    std::cerr << "Warnings: " << stats.warnings << newLine;
+    std::cerr << "Elapsed time: " << totalSeconds << " s" << newLine;
+    std::cerr << "Time per stage (summed over threads):" << newLine;
+    for (auto i = 0; i < STAGE_COUNT; i++) {
+        std::cerr << newItem << stageNames[i] << ": "
+                  << std::chrono::duration_cast<seconds>(stats.stageTime[i])
+                         .count()
+                  << " s" << newLine;
+    }
+}
+
 int main(int argc, char** argv) {
-    (void)argc;
-    (void)argv;
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    std::ios_base::sync_with_stdio(false);
+
+    Options options;
+    if (const auto exitCode = parseOptions(argc, argv, options))
+        return (exitCode < 0) ? 0 : exitCode;
+
+    // Lines are processed in chunks; each thread takes blocks of lines from
+    // the chunk and results are written in input order
+    static const std::size_t chunkSize = 16384;
+    static const std::size_t blockSize = 64;
+
+    Stats stats;
+    std::vector<Stats> threadStats(options.jobs);
+    std::vector<std::string> lines;
+    std::vector<std::string> blockOutput;
+    LineReader reader(options.inputs);
+    if (options.format == OutputFormat::CSV) std::cout << csvHeader();
+
     try {
-        for (std::string report; std::getline(std::cin, report);) {
-            demo(report);
-        }
+        for (;;) {
+            auto t = clock::now();
+            if (!reader.read(lines, chunkSize)) break;
+            stats.stageTime[READ] += clock::now() - t;
+
+            const auto blocks = (lines.size() + blockSize - 1) / blockSize;
+            blockOutput.assign(blocks, std::string());
+            std::atomic<std::size_t> nextBlock(0);
+            const auto threadCount =
+                std::min<std::size_t>(options.jobs, blocks);
+            // Exception must not leave a thread; it is rethrown after all
+            // threads are joined
+            std::vector<std::exception_ptr> errors(threadCount);
+            const auto worker = [&](std::size_t n) {
+                try {
+                    for (auto b = nextBlock++; b < blocks; b = nextBlock++) {
+                        const auto end =
+                            std::min((b + 1) * blockSize, lines.size());
+                        for (auto i = b * blockSize; i < end; i++)
+                            process(lines[i],
+                                    options,
+                                    blockOutput[b],
+                                    threadStats[n]);
+                    }
+                } catch (...) {
+                    errors[n] = std::current_exception();
+                    nextBlock = blocks;  // Other threads stop early
+                }
+            };
+            std::vector<std::thread> threads;
+            for (std::size_t i = 1; i < threadCount; i++)
+                threads.emplace_back(worker, i);
+            worker(0);
+            for (auto& th : threads) th.join();
+            for (const auto& e : errors)
+                if (e) std::rethrow_exception(e);
+
+            t = clock::now();
+            for (const auto& o : blockOutput)
+                std::cout.write(o.data(), o.size());
+            stats.stageTime[WRITE] += clock::now() - t;
+        }
+        std::cout.flush();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << newLine;
+        return 1;
     } catch (...) {
         return 1;
     }
+
+    for (const auto& s : threadStats) stats += s;
+    if (options.stats) printStats(stats, clock::now() - start);
+    if (!std::cout || reader.failed()) return 1;
     return 0;
 }
 
-#endif  // #ifdef __EMSCRIPTEN__
\ No newline at end of file
+#endif  // #ifdef __EMSCRIPTEN__
@@ -0,0 +1,233 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+// Long-running simplification service: accepts batches of raw reports over
+// Unix domain socket and returns serialized simplified reports (see
+// server_protocol.hpp). Connections are served by a fixed pool of worker
+// threads, one connection per worker at a time; each connection keeps its
+// buffers between requests. Connections which do not fit in the pool wait in
+// a queue of limited length and are refused when it is full.
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_serialize.hpp"
+#include "server_protocol.hpp"
+
+using namespace metafsimple;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+extern "C" void onStopSignal(int) { stopRequested = 1; }
+
+// Per-connection state reused between requests
+class Connection {
+   public:
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+    void serve();
+
+   private:
+    int fd;
+    std::string request;
+    std::string response;
+    std::string report;
+    std::string result;
+
+    bool process();
+};
+
+void Connection::serve() {
+    while (protocol::readFrame(fd, request)) {
+        if (!process()) {
+            std::cerr << "Malformed request, closing connection\n";
+            return;
+        }
+        if (!protocol::writeFrame(fd, response)) return;
+    }
+}
+
+// Worker threads which serve accepted connections
+class ConnectionPool {
+   public:
+    ConnectionPool(unsigned int workers, std::size_t maxQueued);
+    ~ConnectionPool() { stop(); }
+    // Takes ownership of socket; returns false and closes it if the queue
+    // is full
+    bool submit(int fd);
+    // Close queued connections, shut down connections being served and
+    // wait for the workers to finish
+    void stop();
+
+   private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::deque<int> queued;
+    std::set<int> active;
+    std::size_t maxQueued;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    void run();
+};
+
+ConnectionPool::ConnectionPool(unsigned int workers, std::size_t maxQueued)
+    : maxQueued(maxQueued) {
+    for (auto i = 0u; i < workers; i++)
+        threads.emplace_back([this]() { run(); });
+}
+
+bool ConnectionPool::submit(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stopping && queued.size() < maxQueued) {
+            queued.push_back(fd);
+            notEmpty.notify_one();
+            return true;
+        }
+    }
+    close(fd);
+    return false;
+}
+
+void ConnectionPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        stopping = true;
+        for (const auto fd : queued) close(fd);
+        queued.clear();
+        // Blocked reads return and connections are closed by their workers
+        for (const auto fd : active) shutdown(fd, SHUT_RDWR);
+    }
+    notEmpty.notify_all();
+    for (auto &t : threads) t.join();
+}
+
+void ConnectionPool::run() {
+    for (;;) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [&]() { return stopping || !queued.empty(); });
+            if (stopping) return;
+            fd = queued.front();
+            queued.pop_front();
+            active.insert(fd);
+        }
+        Connection connection(fd);
+        try {
+            connection.serve();
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
+        }
+        // Removed before the socket is closed, so that stop() never shuts
+        // down a descriptor reused by another connection
+        std::lock_guard<std::mutex> lock(mutex);
+        active.erase(fd);
+    }
+}
+
+bool Connection::process() {
+    Decoder d(request);
+    const auto id = d.readUnsigned();
+    const auto count = d.readUnsigned();
+    if (d.failed() || count > request.size()) return false;
+
+    protocol::beginFrame(response);
+    Encoder e(response);
+    e.writeUnsigned(id);
+    e.writeUnsigned(count);
+    for (auto i = 0u; i < count; i++) {
+        d(report);
+        if (d.failed()) return false;
+        result.clear();
+        serialize(simplify(report), result);
+        e(result);
+    }
+    return d.finished();
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " SOCKET_PATH\n";
+        return 2;
+    }
+    const char *path = argv[1];
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long\n";
+        return 2;
+    }
+    std::strcpy(addr.sun_path, path);
+
+    const auto listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Cannot create socket: " << std::strerror(errno) << '\n';
+        return 1;
+    }
+    unlink(path);
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+        listen(listenFd, SOMAXCONN)) {
+        std::cerr << "Cannot listen on " << path << ": "
+                  << std::strerror(errno) << '\n';
+        close(listenFd);
+        return 1;
+    }
+
+    // Signals interrupt accept() so that socket file can be removed on exit
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Workers inherit blocked signals, so that the signals are delivered to
+    // the main thread and interrupt accept()
+    sigset_t stopSignals, previous;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &previous);
+    static const std::size_t maxQueued = 64;
+    ConnectionPool pool(std::max(std::thread::hardware_concurrency(), 1u),
+                        maxQueued);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    while (!stopRequested) {
+        const auto fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "accept() failed: " << std::strerror(errno) << '\n';
+            break;
+        }
+        if (!pool.submit(fd))
+            std::cerr << "Too many connections, connection refused\n";
+    }
+    close(listenFd);
+    pool.stop();
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+// Protocol shared by metafsimple-server and metafsimple-client.
+//
+// Messages are sent over Unix domain stream socket as frames: 4-byte
+// little-endian payload length followed by payload. Payload is encoded with
+// metafsimple::Encoder.
+//
+// Request: request id, report count, raw reports (strings).
+// Response: request id, result count, serialized metafsimple::Simple for each
+// report in request order (strings, see metafsimple::serialize()).
+//
+// Client may send further requests before receiving responses to previous
+// ones; server responds to requests of each connection in the order they were
+// received, request id allows client to match responses to requests.
+
+#ifndef METAFSIMPLE_SERVER_PROTOCOL_HPP
+#define METAFSIMPLE_SERVER_PROTOCOL_HPP
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "metafsimple_serialize.hpp"
+
+namespace protocol {
+
+// Frames larger than this are treated as protocol error
+static const std::uint32_t maxFrameSize = 64 * 1024 * 1024;
+
+inline bool readAll(int fd, char *data, std::size_t size) {
+    while (size) {
+        const auto r = ::read(fd, data, size);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        data += r;
+        size -= r;
+    }
+    return true;
+}
+
+inline bool writeAll(int fd, const char *data, std::size_t size) {
+    while (size) {
+        const auto w = ::write(fd, data, size);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        data += w;
+        size -= w;
+    }
+    return true;
+}
+
+// Reads frame payload; returns false on end of stream or error
+inline bool readFrame(int fd, std::string &payload) {
+    unsigned char header[4];
+    if (!readAll(fd, reinterpret_cast<char *>(header), sizeof(header)))
+        return false;
+    const std::uint32_t size = header[0] | (header[1] << 8) |
+                               (header[2] << 16) |
+                               (static_cast<std::uint32_t>(header[3]) << 24);
+    if (size > maxFrameSize) return false;
+    payload.resize(size);
+    return readAll(fd, payload.data(), size);
+}
+
+// Writes frame; frame header is prepended to payload at offset 0, so payload
+// must be built starting from offset 4 (see beginFrame())
+inline bool writeFrame(int fd, std::string &frame) {
+    const auto size = frame.size() - 4;
+    if (size > maxFrameSize) return false;
+    frame[0] = static_cast<char>(size & 0xFF);
+    frame[1] = static_cast<char>((size >> 8) & 0xFF);
+    frame[2] = static_cast<char>((size >> 16) & 0xFF);
+    frame[3] = static_cast<char>((size >> 24) & 0xFF);
+    return writeAll(fd, frame.data(), frame.size());
+}
+
+// Clears buffer and reserves space for frame header
+inline void beginFrame(std::string &frame) { frame.assign(4, '\0'); }
+
+}  // namespace protocol
+
+#endif  // #ifndef METAFSIMPLE_SERVER_PROTOCOL_HPP
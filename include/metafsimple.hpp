@@ -9,9 +9,15 @@
 #ifndef METAFSIMPLE_HPP
 #define METAFSIMPLE_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <optional>
 #include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
 #include "metaf.hpp"
@@ -61,6 +67,56 @@ struct Runway {
     Designator designator;
 };
 
+// ICAO location code packed into 32-bit value, one character per byte with
+// the first character in the most significant byte, so that the packed codes
+// are ordered the same way as code strings; empty if code is not 4 characters
+class IcaoCode {
+   public:
+    constexpr IcaoCode() = default;
+    constexpr explicit IcaoCode(std::string_view code) : value(pack(code)) {}
+    static constexpr IcaoCode fromPacked(std::uint32_t p) {
+        IcaoCode result;
+        result.value = p;
+        return result;
+    }
+    constexpr std::uint32_t packed() const { return value; }
+    constexpr bool empty() const { return !value; }
+    inline std::string toString() const;
+
+   private:
+    static constexpr std::uint32_t pack(std::string_view code) {
+        if (code.length() != 4) return 0;
+        std::uint32_t result = 0;
+        for (const auto c : code) {
+            if (!c) return 0;
+            result = (result << 8) | static_cast<unsigned char>(c);
+        }
+        return result;
+    }
+    std::uint32_t value = 0;
+};
+
+}  // namespace metafsimple
+
+// Needed to use IcaoCode as a key in unordered containers; 32-bit finalizer of
+// MurmurHash3 spreads the packed characters over all bits of the hash value
+namespace std {
+template <>
+struct hash<metafsimple::IcaoCode> {
+    size_t operator()(metafsimple::IcaoCode c) const noexcept {
+        uint32_t h = c.packed();
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+};
+}  // namespace std
+
+namespace metafsimple {
+
 // Day-hour-minute time; day is optional
 struct Time {
     std::optional<int> day;
@@ -407,6 +463,23 @@ struct Essentials {
         CLOUDS,
         OBSCURED
     };
+    // Flight category by visibility and ceiling
+    enum class FlightCategory {
+        UNKNOWN,
+        VFR,   // Ceiling above 3000 ft and visibility above 5 SM
+        MVFR,  // Ceiling 1000 to 3000 ft and/or visibility 3 to 5 SM
+        IFR,   // Ceiling 500 to 999 ft and/or visibility 1 to below 3 SM
+        LIFR   // Ceiling below 500 ft and/or visibility below 1 SM
+    };
+    // Hazards included in summary
+    enum class Hazard {
+        THUNDERSTORM,
+        FREEZING_PRECIPITATION,
+        CONVECTIVE_CLOUD,  // Cumulonimbus or towering cumulus
+        WIND_SHEAR,
+        LOW_VISIBILITY,  // Below 1 SM
+        HEAVY_PRECIPITATION
+    };
     std::optional<int> windDirectionDegrees;
     bool windDirectionVariable = false;
     std::optional<int> windDirectionVarFromDegrees;
@@ -422,6 +495,26 @@ struct Essentials {
     std::vector<Weather> weather;
     Pressure seaLevelPressure;
     std::vector<WindShear> windShear;
+    // Flight category and hazards as a bitmask of summaryBit() values, so
+    // that reports can be filtered with a single test, e.g. summary & mask
+    // where mask is summaryBit(FlightCategory::IFR) |
+    // summaryBit(FlightCategory::LIFR) | summaryBit(Hazard::THUNDERSTORM);
+    // set when the report is collated, not compared by equality
+    std::uint32_t summary = 0;
+    inline Height ceilingHeight() const;
+    // Summary computed from the data above
+    inline std::uint32_t computeSummary() const;
+    inline FlightCategory flightCategory() const;
+    bool hasHazard(Hazard h) const { return summary & summaryBit(h); }
+    // Flight category bits are mutually exclusive; UNKNOWN has no bit
+    static constexpr std::uint32_t summaryBit(FlightCategory c) {
+        return c == FlightCategory::UNKNOWN
+                   ? 0
+                   : 1u << (static_cast<int>(c) - 1);
+    }
+    static constexpr std::uint32_t summaryBit(Hazard h) {
+        return 1u << (static_cast<int>(h) + 8);
+    }
 };
 
 // Icing forecast including severity, type and height range where icing occurs
@@ -595,6 +688,9 @@ struct Station {
     std::set<Runway> runwaysNoVisData;
     std::set<CardinalDirection> directionsNoCeilingData;
     std::set<CardinalDirection> directionsNoVisData;
+    // Packed station code; packing is a few shifts and does not allocate.
+    // Empty code if icaoCode is not a 4-character code.
+    IcaoCode icao() const { return IcaoCode(icaoCode); }
 };
 
 // Aerodrome-related info, colour code, runway and directional visibility,
@@ -847,12 +943,68 @@ struct Simple {
     Forecast forecast;
 };
 
+// Report header info obtained without parsing and collating the report body:
+// report type, header syntax error, station ICAO code, report release time
+// and correctional/amended flags
+struct Triage {
+    Report::Type type = Report::Type::ERROR;
+    Report::Error error = Report::Error::NO_REPORT_PARSED;
+    IcaoCode icaoCode;
+    Time reportTime;
+    bool correctional = false;
+    bool amended = false;
+};
+
+// Allow-list of stations used to drop reports from the stations which are not
+// of interest before parsing report body; empty filter allows all stations
+class StationFilter {
+   public:
+    StationFilter() = default;
+    StationFilter(std::initializer_list<IcaoCode> icaoCodes)
+        : stations(icaoCodes) {}
+    void add(IcaoCode icaoCode) { stations.insert(icaoCode); }
+    bool empty() const { return stations.empty(); }
+    bool allows(IcaoCode icaoCode) const {
+        return (stations.empty() || stations.count(icaoCode));
+    }
+
+   private:
+    std::unordered_set<IcaoCode> stations;
+};
+
 // Needed to use std::set<Runway>
 inline bool operator<(const Runway &l, const Runway &r) {
     return ((l.number * 10 + static_cast<int>(l.designator)) <
             (r.number * 10 + static_cast<int>(r.designator)));
 }
 
+constexpr bool operator==(IcaoCode l, IcaoCode r) {
+    return (l.packed() == r.packed());
+}
+constexpr bool operator!=(IcaoCode l, IcaoCode r) {
+    return (l.packed() != r.packed());
+}
+constexpr bool operator<(IcaoCode l, IcaoCode r) {
+    return (l.packed() < r.packed());
+}
+constexpr bool operator>(IcaoCode l, IcaoCode r) {
+    return (l.packed() > r.packed());
+}
+constexpr bool operator<=(IcaoCode l, IcaoCode r) {
+    return (l.packed() <= r.packed());
+}
+constexpr bool operator>=(IcaoCode l, IcaoCode r) {
+    return (l.packed() >= r.packed());
+}
+
+std::string IcaoCode::toString() const {
+    if (empty()) return std::string();
+    return std::string{static_cast<char>(value >> 24),
+                       static_cast<char>((value >> 16) & 0xFF),
+                       static_cast<char>((value >> 8) & 0xFF),
+                       static_cast<char>(value & 0xFF)};
+}
+
 std::optional<double> Temperature::toUnit(Unit u) const {
     const auto convertC = [](Unit uu, double c) {
         switch (uu) {
@@ -1091,6 +1243,111 @@ CardinalDirection directionToCardinal(std::optional<int> degrees) {
     return CardinalDirection::N;
 }
 
+Height Essentials::ceilingHeight() const {
+    // Ceiling is the lowest broken or overcast layer or vertical visibility
+    Height result = verticalVisibility;
+    for (const auto &cl : cloudLayers) {
+        if (cl.amount != CloudLayer::Amount::BROKEN &&
+            cl.amount != CloudLayer::Amount::OVERCAST &&
+            cl.amount != CloudLayer::Amount::VARIABLE_BROKEN_OVERCAST)
+            continue;
+        const auto h = cl.height.toUnit(Height::Unit::FEET);
+        if (!h.has_value()) continue;
+        const auto r = result.toUnit(Height::Unit::FEET);
+        if (!r.has_value() || *h < *r) result = cl.height;
+    }
+    return result;
+}
+
+std::uint32_t Essentials::computeSummary() const {
+    static const auto unknown = FlightCategory::UNKNOWN;
+    auto visibilityCategory = unknown;
+    const auto vis = visibility.toUnit(Distance::Unit::STATUTE_MILES);
+    if (cavok) visibilityCategory = FlightCategory::VFR;
+    if (vis.has_value()) {
+        visibilityCategory = FlightCategory::VFR;
+        if (*vis <= 5) visibilityCategory = FlightCategory::MVFR;
+        if (*vis < 3) visibilityCategory = FlightCategory::IFR;
+        if (*vis < 1) visibilityCategory = FlightCategory::LIFR;
+    }
+
+    // No ceiling if sky condition is known and there are no broken or
+    // overcast layers (e.g. FEW or SCT only, CLR, NSC, CAVOK)
+    auto ceilingCategory = unknown;
+    const auto ceiling = ceilingHeight().toUnit(Height::Unit::FEET);
+    if (ceiling.has_value()) {
+        ceilingCategory = FlightCategory::VFR;
+        if (*ceiling <= 3000) ceilingCategory = FlightCategory::MVFR;
+        if (*ceiling < 1000) ceilingCategory = FlightCategory::IFR;
+        if (*ceiling < 500) ceilingCategory = FlightCategory::LIFR;
+    } else if (skyCondition != SkyCondition::UNKNOWN &&
+               skyCondition != SkyCondition::OBSCURED) {
+        const auto isCeiling = [](const CloudLayer &cl) {
+            return cl.amount == CloudLayer::Amount::BROKEN ||
+                   cl.amount == CloudLayer::Amount::OVERCAST ||
+                   cl.amount == CloudLayer::Amount::VARIABLE_BROKEN_OVERCAST;
+        };
+        if (std::none_of(cloudLayers.begin(), cloudLayers.end(), isCeiling))
+            ceilingCategory = FlightCategory::VFR;
+    }
+
+    // If only one of visibility and ceiling is known, it determines the
+    // category unless it is VFR, in which case the category is not known
+    auto category = std::max(visibilityCategory, ceilingCategory);
+    if ((visibilityCategory == unknown || ceilingCategory == unknown) &&
+        category == FlightCategory::VFR)
+        category = unknown;
+    auto result = summaryBit(category);
+
+    for (const auto &w : weather) {
+        switch (w.phenomena) {
+            case Weather::Phenomena::THUNDERSTORM:
+            case Weather::Phenomena::THUNDERSTORM_PRECIPITATION_LIGHT:
+            case Weather::Phenomena::THUNDERSTORM_PRECIPITATION_MODERATE:
+                result |= summaryBit(Hazard::THUNDERSTORM);
+                break;
+            case Weather::Phenomena::THUNDERSTORM_PRECIPITATION_HEAVY:
+                result |= summaryBit(Hazard::THUNDERSTORM) |
+                          summaryBit(Hazard::HEAVY_PRECIPITATION);
+                break;
+            case Weather::Phenomena::FREEZING_PRECIPITATION_LIGHT:
+            case Weather::Phenomena::FREEZING_PRECIPITATION_MODERATE:
+                result |= summaryBit(Hazard::FREEZING_PRECIPITATION);
+                break;
+            case Weather::Phenomena::FREEZING_PRECIPITATION_HEAVY:
+                result |= summaryBit(Hazard::FREEZING_PRECIPITATION) |
+                          summaryBit(Hazard::HEAVY_PRECIPITATION);
+                break;
+            case Weather::Phenomena::PRECIPITATION_HEAVY:
+            case Weather::Phenomena::SHOWERY_PRECIPITATION_HEAVY:
+                result |= summaryBit(Hazard::HEAVY_PRECIPITATION);
+                break;
+            default:
+                break;
+        }
+    }
+    for (const auto &cl : cloudLayers) {
+        if (cl.details == CloudLayer::Details::CUMULONIMBUS ||
+            cl.details == CloudLayer::Details::TOWERING_CUMULUS)
+            result |= summaryBit(Hazard::CONVECTIVE_CLOUD);
+    }
+    if (!windShear.empty()) result |= summaryBit(Hazard::WIND_SHEAR);
+    if (vis.has_value() && *vis < 1)
+        result |= summaryBit(Hazard::LOW_VISIBILITY);
+    return result;
+}
+
+Essentials::FlightCategory Essentials::flightCategory() const {
+    static const FlightCategory categories[] = {FlightCategory::VFR,
+                                                FlightCategory::MVFR,
+                                                FlightCategory::IFR,
+                                                FlightCategory::LIFR};
+    for (const auto c : categories) {
+        if (summary & summaryBit(c)) return c;
+    }
+    return FlightCategory::UNKNOWN;
+}
+
 Aerodrome::BrakingAction Aerodrome::RunwayData::brakingAction() const {
     if (surfaceFrictionUnreliable) return BrakingAction::UNRELIABLE;
     if (!coefficient.has_value()) return BrakingAction::UNKNOWN;
@@ -3914,6 +4171,7 @@ class CollateVisitor : public metaf::Visitor<void> {
    private:
     CollateVisitor() = delete;
     inline void collateMetadata(const metaf::ReportMetadata &metadata);
+    inline void summarize();
     void setGroupString(const std::string &s) { logger.setIdString(s); }
     inline EssentialsAdapter currentOrTrendBlock();
     void startPrevailingTrend() { isPrevailingTrend = true; }
@@ -4042,6 +4300,7 @@ CollateVisitor::CollateVisitor(
         setGroupString(g.rawString);
         visit(g);
     }
+    summarize();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -4064,6 +4323,25 @@ void CollateVisitor::collateMetadata(const metaf::ReportMetadata &md) {
     mda.setApplicableTime(md.timeSpanFrom, md.timeSpanUntil);
 }
 
+void CollateVisitor::summarize() {
+    // Wind shear specified outside of essentials (runway wind shear, WSCONDS)
+    // is included in the summary of current weather or of the forecast
+    static const auto windShear =
+        Essentials::summaryBit(Essentials::Hazard::WIND_SHEAR);
+    auto &current = result.current.weatherData;
+    current.summary = current.computeSummary();
+    for (const auto &r : result.aerodrome.runways) {
+        if (r.windShearLowerLayers) current.summary |= windShear;
+    }
+    auto &prevailing = result.forecast.prevailing;
+    prevailing.summary = prevailing.computeSummary();
+    if (result.forecast.prevailingWsConds) prevailing.summary |= windShear;
+    for (auto &t : result.forecast.trends) {
+        t.forecast.summary = t.forecast.computeSummary();
+        if (t.windShearConditions) t.forecast.summary |= windShear;
+    }
+}
+
 EssentialsAdapter CollateVisitor::currentOrTrendBlock() {
     if (result.forecast.trends.size())
         return EssentialsAdapter(result.forecast.trends.back().forecast,
@@ -4886,6 +5164,184 @@ void CollateVisitor::visitUnknownGroup(const metaf::UnknownGroup &group,
 
 }  // namespace metafsimple::detail
 
+namespace metafsimple::detail {
+
+// Scans report header only (report type, location, report time, time span,
+// COR/AMD/NIL/CNL keywords) and stops before report body; the header syntax
+// follows Metaf parser but the groups are not parsed into Metaf structures
+class HeaderScanner {
+   public:
+    inline HeaderScanner(const std::string &report);
+    const Triage &data() const { return result; }
+
+   private:
+    HeaderScanner() = delete;
+    inline std::string_view nextGroup();
+    inline void scan();
+    inline bool scanKeywords(std::string_view group);
+    inline static bool isLocation(std::string_view group);
+    inline static std::optional<Time> reportTime(std::string_view group);
+    inline static bool isTimeSpan(std::string_view group);
+    inline static std::optional<int> digits(std::string_view s);
+
+    const std::string *report;
+    std::size_t pos = 0;
+    Triage result;
+};
+
+HeaderScanner::HeaderScanner(const std::string &r) : report(&r) { scan(); }
+
+std::string_view HeaderScanner::nextGroup() {
+    static const char delimiters[] = " \t\r\n";
+    const auto begin = report->find_first_not_of(delimiters, pos);
+    if (begin == std::string::npos) {
+        pos = report->length();
+        return std::string_view();
+    }
+    auto end = report->find_first_of(delimiters, begin);
+    if (end == std::string::npos) end = report->length();
+    pos = end;
+    auto group = std::string_view(*report).substr(begin, end - begin);
+    // Report end designator may be appended to the last group
+    const auto reportEnd = group.find('=');
+    if (reportEnd != std::string_view::npos) {
+        pos = report->length();
+        group = group.substr(0, reportEnd);
+    }
+    return group;
+}
+
+void HeaderScanner::scan() {
+    enum class Expect { TYPE_OR_LOCATION, LOCATION, REPORT_TIME, TIME_SPAN };
+    auto expect = Expect::TYPE_OR_LOCATION;
+    auto isTaf = false;
+    auto typeKnown = false;
+    auto error = [this](Report::Error e) {
+        result.type = Report::Type::ERROR;
+        result.error = e;
+    };
+    for (auto group = nextGroup();; group = nextGroup()) {
+        if (group.empty()) {
+            if (expect == Expect::TYPE_OR_LOCATION)
+                return error(Report::Error::EMPTY_REPORT);
+            return error(Report::Error::UNEXPECTED_REPORT_END);
+        }
+        switch (expect) {
+            case Expect::TYPE_OR_LOCATION:
+                if (group == "METAR" || group == "SPECI" || group == "TAF") {
+                    isTaf = (group == "TAF");
+                    typeKnown = true;
+                    result.type = isTaf ? Report::Type::TAF
+                                        : Report::Type::METAR;
+                    if (group == "SPECI") result.type = Report::Type::SPECI;
+                    expect = Expect::LOCATION;
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::LOCATION:
+                if (typeKnown && scanKeywords(group)) {
+                    if (result.amended && !isTaf)
+                        return error(Report::Error::GROUP_NOT_ALLOWED);
+                    break;
+                }
+                if (!isLocation(group))
+                    return error(Report::Error::REPORT_HEADER_FORMAT);
+                result.icaoCode = IcaoCode(group);
+                expect = Expect::REPORT_TIME;
+                break;
+            case Expect::REPORT_TIME:
+                if (const auto t = reportTime(group); t.has_value()) {
+                    result.reportTime = *t;
+                    if (typeKnown && !isTaf) {
+                        result.error = Report::Error::NO_ERROR;
+                        return;
+                    }
+                    // Without report type keyword, TAF is recognised by time
+                    // span following report release time
+                    expect = Expect::TIME_SPAN;
+                    break;
+                }
+                if (group == "NIL") {
+                    if (!typeKnown) result.type = Report::Type::METAR;
+                    result.error = Report::Error::NO_ERROR;
+                    return;
+                }
+                if (isTaf && isTimeSpan(group)) {
+                    result.error = Report::Error::NO_ERROR;
+                    return;
+                }
+                return error(Report::Error::REPORT_HEADER_FORMAT);
+            case Expect::TIME_SPAN:
+                if (isTimeSpan(group)) {
+                    result.type = Report::Type::TAF;
+                    result.error = Report::Error::NO_ERROR;
+                    return;
+                }
+                if (!typeKnown) {
+                    result.type = Report::Type::METAR;
+                    result.error = Report::Error::NO_ERROR;
+                    return;
+                }
+                if (group == "NIL" || group == "CNL") {
+                    result.error = Report::Error::NO_ERROR;
+                    return;
+                }
+                return error(Report::Error::REPORT_HEADER_FORMAT);
+        }
+    }
+}
+
+bool HeaderScanner::scanKeywords(std::string_view group) {
+    if (group == "COR") {
+        result.correctional = true;
+        return true;
+    }
+    if (group == "AMD") {
+        result.amended = true;
+        return true;
+    }
+    return false;
+}
+
+bool HeaderScanner::isLocation(std::string_view group) {
+    if (group.length() != 4) return false;
+    if (group[0] < 'A' || group[0] > 'Z') return false;
+    for (auto i = 1u; i < group.length(); i++) {
+        const auto c = group[i];
+        if ((c < 'A' || c > 'Z') && (c < '0' || c > '9')) return false;
+    }
+    return true;
+}
+
+std::optional<Time> HeaderScanner::reportTime(std::string_view group) {
+    if (group.length() != 7 || group[6] != 'Z') return std::optional<Time>();
+    const auto day = digits(group.substr(0, 2));
+    const auto hour = digits(group.substr(2, 2));
+    const auto minute = digits(group.substr(4, 2));
+    if (!day.has_value() || !hour.has_value() || !minute.has_value())
+        return std::optional<Time>();
+    if (!*day || *day > 31 || *hour > 24 || *minute > 59)
+        return std::optional<Time>();
+    return Time{day, hour, minute};
+}
+
+bool HeaderScanner::isTimeSpan(std::string_view group) {
+    if (group.length() != 9 || group[4] != '/') return false;
+    return (digits(group.substr(0, 4)).has_value() &&
+            digits(group.substr(5, 4)).has_value());
+}
+
+std::optional<int> HeaderScanner::digits(std::string_view s) {
+    int result = 0;
+    for (const auto c : s) {
+        if (c < '0' || c > '9') return std::optional<int>();
+        result = result * 10 + (c - '0');
+    }
+    return result;
+}
+
+}  // namespace metafsimple::detail
+
 namespace metafsimple {
 inline Simple simplify(const metaf::ParseResult &parseResult) {
     metafsimple::detail::CollateVisitor v(parseResult);
@@ -4896,6 +5352,27 @@ inline Simple simplify(const std::string &report) {
     return simplify(metaf::Parser::parse(report));
 }
 
+// Obtain report type, station and report time from report header; much faster
+// than simplify() since the report body is neither parsed nor collated. Only
+// report header syntax is checked, errors in report body are not detected
+inline Triage triage(const std::string &report) {
+    metafsimple::detail::HeaderScanner s(report);
+    return s.data();
+}
+
+// Simplify report only if the report is from one of the stations allowed by
+// filter; empty optional is returned if the station is not allowed or cannot
+// be determined from the report header
+inline std::optional<Simple> simplify(const std::string &report,
+                                      const StationFilter &filter) {
+    if (!filter.empty()) {
+        const auto t = triage(report);
+        if (t.icaoCode.empty() || !filter.allows(t.icaoCode))
+            return std::optional<Simple>();
+    }
+    return simplify(report);
+}
+
 }  // namespace metafsimple
 
 #endif  // #ifndef METAFSIMPLE_HPP
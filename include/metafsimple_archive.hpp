@@ -0,0 +1,272 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_ARCHIVE_HPP
+#define METAFSIMPLE_ARCHIVE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_serialize.hpp"
+
+// Archive of consecutive simplified reports of a station, delta-encoded.
+//
+// Reports are split into leaf fields: scalars, optional values, strings and
+// containers of the structures listed by visitFields() (containers are not
+// split further). Each leaf is encoded as in serialize(), so that encoding
+// of the whole report is the concatenation of its leaves. A report is
+// stored either in full (keyframe) or as the list of leaves which differ
+// from the previous report with their new values; a keyframe is stored
+// every keyframeInterval reports, so that any report can be decoded
+// starting from the nearest keyframe before it.
+//
+// Archive layout (varints as in serialize()):
+//   serializationVersion
+//   record*: header, payload
+//     header: payload length * 2 + 1 for delta or + 0 for keyframe
+//     keyframe payload: all leaves
+//     delta payload: number of changed leaves, then for each changed leaf
+//       number of unchanged leaves before it, leaf value
+// The list of changed leaves is a sparse form of changed-field bitmap: a
+// METAR usually differs from the previous one in a few leaves out of about
+// two hundred.
+
+namespace metafsimple {
+
+class ArchiveWriter {
+   public:
+    // Start archive at the end of string
+    inline explicit ArchiveWriter(std::string &out,
+                                  std::size_t keyframeInterval = 32);
+    inline void append(const Simple &report);
+    // Number of reports appended
+    std::size_t size() const { return count; }
+
+   private:
+    std::string &out;
+    std::size_t keyframeInterval;
+    std::size_t count = 0;
+    // Encoded leaves of the previous report and their offsets
+    std::string previous;
+    std::vector<std::size_t> previousOffsets;
+    std::string current;
+    std::vector<std::size_t> currentOffsets;
+};
+
+class ArchiveReader {
+   public:
+    // Data must remain valid while the reader is used
+    inline explicit ArchiveReader(std::string_view data);
+    // False if header or record framing is malformed
+    bool valid() const { return !error; }
+    // Number of reports in archive
+    std::size_t size() const { return records.size(); }
+    // Decode the next report; empty optional at the end of archive or if
+    // the report cannot be decoded
+    inline std::optional<Simple> next();
+    // Decode report by index, starting from the last decoded report or the
+    // nearest keyframe before index, whichever is closer; next() continues
+    // after it
+    inline std::optional<Simple> at(std::size_t index);
+
+   private:
+    struct Record {
+        std::string_view payload;
+        bool delta = false;
+    };
+    inline std::optional<Simple> decode(const Record &record) const;
+
+    std::vector<Record> records;
+    bool error = false;
+    std::size_t position = 0;  // Index of report returned by next()
+    std::optional<Simple> last;
+};
+
+}  // namespace metafsimple
+
+namespace metafsimple::detail {
+
+// Structures are split into fields; other types are leaves
+template <typename T>
+struct IsLeaf : std::bool_constant<!std::is_class_v<T>> {};
+template <>
+struct IsLeaf<std::string> : std::true_type {};
+template <typename T>
+struct IsLeaf<std::optional<T>> : std::true_type {};
+template <typename T>
+struct IsLeaf<std::vector<T>> : std::true_type {};
+template <typename T>
+struct IsLeaf<std::set<T>> : std::true_type {};
+
+// Calls f(leaf) for each leaf of structure in serialization order
+template <typename F>
+class LeafVisitor {
+   public:
+    explicit LeafVisitor(F &f) : f(f) {}
+    template <typename... Ts>
+    void operator()(Ts &... values) {
+        (visit(values), ...);
+    }
+
+   private:
+    F &f;
+    template <typename T>
+    void visit(T &value) {
+        if constexpr (IsLeaf<std::remove_const_t<T>>::value) {
+            f(value);
+        } else {
+            visitFields(value, *this);
+        }
+    }
+};
+
+template <typename T, typename F>
+void visitLeaves(T &t, F &&f) {
+    LeafVisitor<F> visitor(f);
+    visitFields(t, visitor);
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+////////////////////////////////////////////////////////////////////////////////
+
+ArchiveWriter::ArchiveWriter(std::string &out, std::size_t keyframeInterval)
+    : out(out), keyframeInterval(keyframeInterval ? keyframeInterval : 1) {
+    Encoder(out).writeUnsigned(serializationVersion);
+}
+
+void ArchiveWriter::append(const Simple &report) {
+    current.clear();
+    currentOffsets.clear();
+    Encoder leafEncoder(current);
+    detail::visitLeaves(report, [&](const auto &leaf) {
+        currentOffsets.push_back(current.length());
+        leafEncoder(leaf);
+    });
+    currentOffsets.push_back(current.length());
+
+    Encoder e(out);
+    if (!(count % keyframeInterval)) {
+        e.writeUnsigned(current.length() * 2);
+        out.append(current);
+    } else {
+        std::string payload;
+        Encoder p(payload);
+        const auto leafCount = currentOffsets.size() - 1;
+        const auto leaf = [](const std::string &s,
+                             const std::vector<std::size_t> &offsets,
+                             std::size_t i) {
+            return std::string_view(s).substr(offsets[i],
+                                              offsets[i + 1] - offsets[i]);
+        };
+        std::vector<std::size_t> changed;
+        for (auto i = 0u; i < leafCount; i++) {
+            if (leaf(current, currentOffsets, i) !=
+                leaf(previous, previousOffsets, i))
+                changed.push_back(i);
+        }
+        p.writeUnsigned(changed.size());
+        std::size_t next = 0;
+        for (const auto i : changed) {
+            p.writeUnsigned(i - next);
+            payload.append(leaf(current, currentOffsets, i));
+            next = i + 1;
+        }
+        e.writeUnsigned(payload.length() * 2 + 1);
+        out.append(payload);
+    }
+    std::swap(previous, current);
+    std::swap(previousOffsets, currentOffsets);
+    count++;
+}
+
+ArchiveReader::ArchiveReader(std::string_view data) {
+    Decoder d(data);
+    if (d.readUnsigned() != serializationVersion || d.failed()) {
+        error = true;
+        return;
+    }
+    while (!d.remaining().empty()) {
+        const auto header = d.readUnsigned();
+        const auto length = header / 2;
+        if (d.failed() || length > d.remaining().length()) {
+            error = true;
+            return;
+        }
+        const auto payload = d.remaining().substr(0, length);
+        records.push_back(Record{payload, (header & 1) != 0});
+        d = Decoder(d.remaining().substr(length));
+    }
+    if (!records.empty() && records.front().delta) error = true;
+}
+
+std::optional<Simple> ArchiveReader::decode(const Record &record) const {
+    Decoder d(record.payload);
+    if (!record.delta) {
+        Simple result;
+        d(result);
+        if (!d.finished()) return std::optional<Simple>();
+        return result;
+    }
+    if (!last.has_value()) return std::optional<Simple>();
+    auto result = *last;
+    auto remaining = d.readUnsigned();
+    // Index of the next changed leaf, counted from the current leaf
+    auto skip = remaining ? d.readUnsigned() : 0;
+    detail::visitLeaves(result, [&](auto &leaf) {
+        if (!remaining || d.failed()) return;
+        if (skip) {
+            skip--;
+            return;
+        }
+        d(leaf);
+        if (--remaining) skip = d.readUnsigned();
+    });
+    if (remaining || !d.finished()) return std::optional<Simple>();
+    return result;
+}
+
+std::optional<Simple> ArchiveReader::next() {
+    if (error || position >= records.size()) return std::optional<Simple>();
+    last = decode(records[position]);
+    // Delta cannot be decoded after a report which failed to decode
+    if (!last.has_value()) {
+        position = records.size();
+        return std::optional<Simple>();
+    }
+    position++;
+    return last;
+}
+
+std::optional<Simple> ArchiveReader::at(std::size_t index) {
+    if (error || index >= records.size()) return std::optional<Simple>();
+    // Nearest keyframe at or before index
+    auto keyframe = index;
+    while (records[keyframe].delta) keyframe--;
+    if (!last.has_value() || index < position || keyframe > position) {
+        position = keyframe;
+        last.reset();
+    }
+    while (position < index) {
+        if (!next().has_value()) return std::optional<Simple>();
+    }
+    return next();
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_ARCHIVE_HPP
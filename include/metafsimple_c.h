@@ -0,0 +1,155 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+/* C API of metafsimple_c shared library: simplifies METAR, SPECI or TAF
+ * reports into flat fixed-size records which can be read from other runtimes
+ * without per-field calls or string marshaling */
+
+#ifndef METAFSIMPLE_C_H
+#define METAFSIMPLE_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define METAFSIMPLE_C_API __attribute__((visibility("default")))
+#else
+#define METAFSIMPLE_C_API
+#endif
+
+/* Version of the record layout and function set; incremented on any change
+ * which breaks binary compatibility */
+#define METAFSIMPLE_C_ABI_VERSION 1
+
+/* Value of integer record fields which are not reported */
+#define METAFSIMPLE_NO_VALUE INT32_MIN
+
+/* Return codes */
+#define METAFSIMPLE_OK 0
+#define METAFSIMPLE_FILTERED 1
+#define METAFSIMPLE_ERROR_ARGUMENT -1
+#define METAFSIMPLE_ERROR_INTERNAL -2
+
+/* Report type, same values as metafsimple::Report::Type */
+enum metafsimple_report_type {
+    METAFSIMPLE_REPORT_ERROR = 0,
+    METAFSIMPLE_REPORT_METAR = 1,
+    METAFSIMPLE_REPORT_SPECI = 2,
+    METAFSIMPLE_REPORT_TAF = 3
+};
+
+/* Bits of metafsimple_record::flags */
+enum metafsimple_flag {
+    METAFSIMPLE_FLAG_MISSING = 0x0001,       /* NIL report */
+    METAFSIMPLE_FLAG_CANCELLED = 0x0002,     /* CNL report */
+    METAFSIMPLE_FLAG_CORRECTIONAL = 0x0004,  /* COR report */
+    METAFSIMPLE_FLAG_AMENDED = 0x0008,       /* AMD report */
+    METAFSIMPLE_FLAG_AUTOMATED = 0x0010,     /* AUTO report */
+    METAFSIMPLE_FLAG_WIND_CALM = 0x0020,
+    METAFSIMPLE_FLAG_WIND_VARIABLE = 0x0040,
+    METAFSIMPLE_FLAG_CAVOK = 0x0080,
+    METAFSIMPLE_FLAG_NOSIG = 0x0100,
+    METAFSIMPLE_FLAG_VIS_LESS_THAN = 0x0200,
+    METAFSIMPLE_FLAG_VIS_MORE_THAN = 0x0400,
+    METAFSIMPLE_FLAG_FILTERED = 0x0800  /* station not in station filter */
+};
+
+/* Report simplified into fixed-size record. Weather data are taken from
+ * current weather for METAR and SPECI and from prevailing conditions for
+ * TAF. Error code has the same values as metafsimple::Report::Error, sky
+ * condition as metafsimple::Essentials::SkyCondition; weather_mask has bit
+ * (1 << metafsimple::Weather::Phenomena) set for each reported phenomena, and
+ * precipitation_mask has bit (1 << metafsimple::Weather::Precipitation) set
+ * for each reported type of precipitation. */
+typedef struct metafsimple_record {
+    char icao[8]; /* NUL-terminated ICAO location code */
+    int32_t report_type;
+    int32_t error;
+    uint32_t flags;
+    int32_t report_day;
+    int32_t report_hour;
+    int32_t report_minute;
+    int32_t applicable_from_day;
+    int32_t applicable_from_hour;
+    int32_t applicable_until_day;
+    int32_t applicable_until_hour;
+    int32_t wind_direction_deg;
+    int32_t wind_var_from_deg;
+    int32_t wind_var_to_deg;
+    int32_t wind_speed_kt;
+    int32_t gust_speed_kt;
+    int32_t visibility_m;
+    int32_t ceiling_ft;
+    int32_t vertical_visibility_ft;
+    int32_t sky_condition;
+    int32_t temperature_tenth_c;
+    int32_t dew_point_tenth_c;
+    int32_t relative_humidity;
+    int32_t pressure_tenth_hpa;
+    uint32_t precipitation_mask;
+    uint64_t weather_mask;
+    uint32_t trend_count;
+    uint32_t warning_count;
+    uint32_t reserved[4];
+} metafsimple_record;
+
+/* Reusable simplifier state; a handle must not be used by multiple threads
+ * simultaneously, use one handle per thread instead */
+typedef struct metafsimple_simplifier metafsimple_simplifier;
+
+METAFSIMPLE_C_API uint32_t metafsimple_abi_version(void);
+
+METAFSIMPLE_C_API metafsimple_simplifier *metafsimple_create(void);
+METAFSIMPLE_C_API void metafsimple_destroy(metafsimple_simplifier *s);
+
+/* Only simplify reports from the listed stations; icao_codes contains count
+ * 4-character ICAO codes without delimiters; zero count allows all stations */
+METAFSIMPLE_C_API int metafsimple_set_station_filter(metafsimple_simplifier *s,
+                                                     const char *icao_codes,
+                                                     size_t count);
+
+/* Simplify single report of given length; returns METAFSIMPLE_OK if record is
+ * filled, or METAFSIMPLE_FILTERED if the station is not allowed by filter
+ * (record has METAFSIMPLE_FLAG_FILTERED set and station code filled) */
+METAFSIMPLE_C_API int metafsimple_simplify(metafsimple_simplifier *s,
+                                           const char *report,
+                                           size_t length,
+                                           metafsimple_record *out);
+
+/* Simplify count reports; out[i] corresponds to reports[i]; returns number of
+ * records filled */
+METAFSIMPLE_C_API size_t metafsimple_simplify_batch(metafsimple_simplifier *s,
+                                                    const char *const *reports,
+                                                    const size_t *lengths,
+                                                    size_t count,
+                                                    metafsimple_record *out);
+
+/* Simplify reports from a buffer where each report is terminated by a line
+ * break; empty lines are skipped. Up to capacity records are written to out,
+ * one per report; number of bytes processed is written to consumed (if not
+ * NULL) so that the rest of the buffer can be passed in the next call. The
+ * last line is not processed unless terminated by a line break, since it may
+ * be continued in the next chunk of input; at the end of input, terminate it
+ * or pass it to metafsimple_simplify(). Returns the number of records
+ * written. */
+METAFSIMPLE_C_API size_t metafsimple_simplify_buffer(metafsimple_simplifier *s,
+                                                     const char *buffer,
+                                                     size_t length,
+                                                     metafsimple_record *out,
+                                                     size_t capacity,
+                                                     size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METAFSIMPLE_C_H */
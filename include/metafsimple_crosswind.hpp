@@ -0,0 +1,259 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_CROSSWIND_HPP
+#define METAFSIMPLE_CROSSWIND_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_flat.hpp"
+
+namespace metafsimple {
+
+// Wind components along and across runways for multiple runways of
+// multiple stations in columnar form: add() appends row per runway with
+// the wind reported by the station, then computeRunwayWinds() fills output
+// columns.
+//
+// Runway heading is derived from the runway number (e.g. 270 degrees for
+// runway 27L); it is a nominal magnetic heading which may be replaced in
+// headingDeg column (e.g. with true heading from aerodrome database) before
+// the components are computed; all components of a runway with heading set
+// to METAFSIMPLE_NO_VALUE are NaN.
+//
+// Crosswind is positive when the wind blows from the right side of the
+// runway; headwind is negative for tailwind. Worst-case components use
+// gust speed if reported and the direction within variable wind sector
+// (or any direction for variable wind with no sector) which gives the
+// strongest crosswind or the weakest headwind. Unknown components are NaN.
+//
+// Wind directions are whole degrees, so sine and cosine are looked up in a
+// table with an entry per degree; the computation loop is branch-free so
+// that the compiler can vectorize it.
+struct RunwayWindColumns {
+    std::size_t size() const { return icao.size(); }
+    inline void clear();
+    inline void reserve(std::size_t rows);
+    // Add rows for runways of the station; returns number of rows added
+    inline std::size_t add(const Simple &report,
+                           const std::vector<Runway> &runways);
+    // Add rows for the runways listed in the report (runway visual range,
+    // runway state, etc)
+    inline std::size_t add(const Simple &report);
+
+    // Input columns, directions are METAFSIMPLE_NO_VALUE if not known
+    std::vector<IcaoCode> icao;
+    std::vector<Runway> runway;
+    std::vector<std::int32_t> headingDeg;
+    std::vector<std::int32_t> windDirectionDeg;
+    std::vector<std::int32_t> windVariable;  // Non-zero for VRB wind
+    std::vector<std::int32_t> windVarFromDeg;
+    std::vector<std::int32_t> windVarToDeg;
+    std::vector<float> windSpeedKt;
+    std::vector<float> gustSpeedKt;  // NaN if no gusts
+
+    // Output columns
+    std::vector<float> crosswindKt;
+    std::vector<float> headwindKt;
+    std::vector<float> gustCrosswindKt;
+    std::vector<float> gustHeadwindKt;
+    std::vector<float> maxCrosswindKt;  // Worst case, absolute value
+    std::vector<float> minHeadwindKt;   // Worst case
+};
+
+// Runway heading in degrees; returns METAFSIMPLE_NO_VALUE for numbers which
+// do not designate a runway direction (e.g. 88 for all runways)
+inline std::int32_t runwayHeading(const Runway &runway);
+
+// Compute output columns
+inline void computeRunwayWinds(RunwayWindColumns &columns);
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::int32_t runwayHeading(const Runway &runway) {
+    if (runway.number < 1 || runway.number > 36) return METAFSIMPLE_NO_VALUE;
+    return runway.number * 10;
+}
+
+void RunwayWindColumns::clear() {
+    icao.clear();
+    runway.clear();
+    headingDeg.clear();
+    windDirectionDeg.clear();
+    windVariable.clear();
+    windVarFromDeg.clear();
+    windVarToDeg.clear();
+    windSpeedKt.clear();
+    gustSpeedKt.clear();
+}
+
+void RunwayWindColumns::reserve(std::size_t rows) {
+    icao.reserve(rows);
+    runway.reserve(rows);
+    headingDeg.reserve(rows);
+    windDirectionDeg.reserve(rows);
+    windVariable.reserve(rows);
+    windVarFromDeg.reserve(rows);
+    windVarToDeg.reserve(rows);
+    windSpeedKt.reserve(rows);
+    gustSpeedKt.reserve(rows);
+}
+
+std::size_t RunwayWindColumns::add(const Simple &report,
+                                   const std::vector<Runway> &runways) {
+    using detail::flatValue;
+    const auto &e = report.current.weatherData;
+    const auto speed = [](const Speed &s) {
+        const auto kt = s.toUnit(Speed::Unit::KT);
+        return kt.has_value() ? static_cast<float>(*kt)
+                              : std::numeric_limits<float>::quiet_NaN();
+    };
+    // Calm wind has no direction but all components are zero
+    const auto direction =
+        e.windCalm ? 0 : flatValue(e.windDirectionDegrees);
+    const auto windSpeed = e.windCalm ? 0.0f : speed(e.windSpeed);
+    const auto gustSpeed = speed(e.gustSpeed);
+    const auto varFrom = flatValue(e.windDirectionVarFromDegrees);
+    const auto varTo = flatValue(e.windDirectionVarToDegrees);
+    std::size_t added = 0;
+    for (const auto &r : runways) {
+        const auto heading = runwayHeading(r);
+        if (heading == METAFSIMPLE_NO_VALUE) continue;
+        icao.push_back(report.station.icao());
+        runway.push_back(r);
+        headingDeg.push_back(heading);
+        windDirectionDeg.push_back(direction);
+        windVariable.push_back(e.windDirectionVariable);
+        windVarFromDeg.push_back(varFrom);
+        windVarToDeg.push_back(varTo);
+        windSpeedKt.push_back(windSpeed);
+        gustSpeedKt.push_back(gustSpeed);
+        added++;
+    }
+    return added;
+}
+
+std::size_t RunwayWindColumns::add(const Simple &report) {
+    std::vector<Runway> runways;
+    for (const auto &r : report.aerodrome.runways) {
+        const auto same = [&](const Runway &other) {
+            return other.number == r.runway.number &&
+                   other.designator == r.runway.designator;
+        };
+        if (std::find_if(runways.begin(), runways.end(), same) ==
+            runways.end())
+            runways.push_back(r.runway);
+    }
+    return add(report, runways);
+}
+
+namespace detail {
+
+// Sine of whole degrees 0 to 359
+inline const std::array<float, 360> &sineTable() {
+    static const auto table = [] {
+        std::array<float, 360> t;
+        const auto pi = std::acos(-1.0);
+        for (auto i = 0; i < 360; i++)
+            t[i] = static_cast<float>(std::sin(i * pi / 180.0));
+        // Exact values at right angles
+        t[0] = t[180] = 0.0f;
+        t[90] = 1.0f;
+        t[270] = -1.0f;
+        return t;
+    }();
+    return table;
+}
+
+inline std::int32_t degrees360(std::int32_t d) {
+    return (d % 360 + 360) % 360;
+}
+
+}  // namespace detail
+
+void computeRunwayWinds(RunwayWindColumns &c) {
+    using detail::degrees360;
+    const auto n = c.size();
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    for (auto col : {&c.crosswindKt,
+                     &c.headwindKt,
+                     &c.gustCrosswindKt,
+                     &c.gustHeadwindKt,
+                     &c.maxCrosswindKt,
+                     &c.minHeadwindKt})
+        col->resize(n);
+    const float *sine = detail::sineTable().data();
+    const auto *heading = c.headingDeg.data();
+    const auto *direction = c.windDirectionDeg.data();
+    const auto *variable = c.windVariable.data();
+    const auto *varFrom = c.windVarFromDeg.data();
+    const auto *varTo = c.windVarToDeg.data();
+    const auto *speed = c.windSpeedKt.data();
+    const auto *gust = c.gustSpeedKt.data();
+    auto *crosswind = c.crosswindKt.data();
+    auto *headwind = c.headwindKt.data();
+    auto *gustCrosswind = c.gustCrosswindKt.data();
+    auto *gustHeadwind = c.gustHeadwindKt.data();
+    auto *maxCrosswind = c.maxCrosswindKt.data();
+    auto *minHeadwind = c.minHeadwindKt.data();
+
+    for (std::size_t i = 0; i < n; i++) {
+        // Values are checked before any arithmetic, since the difference
+        // with METAFSIMPLE_NO_VALUE overflows; nothing is known for a runway
+        // with no heading
+        const auto hasHeading = heading[i] != METAFSIMPLE_NO_VALUE;
+        const auto h = hasHeading ? heading[i] : 0;
+
+        // Steady components
+        const auto known =
+            (direction[i] != METAFSIMPLE_NO_VALUE) & hasHeading;
+        const auto r = degrees360((known ? direction[i] : 0) - h);
+        const auto sinR = sine[r];
+        const auto cosR = sine[degrees360(r + 90)];
+        crosswind[i] = known ? speed[i] * sinR : nan;
+        headwind[i] = known ? speed[i] * cosR : nan;
+        gustCrosswind[i] = known ? gust[i] * sinR : nan;
+        gustHeadwind[i] = known ? gust[i] * cosR : nan;
+
+        // Worst case within variable sector from a clockwise to b
+        const auto sector = (varFrom[i] != METAFSIMPLE_NO_VALUE) &
+                            (varTo[i] != METAFSIMPLE_NO_VALUE) & hasHeading;
+        const auto a = degrees360((sector ? varFrom[i] : 0) - h);
+        const auto length = degrees360((sector ? varTo[i] : 0) -
+                                       (sector ? varFrom[i] : 0));
+        const auto b = degrees360(a + length);
+        const auto across = (degrees360(90 - a) <= length) |
+                            (degrees360(270 - a) <= length);
+        const auto behind = degrees360(180 - a) <= length;
+        const auto sinA = std::fabs(sine[a]), sinB = std::fabs(sine[b]);
+        const auto cosA = sine[degrees360(a + 90)];
+        const auto cosB = sine[degrees360(b + 90)];
+        const auto sectorSin = across ? 1.0f : std::max(sinA, sinB);
+        const auto sectorCos = behind ? -1.0f : std::min(cosA, cosB);
+        // Variable wind with no sector may blow from any direction
+        const auto anyDirection = (variable[i] != 0) & !known & hasHeading;
+        const auto worstSin =
+            sector ? sectorSin : (anyDirection ? 1.0f : std::fabs(sinR));
+        const auto worstCos =
+            sector ? sectorCos : (anyDirection ? -1.0f : cosR);
+        const auto worstKnown = known | sector | anyDirection;
+        const auto peak = gust[i] == gust[i] ? gust[i] : speed[i];
+        maxCrosswind[i] = worstKnown ? peak * worstSin : nan;
+        minHeadwind[i] = worstKnown ? peak * worstCos : nan;
+    }
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_CROSSWIND_HPP
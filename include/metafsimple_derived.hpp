@@ -0,0 +1,412 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_DERIVED_HPP
+#define METAFSIMPLE_DERIVED_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+namespace metafsimple {
+
+// Derived quantities for multiple stations in columnar form: the caller
+// fills input columns (row per station), then computeDerived() fills output
+// columns. Unknown inputs and outputs which are unknown or not applicable
+// for the conditions (e.g. wind chill in warm weather) are NaN.
+//
+// Transcendental functions are not evaluated per station: saturation vapour
+// pressure, power of wind speed and pressure altitude are looked up in
+// tables (tenth of degree, knot and tenth of hectopascal steps) built once,
+// with linear interpolation between the entries. Arguments outside of the
+// tables are evaluated with polynomial approximations of exp2 and log2.
+// Each quantity is computed by a separate branch-free loop over the
+// columns; no platform-specific intrinsics are used and vectorization is
+// left to the compiler. In practice (GCC 12, -O3) loops with table lookups
+// are not vectorized, since the compiler cannot prove that the gathers from
+// the tables do not alias the output columns, and the approximations are
+// only vectorized with -fno-trapping-math; the loops mostly gain from
+// having no branches and no calls of library functions.
+struct DerivedColumns {
+    inline void resize(std::size_t stationCount);
+    std::size_t size() const { return temperatureC.size(); }
+
+    // Input columns
+    std::vector<float> temperatureC;
+    std::vector<float> dewPointC;
+    std::vector<float> windSpeedKt;
+    std::vector<float> stationPressureHpa;  // Pressure at ground level
+    std::vector<float> qnhHpa;              // Used if station pressure is NaN
+    std::vector<float> elevationFt;         // Used with QNH
+
+    // Output columns
+    std::vector<float> relativeHumidity;  // Percent
+    std::vector<float> dewPointDepressionC;
+    std::vector<float> windChillC;  // Temperature 10C or less, wind 5 km/h+
+    std::vector<float> heatIndexC;  // Temperature 26.7C (80F) or more
+    std::vector<float> pressureAltitudeFt;
+    std::vector<float> densityAltitudeFt;
+    std::vector<float> cloudBaseFt;  // Cumulus base above ground level
+};
+
+// Fill input columns of row from METAR / SPECI; station elevation is not
+// reported in METAR and is specified by the caller if known
+inline void setDerivedInput(
+    DerivedColumns &columns,
+    std::size_t row,
+    const Simple &report,
+    std::optional<double> elevationFt = std::optional<double>());
+
+// Compute all output columns
+inline void computeDerived(DerivedColumns &columns);
+
+////////////////////////////////////////////////////////////////////////////////
+
+void DerivedColumns::resize(std::size_t stationCount) {
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    for (auto c : {&temperatureC,
+                   &dewPointC,
+                   &windSpeedKt,
+                   &stationPressureHpa,
+                   &qnhHpa,
+                   &elevationFt,
+                   &relativeHumidity,
+                   &dewPointDepressionC,
+                   &windChillC,
+                   &heatIndexC,
+                   &pressureAltitudeFt,
+                   &densityAltitudeFt,
+                   &cloudBaseFt})
+        c->assign(stationCount, nan);
+}
+
+void setDerivedInput(DerivedColumns &columns,
+                     std::size_t row,
+                     const Simple &report,
+                     std::optional<double> elevationFt) {
+    const auto value = [](std::optional<double> v) {
+        return v.has_value() ? static_cast<float>(*v)
+                             : std::numeric_limits<float>::quiet_NaN();
+    };
+    const auto &c = report.current;
+    columns.temperatureC[row] =
+        value(c.airTemperature.toUnit(Temperature::Unit::C));
+    columns.dewPointC[row] = value(c.dewPoint.toUnit(Temperature::Unit::C));
+    columns.windSpeedKt[row] =
+        value(c.weatherData.windSpeed.toUnit(Speed::Unit::KT));
+    columns.stationPressureHpa[row] =
+        value(c.pressureGroundLevel.toUnit(Pressure::Unit::HPA));
+    columns.qnhHpa[row] =
+        value(c.weatherData.seaLevelPressure.toUnit(Pressure::Unit::HPA));
+    columns.elevationFt[row] = value(elevationFt);
+}
+
+namespace detail {
+
+// Largest integer not greater than x, for 0 <= x < 2^22. Integer is taken
+// from the bits of x + 1.5 * 2^23 (rounded to nearest) instead of converting
+// float to int: with default -ftrapping-math, GCC does not vectorize
+// the conversion of a value selected by min / max.
+inline std::int32_t derivedFloor(float x) {
+    const auto shifted = x + 12582912.0f;
+    std::int32_t bits;
+    std::memcpy(&bits, &shifted, sizeof(bits));
+    const auto rounded = bits - 0x4B400000;
+    return rounded - static_cast<std::int32_t>(shifted - 12582912.0f > x);
+}
+
+// Lookup of function values tabulated at x = first + i / scale with linear
+// interpolation; arguments outside the table are clamped to its range. The
+// kernels keep a copy of it in a local variable, so that the compiler knows
+// the table parameters are not changed by stores to output columns.
+struct DerivedLookup {
+    const float *values;
+    float first;
+    float last;
+    float scale;
+    int size;
+
+    bool contains(float x) const { return (x >= first) & (x <= last); }
+
+    // Argument must not be NaN
+    float operator()(float x) const {
+        const auto position = std::min(std::max((x - first) * scale, 0.0f),
+                                       static_cast<float>(size - 1));
+        const auto i = std::min(derivedFloor(position), size - 2);
+        const auto fraction = position - i;
+        return values[i] + fraction * (values[i + 1] - values[i]);
+    }
+};
+
+template <std::size_t N>
+struct DerivedTable {
+    float first;
+    float step;
+    std::array<float, N> values;
+
+    template <typename F>
+    static DerivedTable make(float first, float step, F &&f) {
+        DerivedTable t{first, step, {}};
+        for (auto i = 0u; i < N; i++) t.values[i] = f(first + i * step);
+        return t;
+    }
+    DerivedLookup lookup() const {
+        return DerivedLookup{values.data(),
+                             first,
+                             first + (N - 1) * step,
+                             1.0f / step,
+                             static_cast<int>(N)};
+    }
+};
+
+// Saturation vapour pressure in hPa from -90.0C to +70.0C, same formula as
+// metaf::Temperature::relativeHumidity
+inline const DerivedTable<1601> &saturationVapourPressure() {
+    static const auto table =
+        DerivedTable<1601>::make(-90.0f, 0.1f, [](double t) {
+            return 6.11 * std::pow(10.0, 7.5 * t / (237.7 + t));
+        });
+    return table;
+}
+
+// Wind speed in km/h raised to power 0.16, from 0 to 250 KT
+inline const DerivedTable<251> &windChillSpeedFactor() {
+    static const auto table =
+        DerivedTable<251>::make(0.0f, 1.0f, [](double kt) {
+            return std::pow(kt * 1.852, 0.16);
+        });
+    return table;
+}
+
+// Pressure altitude in feet (ICAO standard atmosphere) for pressure from
+// 500.0 to 1100.0 hPa
+inline const DerivedTable<6001> &standardPressureAltitude() {
+    static const auto table =
+        DerivedTable<6001>::make(500.0f, 0.1f, [](double hpa) {
+            return 145366.45 * (1.0 - std::pow(hpa / 1013.25, 0.190284));
+        });
+    return table;
+}
+
+inline float derivedNan() { return std::numeric_limits<float>::quiet_NaN(); }
+
+// 2 to the power x; relative error is below 1e-6
+inline float derivedExp2(float x) {
+    const auto clamped = std::min(std::max(x, -126.0f), 127.0f);
+    const auto whole = derivedFloor(clamped + 127.0f);
+    // 2^f = sqrt(2) * e^((f - 0.5) * ln 2), Taylor series for |f - 0.5| < 0.5;
+    // fraction is taken from unbiased value to keep its precision
+    const auto fraction = clamped - static_cast<float>(whole - 127);
+    const auto f = (fraction - 0.5f) * 0.693147181f;
+    const auto p =
+        1.0f +
+        f * (1.0f +
+             f * (1.0f / 2 +
+                  f * (1.0f / 6 +
+                       f * (1.0f / 24 + f * (1.0f / 120 + f * (1.0f / 720))))));
+    const std::int32_t bits = whole << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * 1.41421356f * scale;
+}
+
+// Logarithm base 2 of positive normal number; absolute error is below 1e-6
+inline float derivedLog2(float x) {
+    std::int32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    auto exponent = static_cast<float>((bits >> 23) - 127);
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    // Mantissa is reduced to [sqrt(0.5), sqrt(2)), then
+    // ln(m) = 2 * atanh(s) where s = (m - 1) / (m + 1), |s| < 0.172
+    // Constants are selected rather than results, so that no floating point
+    // operation is conditional
+    const auto high = m > 1.41421356f;
+    m *= high ? 0.5f : 1.0f;
+    exponent += high ? 1.0f : 0.0f;
+    const auto s = (m - 1.0f) / (m + 1.0f);
+    const auto s2 = s * s;
+    const auto ln =
+        2.0f * s *
+        (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7 + s2 / 9))));
+    return exponent + ln * 1.44269504f;
+}
+
+// Approximations of the tabulated functions for arguments outside of the
+// tables
+
+inline float saturationVapourPressureApprox(float t) {
+    // 10^x = 2^(x * log2(10))
+    return 6.11f * derivedExp2(3.32192809f * 7.5f * t / (237.7f + t));
+}
+
+// Wind speed must be positive
+inline float windChillSpeedFactorApprox(float kt) {
+    return derivedExp2(0.16f * derivedLog2(kt * 1.852f));
+}
+
+// Pressure must be positive
+inline float standardPressureAltitudeApprox(float hpa) {
+    return 145366.45f *
+           (1.0f - derivedExp2(0.190284f * derivedLog2(hpa / 1013.25f)));
+}
+
+// NaN is replaced with zero before table lookup; result is set to NaN
+// afterwards
+inline float derivedArg(float x) { return x == x ? x : 0.0f; }
+
+// Values are computed for every row and then selected, and conditions are
+// combined with & and | rather than && and ||, so that loops have no
+// branches
+
+inline void deriveHumidity(const float *t,
+                           const float *td,
+                           float *rh,
+                           float *depression,
+                           std::size_t n) {
+    const auto table = saturationVapourPressure().lookup();
+    // Both values are computed, so that the loop has no branches
+    const auto svp = [&table](float c) {
+        const auto tabulated = table(c);
+        const auto approximated = saturationVapourPressureApprox(c);
+        return table.contains(c) ? tabulated : approximated;
+    };
+    for (std::size_t i = 0; i < n; i++) {
+        const auto valid = (t[i] == t[i]) & (td[i] == td[i]);
+        const auto r = 100.0f * svp(derivedArg(td[i])) / svp(derivedArg(t[i]));
+        rh[i] = valid ? r : derivedNan();
+        depression[i] = t[i] - td[i];
+    }
+}
+
+// Canadian / US wind chill index
+inline void deriveWindChill(const float *t,
+                            const float *kt,
+                            float *windChill,
+                            std::size_t n) {
+    const auto table = windChillSpeedFactor().lookup();
+    for (std::size_t i = 0; i < n; i++) {
+        const auto valid = (t[i] <= 10.0f) & (kt[i] * 1.852f > 4.8f);
+        // Arguments below the table are not valid and are not approximated
+        const auto x = derivedArg(kt[i]);
+        const auto tabulated = table(x);
+        const auto approximated = windChillSpeedFactorApprox(x);
+        const auto v =
+            table.contains(x) | (x <= 0.0f) ? tabulated : approximated;
+        const auto c = 13.12f + 0.6215f * t[i] - 11.37f * v +
+                       0.3965f * t[i] * v;
+        windChill[i] = valid ? c : derivedNan();
+    }
+}
+
+// Rothfusz regression used by US National Weather Service
+inline void deriveHeatIndex(const float *t,
+                            const float *rh,
+                            float *heatIndex,
+                            std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        const auto valid = (t[i] >= 26.7f) & (rh[i] == rh[i]);
+        const auto f = t[i] * 1.8f + 32.0f;
+        const auto r = rh[i];
+        const auto hi = -42.379f + 2.04901523f * f + 10.14333127f * r -
+                        0.22475541f * f * r - 0.00683783f * f * f -
+                        0.05481717f * r * r + 0.00122874f * f * f * r +
+                        0.00085282f * f * r * r -
+                        0.00000199f * f * f * r * r;
+        const auto c = (hi - 32.0f) / 1.8f;
+        heatIndex[i] = valid ? c : derivedNan();
+    }
+}
+
+inline void derivePressureAltitude(const float *stationPressure,
+                                   const float *qnh,
+                                   const float *elevation,
+                                   float *pressureAltitude,
+                                   std::size_t n) {
+    const auto table = standardPressureAltitude().lookup();
+    for (std::size_t i = 0; i < n; i++) {
+        const auto useStation = stationPressure[i] == stationPressure[i];
+        const auto x = derivedArg(useStation ? stationPressure[i] : qnh[i]);
+        const auto tabulated = table(x);
+        const auto approximated = standardPressureAltitudeApprox(x);
+        const auto p =
+            table.contains(x) | (x <= 0.0f) ? tabulated : approximated;
+        // Pressure altitude at station from QNH is elevation plus pressure
+        // altitude of QNH
+        const auto valid = (useStation | (qnh[i] == qnh[i])) & (x > 0.0f);
+        const auto fromQnh = p + elevation[i];
+        const auto result = useStation ? p : fromQnh;
+        pressureAltitude[i] = valid ? result : derivedNan();
+    }
+}
+
+inline void deriveDensityAltitude(const float *pressureAltitude,
+                                  const float *t,
+                                  float *densityAltitude,
+                                  std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        const auto isaTemperature = 15.0f - 1.98f * pressureAltitude[i] / 1000;
+        densityAltitude[i] =
+            pressureAltitude[i] + 118.8f * (t[i] - isaTemperature);
+    }
+}
+
+inline void deriveCloudBase(const float *depression,
+                            float *cloudBase,
+                            std::size_t n) {
+    // Temperature / dew point spread decreases by about 2.5C per 1000 ft
+    for (std::size_t i = 0; i < n; i++) {
+        const auto valid = depression[i] >= 0.0f;
+        const auto height = depression[i] * 400.0f;
+        cloudBase[i] = valid ? height : derivedNan();
+    }
+}
+
+}  // namespace detail
+
+void computeDerived(DerivedColumns &c) {
+    const auto n = c.size();
+    detail::deriveHumidity(c.temperatureC.data(),
+                           c.dewPointC.data(),
+                           c.relativeHumidity.data(),
+                           c.dewPointDepressionC.data(),
+                           n);
+    detail::deriveWindChill(c.temperatureC.data(),
+                            c.windSpeedKt.data(),
+                            c.windChillC.data(),
+                            n);
+    detail::deriveHeatIndex(c.temperatureC.data(),
+                            c.relativeHumidity.data(),
+                            c.heatIndexC.data(),
+                            n);
+    detail::derivePressureAltitude(c.stationPressureHpa.data(),
+                                   c.qnhHpa.data(),
+                                   c.elevationFt.data(),
+                                   c.pressureAltitudeFt.data(),
+                                   n);
+    detail::deriveDensityAltitude(c.pressureAltitudeFt.data(),
+                                  c.temperatureC.data(),
+                                  c.densityAltitudeFt.data(),
+                                  n);
+    detail::deriveCloudBase(c.dewPointDepressionC.data(),
+                            c.cloudBaseFt.data(),
+                            n);
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_DERIVED_HPP
@@ -0,0 +1,241 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_EPOCH_HPP
+#define METAFSIMPLE_EPOCH_HPP
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+// Resolution of report times (day of month, hour and minute) to absolute
+// time in seconds since 1970-01-01 00:00 UTC, using a reference time which
+// is close to the report release time (e.g. receive time or date of the
+// file which contains the report).
+//
+// Month and year are taken from the reference time; times near the month
+// boundary are resolved into the previous or next month. Times with no day
+// (and times with no hour) are resolved to the day (or hour) of the time
+// they relate to, e.g. trend times in METAR are resolved relative to the
+// report release time.
+
+namespace metafsimple {
+
+using EpochTime = std::optional<std::int64_t>;
+
+enum class TimeResolution {
+    NEAREST,     // Time nearest to anchor
+    NOT_BEFORE,  // Earliest time at or after anchor (e.g. forecast)
+    NOT_AFTER    // Latest time at or before anchor (e.g. past event)
+};
+
+// Resolve time relative to anchor time in seconds since epoch; returns
+// empty optional if hour and minute are not specified or the values are
+// out of range
+inline EpochTime resolveTime(const Time &time,
+                             std::int64_t anchor,
+                             TimeResolution resolution =
+                                 TimeResolution::NEAREST);
+
+// All times of simplified report resolved in one pass. Report release time
+// is resolved as the nearest to the reference time; other times are
+// resolved relative to the report release time (or start of validity
+// period for TAF with no release time):
+//  - validity period and TAF trend times: not before the start of validity
+//    period;
+//  - METAR trend times: not before the report release time;
+//  - peak wind, wind shift and recent weather event times: not after the
+//    report release time.
+struct ResolvedTimes {
+    struct TrendTimes {
+        EpochTime from;
+        EpochTime until;
+        EpochTime at;
+    };
+    EpochTime reportTime;
+    EpochTime applicableFrom;
+    EpochTime applicableUntil;
+    EpochTime peakWindObserved;
+    EpochTime windShiftBegan;
+    std::vector<EpochTime> recentWeather;   // Historical::recentWeather
+    std::vector<TrendTimes> trends;         // Forecast::trends
+    std::vector<EpochTime> minTemperature;  // Forecast::minTemperature
+    std::vector<EpochTime> maxTemperature;  // Forecast::maxTemperature
+};
+
+inline ResolvedTimes resolveTimes(const Simple &report,
+                                  std::int64_t referenceTime);
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+inline std::int64_t epochFloorDiv(std::int64_t a, std::int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Days since 1970-01-01 of the date in proleptic Gregorian calendar and
+// the inverse; algorithms by Howard Hinnant, "chrono-Compatible Low-Level
+// Date Algorithms". Years start on March 1, so that leap day is the last
+// day of the year.
+inline std::int64_t daysFromCivil(std::int64_t year, int month, int day) {
+    const auto y = year - (month <= 2);
+    const auto era = epochFloorDiv(y, 400);
+    const auto yearOfEra = y - era * 400;
+    const auto dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 +
+                           day - 1;
+    const auto dayOfEra =
+        yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+struct CivilDate {
+    std::int64_t year = 1970;
+    int month = 1;
+    int day = 1;
+};
+
+inline CivilDate civilFromDays(std::int64_t days) {
+    const auto z = days + 719468;
+    const auto era = epochFloorDiv(z, 146097);
+    const auto dayOfEra = z - era * 146097;
+    const auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                            dayOfEra / 146096) /
+                           365;
+    const auto dayOfYear =
+        dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const auto mp = (5 * dayOfYear + 2) / 153;
+    CivilDate result;
+    result.day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    result.month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    result.year = yearOfEra + era * 400 + (result.month <= 2);
+    return result;
+}
+
+inline int daysInMonth(std::int64_t year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2) {
+        const auto leap = (!(year % 4) && (year % 100)) || !(year % 400);
+        return leap ? 29 : 28;
+    }
+    return days[month - 1];
+}
+
+}  // namespace detail
+
+EpochTime resolveTime(const Time &time,
+                      std::int64_t anchor,
+                      TimeResolution resolution) {
+    static const std::int64_t hourSeconds = 3600;
+    static const std::int64_t daySeconds = 24 * hourSeconds;
+    if (!time.hour.has_value() && !time.minute.has_value()) return EpochTime();
+    if (time.day.has_value() && !time.hour.has_value()) return EpochTime();
+    const auto day = time.day.value_or(1);
+    const auto hour = time.hour.value_or(0);
+    const auto minute = time.minute.value_or(0);
+    // Hour 24 is used in TAF for the end of the day
+    if (day < 1 || day > 31 || hour < 0 || hour > 24 || minute < 0 ||
+        minute > 59)
+        return EpochTime();
+    const auto timeOfDay = hour * hourSeconds + minute * 60;
+
+    // Candidates in the months (days, hours) around the anchor
+    static const auto maxCandidates = 5;
+    std::int64_t candidates[maxCandidates];
+    auto count = 0;
+    if (time.day.has_value()) {
+        const auto date =
+            detail::civilFromDays(detail::epochFloorDiv(anchor, daySeconds));
+        // Day 29 to 31 may not exist in the adjacent month
+        for (auto offset = -2; offset <= 2; offset++) {
+            auto month = date.month + offset;
+            auto year = date.year;
+            if (month < 1) {
+                month += 12;
+                year--;
+            }
+            if (month > 12) {
+                month -= 12;
+                year++;
+            }
+            if (day > detail::daysInMonth(year, month)) continue;
+            candidates[count++] =
+                detail::daysFromCivil(year, month, day) * daySeconds +
+                timeOfDay;
+        }
+    } else {
+        const auto period = time.hour.has_value() ? daySeconds : hourSeconds;
+        const auto offset = time.hour.has_value() ? timeOfDay : minute * 60;
+        const auto start = detail::epochFloorDiv(anchor, period) * period;
+        for (auto i = -1; i <= 1; i++)
+            candidates[count++] = start + i * period + offset;
+    }
+
+    EpochTime result;
+    std::int64_t resultDistance = 0;
+    for (auto i = 0; i < count; i++) {
+        const auto c = candidates[i];
+        if (resolution == TimeResolution::NOT_BEFORE && c < anchor) continue;
+        if (resolution == TimeResolution::NOT_AFTER && c > anchor) continue;
+        const auto distance = c > anchor ? c - anchor : anchor - c;
+        if (result.has_value() && distance >= resultDistance) continue;
+        result = c;
+        resultDistance = distance;
+    }
+    return result;
+}
+
+ResolvedTimes resolveTimes(const Simple &report, std::int64_t referenceTime) {
+    ResolvedTimes result;
+    const auto &r = report.report;
+    result.reportTime = resolveTime(r.reportTime, referenceTime);
+    // TAF may be reported with no release time
+    const auto validityAnchor = result.reportTime.value_or(referenceTime);
+    result.applicableFrom = resolveTime(r.applicableFrom, validityAnchor);
+    const auto from = result.applicableFrom.value_or(validityAnchor);
+    result.applicableUntil =
+        resolveTime(r.applicableUntil, from, TimeResolution::NOT_BEFORE);
+    const auto anchor = result.reportTime.value_or(from);
+
+    const auto &h = report.historical;
+    const auto past = TimeResolution::NOT_AFTER;
+    result.peakWindObserved = resolveTime(h.peakWindObserved, anchor, past);
+    result.windShiftBegan = resolveTime(h.windShiftBegan, anchor, past);
+    result.recentWeather.reserve(h.recentWeather.size());
+    for (const auto &e : h.recentWeather)
+        result.recentWeather.push_back(resolveTime(e.time, anchor, past));
+
+    // Trends in TAF follow the validity period, trends in METAR follow the
+    // report release time
+    const auto &f = report.forecast;
+    const auto future = TimeResolution::NOT_BEFORE;
+    const auto isTaf = r.type == Report::Type::TAF;
+    const auto trendAnchor = isTaf ? from : anchor;
+    result.trends.reserve(f.trends.size());
+    for (const auto &t : f.trends) {
+        ResolvedTimes::TrendTimes times;
+        times.from = resolveTime(t.timeFrom, trendAnchor, future);
+        times.until =
+            resolveTime(t.timeUntil, times.from.value_or(trendAnchor), future);
+        times.at = resolveTime(t.timeAt, trendAnchor, future);
+        result.trends.push_back(times);
+    }
+    result.minTemperature.reserve(f.minTemperature.size());
+    for (const auto &t : f.minTemperature)
+        result.minTemperature.push_back(resolveTime(t.time, from, future));
+    result.maxTemperature.reserve(f.maxTemperature.size());
+    for (const auto &t : f.maxTemperature)
+        result.maxTemperature.push_back(resolveTime(t.time, from, future));
+    return result;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_EPOCH_HPP
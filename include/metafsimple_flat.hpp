@@ -0,0 +1,122 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_FLAT_HPP
+#define METAFSIMPLE_FLAT_HPP
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "metafsimple.hpp"
+#include "metafsimple_c.h"
+
+static_assert(std::is_trivially_copyable_v<metafsimple_record>);
+static_assert(sizeof(metafsimple_record) == 136);
+
+namespace metafsimple {
+
+// Flatten simplified report into fixed-size record defined by C API
+inline void flatten(const Simple &simple, metafsimple_record &record);
+
+}  // namespace metafsimple
+
+namespace metafsimple::detail {
+
+inline std::int32_t flatValue(std::optional<double> value) {
+    if (!value.has_value()) return METAFSIMPLE_NO_VALUE;
+    return static_cast<std::int32_t>(std::lround(*value));
+}
+
+inline std::int32_t flatValue(std::optional<int> value) {
+    if (!value.has_value()) return METAFSIMPLE_NO_VALUE;
+    return *value;
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+void flatten(const Simple &simple, metafsimple_record &record) {
+    using detail::flatValue;
+    record = metafsimple_record();
+
+    const auto icao = simple.station.icaoCode.substr(0, sizeof(record.icao) - 1);
+    std::memcpy(record.icao, icao.data(), icao.length());
+
+    const auto &report = simple.report;
+    record.report_type = static_cast<std::int32_t>(report.type);
+    record.error = static_cast<std::int32_t>(report.error);
+    if (report.missing) record.flags |= METAFSIMPLE_FLAG_MISSING;
+    if (report.cancelled) record.flags |= METAFSIMPLE_FLAG_CANCELLED;
+    if (report.correctional) record.flags |= METAFSIMPLE_FLAG_CORRECTIONAL;
+    if (report.amended) record.flags |= METAFSIMPLE_FLAG_AMENDED;
+    if (report.automated) record.flags |= METAFSIMPLE_FLAG_AUTOMATED;
+    if (simple.forecast.noSignificantChanges)
+        record.flags |= METAFSIMPLE_FLAG_NOSIG;
+    record.report_day = flatValue(report.reportTime.day);
+    record.report_hour = flatValue(report.reportTime.hour);
+    record.report_minute = flatValue(report.reportTime.minute);
+    record.applicable_from_day = flatValue(report.applicableFrom.day);
+    record.applicable_from_hour = flatValue(report.applicableFrom.hour);
+    record.applicable_until_day = flatValue(report.applicableUntil.day);
+    record.applicable_until_hour = flatValue(report.applicableUntil.hour);
+
+    const auto &e = (report.type == Report::Type::TAF)
+                        ? simple.forecast.prevailing
+                        : simple.current.weatherData;
+    if (e.windCalm) record.flags |= METAFSIMPLE_FLAG_WIND_CALM;
+    if (e.windDirectionVariable) record.flags |= METAFSIMPLE_FLAG_WIND_VARIABLE;
+    if (e.cavok) record.flags |= METAFSIMPLE_FLAG_CAVOK;
+    switch (e.visibility.details) {
+        case Distance::Details::EXACTLY:
+            break;
+        case Distance::Details::LESS_THAN:
+            record.flags |= METAFSIMPLE_FLAG_VIS_LESS_THAN;
+            break;
+        case Distance::Details::MORE_THAN:
+            record.flags |= METAFSIMPLE_FLAG_VIS_MORE_THAN;
+            break;
+    }
+    record.wind_direction_deg = flatValue(e.windDirectionDegrees);
+    record.wind_var_from_deg = flatValue(e.windDirectionVarFromDegrees);
+    record.wind_var_to_deg = flatValue(e.windDirectionVarToDegrees);
+    record.wind_speed_kt = flatValue(e.windSpeed.toUnit(Speed::Unit::KT));
+    record.gust_speed_kt = flatValue(e.gustSpeed.toUnit(Speed::Unit::KT));
+    record.visibility_m =
+        flatValue(e.visibility.toUnit(Distance::Unit::METERS));
+    record.ceiling_ft =
+        flatValue(e.ceilingHeight().toUnit(Height::Unit::FEET));
+    record.vertical_visibility_ft =
+        flatValue(e.verticalVisibility.toUnit(Height::Unit::FEET));
+    record.sky_condition = static_cast<std::int32_t>(e.skyCondition);
+    for (const auto &w : e.weather) {
+        record.weather_mask |= (std::uint64_t(1)
+                                << static_cast<unsigned int>(w.phenomena));
+        for (const auto p : w.precipitation)
+            record.precipitation_mask |=
+                (1u << static_cast<unsigned int>(p));
+    }
+
+    const auto &current = simple.current;
+    record.temperature_tenth_c =
+        flatValue(current.airTemperature.toUnit(Temperature::Unit::TENTH_C));
+    record.dew_point_tenth_c =
+        flatValue(current.dewPoint.toUnit(Temperature::Unit::TENTH_C));
+    record.relative_humidity = flatValue(current.relativeHumidity);
+    record.pressure_tenth_hpa =
+        flatValue(e.seaLevelPressure.toUnit(Pressure::Unit::TENTHS_HPA));
+
+    record.trend_count =
+        static_cast<std::uint32_t>(simple.forecast.trends.size());
+    record.warning_count = static_cast<std::uint32_t>(report.warnings.size());
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_FLAT_HPP
@@ -0,0 +1,217 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_GRID_HPP
+#define METAFSIMPLE_GRID_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_timeline.hpp"
+
+namespace metafsimple {
+
+// Hourly forecast for multiple stations in columnar form: each data column
+// holds stations x hours values, row per station, cell (station, hour) is at
+// index(station, hour). Hour 0 of each row is the start of the TAF validity
+// period (startDay / startHour), cells after the end of validity period and
+// values not forecast are noValue (same as METAFSIMPLE_NO_VALUE of C API).
+// Weather mask has the same format as metafsimple_record::weather_mask.
+struct ForecastGrid {
+    static constexpr std::int32_t noValue =
+        std::numeric_limits<std::int32_t>::min();
+
+    // Allocate buffers for given number of stations and hours per station
+    inline void resize(std::size_t stationCount, std::size_t hourCount);
+    std::size_t stations() const { return icao.size(); }
+    std::size_t hours() const { return hoursPerRow; }
+    std::size_t index(std::size_t station, std::size_t hour) const {
+        return station * hoursPerRow + hour;
+    }
+
+    // Per-station columns
+    std::vector<IcaoCode> icao;
+    std::vector<std::int32_t> startDay;
+    std::vector<std::int32_t> startHour;
+    std::vector<std::int32_t> validHours;
+
+    // Per-cell columns: governing conditions at the start of hour
+    std::vector<std::int32_t> windDirectionDeg;
+    std::vector<std::int32_t> windSpeedKt;
+    std::vector<std::int32_t> gustSpeedKt;
+    std::vector<std::int32_t> visibilityM;
+    std::vector<std::int32_t> ceilingFt;
+    std::vector<std::uint64_t> weatherMask;
+    // Per-cell columns: lowest values during the hour including temporary
+    // and transitional conditions
+    std::vector<std::int32_t> minVisibilityM;
+    std::vector<std::int32_t> minCeilingFt;
+
+   private:
+    std::size_t hoursPerRow = 0;
+};
+
+// Fill grid row from simplified TAF; reference time is the same as for
+// TafTimeline; data beyond grid row length are not stored
+inline void fillGridRow(const Simple &taf,
+                        ForecastGrid &grid,
+                        std::size_t row,
+                        std::int64_t referenceTime);
+
+// Fill grid rows from TAFs (row i from tafs[i]) using given number of
+// threads; grid must have at least tafs.size() rows allocated; reference
+// time is passed to fillGridRow
+inline void fillGrid(const std::vector<Simple> &tafs,
+                     ForecastGrid &grid,
+                     std::int64_t referenceTime,
+                     unsigned int threads = 1);
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ForecastGrid::resize(std::size_t stationCount, std::size_t hourCount) {
+    hoursPerRow = hourCount;
+    icao.assign(stationCount, IcaoCode());
+    startDay.assign(stationCount, noValue);
+    startHour.assign(stationCount, noValue);
+    validHours.assign(stationCount, 0);
+    const auto cells = stationCount * hourCount;
+    windDirectionDeg.assign(cells, noValue);
+    windSpeedKt.assign(cells, noValue);
+    gustSpeedKt.assign(cells, noValue);
+    visibilityM.assign(cells, noValue);
+    ceilingFt.assign(cells, noValue);
+    weatherMask.assign(cells, 0);
+    minVisibilityM.assign(cells, noValue);
+    minCeilingFt.assign(cells, noValue);
+}
+
+namespace detail {
+
+inline std::int32_t gridValue(std::optional<double> value) {
+    if (!value.has_value()) return ForecastGrid::noValue;
+    return static_cast<std::int32_t>(std::lround(*value));
+}
+
+inline std::int32_t gridValue(std::optional<int> value) {
+    return value.value_or(ForecastGrid::noValue);
+}
+
+inline std::int32_t gridMin(std::int32_t a, std::int32_t b) {
+    if (a == ForecastGrid::noValue) return b;
+    if (b == ForecastGrid::noValue) return a;
+    return std::min(a, b);
+}
+
+inline std::int32_t gridVisibility(const Essentials &e) {
+    return gridValue(e.visibility.toUnit(Distance::Unit::METERS));
+}
+
+inline std::int32_t gridCeiling(const Essentials &e) {
+    return gridValue(e.ceilingHeight().toUnit(Height::Unit::FEET));
+}
+
+}  // namespace detail
+
+void fillGridRow(const Simple &taf,
+                 ForecastGrid &grid,
+                 std::size_t row,
+                 std::int64_t referenceTime) {
+    using detail::gridMin;
+    using detail::gridValue;
+    const auto noValue = ForecastGrid::noValue;
+    const auto hours = grid.hours();
+    const auto first = grid.index(row, 0);
+    // Clear row in case it was filled before
+    std::fill_n(grid.windDirectionDeg.begin() + first, hours, noValue);
+    std::fill_n(grid.windSpeedKt.begin() + first, hours, noValue);
+    std::fill_n(grid.gustSpeedKt.begin() + first, hours, noValue);
+    std::fill_n(grid.visibilityM.begin() + first, hours, noValue);
+    std::fill_n(grid.ceilingFt.begin() + first, hours, noValue);
+    std::fill_n(grid.weatherMask.begin() + first, hours, 0);
+    std::fill_n(grid.minVisibilityM.begin() + first, hours, noValue);
+    std::fill_n(grid.minCeilingFt.begin() + first, hours, noValue);
+
+    grid.icao[row] = taf.station.icao();
+    grid.startDay[row] = gridValue(taf.report.applicableFrom.day);
+    grid.startHour[row] = gridValue(taf.report.applicableFrom.hour);
+    const TafTimeline timeline(taf, referenceTime);
+    const auto validHours = (timeline.length() + 59) / 60;
+    grid.validHours[row] = validHours;
+
+    // Segments and hours are both in time order: single linear sweep
+    const auto &segments = timeline.data();
+    auto seg = segments.begin();
+    const auto end = std::min<std::size_t>(validHours, hours);
+    for (std::size_t h = 0; h < end; h++) {
+        const int hourBegin = h * 60, hourEnd = hourBegin + 60;
+        while (seg != segments.end() && seg->end <= hourBegin) ++seg;
+        if (seg == segments.end()) break;
+        const auto cell = first + h;
+        const auto &g = seg->governing;
+        grid.windDirectionDeg[cell] = gridValue(g.windDirectionDegrees);
+        grid.windSpeedKt[cell] = gridValue(g.windSpeed.toUnit(Speed::Unit::KT));
+        grid.gustSpeedKt[cell] = gridValue(g.gustSpeed.toUnit(Speed::Unit::KT));
+        grid.visibilityM[cell] = detail::gridVisibility(g);
+        grid.ceilingFt[cell] = detail::gridCeiling(g);
+        std::uint64_t weather = 0;
+        for (const auto &w : g.weather) {
+            weather |= std::uint64_t(1)
+                       << static_cast<unsigned int>(w.phenomena);
+        }
+        grid.weatherMask[cell] = weather;
+
+        auto minVis = noValue, minCeiling = noValue;
+        for (auto s = seg; s != segments.end() && s->begin < hourEnd; ++s) {
+            minVis = gridMin(minVis, detail::gridVisibility(s->governing));
+            minCeiling = gridMin(minCeiling, detail::gridCeiling(s->governing));
+            for (const auto &t : s->temporary) {
+                minVis = gridMin(minVis, detail::gridVisibility(t.conditions));
+                minCeiling =
+                    gridMin(minCeiling, detail::gridCeiling(t.conditions));
+            }
+        }
+        grid.minVisibilityM[cell] = minVis;
+        grid.minCeilingFt[cell] = minCeiling;
+    }
+}
+
+void fillGrid(const std::vector<Simple> &tafs,
+              ForecastGrid &grid,
+              std::int64_t referenceTime,
+              unsigned int threads) {
+    const auto rows = std::min(tafs.size(), grid.stations());
+    // Rows are handed out in small blocks: TAFs differ in number of trends,
+    // so static partitioning would leave some threads idle
+    static const std::size_t blockSize = 16;
+    std::atomic<std::size_t> nextBlock(0);
+    const auto worker = [&]() {
+        for (auto b = nextBlock++; b * blockSize < rows; b = nextBlock++) {
+            const auto end = std::min((b + 1) * blockSize, rows);
+            for (auto row = b * blockSize; row < end; row++)
+                fillGridRow(tafs[row], grid, row, referenceTime);
+        }
+    };
+    const auto blocks = (rows + blockSize - 1) / blockSize;
+    const auto threadCount =
+        std::max<std::size_t>(1, std::min<std::size_t>(threads, blocks));
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threadCount; i++) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_GRID_HPP
@@ -0,0 +1,310 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_HAZARDS_HPP
+#define METAFSIMPLE_HAZARDS_HPP
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+// Inverted index from weather phenomena and hazards to the stations which
+// currently report them, either in the latest observation (METAR / SPECI)
+// or in the latest TAF (prevailing conditions or any trend).
+//
+// Stations are assigned dense numbers in order of appearance; for each
+// hazard the index keeps a bitmap over station numbers. When a new report
+// arrives only the bits of hazards which appeared or disappeared since the
+// previous report of the station are updated.
+
+namespace metafsimple {
+
+// Hazards which are not weather phenomena
+enum class HazardFlag {
+    CUMULONIMBUS,      // CB cloud layer
+    TOWERING_CUMULUS,  // TCU cloud layer
+    LIGHTNING,         // Lightning strikes observed
+    WIND_SHEAR         // Wind shear reported or forecast
+};
+
+// Hazard keys: Weather::Phenomena, then Weather::Precipitation, then
+// ObservedPhenomena (in vicinity), then HazardFlag
+namespace detail {
+static const std::size_t hazardPhenomenaCount =
+    static_cast<std::size_t>(
+        Weather::Phenomena::THUNDERSTORM_PRECIPITATION_HEAVY) +
+    1;
+static const std::size_t hazardPrecipitationCount =
+    static_cast<std::size_t>(Weather::Precipitation::UNDETERMINED) + 1;
+static const std::size_t hazardVicinityCount =
+    static_cast<std::size_t>(ObservedPhenomena::FUNNEL_CLOUD) + 1;
+static const std::size_t hazardFlagCount =
+    static_cast<std::size_t>(HazardFlag::WIND_SHEAR) + 1;
+}  // namespace detail
+
+static const std::size_t hazardKeyCount =
+    detail::hazardPhenomenaCount + detail::hazardPrecipitationCount +
+    detail::hazardVicinityCount + detail::hazardFlagCount;
+
+inline std::size_t hazardKey(Weather::Phenomena p) {
+    return static_cast<std::size_t>(p);
+}
+
+inline std::size_t hazardKey(Weather::Precipitation p) {
+    return detail::hazardPhenomenaCount + static_cast<std::size_t>(p);
+}
+
+inline std::size_t hazardKey(ObservedPhenomena p) {
+    return detail::hazardPhenomenaCount + detail::hazardPrecipitationCount +
+           static_cast<std::size_t>(p);
+}
+
+inline std::size_t hazardKey(HazardFlag f) {
+    return detail::hazardPhenomenaCount + detail::hazardPrecipitationCount +
+           detail::hazardVicinityCount + static_cast<std::size_t>(f);
+}
+
+using HazardSet = std::bitset<hazardKeyCount>;
+
+// Hazards reported in observation (current weather, phenomena in vicinity,
+// cloud layers, lightning, wind shear)
+inline HazardSet observedHazards(const Simple &report);
+// Hazards forecast in TAF prevailing conditions or any trend
+inline HazardSet forecastHazards(const Simple &report);
+
+// Set of stations as bitmap over station numbers
+class StationBitmap {
+   public:
+    bool test(std::uint32_t station) const {
+        const auto w = station / 64;
+        return w < words.size() && ((words[w] >> (station % 64)) & 1);
+    }
+    inline void set(std::uint32_t station, bool value = true);
+    inline std::size_t count() const;
+    bool empty() const { return !count(); }
+    // Calls f(station number) for each station in the set, in ascending
+    // order of station numbers
+    template <typename F>
+    void forEach(F &&f) const;
+    inline StationBitmap &operator&=(const StationBitmap &other);
+    inline StationBitmap &operator|=(const StationBitmap &other);
+    // Remove stations which are in other set
+    inline StationBitmap &subtract(const StationBitmap &other);
+    const std::vector<std::uint64_t> &data() const { return words; }
+
+   private:
+    std::vector<std::uint64_t> words;
+};
+
+class HazardIndex {
+   public:
+    enum class Source { OBSERVED, FORECAST };
+
+    // Index METAR / SPECI as observed hazards or TAF as forecast hazards of
+    // the station, replacing previously indexed report of the same source;
+    // returns false if report was not indexed
+    inline bool update(const Simple &report);
+    // Replace hazards of the station
+    inline void update(IcaoCode icao, Source source, const HazardSet &hazards);
+    // Remove all hazards of the station (e.g. when the report expires)
+    void clear(IcaoCode icao, Source source) {
+        update(icao, source, HazardSet());
+    }
+
+    // Stations with given hazard
+    const StationBitmap &stations(Source source, std::size_t key) const {
+        return bitmaps[static_cast<std::size_t>(source)][key];
+    }
+    inline std::vector<IcaoCode> stationCodes(Source source,
+                                              std::size_t key) const;
+    // Hazards currently indexed for station
+    inline HazardSet hazards(IcaoCode icao, Source source) const;
+
+    // Dense station numbering
+    std::size_t stationCount() const { return codes.size(); }
+    IcaoCode station(std::uint32_t number) const { return codes[number]; }
+    inline std::optional<std::uint32_t> number(IcaoCode icao) const;
+
+   private:
+    static const std::size_t sourceCount = 2;
+    inline std::uint32_t assign(IcaoCode icao);
+
+    std::unordered_map<IcaoCode, std::uint32_t> numbers;
+    std::vector<IcaoCode> codes;
+    // Indexed by station number
+    std::vector<HazardSet> current[sourceCount];
+    StationBitmap bitmaps[sourceCount][hazardKeyCount];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+inline void addHazards(const Essentials &e, HazardSet &result) {
+    for (const auto &w : e.weather) {
+        result.set(hazardKey(w.phenomena));
+        for (const auto p : w.precipitation) result.set(hazardKey(p));
+    }
+    for (const auto &cl : e.cloudLayers) {
+        if (cl.details == CloudLayer::Details::CUMULONIMBUS)
+            result.set(hazardKey(HazardFlag::CUMULONIMBUS));
+        if (cl.details == CloudLayer::Details::TOWERING_CUMULUS)
+            result.set(hazardKey(HazardFlag::TOWERING_CUMULUS));
+    }
+    if (!e.windShear.empty()) result.set(hazardKey(HazardFlag::WIND_SHEAR));
+}
+
+}  // namespace detail
+
+HazardSet observedHazards(const Simple &report) {
+    HazardSet result;
+    detail::addHazards(report.current.weatherData, result);
+    for (const auto &v : report.current.phenomenaInVicinity)
+        result.set(hazardKey(v.phenomena));
+    if (!report.current.lightningStrikes.empty())
+        result.set(hazardKey(HazardFlag::LIGHTNING));
+    for (const auto &r : report.aerodrome.runways) {
+        if (r.windShearLowerLayers)
+            result.set(hazardKey(HazardFlag::WIND_SHEAR));
+    }
+    return result;
+}
+
+HazardSet forecastHazards(const Simple &report) {
+    HazardSet result;
+    const auto &forecast = report.forecast;
+    detail::addHazards(forecast.prevailing, result);
+    for (const auto p : forecast.prevailingVicinity) result.set(hazardKey(p));
+    if (forecast.prevailingWsConds)
+        result.set(hazardKey(HazardFlag::WIND_SHEAR));
+    for (const auto &t : forecast.trends) {
+        detail::addHazards(t.forecast, result);
+        for (const auto p : t.vicinity) result.set(hazardKey(p));
+        if (t.windShearConditions)
+            result.set(hazardKey(HazardFlag::WIND_SHEAR));
+    }
+    return result;
+}
+
+void StationBitmap::set(std::uint32_t station, bool value) {
+    const auto w = station / 64;
+    const auto bit = std::uint64_t(1) << (station % 64);
+    if (w >= words.size()) {
+        if (!value) return;
+        words.resize(w + 1);
+    }
+    if (value) {
+        words[w] |= bit;
+    } else {
+        words[w] &= ~bit;
+    }
+}
+
+std::size_t StationBitmap::count() const {
+    std::size_t result = 0;
+    for (const auto w : words) result += std::bitset<64>(w).count();
+    return result;
+}
+
+template <typename F>
+void StationBitmap::forEach(F &&f) const {
+    for (std::uint32_t i = 0; i < words.size(); i++) {
+        for (auto w = words[i]; w; w &= w - 1) {
+            // Index of the lowest set bit
+            const auto bit = std::bitset<64>((w & (~w + 1)) - 1).count();
+            f(static_cast<std::uint32_t>(i * 64 + bit));
+        }
+    }
+}
+
+StationBitmap &StationBitmap::operator&=(const StationBitmap &other) {
+    if (words.size() > other.words.size()) words.resize(other.words.size());
+    for (auto i = 0u; i < words.size(); i++) words[i] &= other.words[i];
+    return *this;
+}
+
+StationBitmap &StationBitmap::operator|=(const StationBitmap &other) {
+    if (words.size() < other.words.size()) words.resize(other.words.size());
+    for (auto i = 0u; i < other.words.size(); i++) words[i] |= other.words[i];
+    return *this;
+}
+
+StationBitmap &StationBitmap::subtract(const StationBitmap &other) {
+    const auto size = std::min(words.size(), other.words.size());
+    for (auto i = 0u; i < size; i++) words[i] &= ~other.words[i];
+    return *this;
+}
+
+std::uint32_t HazardIndex::assign(IcaoCode icao) {
+    const auto inserted = numbers.emplace(icao, codes.size());
+    if (inserted.second) {
+        codes.push_back(icao);
+        for (auto &c : current) c.emplace_back();
+    }
+    return inserted.first->second;
+}
+
+std::optional<std::uint32_t> HazardIndex::number(IcaoCode icao) const {
+    const auto it = numbers.find(icao);
+    if (it == numbers.end()) return std::optional<std::uint32_t>();
+    return it->second;
+}
+
+bool HazardIndex::update(const Simple &report) {
+    if (report.report.error != Report::Error::NO_ERROR) return false;
+    const auto icao = report.station.icao();
+    if (icao.empty()) return false;
+    switch (report.report.type) {
+        case Report::Type::METAR:
+        case Report::Type::SPECI:
+            update(icao, Source::OBSERVED, observedHazards(report));
+            return true;
+        case Report::Type::TAF:
+            update(icao, Source::FORECAST, forecastHazards(report));
+            return true;
+        default:
+            return false;
+    }
+}
+
+void HazardIndex::update(IcaoCode icao,
+                         Source source,
+                         const HazardSet &hazards) {
+    const auto s = static_cast<std::size_t>(source);
+    const auto station = assign(icao);
+    auto &previous = current[s][station];
+    const auto changed = previous ^ hazards;
+    if (changed.none()) return;
+    for (auto key = 0u; key < hazardKeyCount; key++) {
+        if (changed.test(key)) bitmaps[s][key].set(station, hazards.test(key));
+    }
+    previous = hazards;
+}
+
+std::vector<IcaoCode> HazardIndex::stationCodes(Source source,
+                                                std::size_t key) const {
+    std::vector<IcaoCode> result;
+    stations(source, key).forEach(
+        [&](std::uint32_t n) { result.push_back(codes[n]); });
+    return result;
+}
+
+HazardSet HazardIndex::hazards(IcaoCode icao, Source source) const {
+    const auto n = number(icao);
+    if (!n.has_value()) return HazardSet();
+    return current[static_cast<std::size_t>(source)][*n];
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_HAZARDS_HPP
@@ -0,0 +1,596 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_HISTORY_HPP
+#define METAFSIMPLE_HISTORY_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_flat.hpp"
+#include "metafsimple_serialize.hpp"
+
+// Persistent history of simplified reports: one append-only file per station.
+//
+// File layout (all integers in native byte order, records 8-byte aligned):
+//   file header
+//   record*: record header, metafsimple_record, serialized report, padding
+//   unused space (optional): left by previous footers or incomplete records
+//   footer (optional): index entry*, trailer
+// Each record carries CRC-32 of its contents. Records are appended in
+// chronological order and never modified. Every indexInterval-th record is
+// listed in sparse time index, so that records over a time range are found
+// by binary search and a short forward walk.
+//
+// Footer is written by flush() and close() at the end of file; trailer is
+// protected by CRC-32 of the footer. Before the next record is appended, the
+// trailer is invalidated and the record overwrites the footer. If the writer
+// has crashed, the file has no valid footer; the records are then scanned
+// and checked, and anything after the last valid record (e.g. partially
+// written record) is ignored by readers and overwritten by the next writer.
+// If a valid record is found after an invalid one, the file is damaged in
+// the middle rather than torn at the end: readers only see the records
+// before the damage, and writers refuse to open the file, so that the
+// records after the damage are not overwritten.
+//
+// Readers map the file into memory and access records in place; flattened
+// report is available without parsing, full report is deserialized on
+// demand. Since records are never modified, a file may be read while it is
+// being appended to; the reader sees the records present when it was opened.
+// Files are never truncated, so that the mapped pages remain backed by the
+// file.
+
+namespace metafsimple::detail {
+
+struct HistoryFileHeader {
+    static const std::uint32_t magicValue = 0x4D465348;  // "MFSH"
+    static const std::uint32_t versionValue = 1;
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t serializationVersion;
+    std::uint32_t recordSize;  // Size of metafsimple_record
+    std::uint32_t indexInterval;
+    std::uint32_t reserved[3];
+};
+
+struct HistoryRecordHeader {
+    std::uint32_t crc;     // Of the rest of record except padding
+    std::uint32_t length;  // Length of serialized report
+    std::int64_t time;
+};
+
+struct HistoryIndexEntry {
+    std::int64_t time;
+    std::uint64_t offset;
+};
+
+// Index entries are followed by the trailer at the end of file; there may be
+// unused space between the last record and the index
+struct HistoryTrailer {
+    static const std::uint32_t magicValue = 0x4D465346;  // "MFSF"
+    std::uint64_t dataEnd;  // End of the last record
+    std::uint64_t count;    // Number of records
+    std::uint32_t indexCount;
+    std::uint32_t magic;
+    std::uint32_t reserved;
+    std::uint32_t crc;  // Of index and the rest of trailer
+};
+
+static_assert(sizeof(HistoryFileHeader) == 32);
+static_assert(sizeof(HistoryRecordHeader) == 16);
+static_assert(sizeof(HistoryIndexEntry) == 16);
+static_assert(sizeof(HistoryTrailer) == 32);
+static_assert(sizeof(metafsimple_record) % 8 == 0);
+
+// Size of record with serialized report of given length including padding
+inline std::uint64_t historyRecordSize(std::uint64_t length) {
+    const auto size = sizeof(HistoryRecordHeader) +
+                      sizeof(metafsimple_record) + length;
+    return (size + 7) & ~std::uint64_t(7);
+}
+
+inline bool historyWrite(int fd,
+                         const char *data,
+                         std::size_t size,
+                         std::uint64_t offset) {
+    while (size) {
+        const auto written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+// Record of history file; pointers refer to memory mapped by the reader and
+// remain valid until the reader is closed
+struct HistoryEntry {
+    std::int64_t time = 0;
+    const metafsimple_record *record = nullptr;  // Flattened report
+    std::string_view data;  // Serialized report, see serialize()
+
+    std::optional<Simple> report() const { return deserialize(data); }
+};
+
+// Reads history file of a station
+class StationHistoryReader {
+   public:
+    StationHistoryReader() = default;
+    StationHistoryReader(const StationHistoryReader &) = delete;
+    StationHistoryReader &operator=(const StationHistoryReader &) = delete;
+    ~StationHistoryReader() { close(); }
+
+    // Returns false if file does not exist or has wrong format
+    inline bool open(const std::string &path);
+    inline void close();
+    bool isOpen() const { return base; }
+    // Number of records
+    std::size_t size() const { return count; }
+    // Records with time in range [from, until) in chronological order
+    inline std::vector<HistoryEntry> records(std::int64_t from,
+                                             std::int64_t until) const;
+    // The latest record; empty optional if there are no records
+    inline std::optional<HistoryEntry> latest() const;
+    // Check CRC of all records; records are not checked on open if the file
+    // has valid footer
+    inline bool verify() const;
+    // File has no valid footer and valid records follow an invalid one
+    bool damaged() const { return damage; }
+
+   private:
+    friend class StationHistoryWriter;
+    std::optional<HistoryEntry> entry(std::uint64_t offset, bool check) const {
+        return entry(offset, check, dataEnd);
+    }
+    inline std::optional<HistoryEntry> entry(std::uint64_t offset,
+                                             bool check,
+                                             std::uint64_t end) const;
+    inline void scan(std::uint64_t offset, std::size_t number, bool check);
+    inline bool loadFooter();
+    inline bool validRecordAfter(std::uint64_t offset) const;
+
+    const char *base = nullptr;
+    std::size_t mapSize = 0;
+    std::uint32_t indexInterval = 0;
+    std::uint64_t dataEnd = 0;
+    std::uint64_t lastOffset = 0;
+    std::size_t count = 0;
+    bool footer = false;  // File has valid footer
+    bool damage = false;
+    std::vector<detail::HistoryIndexEntry> index;
+};
+
+// Appends reports to history file of a station; only one writer per file
+// may exist at a time
+class StationHistoryWriter {
+   public:
+    StationHistoryWriter() = default;
+    StationHistoryWriter(const StationHistoryWriter &) = delete;
+    StationHistoryWriter &operator=(const StationHistoryWriter &) = delete;
+    ~StationHistoryWriter() { close(); }
+
+    // Open existing file or create a new one; index interval is only used
+    // when a new file is created. Returns false if file cannot be created,
+    // has wrong format or is damaged (see StationHistoryReader::damaged()).
+    inline bool open(const std::string &path,
+                     std::uint32_t indexInterval = 64);
+    // Write footer and close file
+    inline void close();
+    bool isOpen() const { return fd >= 0; }
+    // Append report observed or issued at given time (see resolveTimes() in
+    // metafsimple_epoch.hpp); returns false if the time is earlier than the
+    // time of the latest record or the record could not be written
+    inline bool append(const Simple &simple, std::int64_t time);
+    // Sync records to disk and write footer, so that readers do not have to
+    // scan the file
+    inline bool flush();
+    // Number of records
+    std::size_t size() const { return count; }
+
+   private:
+    int fd = -1;
+    std::uint32_t indexInterval = 0;
+    std::uint64_t dataEnd = 0;
+    std::uint64_t fileSize = 0;
+    std::size_t count = 0;
+    std::optional<std::int64_t> lastTime;
+    bool footer = false;  // Valid footer is at the end of file
+    std::vector<detail::HistoryIndexEntry> index;
+    std::string buffer;
+};
+
+// History files of multiple stations in a directory, one file per station;
+// at most maxOpenFiles files are kept open, the least recently appended one
+// is closed when another file needs to be opened
+class StationHistoryStore {
+   public:
+    explicit StationHistoryStore(const std::string &directory,
+                                 std::uint32_t indexInterval = 64,
+                                 std::size_t maxOpenFiles = 256)
+        : directory(directory),
+          indexInterval(indexInterval),
+          maxOpenFiles(std::max(maxOpenFiles, std::size_t(1))) {}
+    // Append report to the file of the station it was issued for; reports
+    // with no valid ICAO code are not stored
+    inline bool append(const Simple &simple, std::int64_t time);
+    // Write footers of all open files
+    inline bool flush();
+    void close() { writers.clear(); }
+    // Number of open files
+    std::size_t openFiles() const { return writers.size(); }
+    // Path of history file of the station
+    static std::string path(const std::string &directory, IcaoCode icao) {
+        return directory + '/' + icao.toString() + ".mfsh";
+    }
+
+   private:
+    struct OpenFile {
+        StationHistoryWriter writer;
+        std::uint64_t lastUse = 0;
+    };
+    inline void closeLeastRecent();
+
+    std::string directory;
+    std::uint32_t indexInterval;
+    std::size_t maxOpenFiles;
+    std::uint64_t uses = 0;
+    std::unordered_map<IcaoCode, OpenFile> writers;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool StationHistoryReader::open(const std::string &path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    const auto headerSize = sizeof(detail::HistoryFileHeader);
+    void *p = MAP_FAILED;
+    if (!fstat(fd, &st) && static_cast<std::size_t>(st.st_size) >= headerSize)
+        p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    base = static_cast<const char *>(p);
+    mapSize = st.st_size;
+
+    detail::HistoryFileHeader h;
+    std::memcpy(&h, base, sizeof(h));
+    if (h.magic != detail::HistoryFileHeader::magicValue ||
+        h.version != detail::HistoryFileHeader::versionValue ||
+        h.serializationVersion != serializationVersion ||
+        h.recordSize != sizeof(metafsimple_record) || !h.indexInterval) {
+        close();
+        return false;
+    }
+    indexInterval = h.indexInterval;
+    footer = loadFooter();
+    if (!footer) {
+        index.clear();
+        dataEnd = mapSize;
+        scan(headerSize, 0, true);
+        damage = validRecordAfter(dataEnd);
+    }
+    return true;
+}
+
+void StationHistoryReader::close() {
+    if (base) munmap(const_cast<char *>(base), mapSize);
+    base = nullptr;
+    mapSize = 0;
+    dataEnd = 0;
+    lastOffset = 0;
+    count = 0;
+    footer = false;
+    damage = false;
+    index.clear();
+}
+
+std::vector<HistoryEntry> StationHistoryReader::records(
+    std::int64_t from, std::int64_t until) const {
+    std::vector<HistoryEntry> result;
+    if (until <= from) return result;
+    // Records before the last index entry earlier than range are earlier too
+    auto it = std::lower_bound(
+        index.begin(),
+        index.end(),
+        from,
+        [](const detail::HistoryIndexEntry &e, std::int64_t t) {
+            return e.time < t;
+        });
+    if (it != index.begin()) --it;
+    if (it == index.end()) return result;
+    for (auto offset = it->offset; offset < dataEnd;) {
+        const auto e = entry(offset, false);
+        if (!e.has_value() || e->time >= until) break;
+        if (e->time >= from) result.push_back(*e);
+        offset += detail::historyRecordSize(e->data.length());
+    }
+    return result;
+}
+
+std::optional<HistoryEntry> StationHistoryReader::latest() const {
+    if (!count) return std::optional<HistoryEntry>();
+    return entry(lastOffset, false);
+}
+
+bool StationHistoryReader::verify() const {
+    if (!isOpen()) return false;
+    auto offset = std::uint64_t(sizeof(detail::HistoryFileHeader));
+    std::size_t n = 0;
+    for (; offset < dataEnd; n++) {
+        const auto e = entry(offset, true);
+        if (!e.has_value()) return false;
+        offset += detail::historyRecordSize(e->data.length());
+    }
+    return n == count && offset == dataEnd;
+}
+
+std::optional<HistoryEntry> StationHistoryReader::entry(
+    std::uint64_t offset, bool check, std::uint64_t end) const {
+    static const auto fixedSize =
+        sizeof(detail::HistoryRecordHeader) + sizeof(metafsimple_record);
+    if (offset > end || end - offset < fixedSize)
+        return std::optional<HistoryEntry>();
+    detail::HistoryRecordHeader h;
+    std::memcpy(&h, base + offset, sizeof(h));
+    if (h.length > end - offset ||
+        detail::historyRecordSize(h.length) > end - offset)
+        return std::optional<HistoryEntry>();
+    const auto checked = std::string_view(base + offset + sizeof(h.crc),
+                                          fixedSize - sizeof(h.crc) + h.length);
+    if (check && crc32(checked) != h.crc) return std::optional<HistoryEntry>();
+    const auto *p = base + offset + sizeof(h);
+    HistoryEntry result;
+    result.time = h.time;
+    result.record = reinterpret_cast<const metafsimple_record *>(p);
+    result.data = std::string_view(p + sizeof(metafsimple_record), h.length);
+    return result;
+}
+
+void StationHistoryReader::scan(std::uint64_t offset,
+                                std::size_t number,
+                                bool check) {
+    // Stops at the first record which is incomplete, corrupted or out of
+    // chronological order; dataEnd is set to its offset
+    std::optional<std::int64_t> lastTime;
+    while (offset < dataEnd) {
+        const auto e = entry(offset, check);
+        if (!e.has_value() || (lastTime.has_value() && e->time < *lastTime))
+            break;
+        if (!(number % indexInterval) && index.size() <= number / indexInterval)
+            index.push_back(detail::HistoryIndexEntry{e->time, offset});
+        lastTime = e->time;
+        lastOffset = offset;
+        offset += detail::historyRecordSize(e->data.length());
+        number++;
+    }
+    dataEnd = offset;
+    count = number;
+}
+
+bool StationHistoryReader::validRecordAfter(std::uint64_t offset) const {
+    // Partially written record and remains of overwritten footers at the end
+    // of file never pass the CRC check; records are 8-byte aligned
+    for (offset += 8; offset < mapSize; offset += 8) {
+        if (entry(offset, true, mapSize).has_value()) return true;
+    }
+    return false;
+}
+
+bool StationHistoryReader::loadFooter() {
+    using detail::HistoryIndexEntry;
+    using detail::HistoryTrailer;
+    const auto headerSize = sizeof(detail::HistoryFileHeader);
+    if (mapSize < headerSize + sizeof(HistoryTrailer)) return false;
+    HistoryTrailer t;
+    std::memcpy(&t, base + mapSize - sizeof(t), sizeof(t));
+    const auto indexSize =
+        std::uint64_t(t.indexCount) * sizeof(HistoryIndexEntry);
+    if (t.magic != HistoryTrailer::magicValue || t.dataEnd < headerSize ||
+        t.dataEnd % 8 || indexSize > mapSize - headerSize - sizeof(t) ||
+        t.dataEnd > mapSize - sizeof(t) - indexSize ||
+        t.indexCount != (t.count + indexInterval - 1) / indexInterval)
+        return false;
+    const auto indexOffset = mapSize - sizeof(t) - indexSize;
+    const auto checked = std::string_view(
+        base + indexOffset, indexSize + sizeof(t) - sizeof(t.crc));
+    if (crc32(checked) != t.crc) return false;
+    index.resize(t.indexCount);
+    std::memcpy(index.data(), base + indexOffset, indexSize);
+    // Walk the records after the last index entry to find the latest one
+    dataEnd = t.dataEnd;
+    if (index.empty()) {
+        scan(headerSize, 0, false);
+    } else {
+        const auto number = (index.size() - 1) * indexInterval;
+        scan(index.back().offset, number, false);
+    }
+    return count == t.count && dataEnd == t.dataEnd;
+}
+
+bool StationHistoryWriter::open(const std::string &path,
+                                std::uint32_t interval) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    const auto fail = [this]() {
+        ::close(fd);
+        fd = -1;
+        return false;
+    };
+    struct stat st;
+    if (fstat(fd, &st)) return fail();
+    index.clear();
+    lastTime.reset();
+    footer = false;
+    const auto headerSize = sizeof(detail::HistoryFileHeader);
+    if (static_cast<std::size_t>(st.st_size) < headerSize) {
+        // New file, or creation of file was interrupted
+        if (!interval) return fail();
+        detail::HistoryFileHeader h;
+        std::memset(&h, 0, sizeof(h));
+        h.magic = detail::HistoryFileHeader::magicValue;
+        h.version = detail::HistoryFileHeader::versionValue;
+        h.serializationVersion = serializationVersion;
+        h.recordSize = sizeof(metafsimple_record);
+        h.indexInterval = interval;
+        if (ftruncate(fd, 0) ||
+            !detail::historyWrite(
+                fd, reinterpret_cast<const char *>(&h), sizeof(h), 0))
+            return fail();
+        indexInterval = interval;
+        dataEnd = headerSize;
+        fileSize = headerSize;
+        count = 0;
+        return true;
+    }
+    StationHistoryReader reader;
+    if (!reader.open(path) || reader.damaged()) return fail();
+    indexInterval = reader.indexInterval;
+    dataEnd = reader.dataEnd;
+    fileSize = reader.mapSize;
+    count = reader.count;
+    index = reader.index;
+    if (const auto e = reader.latest(); e.has_value()) lastTime = e->time;
+    // Footer and anything after the last valid record are overwritten by the
+    // next records
+    footer = reader.footer;
+    reader.close();
+    return true;
+}
+
+void StationHistoryWriter::close() {
+    if (!isOpen()) return;
+    flush();
+    ::close(fd);
+    fd = -1;
+}
+
+bool StationHistoryWriter::append(const Simple &simple, std::int64_t time) {
+    if (!isOpen() || (lastTime.has_value() && time < *lastTime)) return false;
+    detail::HistoryRecordHeader h;
+    metafsimple_record record;
+    flatten(simple, record);
+    buffer.assign(sizeof(h) + sizeof(record), '\0');
+    serialize(simple, buffer);
+    h.length = buffer.length() - sizeof(h) - sizeof(record);
+    h.time = time;
+    std::memcpy(&buffer[sizeof(h)], &record, sizeof(record));
+    std::memcpy(&buffer[0], &h, sizeof(h));
+    h.crc = crc32(std::string_view(buffer).substr(sizeof(h.crc)));
+    std::memcpy(&buffer[0], &h.crc, sizeof(h.crc));
+    buffer.resize(detail::historyRecordSize(h.length), '\0');
+
+    // Trailer must not describe the file once the record overwrites the
+    // footer; file is not truncated since readers may have it mapped
+    if (footer) {
+        static const std::uint32_t invalid = 0;
+        const auto magicOffset = fileSize - sizeof(detail::HistoryTrailer) +
+                                 offsetof(detail::HistoryTrailer, magic);
+        if (!detail::historyWrite(fd,
+                                  reinterpret_cast<const char *>(&invalid),
+                                  sizeof(invalid),
+                                  magicOffset))
+            return false;
+        footer = false;
+    }
+    // Partially written record is overwritten by the next append or
+    // ignored on the next open
+    if (!detail::historyWrite(fd, buffer.data(), buffer.length(), dataEnd))
+        return false;
+    if (!(count % indexInterval))
+        index.push_back(detail::HistoryIndexEntry{time, dataEnd});
+    count++;
+    dataEnd += buffer.length();
+    fileSize = std::max(fileSize, dataEnd);
+    lastTime = time;
+    return true;
+}
+
+bool StationHistoryWriter::flush() {
+    if (!isOpen()) return false;
+    if (footer) return true;
+    // Records must be on disk before the footer which lists them
+    if (fsync(fd)) return false;
+    detail::HistoryTrailer t;
+    t.dataEnd = dataEnd;
+    t.count = count;
+    t.indexCount = index.size();
+    t.magic = detail::HistoryTrailer::magicValue;
+    t.reserved = 0;
+    const auto indexSize = index.size() * sizeof(detail::HistoryIndexEntry);
+    buffer.resize(indexSize + sizeof(t));
+    std::memcpy(&buffer[0], index.data(), indexSize);
+    std::memcpy(&buffer[indexSize], &t, sizeof(t));
+    t.crc = crc32(std::string_view(buffer.data(), buffer.length() - 4));
+    std::memcpy(&buffer[buffer.length() - 4], &t.crc, sizeof(t.crc));
+    // Footer ends at the end of file, after anything left from previous
+    // footers or records which were not written completely
+    const auto offset =
+        std::max(fileSize, dataEnd + buffer.length()) - buffer.length();
+    if (!detail::historyWrite(fd, buffer.data(), buffer.length(), offset))
+        return false;
+    fileSize = offset + buffer.length();
+    footer = true;
+    return !fsync(fd);
+}
+
+bool StationHistoryStore::append(const Simple &simple, std::int64_t time) {
+    const auto icao = simple.station.icao();
+    if (icao.empty()) return false;
+    if (!writers.count(icao) && writers.size() >= maxOpenFiles)
+        closeLeastRecent();
+    auto &file = writers[icao];
+    if (!file.writer.isOpen() &&
+        !file.writer.open(path(directory, icao), indexInterval)) {
+        writers.erase(icao);
+        return false;
+    }
+    file.lastUse = ++uses;
+    return file.writer.append(simple, time);
+}
+
+bool StationHistoryStore::flush() {
+    bool result = true;
+    for (auto &w : writers) result = w.second.writer.flush() && result;
+    return result;
+}
+
+void StationHistoryStore::closeLeastRecent() {
+    const auto it = std::min_element(
+        writers.begin(), writers.end(), [](const auto &w1, const auto &w2) {
+            return w1.second.lastUse < w2.second.lastUse;
+        });
+    if (it != writers.end()) writers.erase(it);
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_HISTORY_HPP
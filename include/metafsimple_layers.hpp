@@ -0,0 +1,339 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_LAYERS_HPP
+#define METAFSIMPLE_LAYERS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_epoch.hpp"
+
+// Index of icing and turbulence layers forecast in TAFs of all stations, to
+// find stations with icing or turbulence of given severity or worse within
+// height range and time window.
+//
+// Each layer is stored once as entry with height range in feet, time period
+// and severity. Heights are split into fixed bands; for each kind of layer,
+// band and severity the index keeps list of entries which overlap the band.
+// Query only visits the lists of requested bands and severities and checks
+// exact height and time overlap of the entries found there.
+//
+// Time is measured in minutes since 1970-01-01 00:00 UTC: report times are
+// resolved with resolveTimes() using a reference time close to the report
+// release time.
+//
+// FM trend replaces all forecast conditions: layers forecast for prevailing
+// conditions and in FM or BECMG trends end at the start of the next FM.
+
+namespace metafsimple {
+
+enum class LayerKind { ICING, TURBULENCE };
+
+struct LayerEntry {
+    IcaoCode icao;
+    LayerKind kind = LayerKind::ICING;
+    // IcingForecast::Severity or TurbulenceForecast::Severity
+    int severity = 0;
+    int minFeet = 0;
+    int maxFeet = 0;
+    int from = 0;   // Minute, inclusive
+    int until = 0;  // Minute, exclusive
+};
+
+class LayerIndex {
+   public:
+    static constexpr int bandFeet = 1000;
+    static constexpr int bandCount = 64;  // The last band has no upper limit
+    static constexpr int severityCount = 5;
+    static constexpr int noHeight = std::numeric_limits<int>::max();
+
+    // Minute of time specified in seconds since epoch
+    static int minute(std::int64_t epochTime) {
+        return static_cast<int>(detail::epochFloorDiv(epochTime, 60));
+    }
+
+    // Index icing and turbulence of TAF, replacing layers of previous TAF of
+    // the same station; returns false if the report is not a TAF or its
+    // validity period is not known. Report times are resolved relative to
+    // reference time in seconds since epoch.
+    inline bool add(const Simple &taf, std::int64_t referenceTime);
+    // Remove layers of the station
+    inline void remove(IcaoCode icao);
+
+    // Call f(const LayerEntry &) for each layer of given kind with severity
+    // at least minSeverity which overlaps height range [minFeet, maxFeet]
+    // and time window [from, until)
+    template <typename F>
+    void forEach(LayerKind kind,
+                 int minSeverity,
+                 int minFeet,
+                 int maxFeet,
+                 int from,
+                 int until,
+                 F &&f) const;
+    // Stations with icing / turbulence at least of given severity in height
+    // range and time window, sorted by ICAO code
+    inline std::vector<IcaoCode> stations(IcingForecast::Severity severity,
+                                          int minFeet,
+                                          int maxFeet,
+                                          int from,
+                                          int until) const;
+    inline std::vector<IcaoCode> stations(TurbulenceForecast::Severity severity,
+                                          int minFeet,
+                                          int maxFeet,
+                                          int from,
+                                          int until) const;
+    // Number of layers currently indexed
+    std::size_t size() const { return entries.size() - removed; }
+
+   private:
+    static int band(int feet) {
+        return std::clamp(feet / bandFeet, 0, bandCount - 1);
+    }
+    std::vector<std::uint32_t> &list(LayerKind kind, int band, int severity) {
+        return lists[static_cast<int>(kind)][band][severity];
+    }
+    // Trend period in minutes since start of validity period
+    struct TrendPeriod {
+        std::optional<int> from;
+        std::optional<int> until;
+    };
+    inline bool insert(const Simple &taf,
+                       int validFrom,
+                       int validity,
+                       const std::vector<TrendPeriod> &trends);
+    inline void insert(const LayerEntry &entry);
+    inline void compact();
+    inline std::vector<IcaoCode> stations(LayerKind kind,
+                                          int severity,
+                                          int minFeet,
+                                          int maxFeet,
+                                          int from,
+                                          int until) const;
+
+    std::vector<LayerEntry> entries;
+    std::vector<bool> alive;
+    std::size_t removed = 0;
+    std::unordered_map<IcaoCode, std::vector<std::uint32_t>> byStation;
+    std::array<std::array<std::array<std::vector<std::uint32_t>, severityCount>,
+                          bandCount>,
+               2>
+        lists;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool LayerIndex::add(const Simple &taf, std::int64_t referenceTime) {
+    if (taf.report.type != Report::Type::TAF) return false;
+    const auto times = resolveTimes(taf, referenceTime);
+    if (!times.applicableFrom.has_value() ||
+        !times.applicableUntil.has_value())
+        return false;
+    const auto validFrom = minute(*times.applicableFrom);
+    const auto validity = minute(*times.applicableUntil) - validFrom;
+    const auto relative = [&](const EpochTime &t) {
+        if (!t.has_value()) return std::optional<int>();
+        return std::optional<int>(minute(*t) - validFrom);
+    };
+    std::vector<TrendPeriod> trends;
+    trends.reserve(times.trends.size());
+    for (const auto &t : times.trends)
+        trends.push_back(TrendPeriod{relative(t.from), relative(t.until)});
+    return insert(taf, validFrom, validity, trends);
+}
+
+bool LayerIndex::insert(const Simple &taf,
+                        int validFrom,
+                        int validity,
+                        const std::vector<TrendPeriod> &trends) {
+    const auto icao = taf.station.icao();
+    if (icao.empty() || validity <= 0) return false;
+    remove(icao);
+
+    const auto feet = [](const Height &h, int unknown) {
+        const auto f = h.toUnit(Height::Unit::FEET);
+        return f.has_value() ? static_cast<int>(*f) : unknown;
+    };
+    const auto addLayers = [&](const std::vector<IcingForecast> &icing,
+                               const std::vector<TurbulenceForecast> &turb,
+                               int from,
+                               int until) {
+        if (until <= from) return;
+        for (const auto &i : icing) {
+            insert(LayerEntry{icao,
+                              LayerKind::ICING,
+                              static_cast<int>(i.severity),
+                              feet(i.minHeight, 0),
+                              feet(i.maxHeight, noHeight),
+                              validFrom + from,
+                              validFrom + until});
+        }
+        for (const auto &t : turb) {
+            insert(LayerEntry{icao,
+                              LayerKind::TURBULENCE,
+                              static_cast<int>(t.severity),
+                              feet(t.minHeight, 0),
+                              feet(t.maxHeight, noHeight),
+                              validFrom + from,
+                              validFrom + until});
+        }
+    };
+    const auto &f = taf.forecast;
+    const auto clip = [&](int m) { return std::clamp(m, 0, validity); };
+    // FM is recognised the same way as in TafTimeline
+    const auto isFm = [&](std::size_t i) {
+        return f.trends[i].type == Trend::Type::TIMED &&
+               !f.trends[i].probability.has_value() &&
+               trends[i].from.has_value() && !trends[i].until.has_value();
+    };
+    std::vector<int> fm;
+    for (auto i = 0u; i < f.trends.size(); i++)
+        if (isFm(i)) fm.push_back(clip(*trends[i].from));
+    std::sort(fm.begin(), fm.end());
+    const auto nextFm = [&](int m) {
+        const auto it = std::upper_bound(fm.begin(), fm.end(), m);
+        return it == fm.end() ? validity : *it;
+    };
+
+    addLayers(f.prevailingIcing,
+              f.prevailingTurbulence,
+              0,
+              fm.empty() ? validity : fm.front());
+    for (auto i = 0u; i < f.trends.size(); i++) {
+        const auto &trend = f.trends[i];
+        // Trend with no time specified applies to whole validity period;
+        // FM and BECMG apply until the next FM
+        const auto begin = clip(trends[i].from.value_or(0));
+        auto end = validity;
+        if (isFm(i) || trend.type == Trend::Type::BECMG)
+            end = nextFm(begin);
+        else if (trends[i].until.has_value())
+            end = std::clamp(*trends[i].until, begin, validity);
+        addLayers(trend.icing, trend.turbulence, begin, end);
+    }
+    return true;
+}
+
+void LayerIndex::insert(const LayerEntry &entry) {
+    if (entry.minFeet > entry.maxFeet) return;
+    const auto index = static_cast<std::uint32_t>(entries.size());
+    entries.push_back(entry);
+    alive.push_back(true);
+    byStation[entry.icao].push_back(index);
+    const auto severity = std::clamp(entry.severity, 0, severityCount - 1);
+    for (auto b = band(entry.minFeet); b <= band(entry.maxFeet); b++)
+        list(entry.kind, b, severity).push_back(index);
+}
+
+void LayerIndex::remove(IcaoCode icao) {
+    const auto it = byStation.find(icao);
+    if (it == byStation.end()) return;
+    // Entries are only marked as removed; lists are rebuilt when removed
+    // entries outnumber the remaining ones
+    for (const auto index : it->second) alive[index] = false;
+    removed += it->second.size();
+    byStation.erase(it);
+    if (removed > entries.size() / 2) compact();
+}
+
+void LayerIndex::compact() {
+    std::vector<LayerEntry> remaining;
+    remaining.reserve(entries.size() - removed);
+    for (auto i = 0u; i < entries.size(); i++) {
+        if (alive[i]) remaining.push_back(entries[i]);
+    }
+    entries.clear();
+    alive.clear();
+    removed = 0;
+    byStation.clear();
+    for (auto &kind : lists) {
+        for (auto &b : kind) {
+            for (auto &l : b) l.clear();
+        }
+    }
+    for (const auto &e : remaining) insert(e);
+}
+
+template <typename F>
+void LayerIndex::forEach(LayerKind kind,
+                         int minSeverity,
+                         int minFeet,
+                         int maxFeet,
+                         int from,
+                         int until,
+                         F &&f) const {
+    if (minFeet > maxFeet || from >= until) return;
+    const auto firstBand = band(minFeet), lastBand = band(maxFeet);
+    const auto &k = lists[static_cast<int>(kind)];
+    for (auto s = std::max(minSeverity, 0); s < severityCount; s++) {
+        for (auto b = firstBand; b <= lastBand; b++) {
+            for (const auto index : k[b][s]) {
+                if (!alive[index]) continue;
+                const auto &e = entries[index];
+                // Entry spanning several bands is reported only in the
+                // first band of query range it overlaps
+                if (b != std::max(firstBand, band(e.minFeet))) continue;
+                if (e.maxFeet < minFeet || e.minFeet > maxFeet) continue;
+                if (e.until <= from || e.from >= until) continue;
+                f(e);
+            }
+        }
+    }
+}
+
+std::vector<IcaoCode> LayerIndex::stations(LayerKind kind,
+                                           int severity,
+                                           int minFeet,
+                                           int maxFeet,
+                                           int from,
+                                           int until) const {
+    std::vector<IcaoCode> result;
+    forEach(kind, severity, minFeet, maxFeet, from, until,
+            [&](const LayerEntry &e) { result.push_back(e.icao); });
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<IcaoCode> LayerIndex::stations(IcingForecast::Severity severity,
+                                           int minFeet,
+                                           int maxFeet,
+                                           int from,
+                                           int until) const {
+    return stations(LayerKind::ICING,
+                    static_cast<int>(severity),
+                    minFeet,
+                    maxFeet,
+                    from,
+                    until);
+}
+
+std::vector<IcaoCode> LayerIndex::stations(
+    TurbulenceForecast::Severity severity,
+    int minFeet,
+    int maxFeet,
+    int from,
+    int until) const {
+    return stations(LayerKind::TURBULENCE,
+                    static_cast<int>(severity),
+                    minFeet,
+                    maxFeet,
+                    from,
+                    until);
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_LAYERS_HPP
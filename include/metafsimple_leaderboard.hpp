@@ -0,0 +1,308 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_LEADERBOARD_HPP
+#define METAFSIMPLE_LEADERBOARD_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+// Live rankings of stations with the worst conditions in their latest
+// observation (e.g. the lowest visibility or the highest gusts).
+//
+// For each ranking the stations are kept in an indexed binary min-heap:
+// heap position of every station is stored, so when a new report replaces
+// the station's previous value, the station is moved up or down the heap in
+// O(log n) instead of re-sorting all stations. The K worst stations are
+// listed in O(K log K) by walking the heap from its root.
+
+namespace metafsimple {
+
+// Binary min-heap of keys associated with dense ids; each id has at most
+// one key in the heap. Equal keys are ordered by id.
+class IndexedHeap {
+   public:
+    struct Item {
+        double key;
+        std::uint32_t id;
+    };
+
+    // Insert id with key or change the key of id already in the heap
+    inline void update(std::uint32_t id, double key);
+    inline void erase(std::uint32_t id);
+    bool contains(std::uint32_t id) const {
+        return id < positions.size() && positions[id] != npos;
+    }
+    std::optional<double> key(std::uint32_t id) const {
+        if (!contains(id)) return std::optional<double>();
+        return items[positions[id]].key;
+    }
+    std::size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    const Item &top() const { return items.front(); }
+    // Call f(const Item &) for up to k items with the smallest keys, in
+    // ascending order of keys
+    template <typename F>
+    void forEachSmallest(std::size_t k, F &&f) const;
+
+   private:
+    static constexpr std::uint32_t npos =
+        std::numeric_limits<std::uint32_t>::max();
+    static bool less(const Item &a, const Item &b) {
+        return a.key < b.key || (a.key == b.key && a.id < b.id);
+    }
+    void place(std::size_t position, const Item &item) {
+        items[position] = item;
+        positions[item.id] = static_cast<std::uint32_t>(position);
+    }
+    inline void siftUp(std::size_t position);
+    inline void siftDown(std::size_t position);
+
+    std::vector<Item> items;
+    std::vector<std::uint32_t> positions;  // Indexed by id
+};
+
+class Leaderboard {
+   public:
+    enum class Ranking {
+        LOWEST_VISIBILITY,          // Prevailing visibility in meters
+        LOWEST_CEILING,             // Ceiling in feet
+        HIGHEST_GUST,               // Gust speed in knots
+        LOWEST_RUNWAY_COEFFICIENT,  // Friction coefficient in 1/100s
+        WORST_BRAKING_ACTION        // Aerodrome::BrakingAction, POOR first
+    };
+    static constexpr std::size_t rankingCount =
+        static_cast<std::size_t>(Ranking::WORST_BRAKING_ACTION) + 1;
+
+    struct Entry {
+        IcaoCode icao;
+        double value;
+    };
+    using Values = std::array<std::optional<double>, rankingCount>;
+
+    // Ranked values of METAR or SPECI; the runway rankings use the worst
+    // value of all runways; unreliable or unknown braking action is not
+    // ranked
+    static inline Values values(const Simple &report);
+
+    // Replace the station's values with values of the new METAR or SPECI;
+    // returns false if report was not used
+    inline bool update(const Simple &report);
+    inline void update(IcaoCode icao, const Values &values);
+    // Remove the station from all rankings (e.g. when the report expires)
+    inline void remove(IcaoCode icao);
+
+    // Up to k worst stations in the ranking, worst first
+    inline std::vector<Entry> top(Ranking ranking, std::size_t k) const;
+    // Value of the station in the ranking
+    inline std::optional<double> value(IcaoCode icao, Ranking ranking) const;
+    std::size_t size(Ranking ranking) const {
+        return heaps[static_cast<std::size_t>(ranking)].size();
+    }
+
+   private:
+    // Heaps keep the smallest value on top; values of rankings where the
+    // highest value is the worst are stored negated
+    static bool highestFirst(std::size_t ranking) {
+        return ranking == static_cast<std::size_t>(Ranking::HIGHEST_GUST);
+    }
+    inline std::optional<std::uint32_t> number(IcaoCode icao) const;
+
+    std::unordered_map<IcaoCode, std::uint32_t> numbers;
+    std::vector<IcaoCode> codes;
+    std::array<IndexedHeap, rankingCount> heaps;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+void IndexedHeap::update(std::uint32_t id, double key) {
+    if (id >= positions.size()) positions.resize(id + 1, npos);
+    if (positions[id] == npos) {
+        items.push_back(Item{key, id});
+        positions[id] = static_cast<std::uint32_t>(items.size() - 1);
+        siftUp(items.size() - 1);
+        return;
+    }
+    const auto position = positions[id];
+    const auto previous = items[position].key;
+    items[position].key = key;
+    if (key < previous) {
+        siftUp(position);
+    } else {
+        siftDown(position);
+    }
+}
+
+void IndexedHeap::erase(std::uint32_t id) {
+    if (!contains(id)) return;
+    const auto position = positions[id];
+    positions[id] = npos;
+    const auto last = items.back();
+    items.pop_back();
+    if (position == items.size()) return;
+    const auto removed = items[position];
+    place(position, last);
+    if (less(last, removed)) {
+        siftUp(position);
+    } else {
+        siftDown(position);
+    }
+}
+
+void IndexedHeap::siftUp(std::size_t position) {
+    const auto item = items[position];
+    while (position) {
+        const auto parent = (position - 1) / 2;
+        if (!less(item, items[parent])) break;
+        place(position, items[parent]);
+        position = parent;
+    }
+    place(position, item);
+}
+
+void IndexedHeap::siftDown(std::size_t position) {
+    const auto item = items[position];
+    while (true) {
+        auto child = position * 2 + 1;
+        if (child >= items.size()) break;
+        if (child + 1 < items.size() && less(items[child + 1], items[child]))
+            child++;
+        if (!less(items[child], item)) break;
+        place(position, items[child]);
+        position = child;
+    }
+    place(position, item);
+}
+
+template <typename F>
+void IndexedHeap::forEachSmallest(std::size_t k, F &&f) const {
+    // The next smallest item is always a child of an item already reported,
+    // so only the candidates are kept in a small heap of positions
+    const auto greater = [this](std::size_t a, std::size_t b) {
+        return less(items[b], items[a]);
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>,
+                        decltype(greater)>
+        candidates(greater);
+    if (!items.empty()) candidates.push(0);
+    while (k && !candidates.empty()) {
+        const auto position = candidates.top();
+        candidates.pop();
+        f(items[position]);
+        k--;
+        const auto child = position * 2 + 1;
+        if (child < items.size()) candidates.push(child);
+        if (child + 1 < items.size()) candidates.push(child + 1);
+    }
+}
+
+Leaderboard::Values Leaderboard::values(const Simple &report) {
+    Values result;
+    const auto set = [&](Ranking r, std::optional<double> v) {
+        result[static_cast<std::size_t>(r)] = v;
+    };
+    const auto &e = report.current.weatherData;
+    set(Ranking::LOWEST_VISIBILITY,
+        e.cavok ? std::optional<double>()
+                : e.visibility.toUnit(Distance::Unit::METERS));
+    set(Ranking::LOWEST_CEILING,
+        e.ceilingHeight().toUnit(Height::Unit::FEET));
+    set(Ranking::HIGHEST_GUST, e.gustSpeed.toUnit(Speed::Unit::KT));
+
+    std::optional<double> coefficient, braking;
+    for (const auto &r : report.aerodrome.runways) {
+        // Unreliable readings and values out of range are not ranked, as
+        // in brakingAction()
+        const bool validCoefficient = !r.surfaceFrictionUnreliable &&
+                                      r.coefficient.has_value() &&
+                                      *r.coefficient >= 0 &&
+                                      *r.coefficient <= 100;
+        if (validCoefficient &&
+            (!coefficient.has_value() || *r.coefficient < *coefficient))
+            coefficient = *r.coefficient;
+        const auto ba = r.brakingAction();
+        if (ba == Aerodrome::BrakingAction::UNRELIABLE ||
+            ba == Aerodrome::BrakingAction::UNKNOWN)
+            continue;
+        const auto b = static_cast<double>(ba);
+        if (!braking.has_value() || b < *braking) braking = b;
+    }
+    set(Ranking::LOWEST_RUNWAY_COEFFICIENT, coefficient);
+    set(Ranking::WORST_BRAKING_ACTION, braking);
+    return result;
+}
+
+bool Leaderboard::update(const Simple &report) {
+    if (report.report.error != Report::Error::NO_ERROR) return false;
+    if (report.report.type != Report::Type::METAR &&
+        report.report.type != Report::Type::SPECI)
+        return false;
+    const auto icao = report.station.icao();
+    if (icao.empty()) return false;
+    update(icao, values(report));
+    return true;
+}
+
+void Leaderboard::update(IcaoCode icao, const Values &values) {
+    const auto inserted = numbers.emplace(icao, codes.size());
+    if (inserted.second) codes.push_back(icao);
+    const auto station = inserted.first->second;
+    for (auto r = 0u; r < rankingCount; r++) {
+        if (!values[r].has_value()) {
+            heaps[r].erase(station);
+            continue;
+        }
+        heaps[r].update(station, highestFirst(r) ? -*values[r] : *values[r]);
+    }
+}
+
+void Leaderboard::remove(IcaoCode icao) {
+    const auto n = number(icao);
+    if (!n.has_value()) return;
+    for (auto &h : heaps) h.erase(*n);
+}
+
+std::vector<Leaderboard::Entry> Leaderboard::top(Ranking ranking,
+                                                 std::size_t k) const {
+    const auto r = static_cast<std::size_t>(ranking);
+    std::vector<Entry> result;
+    result.reserve(std::min(k, heaps[r].size()));
+    heaps[r].forEachSmallest(k, [&](const IndexedHeap::Item &item) {
+        result.push_back(
+            Entry{codes[item.id], highestFirst(r) ? -item.key : item.key});
+    });
+    return result;
+}
+
+std::optional<double> Leaderboard::value(IcaoCode icao,
+                                         Ranking ranking) const {
+    const auto n = number(icao);
+    if (!n.has_value()) return std::optional<double>();
+    const auto r = static_cast<std::size_t>(ranking);
+    const auto v = heaps[r].key(*n);
+    if (!v.has_value() || !highestFirst(r)) return v;
+    return -*v;
+}
+
+std::optional<std::uint32_t> Leaderboard::number(IcaoCode icao) const {
+    const auto it = numbers.find(icao);
+    if (it == numbers.end()) return std::optional<std::uint32_t>();
+    return it->second;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_LEADERBOARD_HPP
@@ -0,0 +1,305 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_PRECIP_HPP
+#define METAFSIMPLE_PRECIP_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+// Hourly series of precipitation, snowfall and ice accretion per station,
+// reconciled from amounts over different periods reported in consecutive
+// METARs.
+//
+// Time is measured in minutes on a timeline chosen by the caller (e.g.
+// minutes since epoch); hour N covers minutes [N * 60, N * 60 + 60). An
+// amount over a period ending at the report time is assigned to the hours
+// which contain the middle of each hour of the period, so that the amount
+// for the hour ending at 1253 or at 1300 goes to hour 12.
+//
+// For each hour the series keeps the amount and its source, from the most
+// to the least reliable:
+//  - 1-hour total reported for the hour (precipitationTotal1h,
+//    snowfallIncrease1h, icing1h);
+//  - amount accumulated from precipitation since last report or rainfall
+//    since 0900; the interval since the previous report is split into hours
+//    counted back from its end, and each of them is assigned to the hour
+//    which contains its middle, the same way as the 1-hour total;
+//  - share of a 3-, 6- or 24-hour total (precipitationFrozen3h / 6h / 24h,
+//    snow6h, icing3h / 6h): the total minus the amounts already known for
+//    the hours of the period is split evenly between the remaining hours;
+//    shares of a shorter period take precedence over a longer one;
+//  - rainfall of the last 10 minutes, which only covers part of the hour
+//    and is kept until any of the above is known for the hour.
+// Hours with no amount are missing; a missing report leaves its hours
+// missing until a total over a longer period covers them.
+//
+// Reports must be added in chronological order for each station; a report
+// older than the latest one is not used. precipitationFrozen3or6h is not
+// used since its period is not known.
+
+namespace metafsimple {
+
+class PrecipitationSeries {
+   public:
+    enum class Kind {
+        PRECIPITATION,  // Liquid equivalent, mm
+        SNOWFALL,       // Depth of fresh snow, mm
+        ICING           // Ice accretion, mm
+    };
+    static constexpr std::size_t kindCount =
+        static_cast<std::size_t>(Kind::ICING) + 1;
+    enum class Source {
+        MISSING,
+        SAMPLED,  // Part of the hour only, lower bound of the amount
+        PERIOD_TOTAL,
+        ACCUMULATED,
+        HOURLY_TOTAL
+    };
+
+    // Number of hours kept per station
+    static constexpr int hourCount = 72;
+    // Longest interval since the previous report which is accumulated
+    static constexpr int maxGapMinutes = 6 * 60;
+
+    struct HourlyAmount {
+        int hour = 0;
+        std::optional<double> amount;
+        Source source = Source::MISSING;
+    };
+
+    // Add METAR or SPECI issued at given minute; returns false if the report
+    // was not used
+    inline bool update(const Simple &report, int minute);
+    // Hourly amounts for hours [fromHour, untilHour)
+    inline std::vector<HourlyAmount> hourly(IcaoCode icao,
+                                            Kind kind,
+                                            int fromHour,
+                                            int untilHour) const;
+    // Hour of the period ending at the report issued at given minute
+    static int hour(int minute) { return floorDiv(minute - 30, 60); }
+    void remove(IcaoCode icao) { stations.erase(icao); }
+    std::size_t size() const { return stations.size(); }
+
+   private:
+    struct Slot {
+        std::int32_t hour = -1;
+        float amount = 0.0;
+        Source source = Source::MISSING;
+        std::uint8_t period = 0;  // Hours, for PERIOD_TOTAL
+    };
+    using Slots = std::array<Slot, hourCount>;
+    struct Station {
+        std::array<Slots, kindCount> slots;
+        std::optional<int> lastMinute;
+        std::optional<double> lastSince0900;
+    };
+
+    static int floorDiv(int a, int b) {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+    static int index(int hour) {
+        return (hour % hourCount + hourCount) % hourCount;
+    }
+    static Slot &slot(Slots &slots, int hour) {
+        auto &s = slots[index(hour)];
+        if (s.hour != hour) s = Slot{hour, 0.0, Source::MISSING, 0};
+        return s;
+    }
+    static std::optional<double> mm(const Precipitation &p) {
+        return p.toUnit(Precipitation::Unit::MM);
+    }
+    static inline void setHourly(Slots &slots, int hour, double amount);
+    static inline void accumulate(Slots &slots,
+                                  int fromMinute,
+                                  int toMinute,
+                                  double amount);
+    static inline void sample(Slots &slots,
+                              int fromMinute,
+                              int toMinute,
+                              double amount);
+    static inline void reconcile(Slots &slots,
+                                 int lastHour,
+                                 int hours,
+                                 double total);
+
+    std::unordered_map<IcaoCode, Station> stations;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool PrecipitationSeries::update(const Simple &report, int minute) {
+    if (report.report.error != Report::Error::NO_ERROR) return false;
+    if (report.report.type != Report::Type::METAR &&
+        report.report.type != Report::Type::SPECI)
+        return false;
+    const auto icao = report.station.icao();
+    if (icao.empty()) return false;
+    auto &station = stations[icao];
+    if (station.lastMinute.has_value() && *station.lastMinute > minute)
+        return false;
+    const auto &h = report.historical;
+    const auto lastHour = hour(minute);
+    const auto previous = station.lastMinute;
+    const bool previousKnown =
+        previous.has_value() && minute - *previous <= maxGapMinutes;
+
+    auto &precipitation =
+        station.slots[static_cast<std::size_t>(Kind::PRECIPITATION)];
+    const auto since0900 = mm(h.rainfallSince0900LocalTime);
+    if (const auto total = mm(h.precipitationTotal1h); total.has_value()) {
+        setHourly(precipitation, lastHour, *total);
+    } else if (const auto sinceLast = mm(h.precipitationSinceLastReport);
+               sinceLast.has_value() && previousKnown) {
+        accumulate(precipitation, *previous, minute, *sinceLast);
+    } else if (since0900.has_value() && station.lastSince0900.has_value() &&
+               previousKnown) {
+        // Accumulation restarts at 0900 local time
+        const auto diff = *since0900 - *station.lastSince0900;
+        accumulate(precipitation,
+                   *previous,
+                   minute,
+                   diff >= 0.0 ? diff : *since0900);
+    } else if (const auto last10m = mm(h.rainfall10m); last10m.has_value()) {
+        // Reports less than 10 minutes apart share part of the interval
+        const auto from =
+            previousKnown ? std::max(minute - 10, *previous) : minute - 10;
+        if (from < minute) {
+            const auto amount = *last10m * (minute - from) / 10;
+            sample(precipitation, from, minute, amount);
+        }
+    }
+    const std::pair<const Precipitation &, int> precipitationTotals[] = {
+        {h.precipitationFrozen3h, 3},
+        {h.precipitationFrozen6h, 6},
+        {h.precipitationFrozen24h, 24}};
+    for (const auto &t : precipitationTotals) {
+        if (const auto p = mm(t.first); p.has_value())
+            reconcile(precipitation, lastHour, t.second, *p);
+    }
+
+    auto &snowfall = station.slots[static_cast<std::size_t>(Kind::SNOWFALL)];
+    if (const auto p = mm(h.snowfallIncrease1h); p.has_value())
+        setHourly(snowfall, lastHour, *p);
+    if (const auto p = mm(h.snow6h); p.has_value())
+        reconcile(snowfall, lastHour, 6, *p);
+
+    auto &icing = station.slots[static_cast<std::size_t>(Kind::ICING)];
+    if (const auto p = mm(h.icing1h); p.has_value())
+        setHourly(icing, lastHour, *p);
+    if (const auto p = mm(h.icing3h); p.has_value())
+        reconcile(icing, lastHour, 3, *p);
+    if (const auto p = mm(h.icing6h); p.has_value())
+        reconcile(icing, lastHour, 6, *p);
+
+    station.lastMinute = minute;
+    if (since0900.has_value()) station.lastSince0900 = since0900;
+    return true;
+}
+
+void PrecipitationSeries::setHourly(Slots &slots, int hour, double amount) {
+    auto &s = slot(slots, hour);
+    s.amount = static_cast<float>(amount);
+    s.source = Source::HOURLY_TOTAL;
+}
+
+void PrecipitationSeries::accumulate(Slots &slots,
+                                     int fromMinute,
+                                     int toMinute,
+                                     double amount) {
+    const auto length = toMinute - fromMinute;
+    if (length <= 0) return;
+    // Hour which ends at the report time goes to hour(toMinute), as the
+    // 1-hour total reported at that time would
+    for (auto end = toMinute; end > fromMinute; end -= 60) {
+        const auto begin = std::max(fromMinute, end - 60);
+        auto &s = slot(slots, floorDiv(begin + end, 2 * 60));
+        if (s.source == Source::HOURLY_TOTAL) continue;
+        if (s.source != Source::ACCUMULATED) s.amount = 0.0;
+        s.amount += static_cast<float>(amount * (end - begin) / length);
+        s.source = Source::ACCUMULATED;
+    }
+}
+
+void PrecipitationSeries::sample(Slots &slots,
+                                 int fromMinute,
+                                 int toMinute,
+                                 double amount) {
+    auto &s = slot(slots, floorDiv(fromMinute + toMinute, 2 * 60));
+    if (s.source != Source::MISSING && s.source != Source::SAMPLED) return;
+    if (s.source == Source::MISSING) s.amount = 0.0;
+    s.amount += static_cast<float>(amount);
+    s.source = Source::SAMPLED;
+}
+
+void PrecipitationSeries::reconcile(Slots &slots,
+                                    int lastHour,
+                                    int hours,
+                                    double total) {
+    double known = 0.0;
+    int unknown = 0;
+    const auto isKnown = [hours](const Slot &s) {
+        if (s.source == Source::MISSING || s.source == Source::SAMPLED)
+            return false;
+        return s.source != Source::PERIOD_TOTAL || s.period < hours;
+    };
+    for (auto h = lastHour - hours + 1; h <= lastHour; h++) {
+        const auto &s = slot(slots, h);
+        if (isKnown(s)) {
+            known += s.amount;
+        } else {
+            unknown++;
+        }
+    }
+    // Hours are all known: amounts reported for them take precedence over
+    // the total
+    if (!unknown) return;
+    const auto share =
+        static_cast<float>(std::max(total - known, 0.0) / unknown);
+    for (auto h = lastHour - hours + 1; h <= lastHour; h++) {
+        auto &s = slot(slots, h);
+        if (isKnown(s)) continue;
+        s.amount = share;
+        s.source = Source::PERIOD_TOTAL;
+        s.period = static_cast<std::uint8_t>(hours);
+    }
+}
+
+std::vector<PrecipitationSeries::HourlyAmount> PrecipitationSeries::hourly(
+    IcaoCode icao, Kind kind, int fromHour, int untilHour) const {
+    std::vector<HourlyAmount> result;
+    if (untilHour <= fromHour) return result;
+    result.reserve(untilHour - fromHour);
+    const auto it = stations.find(icao);
+    for (auto h = fromHour; h < untilHour; h++) {
+        HourlyAmount a;
+        a.hour = h;
+        if (it != stations.end()) {
+            const auto k = static_cast<std::size_t>(kind);
+            const auto &slots = it->second.slots[k];
+            const auto &s = slots[index(h)];
+            if (s.hour == h && s.source != Source::MISSING) {
+                a.amount = s.amount;
+                a.source = s.source;
+            }
+        }
+        result.push_back(a);
+    }
+    return result;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_PRECIP_HPP
@@ -0,0 +1,290 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_ROLLING_HPP
+#define METAFSIMPLE_ROLLING_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include "metafsimple.hpp"
+
+// Rolling statistics (min, max, mean, count) of station observations over
+// the last hour, 6 hours and 24 hours, updated as reports arrive without
+// keeping the reports.
+//
+// For each station and quantity the accumulator keeps a ring of 10-minute
+// buckets covering 24 hours; each bucket holds min, max, sum and count of
+// the values observed during its 10 minutes. Windows are rounded to whole
+// buckets: the window ending at minute 'now' includes the bucket of 'now'
+// and the preceding buckets up to the window length.
+//
+// Time is measured in minutes on a timeline chosen by the caller (e.g.
+// minutes since epoch); it must not be negative.
+//
+// Extremes reported in the Historical group (6- and 24-hour temperature
+// extremes, peak wind) are kept in separate rings of buckets, one ring per
+// kind of extreme, holding the lowest (or highest) extreme reported during
+// the bucket. They are folded into min and max of the windows at least as
+// long as the period they cover, as long as they were reported within the
+// window; mean and count only include the observed values.
+
+namespace metafsimple {
+
+class RollingStats {
+   public:
+    enum class Quantity {
+        AIR_TEMPERATURE,    // Degrees Celsius
+        DEW_POINT,          // Degrees Celsius
+        WIND_SPEED,         // Knots
+        GUST_SPEED,         // Knots
+        VISIBILITY,         // Meters
+        SEA_LEVEL_PRESSURE  // Hectopascal
+    };
+    static constexpr std::size_t quantityCount =
+        static_cast<std::size_t>(Quantity::SEA_LEVEL_PRESSURE) + 1;
+    enum class Window { HOUR, HOURS_6, HOURS_24 };
+
+    static constexpr int bucketMinutes = 10;
+    static constexpr int bucketCount = 24 * 60 / bucketMinutes;
+
+    struct Stats {
+        double min = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        std::size_t count = 0;
+        bool empty() const { return !count; }
+    };
+
+    // Observed values of METAR / SPECI
+    using Values = std::array<std::optional<double>, quantityCount>;
+    static inline Values values(const Simple &report);
+
+    // Add METAR or SPECI observed at given minute; returns false if the
+    // report was not used
+    inline bool update(const Simple &report, int minute);
+    inline void update(IcaoCode icao, int minute, const Values &values);
+    // Statistics over the window ending at minute now
+    inline Stats stats(IcaoCode icao,
+                       Quantity quantity,
+                       Window window,
+                       int now) const;
+    void remove(IcaoCode icao) { stations.erase(icao); }
+    std::size_t size() const { return stations.size(); }
+
+   private:
+    struct Bucket {
+        std::int32_t slot = -1;  // Minute / bucketMinutes
+        float min = 0.0;
+        float max = 0.0;
+        float sum = 0.0;
+        std::uint32_t count = 0;
+    };
+    // Extremes reported in Historical group
+    enum class Extreme {
+        TEMPERATURE_MIN_6H,
+        TEMPERATURE_MAX_6H,
+        TEMPERATURE_MIN_24H,
+        TEMPERATURE_MAX_24H,
+        PEAK_WIND
+    };
+    static constexpr std::size_t extremeCount =
+        static_cast<std::size_t>(Extreme::PEAK_WIND) + 1;
+    // Lowest (or highest) extreme of given kind reported during the bucket
+    struct ExtremeBucket {
+        std::int32_t slot = -1;  // Minute / bucketMinutes
+        float value = 0.0;
+    };
+    struct Station {
+        std::array<std::array<Bucket, bucketCount>, quantityCount> buckets;
+        std::array<std::array<ExtremeBucket, bucketCount>, extremeCount>
+            extremes;
+    };
+    using Extremes = std::array<std::optional<double>, extremeCount>;
+    struct ExtremeInfo {
+        Quantity quantity;
+        int minutes;  // Period covered by the extreme
+        bool isMax;
+    };
+    static inline const ExtremeInfo &extremeInfo(std::size_t extreme);
+    static inline Extremes extremes(const Simple &report);
+    static int windowMinutes(Window window) {
+        switch (window) {
+            case Window::HOUR:
+                return 60;
+            case Window::HOURS_6:
+                return 6 * 60;
+            case Window::HOURS_24:
+                return 24 * 60;
+        }
+        return 0;
+    }
+    inline void add(Station &station, Quantity quantity, int minute, double v);
+    inline void addExtreme(Station &station,
+                           std::size_t extreme,
+                           int minute,
+                           double v);
+
+    std::unordered_map<IcaoCode, Station> stations;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+RollingStats::Values RollingStats::values(const Simple &report) {
+    Values result;
+    const auto set = [&](Quantity q, std::optional<double> v) {
+        result[static_cast<std::size_t>(q)] = v;
+    };
+    const auto &c = report.current;
+    const auto &e = c.weatherData;
+    const auto celsius = Temperature::Unit::C;
+    set(Quantity::AIR_TEMPERATURE, c.airTemperature.toUnit(celsius));
+    set(Quantity::DEW_POINT, c.dewPoint.toUnit(celsius));
+    set(Quantity::WIND_SPEED, e.windSpeed.toUnit(Speed::Unit::KT));
+    set(Quantity::GUST_SPEED, e.gustSpeed.toUnit(Speed::Unit::KT));
+    if (!e.cavok)
+        set(Quantity::VISIBILITY, e.visibility.toUnit(Distance::Unit::METERS));
+    set(Quantity::SEA_LEVEL_PRESSURE,
+        e.seaLevelPressure.toUnit(Pressure::Unit::HPA));
+    return result;
+}
+
+const RollingStats::ExtremeInfo &RollingStats::extremeInfo(
+    std::size_t extreme) {
+    static const ExtremeInfo info[extremeCount] = {
+        {Quantity::AIR_TEMPERATURE, 6 * 60, false},
+        {Quantity::AIR_TEMPERATURE, 6 * 60, true},
+        {Quantity::AIR_TEMPERATURE, 24 * 60, false},
+        {Quantity::AIR_TEMPERATURE, 24 * 60, true},
+        {Quantity::WIND_SPEED, 60, true}};
+    return info[extreme];
+}
+
+RollingStats::Extremes RollingStats::extremes(const Simple &report) {
+    Extremes result;
+    const auto set = [&](Extreme e, std::optional<double> v) {
+        result[static_cast<std::size_t>(e)] = v;
+    };
+    const auto &h = report.historical;
+    const auto c = Temperature::Unit::C;
+    set(Extreme::TEMPERATURE_MIN_6H, h.temperatureMin6h.toUnit(c));
+    set(Extreme::TEMPERATURE_MAX_6H, h.temperatureMax6h.toUnit(c));
+    set(Extreme::TEMPERATURE_MIN_24H, h.temperatureMin24h.toUnit(c));
+    set(Extreme::TEMPERATURE_MAX_24H, h.temperatureMax24h.toUnit(c));
+    set(Extreme::PEAK_WIND, h.peakWindSpeed.toUnit(Speed::Unit::KT));
+    return result;
+}
+
+bool RollingStats::update(const Simple &report, int minute) {
+    if (report.report.error != Report::Error::NO_ERROR) return false;
+    if (report.report.type != Report::Type::METAR &&
+        report.report.type != Report::Type::SPECI)
+        return false;
+    const auto icao = report.station.icao();
+    if (icao.empty() || minute < 0) return false;
+    update(icao, minute, values(report));
+    const auto e = extremes(report);
+    auto &station = stations[icao];
+    for (auto i = 0u; i < extremeCount; i++) {
+        if (e[i].has_value()) addExtreme(station, i, minute, *e[i]);
+    }
+    return true;
+}
+
+void RollingStats::update(IcaoCode icao, int minute, const Values &values) {
+    if (minute < 0) return;
+    auto &station = stations[icao];
+    for (auto q = 0u; q < quantityCount; q++) {
+        if (values[q].has_value())
+            add(station, static_cast<Quantity>(q), minute, *values[q]);
+    }
+}
+
+void RollingStats::add(Station &station,
+                       Quantity quantity,
+                       int minute,
+                       double v) {
+    const auto slot = minute / bucketMinutes;
+    auto &b = station.buckets[static_cast<std::size_t>(quantity)]
+                             [slot % bucketCount];
+    // Bucket still holds a later slot: the value is older than 24 hours
+    // relative to the latest report and is dropped
+    if (b.slot > slot) return;
+    const auto value = static_cast<float>(v);
+    if (b.slot < slot) {
+        b = Bucket{slot, value, value, value, 1};
+        return;
+    }
+    b.min = std::min(b.min, value);
+    b.max = std::max(b.max, value);
+    b.sum += value;
+    b.count++;
+}
+
+void RollingStats::addExtreme(Station &station,
+                              std::size_t extreme,
+                              int minute,
+                              double v) {
+    const auto slot = minute / bucketMinutes;
+    auto &b = station.extremes[extreme][slot % bucketCount];
+    // Same as in add()
+    if (b.slot > slot) return;
+    const auto value = static_cast<float>(v);
+    if (b.slot < slot) {
+        b = ExtremeBucket{slot, value};
+        return;
+    }
+    b.value = extremeInfo(extreme).isMax ? std::max(b.value, value)
+                                         : std::min(b.value, value);
+}
+
+RollingStats::Stats RollingStats::stats(IcaoCode icao,
+                                        Quantity quantity,
+                                        Window window,
+                                        int now) const {
+    Stats result;
+    const auto it = stations.find(icao);
+    if (it == stations.end() || now < 0) return result;
+    const auto &station = it->second;
+    const auto nowSlot = now / bucketMinutes;
+    const auto length = windowMinutes(window);
+    const auto firstSlot = nowSlot - length / bucketMinutes + 1;
+    double sum = 0.0;
+    const auto include = [&](double min, double max) {
+        result.min = result.count ? std::min(result.min, min) : min;
+        result.max = result.count ? std::max(result.max, max) : max;
+    };
+    for (const auto &b : station.buckets[static_cast<std::size_t>(quantity)]) {
+        if (b.slot < firstSlot || b.slot > nowSlot || !b.count) continue;
+        include(b.min, b.max);
+        sum += b.sum;
+        result.count += b.count;
+    }
+    if (!result.count) return result;
+    result.mean = sum / result.count;
+    for (auto i = 0u; i < extremeCount; i++) {
+        const auto &info = extremeInfo(i);
+        if (info.quantity != quantity || info.minutes > length) continue;
+        for (const auto &b : station.extremes[i]) {
+            if (b.slot < firstSlot || b.slot > nowSlot) continue;
+            if (info.isMax) {
+                result.max = std::max(result.max, static_cast<double>(b.value));
+            } else {
+                result.min = std::min(result.min, static_cast<double>(b.value));
+            }
+        }
+    }
+    return result;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_ROLLING_HPP
@@ -0,0 +1,732 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_RULES_HPP
+#define METAFSIMPLE_RULES_HPP
+
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+// Alert rules over simplified report data, for example:
+//
+//   current.weatherData.windSpeed > 30 KT AND skyCondition == OBSCURED
+//   (visibility < 1 SM OR ceilingHeight < 500) AND NOT weather == FOG
+//
+// Rule is a boolean expression of comparisons joined with AND, OR, NOT and
+// parentheses. Each comparison is a field name, operator (==, !=, <, <=, >,
+// >=) and either a number optionally followed by unit, or a name of enum
+// value (TRUE / FALSE for flags). Field is referred to by full name or last
+// component of the name. For 'weather' field, == and != test whether
+// weather phenomena is present or not. Comparison of a field with no value
+// is false.
+//
+// Rules are compiled into stack bytecode. For each report, values of all
+// fields are extracted once into RuleValues; only rules which refer to the
+// fields changed since the previous report of the same station are
+// evaluated. Evaluation does not allocate memory.
+
+namespace metafsimple {
+
+enum class RuleField {
+    REPORT_TYPE,
+    WIND_DIRECTION,
+    WIND_DIRECTION_VARIABLE,
+    WIND_SPEED,
+    GUST_SPEED,
+    WIND_CALM,
+    VISIBILITY,
+    CAVOK,
+    SKY_CONDITION,
+    CEILING,
+    VERTICAL_VISIBILITY,
+    WEATHER,
+    SEA_LEVEL_PRESSURE,
+    AIR_TEMPERATURE,
+    DEW_POINT,
+    RELATIVE_HUMIDITY
+};
+
+static const std::size_t ruleFieldCount = 16;
+
+// Field values of single report in units used by rules: knots, meters (for
+// visibility), feet (for heights), degrees Celsius, hectopascals; enums and
+// flags as numbers; weather as bit mask of phenomena; NaN if not reported
+using RuleValues = std::array<double, ruleFieldCount>;
+
+inline void extractRuleValues(const Simple &report, RuleValues &values);
+
+class RuleEngine {
+   public:
+    // Compile rule and add it to the engine; returns rule index or no value
+    // if the rule contains errors, in which case error description is
+    // stored in 'error' if specified
+    inline std::optional<std::size_t> add(const std::string &rule,
+                                          std::string *error = nullptr);
+    std::size_t size() const { return rules.size(); }
+    // Evaluate rules against new report and call onChange(icao, rule, state)
+    // for each rule which result changed since the previous report of the
+    // same station; rules are initially false for all stations
+    template <typename F>
+    void update(const Simple &report, F &&onChange);
+    // Latest result of rule for station
+    inline bool state(IcaoCode icao, std::size_t rule) const;
+    // Evaluate single rule
+    inline bool evaluate(std::size_t rule, const RuleValues &values) const;
+
+    // Bit for each RuleField referred to by rule
+    std::uint64_t fields(std::size_t rule) const { return rules[rule].fields; }
+
+    enum class Opcode : std::uint8_t { COMPARE, AND, OR, NOT };
+    enum class Compare : std::uint8_t { EQ, NE, LT, LE, GT, GE, HAS, HAS_NOT };
+    struct Instruction {
+        Opcode opcode = Opcode::COMPARE;
+        Compare compare = Compare::EQ;
+        std::uint8_t field = 0;
+        double value = 0.0;
+    };
+
+   private:
+    struct Rule {
+        std::uint32_t begin;  // Instructions of all rules are stored in code
+        std::uint32_t end;
+        std::uint64_t fields;
+    };
+    struct Station {
+        RuleValues values;
+        std::size_t rules = 0;  // Number of rules evaluated for station
+        std::vector<std::uint64_t> states;
+    };
+    inline static bool equal(double a, double b);
+
+    std::vector<Instruction> code;
+    std::vector<Rule> rules;
+    std::array<std::vector<std::uint32_t>, ruleFieldCount> rulesByField;
+    std::unordered_map<IcaoCode, Station> stations;
+    std::vector<std::uint32_t> checked;
+    std::uint32_t stamp = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+enum class RuleDimension {
+    NONE,
+    FLAG,
+    ENUM,
+    MASK,
+    SPEED,
+    DISTANCE,
+    HEIGHT,
+    TEMPERATURE,
+    PRESSURE
+};
+
+struct RuleFieldInfo {
+    const char *name;
+    RuleDimension dimension;
+    const char *const *enumNames;  // Enum value names, nullptr-terminated
+};
+
+static const char *const ruleReportTypeNames[] = {
+    "ERROR", "METAR", "SPECI", "TAF", nullptr};
+
+static const char *const ruleSkyConditionNames[] = {"UNKNOWN",
+                                                    "CLEAR_CLR",
+                                                    "CLEAR_SKC",
+                                                    "CLEAR_NCD",
+                                                    "NO_SIGNIFICANT_CLOUD",
+                                                    "CAVOK",
+                                                    "CLOUDS",
+                                                    "OBSCURED",
+                                                    nullptr};
+
+static const char *const rulePhenomenaNames[] = {
+    "UNKNOWN",
+    "NO_SIGNIFICANT_WEATHER",
+    "SHALLOW_FOG",
+    "PARTIAL_FOG",
+    "PATCHES_FOG",
+    "FREEZING_FOG",
+    "FOG",
+    "DRIFTING_DUST",
+    "BLOWING_DUST",
+    "DUST",
+    "DRIFTING_SAND",
+    "BLOWING_SAND",
+    "SAND",
+    "DRIFTING_SNOW",
+    "BLOWING_SNOW",
+    "BLOWING_SPRAY",
+    "ICE_CRYSTALS",
+    "MIST",
+    "SMOKE",
+    "VOLCANIC_ASH",
+    "HAZE",
+    "DUST_WHIRLS",
+    "SQUALLS",
+    "FUNNEL_CLOUD",
+    "TORNADO",
+    "SAND_STORM",
+    "DUST_STORM",
+    "DUST_SAND_STORM",
+    "HEAVY_SAND_STORM",
+    "HEAVY_DUST_STORM",
+    "HEAVY_DUST_SAND_STORM",
+    "PRECIPITATION",
+    "SHOWERY_PRECIPITATION",
+    "PRECIPITATION_LIGHT",
+    "PRECIPITATION_MODERATE",
+    "PRECIPITATION_HEAVY",
+    "SHOWERY_PRECIPITATION_LIGHT",
+    "SHOWERY_PRECIPITATION_MODERATE",
+    "SHOWERY_PRECIPITATION_HEAVY",
+    "FREEZING_PRECIPITATION_LIGHT",
+    "FREEZING_PRECIPITATION_MODERATE",
+    "FREEZING_PRECIPITATION_HEAVY",
+    "THUNDERSTORM",
+    "THUNDERSTORM_PRECIPITATION_LIGHT",
+    "THUNDERSTORM_PRECIPITATION_MODERATE",
+    "THUNDERSTORM_PRECIPITATION_HEAVY",
+    nullptr};
+
+// Weather mask is stored in double, all bits must be exactly representable
+static_assert(static_cast<int>(
+                  Weather::Phenomena::THUNDERSTORM_PRECIPITATION_HEAVY) <
+              std::numeric_limits<double>::digits);
+
+static const char *const ruleFlagNames[] = {"FALSE", "TRUE", nullptr};
+
+// In the order of RuleField
+static const RuleFieldInfo ruleFields[ruleFieldCount] = {
+    {"report.type", RuleDimension::ENUM, ruleReportTypeNames},
+    {"current.weatherData.windDirectionDegrees", RuleDimension::NONE, nullptr},
+    {"current.weatherData.windDirectionVariable",
+     RuleDimension::FLAG,
+     ruleFlagNames},
+    {"current.weatherData.windSpeed", RuleDimension::SPEED, nullptr},
+    {"current.weatherData.gustSpeed", RuleDimension::SPEED, nullptr},
+    {"current.weatherData.windCalm", RuleDimension::FLAG, ruleFlagNames},
+    {"current.weatherData.visibility", RuleDimension::DISTANCE, nullptr},
+    {"current.weatherData.cavok", RuleDimension::FLAG, ruleFlagNames},
+    {"current.weatherData.skyCondition",
+     RuleDimension::ENUM,
+     ruleSkyConditionNames},
+    {"current.weatherData.ceilingHeight", RuleDimension::HEIGHT, nullptr},
+    {"current.weatherData.verticalVisibility", RuleDimension::HEIGHT, nullptr},
+    {"current.weatherData.weather", RuleDimension::MASK, rulePhenomenaNames},
+    {"current.weatherData.seaLevelPressure", RuleDimension::PRESSURE, nullptr},
+    {"current.airTemperature", RuleDimension::TEMPERATURE, nullptr},
+    {"current.dewPoint", RuleDimension::TEMPERATURE, nullptr},
+    {"current.relativeHumidity", RuleDimension::NONE, nullptr}};
+
+struct RuleUnit {
+    const char *name;
+    RuleDimension dimension;
+    double offset;  // Value in rule units is offset + value * factor
+    double factor;
+};
+
+template <typename T, typename U>
+T ruleQuantity(int value, U unit) {
+    return T{value, unit};
+}
+
+template <>
+inline Distance ruleQuantity<Distance, Distance::Unit>(int value,
+                                                       Distance::Unit unit) {
+    return Distance{Distance::Details::EXACTLY, value, unit};
+}
+
+// Conversion of x from unit u to rule unit, derived from toUnit() of data
+// type to keep conversion factors in one place
+template <typename T, typename U>
+RuleUnit ruleUnit(const char *name, RuleDimension d, U u, U ruleUnit) {
+    static const int scale = 1000;
+    const auto zero = ruleQuantity<T>(0, u).toUnit(ruleUnit).value_or(0.0);
+    const auto one = ruleQuantity<T>(scale, u).toUnit(ruleUnit).value_or(0.0);
+    return RuleUnit{name, d, zero, (one - zero) / scale};
+}
+
+inline const std::vector<RuleUnit> &ruleUnits() {
+    using D = RuleDimension;
+    static const std::vector<RuleUnit> units = {
+        ruleUnit<Speed>("KT", D::SPEED, Speed::Unit::KT, Speed::Unit::KT),
+        ruleUnit<Speed>("MPS", D::SPEED, Speed::Unit::MPS, Speed::Unit::KT),
+        ruleUnit<Speed>("KMH", D::SPEED, Speed::Unit::KMH, Speed::Unit::KT),
+        ruleUnit<Speed>("MPH", D::SPEED, Speed::Unit::MPH, Speed::Unit::KT),
+        ruleUnit<Distance>("M",
+                           D::DISTANCE,
+                           Distance::Unit::METERS,
+                           Distance::Unit::METERS),
+        ruleUnit<Distance>("SM",
+                           D::DISTANCE,
+                           Distance::Unit::STATUTE_MILES,
+                           Distance::Unit::METERS),
+        ruleUnit<Distance>("FT",
+                           D::DISTANCE,
+                           Distance::Unit::FEET,
+                           Distance::Unit::METERS),
+        ruleUnit<Height>("FT",
+                         D::HEIGHT,
+                         Height::Unit::FEET,
+                         Height::Unit::FEET),
+        ruleUnit<Height>("M",
+                         D::HEIGHT,
+                         Height::Unit::METERS,
+                         Height::Unit::FEET),
+        ruleUnit<Temperature>("C",
+                              D::TEMPERATURE,
+                              Temperature::Unit::C,
+                              Temperature::Unit::C),
+        ruleUnit<Temperature>("F",
+                              D::TEMPERATURE,
+                              Temperature::Unit::F,
+                              Temperature::Unit::C),
+        ruleUnit<Pressure>("HPA",
+                           D::PRESSURE,
+                           Pressure::Unit::HPA,
+                           Pressure::Unit::HPA),
+        ruleUnit<Pressure>("INHG",
+                           D::PRESSURE,
+                           Pressure::Unit::IN_HG,
+                           Pressure::Unit::HPA),
+        ruleUnit<Pressure>("MMHG",
+                           D::PRESSURE,
+                           Pressure::Unit::MM_HG,
+                           Pressure::Unit::HPA)};
+    return units;
+}
+
+inline double ruleValue(std::optional<double> v) {
+    return v.value_or(std::numeric_limits<double>::quiet_NaN());
+}
+
+// Recursive descent parser producing postfix code:
+//   or = and {"OR" and}
+//   and = unary {"AND" unary}
+//   unary = "NOT" unary | "(" or ")" | comparison
+//   comparison = field operator (number [unit] | name)
+class RuleParser {
+   public:
+    using Instruction = RuleEngine::Instruction;
+    using Opcode = RuleEngine::Opcode;
+    using Compare = RuleEngine::Compare;
+    static const int maxDepth = 64;  // Evaluation stack is a 64-bit word
+    static const int maxNesting = 256;
+
+    RuleParser(const std::string &rule, std::vector<Instruction> &out)
+        : text(rule), code(out) {}
+    inline bool parse();
+    const std::string &error() const { return errorMessage; }
+    std::uint64_t fields() const { return fieldMask; }
+
+   private:
+    inline void skipSpace();
+    inline std::string word();
+    inline bool keyword(const char *k);
+    inline bool number(double &value);
+    inline bool fail(const std::string &message);
+    inline bool emit(Opcode op);
+    inline bool parseOr();
+    inline bool parseAnd();
+    inline bool parseUnary();
+    inline bool parseComparison();
+    inline bool parseCompare(Compare &c);
+
+    const std::string &text;
+    std::vector<Instruction> &code;
+    std::size_t pos = 0;
+    int depth = 0;
+    int nesting = 0;
+    std::uint64_t fieldMask = 0;
+    std::string errorMessage;
+};
+
+void RuleParser::skipSpace() {
+    while (pos < text.size() &&
+           std::isspace(static_cast<unsigned char>(text[pos])))
+        pos++;
+}
+
+std::string RuleParser::word() {
+    skipSpace();
+    const auto begin = pos;
+    while (pos < text.size()) {
+        const auto c = static_cast<unsigned char>(text[pos]);
+        if (!std::isalnum(c) && c != '_' && c != '.') break;
+        pos++;
+    }
+    return text.substr(begin, pos - begin);
+}
+
+bool RuleParser::keyword(const char *k) {
+    skipSpace();
+    const auto len = std::strlen(k);
+    if (text.compare(pos, len, k)) return false;
+    if (pos + len < text.size()) {
+        const auto c = static_cast<unsigned char>(text[pos + len]);
+        if (std::isalnum(c) || c == '_' || c == '.') return false;
+    }
+    pos += len;
+    return true;
+}
+
+bool RuleParser::number(double &value) {
+    // Decimal number with optional sign and fraction; unlike strtod() does
+    // not depend on locale and does not accept exponent, inf or nan
+    skipSpace();
+    auto p = pos;
+    const bool negative = p < text.size() && text[p] == '-';
+    if (p < text.size() && (text[p] == '-' || text[p] == '+')) p++;
+    double result = 0.0, scale = 1.0;
+    bool digits = false, fraction = false;
+    for (; p < text.size(); p++) {
+        const auto c = text[p];
+        if (c == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (c < '0' || c > '9') break;
+        digits = true;
+        // Digits beyond double precision do not change the value
+        if (fraction && scale < 1e-17) continue;
+        if (fraction) scale /= 10.0;
+        result = result * 10.0 + (c - '0');
+    }
+    result *= scale;
+    if (!digits || !std::isfinite(result)) return false;
+    value = negative ? -result : result;
+    pos = p;
+    return true;
+}
+
+bool RuleParser::fail(const std::string &message) {
+    if (errorMessage.empty())
+        errorMessage = message + " at position " + std::to_string(pos);
+    return false;
+}
+
+bool RuleParser::emit(Opcode op) {
+    Instruction i;
+    i.opcode = op;
+    code.push_back(i);
+    if (op == Opcode::AND || op == Opcode::OR) depth--;
+    return true;
+}
+
+bool RuleParser::parse() {
+    if (!parseOr()) return false;
+    skipSpace();
+    if (pos != text.size()) return fail("Unexpected text");
+    return true;
+}
+
+bool RuleParser::parseOr() {
+    if (!parseAnd()) return false;
+    while (keyword("OR")) {
+        if (!parseAnd()) return false;
+        emit(Opcode::OR);
+    }
+    return true;
+}
+
+bool RuleParser::parseAnd() {
+    if (!parseUnary()) return false;
+    while (keyword("AND")) {
+        if (!parseUnary()) return false;
+        emit(Opcode::AND);
+    }
+    return true;
+}
+
+bool RuleParser::parseUnary() {
+    if (++nesting > maxNesting) return fail("Rule is too complex");
+    bool result;
+    skipSpace();
+    if (keyword("NOT")) {
+        result = parseUnary() && emit(Opcode::NOT);
+    } else if (pos < text.size() && text[pos] == '(') {
+        pos++;
+        result = parseOr();
+        skipSpace();
+        if (result && (pos >= text.size() || text[pos] != ')'))
+            result = fail("Expected ')'");
+        pos++;
+    } else {
+        result = parseComparison();
+    }
+    nesting--;
+    return result;
+}
+
+bool RuleParser::parseCompare(Compare &c) {
+    skipSpace();
+    static const struct {
+        const char *text;
+        Compare compare;
+    } operators[] = {{"==", Compare::EQ},
+                     {"!=", Compare::NE},
+                     {"<=", Compare::LE},
+                     {">=", Compare::GE},
+                     {"<", Compare::LT},
+                     {">", Compare::GT}};
+    for (const auto &op : operators) {
+        const auto len = std::strlen(op.text);
+        if (!text.compare(pos, len, op.text)) {
+            pos += len;
+            c = op.compare;
+            return true;
+        }
+    }
+    return fail("Expected comparison operator");
+}
+
+bool RuleParser::parseComparison() {
+    const auto name = word();
+    if (name.empty()) return fail("Expected field name");
+    std::size_t field = ruleFieldCount;
+    for (auto i = 0u; i < ruleFieldCount; i++) {
+        const std::string full = ruleFields[i].name;
+        const auto dot = full.rfind('.');
+        if (name == full || name == full.substr(dot + 1)) {
+            field = i;
+            break;
+        }
+    }
+    if (field == ruleFieldCount) return fail("Unknown field '" + name + "'");
+    const auto &info = ruleFields[field];
+
+    Instruction ins;
+    ins.opcode = Opcode::COMPARE;
+    ins.field = static_cast<std::uint8_t>(field);
+    if (!parseCompare(ins.compare)) return false;
+    skipSpace();
+
+    if (info.enumNames) {
+        const auto value = word();
+        auto index = 0;
+        while (info.enumNames[index] && value != info.enumNames[index])
+            index++;
+        if (!info.enumNames[index])
+            return fail("Unknown value '" + value + "'");
+        if (ins.compare != Compare::EQ && ins.compare != Compare::NE)
+            return fail("Only == and != are allowed");
+        ins.value = index;
+        if (info.dimension == RuleDimension::MASK)
+            ins.compare =
+                ins.compare == Compare::EQ ? Compare::HAS : Compare::HAS_NOT;
+    } else {
+        double value = 0.0;
+        if (!number(value)) return fail("Expected number");
+        ins.value = value;
+        const auto unitPos = pos;
+        const auto unit = word();
+        if (!unit.empty() && unit != "AND" && unit != "OR") {
+            bool found = false;
+            for (const auto &u : ruleUnits()) {
+                if (u.dimension != info.dimension || unit != u.name) continue;
+                ins.value = u.offset + value * u.factor;
+                found = true;
+                break;
+            }
+            if (!found) {
+                pos = unitPos;
+                return fail("Unknown unit '" + unit + "'");
+            }
+        } else {
+            pos = unitPos;
+        }
+    }
+    code.push_back(ins);
+    fieldMask |= std::uint64_t(1) << field;
+    if (++depth > maxDepth) return fail("Rule is too complex");
+    return true;
+}
+
+}  // namespace detail
+
+void extractRuleValues(const Simple &report, RuleValues &v) {
+    using detail::ruleValue;
+    const auto &e = report.current.weatherData;
+    const auto set = [&v](RuleField f, double value) {
+        v[static_cast<std::size_t>(f)] = value;
+    };
+    set(RuleField::REPORT_TYPE, static_cast<int>(report.report.type));
+    set(RuleField::WIND_DIRECTION, ruleValue(e.windDirectionDegrees));
+    set(RuleField::WIND_DIRECTION_VARIABLE, e.windDirectionVariable);
+    set(RuleField::WIND_SPEED, ruleValue(e.windSpeed.toUnit(Speed::Unit::KT)));
+    set(RuleField::GUST_SPEED, ruleValue(e.gustSpeed.toUnit(Speed::Unit::KT)));
+    set(RuleField::WIND_CALM, e.windCalm);
+    set(RuleField::VISIBILITY,
+        ruleValue(e.visibility.toUnit(Distance::Unit::METERS)));
+    set(RuleField::CAVOK, e.cavok);
+    set(RuleField::SKY_CONDITION, static_cast<int>(e.skyCondition));
+    set(RuleField::CEILING,
+        ruleValue(e.ceilingHeight().toUnit(Height::Unit::FEET)));
+    set(RuleField::VERTICAL_VISIBILITY,
+        ruleValue(e.verticalVisibility.toUnit(Height::Unit::FEET)));
+    std::uint64_t weather = 0;
+    for (const auto &w : e.weather)
+        weather |= std::uint64_t(1) << static_cast<unsigned int>(w.phenomena);
+    set(RuleField::WEATHER, static_cast<double>(weather));
+    set(RuleField::SEA_LEVEL_PRESSURE,
+        ruleValue(e.seaLevelPressure.toUnit(Pressure::Unit::HPA)));
+    set(RuleField::AIR_TEMPERATURE,
+        ruleValue(report.current.airTemperature.toUnit(Temperature::Unit::C)));
+    set(RuleField::DEW_POINT,
+        ruleValue(report.current.dewPoint.toUnit(Temperature::Unit::C)));
+    set(RuleField::RELATIVE_HUMIDITY,
+        ruleValue(report.current.relativeHumidity));
+}
+
+std::optional<std::size_t> RuleEngine::add(const std::string &rule,
+                                           std::string *error) {
+    const auto begin = code.size();
+    detail::RuleParser parser(rule, code);
+    if (!parser.parse()) {
+        code.resize(begin);
+        if (error) *error = parser.error();
+        return std::optional<std::size_t>();
+    }
+    const auto index = rules.size();
+    rules.push_back(Rule{static_cast<std::uint32_t>(begin),
+                         static_cast<std::uint32_t>(code.size()),
+                         parser.fields()});
+    for (auto f = 0u; f < ruleFieldCount; f++) {
+        if (parser.fields() & (std::uint64_t(1) << f))
+            rulesByField[f].push_back(index);
+    }
+    checked.push_back(0);
+    return index;
+}
+
+bool RuleEngine::evaluate(std::size_t rule, const RuleValues &values) const {
+    // Stack of boolean values, top of stack is the least significant bit
+    std::uint64_t stack = 0;
+    const auto &r = rules[rule];
+    for (auto i = r.begin; i < r.end; i++) {
+        const auto &ins = code[i];
+        switch (ins.opcode) {
+            case Opcode::COMPARE: {
+                const auto v = values[ins.field];
+                bool result = false;
+                if (!std::isnan(v)) {
+                    switch (ins.compare) {
+                        case Compare::EQ:
+                            result = v == ins.value;
+                            break;
+                        case Compare::NE:
+                            result = v != ins.value;
+                            break;
+                        case Compare::LT:
+                            result = v < ins.value;
+                            break;
+                        case Compare::LE:
+                            result = v <= ins.value;
+                            break;
+                        case Compare::GT:
+                            result = v > ins.value;
+                            break;
+                        case Compare::GE:
+                            result = v >= ins.value;
+                            break;
+                        case Compare::HAS:
+                        case Compare::HAS_NOT: {
+                            const auto mask = static_cast<std::uint64_t>(v);
+                            const auto bit =
+                                static_cast<unsigned int>(ins.value);
+                            result = ((mask >> bit) & 1) ==
+                                     (ins.compare == Compare::HAS);
+                            break;
+                        }
+                    }
+                }
+                stack = (stack << 1) | result;
+                break;
+            }
+            case Opcode::AND:
+                stack = (stack >> 1) & (stack | ~std::uint64_t(1));
+                break;
+            case Opcode::OR:
+                stack = (stack >> 1) | (stack & 1);
+                break;
+            case Opcode::NOT:
+                stack ^= 1;
+                break;
+        }
+    }
+    return stack & 1;
+}
+
+bool RuleEngine::equal(double a, double b) {
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+template <typename F>
+void RuleEngine::update(const Simple &report, F &&onChange) {
+    const auto icao = report.station.icao();
+    if (icao.empty()) return;
+    RuleValues values;
+    extractRuleValues(report, values);
+
+    const auto inserted = stations.emplace(icao, Station());
+    auto &station = inserted.first->second;
+    std::uint64_t changed = 0;
+    if (inserted.second || station.rules != rules.size()) {
+        // New station or rules added: evaluate all rules
+        changed = ~std::uint64_t(0);
+        station.rules = rules.size();
+        station.states.resize((rules.size() + 63) / 64);
+    } else {
+        for (auto f = 0u; f < ruleFieldCount; f++) {
+            if (!equal(station.values[f], values[f]))
+                changed |= std::uint64_t(1) << f;
+        }
+    }
+    station.values = values;
+    if (!changed) return;
+
+    if (!++stamp) {
+        std::fill(checked.begin(), checked.end(), 0);
+        stamp = 1;
+    }
+    for (auto f = 0u; f < ruleFieldCount; f++) {
+        if (!(changed & (std::uint64_t(1) << f))) continue;
+        for (const auto rule : rulesByField[f]) {
+            if (checked[rule] == stamp) continue;
+            checked[rule] = stamp;
+            const bool result = evaluate(rule, values);
+            auto &word = station.states[rule / 64];
+            const auto bit = std::uint64_t(1) << (rule % 64);
+            if (result == static_cast<bool>(word & bit)) continue;
+            word ^= bit;
+            onChange(icao, rule, result);
+        }
+    }
+}
+
+bool RuleEngine::state(IcaoCode icao, std::size_t rule) const {
+    const auto it = stations.find(icao);
+    if (it == stations.end() || rule >= it->second.rules) return false;
+    return (it->second.states[rule / 64] >> (rule % 64)) & 1;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_RULES_HPP
@@ -0,0 +1,276 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_RUNWAYLOG_HPP
+#define METAFSIMPLE_RUNWAYLOG_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_flat.hpp"
+
+// Time series of runway surface condition and runway visual range per
+// runway of each aerodrome, built incrementally from METARs / SPECIs.
+//
+// Each observation of a runway is stored as a fixed-size record; records of
+// a runway are kept in a single array in chronological order, so that the
+// records over a time range (e.g. braking action over the last 6 hours) are
+// a contiguous slice found by binary search.
+//
+// Time is measured in seconds on a timeline chosen by the caller (e.g. from
+// resolveTimes() in metafsimple_epoch.hpp). Reports must be added in
+// chronological order for each runway; a report with the same time as the
+// latest record replaces it (e.g. corrected report).
+
+namespace metafsimple {
+
+// Runway state at the time of report; values not reported are
+// METAFSIMPLE_NO_VALUE, enums are values of Aerodrome enums
+struct RunwayConditionRecord {
+    enum Flags : std::uint16_t {
+        NOT_OPERATIONAL = 0x0001,
+        SNOCLO = 0x0002,            // Runway closed due to snow
+        AERODROME_SNOCLO = 0x0004,  // Aerodrome closed due to snow
+        CLRD = 0x0008,              // Contamination cleared
+        FRICTION_UNRELIABLE = 0x0010,
+        RVR_LESS_THAN = 0x0020,  // Prevailing RVR below reported value
+        RVR_MORE_THAN = 0x0040   // Prevailing RVR above reported value
+    };
+    std::int64_t time;
+    std::int32_t depositDepthTenthsMm;
+    std::int32_t rvrMeters;  // Prevailing
+    std::int32_t rvrMinMeters;
+    std::int32_t rvrMaxMeters;
+    std::int16_t coefficient;  // In 1/100s, -1 if not reported
+    std::uint8_t deposits;             // Aerodrome::RunwayDeposits
+    std::uint8_t contaminationExtent;  // Aerodrome::RunwayContamExtent
+    std::uint8_t brakingAction;        // Aerodrome::BrakingAction
+    std::uint8_t rvrTrend;             // Aerodrome::RvrTrend
+    std::uint16_t flags;
+
+    Aerodrome::BrakingAction braking() const {
+        return static_cast<Aerodrome::BrakingAction>(brakingAction);
+    }
+    Aerodrome::RunwayDeposits runwayDeposits() const {
+        return static_cast<Aerodrome::RunwayDeposits>(deposits);
+    }
+    Aerodrome::RunwayContamExtent extent() const {
+        return static_cast<Aerodrome::RunwayContamExtent>(contaminationExtent);
+    }
+    Aerodrome::RvrTrend visualRangeTrend() const {
+        return static_cast<Aerodrome::RvrTrend>(rvrTrend);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<RunwayConditionRecord>);
+static_assert(sizeof(RunwayConditionRecord) == 32);
+
+// Record from runway data of report; aerodrome SNOCLO is not included
+inline RunwayConditionRecord runwayConditionRecord(
+    const Aerodrome::RunwayData &data,
+    std::int64_t time);
+
+class RunwayConditionLog {
+   public:
+    using Record = RunwayConditionRecord;
+    // Slice of records of a runway
+    struct Range {
+        const Record *first = nullptr;
+        const Record *last = nullptr;
+        const Record *begin() const { return first; }
+        const Record *end() const { return last; }
+        std::size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+
+    // Add runway data of METAR or SPECI observed at given time; returns
+    // number of runways updated. Aerodrome SNOCLO is recorded for all
+    // runways previously reported by the station.
+    inline std::size_t update(const Simple &report, std::int64_t time);
+    // Add record of a runway; returns false if the record is older than the
+    // latest record of the runway
+    inline bool update(IcaoCode icao, Runway runway, const Record &record);
+    // Records of runway with time in range [from, until)
+    inline Range records(IcaoCode icao,
+                         Runway runway,
+                         std::int64_t from,
+                         std::int64_t until) const;
+    // Latest record of runway, nullptr if none
+    inline const Record *latest(IcaoCode icao, Runway runway) const;
+    // Runways of the station which have records, in order of appearance
+    inline std::vector<Runway> runways(IcaoCode icao) const;
+    // Remove records older than given time
+    inline void expire(std::int64_t before);
+    // Number of runways which have records
+    std::size_t size() const { return series.size(); }
+
+   private:
+    static std::uint64_t key(IcaoCode icao, Runway runway) {
+        return (std::uint64_t(icao.packed()) << 16) |
+               (static_cast<std::uint64_t>(runway.number & 0xFF) << 8) |
+               static_cast<std::uint64_t>(runway.designator);
+    }
+
+    std::unordered_map<std::uint64_t, std::vector<Record>> series;
+    std::unordered_map<IcaoCode, std::vector<Runway>> stationRunways;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+RunwayConditionRecord runwayConditionRecord(
+    const Aerodrome::RunwayData &data,
+    std::int64_t time) {
+    using detail::flatValue;
+    using Record = RunwayConditionRecord;
+    Record r;
+    r.time = time;
+    r.depositDepthTenthsMm =
+        flatValue(data.depositDepth.toUnit(Precipitation::Unit::TENTHS_MM));
+    const auto meters = [](const Distance &d) {
+        return flatValue(d.toUnit(Distance::Unit::METERS));
+    };
+    r.rvrMeters = meters(data.visualRange.prevailing);
+    r.rvrMinMeters = meters(data.visualRange.minimum);
+    r.rvrMaxMeters = meters(data.visualRange.maximum);
+    r.coefficient = data.coefficient.has_value()
+                        ? static_cast<std::int16_t>(*data.coefficient)
+                        : std::int16_t(-1);
+    r.deposits = static_cast<std::uint8_t>(data.deposits);
+    r.contaminationExtent =
+        static_cast<std::uint8_t>(data.contaminationExtent);
+    r.brakingAction = static_cast<std::uint8_t>(data.brakingAction());
+    r.rvrTrend = static_cast<std::uint8_t>(data.visualRangeTrend);
+    r.flags = 0;
+    if (data.notOperational) r.flags |= Record::NOT_OPERATIONAL;
+    if (data.snoclo) r.flags |= Record::SNOCLO;
+    if (data.clrd) r.flags |= Record::CLRD;
+    if (data.surfaceFrictionUnreliable) r.flags |= Record::FRICTION_UNRELIABLE;
+    const auto rvrDetails = data.visualRange.prevailing.details;
+    if (r.rvrMeters != METAFSIMPLE_NO_VALUE) {
+        if (rvrDetails == Distance::Details::LESS_THAN)
+            r.flags |= Record::RVR_LESS_THAN;
+        if (rvrDetails == Distance::Details::MORE_THAN)
+            r.flags |= Record::RVR_MORE_THAN;
+    }
+    return r;
+}
+
+std::size_t RunwayConditionLog::update(const Simple &report,
+                                       std::int64_t time) {
+    if (report.report.error != Report::Error::NO_ERROR) return 0;
+    if (report.report.type != Report::Type::METAR &&
+        report.report.type != Report::Type::SPECI)
+        return 0;
+    const auto icao = report.station.icao();
+    if (icao.empty()) return 0;
+    const auto &aerodrome = report.aerodrome;
+    std::size_t result = 0;
+    for (const auto &rd : aerodrome.runways) {
+        auto record = runwayConditionRecord(rd, time);
+        if (aerodrome.snoclo) record.flags |= Record::AERODROME_SNOCLO;
+        if (update(icao, rd.runway, record)) result++;
+    }
+    if (!aerodrome.snoclo) return result;
+    // Runways not reported are closed too; their last known state is kept
+    const auto it = stationRunways.find(icao);
+    if (it == stationRunways.end()) return result;
+    for (const auto runway : it->second) {
+        const auto reported = [&](const Aerodrome::RunwayData &rd) {
+            return rd.runway == runway;
+        };
+        if (std::any_of(
+                aerodrome.runways.begin(), aerodrome.runways.end(), reported))
+            continue;
+        const auto previous = latest(icao, runway);
+        if (!previous) continue;
+        auto record = *previous;
+        record.time = time;
+        record.flags |= Record::AERODROME_SNOCLO;
+        if (update(icao, runway, record)) result++;
+    }
+    return result;
+}
+
+bool RunwayConditionLog::update(IcaoCode icao,
+                                Runway runway,
+                                const Record &record) {
+    auto &records = series[key(icao, runway)];
+    if (records.empty()) stationRunways[icao].push_back(runway);
+    if (!records.empty()) {
+        if (records.back().time > record.time) return false;
+        if (records.back().time == record.time) {
+            records.back() = record;
+            return true;
+        }
+    }
+    records.push_back(record);
+    return true;
+}
+
+RunwayConditionLog::Range RunwayConditionLog::records(
+    IcaoCode icao, Runway runway, std::int64_t from, std::int64_t until) const {
+    const auto it = series.find(key(icao, runway));
+    if (it == series.end() || until <= from) return Range();
+    const auto &records = it->second;
+    const auto earlier = [](const Record &r, std::int64_t t) {
+        return r.time < t;
+    };
+    const auto first =
+        std::lower_bound(records.begin(), records.end(), from, earlier);
+    const auto last = std::lower_bound(first, records.end(), until, earlier);
+    const auto *data = records.data();
+    return Range{data + (first - records.begin()),
+                 data + (last - records.begin())};
+}
+
+const RunwayConditionRecord *RunwayConditionLog::latest(IcaoCode icao,
+                                                        Runway runway) const {
+    const auto it = series.find(key(icao, runway));
+    if (it == series.end() || it->second.empty()) return nullptr;
+    return &it->second.back();
+}
+
+std::vector<Runway> RunwayConditionLog::runways(IcaoCode icao) const {
+    const auto it = stationRunways.find(icao);
+    if (it == stationRunways.end()) return std::vector<Runway>();
+    return it->second;
+}
+
+void RunwayConditionLog::expire(std::int64_t before) {
+    const auto earlier = [](const Record &r, std::int64_t t) {
+        return r.time < t;
+    };
+    for (auto st = stationRunways.begin(); st != stationRunways.end();) {
+        auto &runways = st->second;
+        for (auto rw = runways.begin(); rw != runways.end();) {
+            const auto it = series.find(key(st->first, *rw));
+            auto &records = it->second;
+            records.erase(records.begin(),
+                          std::lower_bound(records.begin(),
+                                           records.end(),
+                                           before,
+                                           earlier));
+            if (!records.empty()) {
+                ++rw;
+                continue;
+            }
+            series.erase(it);
+            rw = runways.erase(rw);
+        }
+        st = runways.empty() ? stationRunways.erase(st) : std::next(st);
+    }
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_RUNWAYLOG_HPP
@@ -0,0 +1,728 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_SERIALIZE_HPP
+#define METAFSIMPLE_SERIALIZE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "metafsimple.hpp"
+
+namespace metafsimple {
+
+// Version of binary serialization format; incremented on every change of
+// field set or encoding
+inline const std::uint32_t serializationVersion = 2;
+
+// Append binary representation of simplified report to string
+inline void serialize(const Simple &simple, std::string &out);
+
+// Binary representation of simplified report
+inline std::string serialize(const Simple &simple);
+
+// Restore simplified report from binary representation; empty optional is
+// returned if data are truncated, malformed or have different format version
+inline std::optional<Simple> deserialize(std::string_view data);
+
+// CRC-32 (as in zlib) of data; crc of preceding data may be given to
+// continue the calculation
+inline std::uint32_t crc32(std::string_view data, std::uint32_t crc = 0);
+
+}  // namespace metafsimple
+
+namespace metafsimple::detail {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Field lists of data structures. Each visitFields() calls visitor with all
+// data members of the structure in serialization order; the same function is
+// used for const (serializing) and non-const (deserializing) structures.
+
+template <typename T, typename U>
+using IfType = std::enable_if_t<std::is_same_v<std::remove_const_t<T>, U>>;
+
+template <typename T, typename V>
+IfType<T, Runway> visitFields(T &t, V &&v) {
+    v(t.number, t.designator);
+}
+
+template <typename T, typename V>
+IfType<T, Time> visitFields(T &t, V &&v) {
+    v(t.day, t.hour, t.minute);
+}
+
+template <typename T, typename V>
+IfType<T, Temperature> visitFields(T &t, V &&v) {
+    v(t.temperature, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, Speed> visitFields(T &t, V &&v) {
+    v(t.speed, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, Distance> visitFields(T &t, V &&v) {
+    v(t.details, t.distance, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, DistanceRange> visitFields(T &t, V &&v) {
+    v(t.prevailing, t.minimum, t.maximum);
+}
+
+template <typename T, typename V>
+IfType<T, Height> visitFields(T &t, V &&v) {
+    v(t.height, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, Ceiling> visitFields(T &t, V &&v) {
+    v(t.exact, t.minimum, t.maximum);
+}
+
+template <typename T, typename V>
+IfType<T, Pressure> visitFields(T &t, V &&v) {
+    v(t.pressure, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, Precipitation> visitFields(T &t, V &&v) {
+    v(t.amount, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, WaveHeight> visitFields(T &t, V &&v) {
+    v(t.waveHeight, t.unit);
+}
+
+template <typename T, typename V>
+IfType<T, Weather> visitFields(T &t, V &&v) {
+    v(t.phenomena, t.precipitation);
+}
+
+template <typename T, typename V>
+IfType<T, CloudLayer> visitFields(T &t, V &&v) {
+    v(t.amount, t.height, t.details, t.okta);
+}
+
+template <typename T, typename V>
+IfType<T, Vicinity> visitFields(T &t, V &&v) {
+    v(t.phenomena, t.distance, t.moving, t.directions);
+}
+
+template <typename T, typename V>
+IfType<T, LightningStrikes> visitFields(T &t, V &&v) {
+    v(t.frequency, t.type, t.distance, t.directions);
+}
+
+template <typename T, typename V>
+IfType<T, WindShear> visitFields(T &t, V &&v) {
+    v(t.height, t.directionDegrees, t.windSpeed);
+}
+
+template <typename T, typename V>
+IfType<T, Essentials> visitFields(T &t, V &&v) {
+    v(t.windDirectionDegrees,
+      t.windDirectionVariable,
+      t.windDirectionVarFromDegrees,
+      t.windDirectionVarToDegrees,
+      t.windSpeed,
+      t.gustSpeed,
+      t.windCalm,
+      t.visibility,
+      t.cavok,
+      t.skyCondition,
+      t.cloudLayers,
+      t.verticalVisibility,
+      t.weather,
+      t.seaLevelPressure,
+      t.windShear,
+      t.summary);
+}
+
+template <typename T, typename V>
+IfType<T, IcingForecast> visitFields(T &t, V &&v) {
+    v(t.severity, t.type, t.minHeight, t.maxHeight);
+}
+
+template <typename T, typename V>
+IfType<T, TurbulenceForecast> visitFields(T &t, V &&v) {
+    v(t.severity, t.location, t.frequency, t.minHeight, t.maxHeight);
+}
+
+template <typename T, typename V>
+IfType<T, TemperatureForecast> visitFields(T &t, V &&v) {
+    v(t.temperature, t.time);
+}
+
+template <typename T, typename V>
+IfType<T, Trend> visitFields(T &t, V &&v) {
+    v(t.type,
+      t.probability,
+      t.timeFrom,
+      t.timeUntil,
+      t.timeAt,
+      t.metar,
+      t.forecast,
+      t.icing,
+      t.turbulence,
+      t.vicinity,
+      t.windShearConditions);
+}
+
+template <typename T, typename V>
+IfType<T, Report::Warning> visitFields(T &t, V &&v) {
+    v(t.message, t.id);
+}
+
+template <typename T, typename V>
+IfType<T, Report> visitFields(T &t, V &&v) {
+    v(t.type,
+      t.missing,
+      t.cancelled,
+      t.correctional,
+      t.amended,
+      t.automated,
+      t.correctionNumber,
+      t.reportTime,
+      t.applicableFrom,
+      t.applicableUntil,
+      t.error,
+      t.warnings,
+      t.plainText);
+}
+
+template <typename T, typename V>
+IfType<T, Station> visitFields(T &t, V &&v) {
+    v(t.icaoCode,
+      t.autoType,
+      t.requiresMaintenance,
+      t.noSpeciReports,
+      t.noVisDirectionalVariation,
+      t.missingData,
+      t.runwaysNoCeilingData,
+      t.runwaysNoVisData,
+      t.directionsNoCeilingData,
+      t.directionsNoVisData);
+}
+
+template <typename T, typename V>
+IfType<T, Aerodrome::RunwayData> visitFields(T &t, V &&v) {
+    v(t.runway,
+      t.notOperational,
+      t.snoclo,
+      t.clrd,
+      t.windShearLowerLayers,
+      t.deposits,
+      t.contaminationExtent,
+      t.depositDepth,
+      t.coefficient,
+      t.surfaceFrictionUnreliable,
+      t.visualRange,
+      t.visualRangeTrend,
+      t.ceiling,
+      t.visibility);
+}
+
+template <typename T, typename V>
+IfType<T, Aerodrome::DirectionData> visitFields(T &t, V &&v) {
+    v(t.cardinalDirection, t.visibility, t.ceiling);
+}
+
+template <typename T, typename V>
+IfType<T, Aerodrome> visitFields(T &t, V &&v) {
+    v(t.snoclo,
+      t.colourCode,
+      t.colourCodeBlack,
+      t.runways,
+      t.directions,
+      t.ceiling,
+      t.surfaceVisibility,
+      t.towerVisibility);
+}
+
+template <typename T, typename V>
+IfType<T, Current> visitFields(T &t, V &&v) {
+    v(t.weatherData,
+      t.variableVisibility,
+      t.obscurations,
+      t.lowCloudLayer,
+      t.midCloudLayer,
+      t.highCloudLayer,
+      t.airTemperature,
+      t.dewPoint,
+      t.relativeHumidity,
+      t.pressureGroundLevel,
+      t.seaSurfaceTemperature,
+      t.waveHeight,
+      t.snowWaterEquivalent,
+      t.snowDepthOnGround,
+      t.snowIncreasingRapidly,
+      t.phenomenaInVicinity,
+      t.lightningStrikes,
+      t.densityAltitude,
+      t.hailstoneSizeQuartersInch,
+      t.frostOnInstrument);
+}
+
+template <typename T, typename V>
+IfType<T, Historical::WeatherEvent> visitFields(T &t, V &&v) {
+    v(t.event, t.weather, t.time);
+}
+
+template <typename T, typename V>
+IfType<T, Historical> visitFields(T &t, V &&v) {
+    v(t.peakWindDirectionDegrees,
+      t.peakWindSpeed,
+      t.peakWindObserved,
+      t.windShift,
+      t.windShiftFrontPassage,
+      t.windShiftBegan,
+      t.temperatureMin6h,
+      t.temperatureMax6h,
+      t.temperatureMin24h,
+      t.temperatureMax24h,
+      t.pressureTendency,
+      t.pressureTrend,
+      t.pressureChange3h,
+      t.recentWeather,
+      t.rainfall10m,
+      t.rainfallSince0900LocalTime,
+      t.precipitationSinceLastReport,
+      t.precipitationTotal1h,
+      t.precipitationFrozen3or6h,
+      t.precipitationFrozen3h,
+      t.precipitationFrozen6h,
+      t.precipitationFrozen24h,
+      t.snow6h,
+      t.snowfallTotal,
+      t.snowfallIncrease1h,
+      t.icing1h,
+      t.icing3h,
+      t.icing6h,
+      t.sunshineDurationMinutes24h);
+}
+
+template <typename T, typename V>
+IfType<T, Forecast> visitFields(T &t, V &&v) {
+    v(t.prevailing,
+      t.prevailingIcing,
+      t.prevailingTurbulence,
+      t.prevailingVicinity,
+      t.prevailingWsConds,
+      t.trends,
+      t.noSignificantChanges,
+      t.minTemperature,
+      t.maxTemperature);
+}
+
+template <typename T, typename V>
+IfType<T, Simple> visitFields(T &t, V &&v) {
+    v(t.report, t.station, t.aerodrome, t.current, t.historical, t.forecast);
+}
+
+// Last enumerator of each enum; Decoder rejects values above it, so that
+// malformed data never produce enum values which are not enumerated
+
+constexpr auto lastEnumerator(CardinalDirection) {
+    return CardinalDirection::UNKNOWN;
+}
+
+constexpr auto lastEnumerator(Runway::Designator) {
+    return Runway::Designator::RIGHT;
+}
+
+constexpr auto lastEnumerator(Temperature::Unit) {
+    return Temperature::Unit::F;
+}
+
+constexpr auto lastEnumerator(Speed::Unit) {
+    return Speed::Unit::MPH;
+}
+
+constexpr auto lastEnumerator(Distance::Unit) {
+    return Distance::Unit::FEET;
+}
+
+constexpr auto lastEnumerator(Distance::Details) {
+    return Distance::Details::MORE_THAN;
+}
+
+constexpr auto lastEnumerator(Distance::Fraction) {
+    return Distance::Fraction::F_15_16;
+}
+
+constexpr auto lastEnumerator(Height::Unit) {
+    return Height::Unit::FEET;
+}
+
+constexpr auto lastEnumerator(Pressure::Unit) {
+    return Pressure::Unit::MM_HG;
+}
+
+constexpr auto lastEnumerator(Precipitation::Unit) {
+    return Precipitation::Unit::HUNDREDTHS_IN;
+}
+
+constexpr auto lastEnumerator(WaveHeight::Unit) {
+    return WaveHeight::Unit::YARDS;
+}
+
+constexpr auto lastEnumerator(WaveHeight::StateOfSurface) {
+    return WaveHeight::StateOfSurface::PHENOMENAL;
+}
+
+constexpr auto lastEnumerator(Weather::Phenomena) {
+    return Weather::Phenomena::THUNDERSTORM_PRECIPITATION_HEAVY;
+}
+
+constexpr auto lastEnumerator(Weather::Precipitation) {
+    return Weather::Precipitation::UNDETERMINED;
+}
+
+constexpr auto lastEnumerator(CloudLayer::Amount) {
+    return CloudLayer::Amount::VARIABLE_BROKEN_OVERCAST;
+}
+
+constexpr auto lastEnumerator(CloudLayer::Details) {
+    return CloudLayer::Details::VOLCANIC_ASH;
+}
+
+constexpr auto lastEnumerator(ObservedPhenomena) {
+    return ObservedPhenomena::FUNNEL_CLOUD;
+}
+
+constexpr auto lastEnumerator(LightningStrikes::Type) {
+    return LightningStrikes::Type::CLOUD_AIR;
+}
+
+constexpr auto lastEnumerator(LightningStrikes::Frequency) {
+    return LightningStrikes::Frequency::CONSTANT;
+}
+
+constexpr auto lastEnumerator(Essentials::SkyCondition) {
+    return Essentials::SkyCondition::OBSCURED;
+}
+
+constexpr auto lastEnumerator(Essentials::FlightCategory) {
+    return Essentials::FlightCategory::LIFR;
+}
+
+constexpr auto lastEnumerator(Essentials::Hazard) {
+    return Essentials::Hazard::HEAVY_PRECIPITATION;
+}
+
+constexpr auto lastEnumerator(IcingForecast::Severity) {
+    return IcingForecast::Severity::SEVERE;
+}
+
+constexpr auto lastEnumerator(IcingForecast::Type) {
+    return IcingForecast::Type::MIXED;
+}
+
+constexpr auto lastEnumerator(TurbulenceForecast::Severity) {
+    return TurbulenceForecast::Severity::EXTREME;
+}
+
+constexpr auto lastEnumerator(TurbulenceForecast::Location) {
+    return TurbulenceForecast::Location::IN_CLEAR_AIR;
+}
+
+constexpr auto lastEnumerator(TurbulenceForecast::Frequency) {
+    return TurbulenceForecast::Frequency::OCCASIONAL;
+}
+
+constexpr auto lastEnumerator(Trend::Type) {
+    return Trend::Type::PROB;
+}
+
+constexpr auto lastEnumerator(Report::Type) {
+    return Report::Type::TAF;
+}
+
+constexpr auto lastEnumerator(Report::Error) {
+    return Report::Error::GROUP_NOT_ALLOWED;
+}
+
+constexpr auto lastEnumerator(Report::Warning::Message) {
+    return Report::Warning::Message::INVALID_TIME;
+}
+
+constexpr auto lastEnumerator(Station::AutoType) {
+    return Station::AutoType::AO2A;
+}
+
+constexpr auto lastEnumerator(Station::MissingData) {
+    return Station::MissingData::DENSITY_ALT_MISG;
+}
+
+constexpr auto lastEnumerator(Aerodrome::ColourCode) {
+    return Aerodrome::ColourCode::RED;
+}
+
+constexpr auto lastEnumerator(Aerodrome::RvrTrend) {
+    return Aerodrome::RvrTrend::UPWARD;
+}
+
+constexpr auto lastEnumerator(Aerodrome::RunwayDeposits) {
+    return Aerodrome::RunwayDeposits::FROZEN_RUTS_OR_RIDGES;
+}
+
+constexpr auto lastEnumerator(Aerodrome::RunwayContamExtent) {
+    return Aerodrome::RunwayContamExtent::MORE_THAN_50_PERCENT;
+}
+
+constexpr auto lastEnumerator(Aerodrome::BrakingAction) {
+    return Aerodrome::BrakingAction::UNKNOWN;
+}
+
+constexpr auto lastEnumerator(Current::LowCloudLayer) {
+    return Current::LowCloudLayer::UNKNOWN;
+}
+
+constexpr auto lastEnumerator(Current::MidCloudLayer) {
+    return Current::MidCloudLayer::UNKNOWN;
+}
+
+constexpr auto lastEnumerator(Current::HighCloudLayer) {
+    return Current::HighCloudLayer::UNKNOWN;
+}
+
+constexpr auto lastEnumerator(Historical::PressureTendency) {
+    return Historical::PressureTendency::FALLING_RAPIDLY;
+}
+
+constexpr auto lastEnumerator(Historical::PressureTrend) {
+    return Historical::PressureTrend::LOWER;
+}
+
+constexpr auto lastEnumerator(Historical::Event) {
+    return Historical::Event::ENDED;
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Appends values to string in compact binary form: unsigned integers, sizes
+// and enums as base-128 varints, signed integers zigzag-encoded, empty
+// optional values as single zero byte, strings and containers prefixed with
+// element count, and structures as the sequence of their fields
+class Encoder {
+   public:
+    explicit Encoder(std::string &out) : out(out) {}
+    template <typename... Ts>
+    void operator()(const Ts &... values) {
+        (write(values), ...);
+    }
+    inline void writeUnsigned(std::uint64_t value);
+
+   private:
+    std::string &out;
+
+    void write(bool value) { writeUnsigned(value); }
+    void write(int value) { writeUnsigned(zigzag(value)); }
+    void write(std::uint32_t value) { writeUnsigned(value); }
+    void write(std::uint64_t value) { writeUnsigned(value); }
+    void write(const std::optional<int> &value) {
+        writeUnsigned(value.has_value() ? zigzag(*value) + 1 : 0);
+    }
+    void write(const std::string &value) {
+        writeUnsigned(value.length());
+        out.append(value);
+    }
+    template <typename E>
+    std::enable_if_t<std::is_enum_v<E>> write(E value) {
+        using U = std::make_unsigned_t<std::underlying_type_t<E>>;
+        writeUnsigned(static_cast<U>(value));
+    }
+    template <typename T>
+    void write(const std::vector<T> &value) {
+        writeUnsigned(value.size());
+        for (const auto &v : value) write(v);
+    }
+    template <typename T>
+    void write(const std::set<T> &value) {
+        writeUnsigned(value.size());
+        for (const auto &v : value) write(v);
+    }
+    template <typename T>
+    std::enable_if_t<std::is_class_v<T>> write(const T &value) {
+        detail::visitFields(value, *this);
+    }
+    static std::uint64_t zigzag(int value) {
+        return (static_cast<std::uint32_t>(value) << 1) ^
+               static_cast<std::uint32_t>(value >> 31);
+    }
+};
+
+// Reads values written by Encoder; any truncated or malformed data set the
+// failed flag, after which all values read are zero or empty
+class Decoder {
+   public:
+    explicit Decoder(std::string_view data) : data(data) {}
+    template <typename... Ts>
+    void operator()(Ts &... values) {
+        (read(values), ...);
+    }
+    inline std::uint64_t readUnsigned();
+    bool failed() const { return error; }
+    // True if all data were read with no errors
+    bool finished() const { return !error && data.empty(); }
+    std::string_view remaining() const { return data; }
+
+   private:
+    std::string_view data;
+    bool error = false;
+
+    void fail() {
+        error = true;
+        data = std::string_view();
+    }
+    void read(bool &value) { value = (readUnsigned() != 0); }
+    void read(int &value) { value = unzigzag(readUnsigned()); }
+    void read(std::uint32_t &value) {
+        const auto v = readUnsigned();
+        if (v > UINT32_MAX) return fail();
+        value = static_cast<std::uint32_t>(v);
+    }
+    void read(std::uint64_t &value) { value = readUnsigned(); }
+    void read(std::optional<int> &value) {
+        const auto v = readUnsigned();
+        value = v ? std::optional<int>(unzigzag(v - 1)) : std::optional<int>();
+    }
+    void read(std::string &value) {
+        const auto size = readUnsigned();
+        if (size > data.length()) return fail();
+        value.assign(data.data(), size);
+        data.remove_prefix(size);
+    }
+    template <typename E>
+    std::enable_if_t<std::is_enum_v<E>> read(E &value) {
+        const auto v = readUnsigned();
+        if (v > static_cast<std::uint64_t>(detail::lastEnumerator(E())))
+            return fail();
+        value = static_cast<E>(v);
+    }
+    template <typename T>
+    void read(std::vector<T> &value) {
+        value.clear();
+        value.resize(readCount());
+        for (auto &v : value) read(v);
+    }
+    template <typename T>
+    void read(std::set<T> &value) {
+        value.clear();
+        for (auto i = readCount(); i > 0; i--) {
+            T v{};
+            read(v);
+            value.insert(value.end(), v);
+        }
+    }
+    template <typename T>
+    std::enable_if_t<std::is_class_v<T>> read(T &value) {
+        detail::visitFields(value, *this);
+    }
+    // Every element takes at least one byte, so count cannot exceed
+    // remaining data size; this prevents huge allocations on corrupt data
+    std::size_t readCount() {
+        const auto count = readUnsigned();
+        if (count > data.length()) {
+            fail();
+            return 0;
+        }
+        return count;
+    }
+    int unzigzag(std::uint64_t value) {
+        if (value > UINT32_MAX) {
+            fail();
+            return 0;
+        }
+        const auto v = static_cast<std::uint32_t>(value);
+        return static_cast<int>((v >> 1) ^ (0u - (v & 1)));
+    }
+};
+
+void Encoder::writeUnsigned(std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+std::uint64_t Decoder::readUnsigned() {
+    static const auto maxBytes = 10;
+    std::uint64_t result = 0;
+    for (auto i = 0; i < maxBytes; i++) {
+        if (data.empty()) break;
+        const auto byte = static_cast<unsigned char>(data.front());
+        data.remove_prefix(1);
+        result |= static_cast<std::uint64_t>(byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80)) return result;
+    }
+    fail();
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void serialize(const Simple &simple, std::string &out) {
+    Encoder e(out);
+    e.writeUnsigned(serializationVersion);
+    e(simple);
+}
+
+std::string serialize(const Simple &simple) {
+    std::string result;
+    serialize(simple, result);
+    return result;
+}
+
+std::optional<Simple> deserialize(std::string_view data) {
+    Decoder d(data);
+    if (d.readUnsigned() != serializationVersion)
+        return std::optional<Simple>();
+    Simple result;
+    d(result);
+    if (!d.finished()) return std::optional<Simple>();
+    return result;
+}
+
+std::uint32_t crc32(std::string_view data, std::uint32_t crc) {
+    struct Table {
+        std::uint32_t values[256];
+        constexpr Table() : values() {
+            for (auto i = 0u; i < 256; i++) {
+                auto v = i;
+                for (auto bit = 0; bit < 8; bit++)
+                    v = (v & 1) ? (0xEDB88320 ^ (v >> 1)) : (v >> 1);
+                values[i] = v;
+            }
+        }
+    };
+    static constexpr Table table;
+    crc = ~crc;
+    for (const auto c : data)
+        crc = table.values[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^
+              (crc >> 8);
+    return ~crc;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_SERIALIZE_HPP
@@ -0,0 +1,301 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_SHM_HPP
+#define METAFSIMPLE_SHM_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "metafsimple.hpp"
+#include "metafsimple_flat.hpp"
+
+// Publication of latest station conditions to POSIX shared memory (e.g.
+// /dev/shm/<name>). One writer process publishes metafsimple_record for each
+// station; any number of reader processes read them lock-free.
+//
+// Segment is a table of fixed-size slots indexed by station: slot is found
+// by hash of packed ICAO code with linear probing; station is assigned a
+// slot on first publication and keeps it while segment exists. Each slot is
+// protected by sequence counter (seqlock): writer makes counter odd before
+// updating the record and even after; reader retries if counter was odd or
+// changed while the record was being copied; after a bounded number of
+// retries (e.g. if writer died while updating the record) read fails.
+//
+// When publisher re-creates the segment, it marks the replaced segment as
+// retired; readers which still map it should reopen the segment by name.
+
+namespace metafsimple::detail {
+
+struct ShmHeader {
+    static const std::uint32_t magicValue = 0x4D46534D;  // "MFSM"
+    static const std::uint32_t versionValue = 1;
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t capacity;
+    std::uint32_t recordSize;
+    // Non-zero if segment was replaced or removed
+    std::atomic<std::uint32_t> retired;
+};
+
+struct alignas(64) ShmSlot {
+    static constexpr std::size_t words = sizeof(metafsimple_record) / 4;
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::uint32_t> icao;  // packed ICAO code, zero if slot is free
+    // Record is copied word by word using atomic operations, so that
+    // concurrent reads and writes do not constitute data race
+    std::atomic<std::uint32_t> data[words];
+};
+
+static_assert(sizeof(metafsimple_record) % 4 == 0);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+static const std::size_t shmHeaderSize = 64;
+static_assert(sizeof(ShmHeader) <= shmHeaderSize);
+
+// Number of attempts to read the record consistently
+static const int shmReadRetries = 1024;
+
+inline std::size_t shmSize(std::uint32_t capacity) {
+    return shmHeaderSize + capacity * sizeof(ShmSlot);
+}
+
+inline std::uint32_t shmFirstSlot(IcaoCode icao, std::uint32_t capacity) {
+    return std::hash<IcaoCode>()(icao) % capacity;
+}
+
+// Shared memory mapping owned by publisher or reader
+class ShmMapping {
+   public:
+    ShmMapping() = default;
+    ShmMapping(const ShmMapping &) = delete;
+    ShmMapping &operator=(const ShmMapping &) = delete;
+    ~ShmMapping() { close(); }
+
+    bool isOpen() const { return header; }
+    inline void close();
+    inline bool map(int fd, std::size_t size, bool writable);
+
+    ShmHeader *header = nullptr;
+    ShmSlot *slots = nullptr;
+
+   private:
+    std::size_t size = 0;
+};
+
+// Mark existing segment as retired, so that its readers reopen the segment
+inline void shmRetire(const std::string &name);
+
+void ShmMapping::close() {
+    if (header) munmap(header, size);
+    header = nullptr;
+    slots = nullptr;
+    size = 0;
+}
+
+bool ShmMapping::map(int fd, std::size_t s, bool writable) {
+    const auto prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *p = mmap(nullptr, s, prot, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    header = static_cast<ShmHeader *>(p);
+    slots = reinterpret_cast<ShmSlot *>(static_cast<char *>(p) + shmHeaderSize);
+    size = s;
+    return true;
+}
+
+void shmRetire(const std::string &name) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return;
+    struct stat st;
+    ShmMapping m;
+    const bool mapped =
+        !fstat(fd, &st) &&
+        static_cast<std::size_t>(st.st_size) >= shmHeaderSize &&
+        m.map(fd, shmHeaderSize, true);
+    ::close(fd);
+    // Segments of other format are left intact
+    if (mapped && m.header->magic == ShmHeader::magicValue)
+        m.header->retired.store(1, std::memory_order_release);
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+// Writes latest station records to shared memory segment; only one publisher
+// per segment may exist at a time
+class StationStatePublisher {
+   public:
+    // Create (or re-create) segment with table for given number of stations;
+    // name must start with '/', e.g. "/metafsimple"
+    inline bool open(const std::string &name, std::uint32_t capacity);
+    void close() { mapping.close(); }
+    bool isOpen() const { return mapping.isOpen(); }
+    // Publish record for station; returns false if table is full
+    inline bool publish(IcaoCode icao, const metafsimple_record &record);
+    // Publish simplified report for the station it was issued for; reports
+    // with no valid ICAO code are not published
+    inline bool publish(const Simple &simple);
+    // Remove shared memory segment; existing mappings remain valid but
+    // are marked as retired
+    static bool remove(const std::string &name) {
+        detail::shmRetire(name);
+        return !shm_unlink(name.c_str());
+    }
+
+   private:
+    detail::ShmMapping mapping;
+};
+
+// Reads station records published by StationStatePublisher
+class StationStateReader {
+   public:
+    inline bool open(const std::string &name);
+    void close() { mapping.close(); }
+    bool isOpen() const { return mapping.isOpen(); }
+    // Copy latest record for station; returns false if nothing was published
+    // for the station or record was not read consistently after retries
+    inline bool read(IcaoCode icao, metafsimple_record &record) const;
+    // True if segment was replaced or removed by publisher; reader must be
+    // reopened to see new publications
+    bool retired() const {
+        return mapping.isOpen() &&
+               mapping.header->retired.load(std::memory_order_acquire);
+    }
+    // Number of slots in the table
+    std::uint32_t capacity() const {
+        return mapping.isOpen() ? mapping.header->capacity : 0;
+    }
+
+   private:
+    detail::ShmMapping mapping;
+};
+
+bool StationStatePublisher::open(const std::string &name,
+                                 std::uint32_t capacity) {
+    close();
+    if (!capacity) return false;
+    const auto size = detail::shmSize(capacity);
+    detail::shmRetire(name);
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+    const bool mapped = !ftruncate(fd, size) && mapping.map(fd, size, true);
+    ::close(fd);
+    if (!mapped) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+    // Segment is zero-filled by ftruncate: all slots are free
+    auto h = mapping.header;
+    h->capacity = capacity;
+    h->recordSize = sizeof(metafsimple_record);
+    h->version = detail::ShmHeader::versionValue;
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = detail::ShmHeader::magicValue;
+    return true;
+}
+
+bool StationStatePublisher::publish(IcaoCode icao,
+                                    const metafsimple_record &record) {
+    if (!isOpen() || icao.empty()) return false;
+    const auto capacity = mapping.header->capacity;
+    auto index = detail::shmFirstSlot(icao, capacity);
+    for (auto i = 0u; i < capacity; i++) {
+        auto &slot = mapping.slots[index];
+        const auto key = slot.icao.load(std::memory_order_relaxed);
+        if (!key || key == icao.packed()) {
+            std::uint32_t words[detail::ShmSlot::words];
+            std::memcpy(words, &record, sizeof(record));
+            const auto seq = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (auto w = 0u; w < detail::ShmSlot::words; w++)
+                slot.data[w].store(words[w], std::memory_order_relaxed);
+            slot.sequence.store(seq + 2, std::memory_order_release);
+            if (!key) slot.icao.store(icao.packed(), std::memory_order_release);
+            return true;
+        }
+        if (++index == capacity) index = 0;
+    }
+    return false;
+}
+
+bool StationStatePublisher::publish(const Simple &simple) {
+    const auto icao = simple.station.icao();
+    if (icao.empty()) return false;
+    metafsimple_record record;
+    flatten(simple, record);
+    return publish(icao, record);
+}
+
+bool StationStateReader::open(const std::string &name) {
+    close();
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    const bool mapped =
+        !fstat(fd, &st) &&
+        static_cast<std::size_t>(st.st_size) >= detail::shmHeaderSize &&
+        mapping.map(fd, st.st_size, false);
+    ::close(fd);
+    if (!mapped) return false;
+    const auto h = mapping.header;
+    if (h->magic != detail::ShmHeader::magicValue ||
+        h->version != detail::ShmHeader::versionValue ||
+        h->recordSize != sizeof(metafsimple_record) || !h->capacity ||
+        detail::shmSize(h->capacity) > static_cast<std::size_t>(st.st_size)) {
+        close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+bool StationStateReader::read(IcaoCode icao, metafsimple_record &record) const {
+    if (!isOpen() || icao.empty()) return false;
+    const auto capacity = mapping.header->capacity;
+    auto index = detail::shmFirstSlot(icao, capacity);
+    for (auto i = 0u; i < capacity; i++) {
+        const auto &slot = mapping.slots[index];
+        const auto key = slot.icao.load(std::memory_order_acquire);
+        if (!key) return false;
+        if (key == icao.packed()) {
+            std::uint32_t words[detail::ShmSlot::words];
+            for (auto r = 0; r < detail::shmReadRetries; r++) {
+                const auto seq1 = slot.sequence.load(std::memory_order_acquire);
+                if (seq1 & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (auto w = 0u; w < detail::ShmSlot::words; w++)
+                    words[w] = slot.data[w].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                const auto seq2 = slot.sequence.load(std::memory_order_relaxed);
+                if (seq1 != seq2) continue;
+                std::memcpy(&record, words, sizeof(record));
+                return true;
+            }
+            return false;
+        }
+        if (++index == capacity) index = 0;
+    }
+    return false;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_SHM_HPP
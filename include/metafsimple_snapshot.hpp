@@ -0,0 +1,349 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_SNAPSHOT_HPP
+#define METAFSIMPLE_SNAPSHOT_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_flat.hpp"
+#include "metafsimple_serialize.hpp"
+
+// Snapshot of latest reports of all stations in a single file, so that a
+// restarted service can restore its state without simplifying the reports
+// again.
+//
+// Snapshot is built in memory from the current state and written to file
+// by a background thread; file is replaced atomically (written under
+// temporary name and renamed), so that readers always see either previous
+// or new complete snapshot.
+//
+// File layout (all integers in native byte order):
+//   header
+//   station table: entry per station sorted by packed ICAO code
+//   metafsimple_record per station, in the order of station table
+//   serialized reports
+// Snapshot is loaded by mapping the file into memory; after the checksum is
+// verified, stations are found by binary search over the table and their
+// flattened records are used in place. Full reports are deserialized on
+// demand or all at once by restore().
+
+namespace metafsimple {
+
+// Latest report per station
+using StationStates = std::unordered_map<IcaoCode, Simple>;
+
+}  // namespace metafsimple
+
+namespace metafsimple::detail {
+
+struct SnapshotHeader {
+    static const std::uint32_t magicValue = 0x4D465353;  // "MFSS"
+    static const std::uint32_t versionValue = 1;
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t serializationVersion;
+    std::uint32_t recordSize;  // Size of metafsimple_record
+    std::uint32_t stationCount;
+    std::uint32_t crc;   // Of the file contents after header
+    std::uint64_t size;  // Size of file
+};
+
+struct SnapshotStation {
+    std::uint32_t icao;    // Packed ICAO code
+    std::uint32_t length;  // Length of serialized report
+    std::uint64_t offset;  // Offset of serialized report in file
+};
+
+static_assert(sizeof(SnapshotHeader) == 32);
+static_assert(sizeof(SnapshotStation) == 16);
+static_assert(sizeof(metafsimple_record) % 8 == 0);
+
+// Sync directory which contains the file, so that renaming of the file is
+// on disk
+inline bool snapshotSyncDirectory(const std::string &path) {
+    // Root directory is kept as "/"
+    const auto slash = path.rfind('/');
+    std::string directory(".");
+    if (slash != std::string::npos)
+        directory = path.substr(0, std::max<std::size_t>(slash, 1));
+    const int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    const bool result = !fsync(fd);
+    ::close(fd);
+    return result;
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+// Contents of snapshot file of the state
+inline std::string snapshotImage(const StationStates &states);
+
+// Write snapshot image to file, replacing the existing file atomically;
+// returns true when the new file is on disk
+inline bool writeSnapshot(const std::string &path, const std::string &image);
+
+// Writes snapshots in background thread
+class SnapshotWriter {
+   public:
+    SnapshotWriter() = default;
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+    ~SnapshotWriter() { wait(); }
+
+    // Build snapshot of the state and start writing it; waits for the
+    // previous snapshot to be written. State may be modified as soon as the
+    // function returns.
+    inline void start(const std::string &path, const StationStates &states);
+    // Wait until snapshot is written; returns false if writing failed or
+    // no snapshot was started
+    inline bool wait();
+    // True while snapshot is being written
+    bool busy() const {
+        return worker.joinable() && !done.load(std::memory_order_acquire);
+    }
+
+   private:
+    std::thread worker;
+    std::atomic<bool> done = false;
+    bool result = false;
+};
+
+// Snapshot file loaded into memory
+class StationSnapshot {
+   public:
+    StationSnapshot() = default;
+    StationSnapshot(const StationSnapshot &) = delete;
+    StationSnapshot &operator=(const StationSnapshot &) = delete;
+    ~StationSnapshot() { close(); }
+
+    // Returns false if file does not exist, has wrong format or checksum
+    inline bool open(const std::string &path);
+    inline void close();
+    bool isOpen() const { return base; }
+    // Number of stations
+    std::size_t size() const { return header ? header->stationCount : 0; }
+
+    // Stations are numbered in the order of packed ICAO codes
+    IcaoCode station(std::size_t number) const {
+        return IcaoCode::fromPacked(table[number].icao);
+    }
+    // Number of station; empty optional if station is not in snapshot
+    inline std::optional<std::size_t> find(IcaoCode icao) const;
+    const metafsimple_record &record(std::size_t number) const {
+        return records[number];
+    }
+    std::string_view data(std::size_t number) const {
+        return std::string_view(base + table[number].offset,
+                                table[number].length);
+    }
+    std::optional<Simple> report(std::size_t number) const {
+        return deserialize(data(number));
+    }
+    // Deserialize all reports and add them to state, replacing reports of
+    // the same stations; returns false if any report cannot be decoded
+    inline bool restore(StationStates &states) const;
+
+   private:
+    const char *base = nullptr;
+    std::size_t mapSize = 0;
+    const detail::SnapshotHeader *header = nullptr;
+    const detail::SnapshotStation *table = nullptr;
+    const metafsimple_record *records = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string snapshotImage(const StationStates &states) {
+    std::vector<std::pair<IcaoCode, const Simple *>> stations;
+    stations.reserve(states.size());
+    for (const auto &s : states)
+        if (!s.first.empty()) stations.emplace_back(s.first, &s.second);
+    std::sort(stations.begin(), stations.end(), [](auto &s1, auto &s2) {
+        return s1.first.packed() < s2.first.packed();
+    });
+
+    const auto count = stations.size();
+    const auto tableOffset = sizeof(detail::SnapshotHeader);
+    const auto recordsOffset =
+        tableOffset + count * sizeof(detail::SnapshotStation);
+    const auto dataOffset = recordsOffset + count * sizeof(metafsimple_record);
+    std::string result(dataOffset, '\0');
+    for (auto i = 0u; i < count; i++) {
+        detail::SnapshotStation entry;
+        entry.icao = stations[i].first.packed();
+        entry.offset = result.length();
+        serialize(*stations[i].second, result);
+        entry.length = result.length() - entry.offset;
+        std::memcpy(&result[tableOffset + i * sizeof(entry)],
+                    &entry,
+                    sizeof(entry));
+        metafsimple_record record;
+        flatten(*stations[i].second, record);
+        std::memcpy(&result[recordsOffset + i * sizeof(record)],
+                    &record,
+                    sizeof(record));
+    }
+    detail::SnapshotHeader h;
+    h.magic = detail::SnapshotHeader::magicValue;
+    h.version = detail::SnapshotHeader::versionValue;
+    h.serializationVersion = serializationVersion;
+    h.recordSize = sizeof(metafsimple_record);
+    h.stationCount = count;
+    h.crc = crc32(std::string_view(result).substr(sizeof(h)));
+    h.size = result.length();
+    std::memcpy(&result[0], &h, sizeof(h));
+    return result;
+}
+
+bool writeSnapshot(const std::string &path, const std::string &image) {
+    const auto temporary = path + ".tmp";
+    const int fd =
+        ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    const char *data = image.data();
+    auto size = image.length();
+    while (size) {
+        const auto written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) break;
+        data += written;
+        size -= written;
+    }
+    // Data must be on disk before the file replaces previous snapshot
+    const bool written = !size && !fsync(fd);
+    if (::close(fd) || !written ||
+        std::rename(temporary.c_str(), path.c_str())) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return detail::snapshotSyncDirectory(path);
+}
+
+void SnapshotWriter::start(const std::string &path,
+                           const StationStates &states) {
+    wait();
+    done.store(false, std::memory_order_relaxed);
+    worker = std::thread(
+        [this](std::string path, std::string image) {
+            result = writeSnapshot(path, image);
+            done.store(true, std::memory_order_release);
+        },
+        path,
+        snapshotImage(states));
+}
+
+bool SnapshotWriter::wait() {
+    if (!worker.joinable()) return false;
+    worker.join();
+    return result;
+}
+
+bool StationSnapshot::open(const std::string &path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    const auto headerSize = sizeof(detail::SnapshotHeader);
+    void *p = MAP_FAILED;
+    if (!fstat(fd, &st) && static_cast<std::size_t>(st.st_size) >= headerSize)
+        p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    base = static_cast<const char *>(p);
+    mapSize = st.st_size;
+
+    header = reinterpret_cast<const detail::SnapshotHeader *>(base);
+    const auto count = std::uint64_t(header->stationCount);
+    const auto tableSize = count * sizeof(detail::SnapshotStation);
+    const auto recordsSize = count * sizeof(metafsimple_record);
+    const auto dataOffset = headerSize + tableSize + recordsSize;
+    if (header->magic != detail::SnapshotHeader::magicValue ||
+        header->version != detail::SnapshotHeader::versionValue ||
+        header->serializationVersion != serializationVersion ||
+        header->recordSize != sizeof(metafsimple_record) ||
+        header->size != mapSize || dataOffset > mapSize ||
+        crc32(std::string_view(base + headerSize, mapSize - headerSize)) !=
+            header->crc) {
+        close();
+        return false;
+    }
+    table =
+        reinterpret_cast<const detail::SnapshotStation *>(base + headerSize);
+    records = reinterpret_cast<const metafsimple_record *>(
+        base + headerSize + tableSize);
+    // Checksum protects from corruption but not from a writer with a bug
+    for (auto i = 0u; i < count; i++) {
+        const auto &s = table[i];
+        if (s.offset < dataOffset || s.offset > mapSize ||
+            s.length > mapSize - s.offset ||
+            (i && table[i - 1].icao >= s.icao)) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void StationSnapshot::close() {
+    if (base) munmap(const_cast<char *>(base), mapSize);
+    base = nullptr;
+    mapSize = 0;
+    header = nullptr;
+    table = nullptr;
+    records = nullptr;
+}
+
+std::optional<std::size_t> StationSnapshot::find(IcaoCode icao) const {
+    const auto end = table + size();
+    const auto it = std::lower_bound(
+        table, end, icao.packed(), [](const auto &s, std::uint32_t i) {
+            return s.icao < i;
+        });
+    if (it == end || it->icao != icao.packed())
+        return std::optional<std::size_t>();
+    return it - table;
+}
+
+bool StationSnapshot::restore(StationStates &states) const {
+    states.reserve(states.size() + size());
+    bool result = true;
+    for (auto i = 0u; i < size(); i++) {
+        auto r = report(i);
+        if (!r.has_value()) {
+            result = false;
+            continue;
+        }
+        states.insert_or_assign(station(i), std::move(*r));
+    }
+    return result;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_SNAPSHOT_HPP
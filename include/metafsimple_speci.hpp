@@ -0,0 +1,296 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_SPECI_HPP
+#define METAFSIMPLE_SPECI_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <unordered_map>
+
+#include "metafsimple.hpp"
+
+// Detection of significant changes between consecutive observations of the
+// same station, according to SPECI criteria of ICAO Annex 3, Appendix 3,
+// 2.3.2: wind direction, speed and gust changes; onset, cessation or change
+// of intensity of specified weather phenomena; visibility, runway visual
+// range, ceiling and vertical visibility passing through thresholds; and
+// cloud layer below 1500 ft changing between SCT or less and BKN/OVC.
+//
+// Each observation is reduced to a compact SpeciState where values subject
+// to thresholds are stored as band numbers, so that threshold crossing is a
+// single comparison and unchanged observations are detected by comparing
+// states only.
+
+namespace metafsimple {
+
+enum class SpeciCriterion {
+    WIND_DIRECTION,
+    WIND_SPEED,
+    GUST,
+    WEATHER,
+    VISIBILITY,
+    RVR,
+    CEILING,
+    VERTICAL_VISIBILITY,
+    CLOUD_AMOUNT
+};
+
+// Bit for each SpeciCriterion
+using SpeciChanges = std::uint16_t;
+
+inline bool hasChange(SpeciChanges changes, SpeciCriterion c) {
+    return changes & (1u << static_cast<unsigned int>(c));
+}
+
+struct SpeciState {
+    static constexpr std::uint8_t unknownBand = 0xFF;
+    static constexpr std::int16_t unknownValue = -1;
+    // Phenomena subject to onset / cessation / intensity change criteria
+    std::uint64_t weather = 0;
+    std::int16_t windDirection = unknownValue;  // Degrees
+    std::int16_t windSpeed = unknownValue;      // Knots
+    std::int16_t gustSpeed = unknownValue;      // Knots
+    // Number of thresholds which value is at or above
+    std::uint8_t visibilityBand = unknownBand;
+    std::uint8_t rvrBand = unknownBand;  // Lowest RVR of all runways
+    std::uint8_t ceilingBand = unknownBand;
+    std::uint8_t verticalVisibilityBand = unknownBand;
+    // BKN or OVC layer below 1500 ft: 0 or 1, unknownBand if not reported
+    std::uint8_t lowBrokenLayer = unknownBand;
+
+    inline static SpeciState make(const Essentials &e,
+                                  const Aerodrome &aerodrome = Aerodrome());
+    inline bool operator==(const SpeciState &other) const;
+    bool operator!=(const SpeciState &other) const { return !(*this == other); }
+};
+
+// Criteria met by change from previous to current state
+inline SpeciChanges speciChanges(const SpeciState &previous,
+                                 const SpeciState &current);
+
+// Keeps last observed state of each station
+class SpeciEvaluator {
+   public:
+    // Compare observation (METAR or SPECI) to the previous observation of the
+    // same station and remember it; returns criteria met, no criteria are
+    // met by the first observation of the station
+    inline SpeciChanges update(const Simple &observation);
+    inline SpeciChanges update(IcaoCode icao, const SpeciState &state);
+    std::size_t stations() const { return states.size(); }
+
+   private:
+    std::unordered_map<IcaoCode, SpeciState> states;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+static const int speciVisibilityMeters[] = {800, 1500, 3000, 5000};
+static const int speciRvrMeters[] = {150, 350, 600, 800};
+static const int speciCeilingFeet[] = {100, 200, 500, 1000, 1500};
+static const int speciVerticalVisibilityFeet[] = {100, 200, 500, 1000};
+static const int speciLowCloudFeet = 1500;
+static const int speciWindDirectionDegrees = 60;
+static const int speciWindDirectionMinSpeed = 10;
+static const int speciWindSpeedKnots = 10;
+static const int speciGustKnots = 10;
+static const int speciGustMinSpeed = 15;
+
+template <std::size_t N>
+std::uint8_t speciBand(std::optional<double> value,
+                       const int (&thresholds)[N]) {
+    if (!value.has_value()) return SpeciState::unknownBand;
+    std::uint8_t band = 0;
+    for (const auto t : thresholds) {
+        if (*value >= t) band++;
+    }
+    return band;
+}
+
+inline std::int16_t speciValue(std::optional<double> value) {
+    if (!value.has_value()) return SpeciState::unknownValue;
+    return static_cast<std::int16_t>(std::lround(*value));
+}
+
+inline bool isSpeciPhenomena(Weather::Phenomena p) {
+    switch (p) {
+        // Onset, cessation or change of intensity
+        case Weather::Phenomena::FREEZING_PRECIPITATION_LIGHT:
+        case Weather::Phenomena::FREEZING_PRECIPITATION_MODERATE:
+        case Weather::Phenomena::FREEZING_PRECIPITATION_HEAVY:
+        case Weather::Phenomena::PRECIPITATION:
+        case Weather::Phenomena::PRECIPITATION_MODERATE:
+        case Weather::Phenomena::PRECIPITATION_HEAVY:
+        case Weather::Phenomena::SHOWERY_PRECIPITATION:
+        case Weather::Phenomena::SHOWERY_PRECIPITATION_MODERATE:
+        case Weather::Phenomena::SHOWERY_PRECIPITATION_HEAVY:
+        case Weather::Phenomena::THUNDERSTORM_PRECIPITATION_LIGHT:
+        case Weather::Phenomena::THUNDERSTORM_PRECIPITATION_MODERATE:
+        case Weather::Phenomena::THUNDERSTORM_PRECIPITATION_HEAVY:
+        case Weather::Phenomena::SAND_STORM:
+        case Weather::Phenomena::DUST_STORM:
+        case Weather::Phenomena::DUST_SAND_STORM:
+        case Weather::Phenomena::HEAVY_SAND_STORM:
+        case Weather::Phenomena::HEAVY_DUST_STORM:
+        case Weather::Phenomena::HEAVY_DUST_SAND_STORM:
+        // Onset or cessation
+        case Weather::Phenomena::FREEZING_FOG:
+        case Weather::Phenomena::DRIFTING_DUST:
+        case Weather::Phenomena::DRIFTING_SAND:
+        case Weather::Phenomena::DRIFTING_SNOW:
+        case Weather::Phenomena::BLOWING_DUST:
+        case Weather::Phenomena::BLOWING_SAND:
+        case Weather::Phenomena::BLOWING_SNOW:
+        case Weather::Phenomena::THUNDERSTORM:
+        case Weather::Phenomena::SQUALLS:
+        case Weather::Phenomena::FUNNEL_CLOUD:
+        case Weather::Phenomena::TORNADO:
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline SpeciChanges speciBit(SpeciCriterion c) {
+    return 1u << static_cast<unsigned int>(c);
+}
+
+// Band changed, changes from or to unknown value are not significant
+inline bool speciBandChanged(std::uint8_t previous, std::uint8_t current) {
+    return previous != current && previous != SpeciState::unknownBand &&
+           current != SpeciState::unknownBand;
+}
+
+}  // namespace detail
+
+SpeciState SpeciState::make(const Essentials &e, const Aerodrome &aerodrome) {
+    using namespace detail;
+    SpeciState s;
+    for (const auto &w : e.weather) {
+        if (isSpeciPhenomena(w.phenomena))
+            s.weather |= std::uint64_t(1)
+                         << static_cast<unsigned int>(w.phenomena);
+    }
+    if (!e.windDirectionVariable)
+        s.windDirection = speciValue(e.windDirectionDegrees);
+    s.windSpeed =
+        e.windCalm ? 0 : speciValue(e.windSpeed.toUnit(Speed::Unit::KT));
+    s.gustSpeed = speciValue(e.gustSpeed.toUnit(Speed::Unit::KT));
+    s.visibilityBand = speciBand(e.visibility.toUnit(Distance::Unit::METERS),
+                                 speciVisibilityMeters);
+    std::optional<double> rvr;
+    for (const auto &r : aerodrome.runways) {
+        const auto v = r.visualRange.prevailing.toUnit(Distance::Unit::METERS);
+        if (v.has_value() && (!rvr.has_value() || *v < *rvr)) rvr = v;
+    }
+    s.rvrBand = speciBand(rvr, speciRvrMeters);
+    s.verticalVisibilityBand =
+        speciBand(e.verticalVisibility.toUnit(Height::Unit::FEET),
+                  speciVerticalVisibilityFeet);
+    if (e.skyCondition != Essentials::SkyCondition::UNKNOWN) {
+        // Sky condition is reported: no ceiling means ceiling above all
+        // thresholds
+        const auto ceiling = e.ceilingHeight().toUnit(Height::Unit::FEET);
+        s.ceilingBand =
+            ceiling.has_value()
+                ? speciBand(ceiling, speciCeilingFeet)
+                : static_cast<std::uint8_t>(std::size(speciCeilingFeet));
+        s.lowBrokenLayer = 0;
+        for (const auto &cl : e.cloudLayers) {
+            if (cl.amount != CloudLayer::Amount::BROKEN &&
+                cl.amount != CloudLayer::Amount::OVERCAST &&
+                cl.amount != CloudLayer::Amount::VARIABLE_BROKEN_OVERCAST)
+                continue;
+            const auto h = cl.height.toUnit(Height::Unit::FEET);
+            if (h.has_value() && *h < speciLowCloudFeet) s.lowBrokenLayer = 1;
+        }
+    }
+    return s;
+}
+
+bool SpeciState::operator==(const SpeciState &other) const {
+    return weather == other.weather && windDirection == other.windDirection &&
+           windSpeed == other.windSpeed && gustSpeed == other.gustSpeed &&
+           visibilityBand == other.visibilityBand &&
+           rvrBand == other.rvrBand && ceilingBand == other.ceilingBand &&
+           verticalVisibilityBand == other.verticalVisibilityBand &&
+           lowBrokenLayer == other.lowBrokenLayer;
+}
+
+SpeciChanges speciChanges(const SpeciState &previous,
+                          const SpeciState &current) {
+    using namespace detail;
+    SpeciChanges result = 0;
+    if (previous.weather != current.weather)
+        result |= speciBit(SpeciCriterion::WEATHER);
+    if (speciBandChanged(previous.visibilityBand, current.visibilityBand))
+        result |= speciBit(SpeciCriterion::VISIBILITY);
+    if (speciBandChanged(previous.rvrBand, current.rvrBand))
+        result |= speciBit(SpeciCriterion::RVR);
+    if (speciBandChanged(previous.ceilingBand, current.ceilingBand))
+        result |= speciBit(SpeciCriterion::CEILING);
+    if (speciBandChanged(previous.verticalVisibilityBand,
+                         current.verticalVisibilityBand))
+        result |= speciBit(SpeciCriterion::VERTICAL_VISIBILITY);
+    if (speciBandChanged(previous.lowBrokenLayer, current.lowBrokenLayer))
+        result |= speciBit(SpeciCriterion::CLOUD_AMOUNT);
+
+    static const auto unknown = SpeciState::unknownValue;
+    const auto prevSpeed = previous.windSpeed, curSpeed = current.windSpeed;
+    if (prevSpeed == unknown || curSpeed == unknown) return result;
+    if (std::abs(curSpeed - prevSpeed) >= speciWindSpeedKnots)
+        result |= speciBit(SpeciCriterion::WIND_SPEED);
+    if (previous.windDirection != unknown &&
+        current.windDirection != unknown &&
+        (prevSpeed >= speciWindDirectionMinSpeed ||
+         curSpeed >= speciWindDirectionMinSpeed)) {
+        auto diff = std::abs(current.windDirection - previous.windDirection);
+        if (diff > 180) diff = 360 - diff;
+        if (diff >= speciWindDirectionDegrees)
+            result |= speciBit(SpeciCriterion::WIND_DIRECTION);
+    }
+    // Gusts are measured as variation from mean speed
+    const auto gustVariation = [](const SpeciState &s) {
+        if (s.gustSpeed == unknown) return 0;
+        return std::max(s.gustSpeed - s.windSpeed, 0);
+    };
+    if (gustVariation(current) - gustVariation(previous) >= speciGustKnots &&
+        (prevSpeed >= speciGustMinSpeed || curSpeed >= speciGustMinSpeed))
+        result |= speciBit(SpeciCriterion::GUST);
+    return result;
+}
+
+SpeciChanges SpeciEvaluator::update(IcaoCode icao, const SpeciState &state) {
+    const auto inserted = states.emplace(icao, state);
+    if (inserted.second) return 0;
+    auto &previous = inserted.first->second;
+    if (previous == state) return 0;
+    const auto result = speciChanges(previous, state);
+    previous = state;
+    return result;
+}
+
+SpeciChanges SpeciEvaluator::update(const Simple &observation) {
+    if (observation.report.error != Report::Error::NO_ERROR ||
+        (observation.report.type != Report::Type::METAR &&
+         observation.report.type != Report::Type::SPECI))
+        return 0;
+    const auto icao = observation.station.icao();
+    if (icao.empty()) return 0;
+    return update(icao,
+                  SpeciState::make(observation.current.weatherData,
+                                   observation.aerodrome));
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_SPECI_HPP
@@ -0,0 +1,270 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_TIMELINE_HPP
+#define METAFSIMPLE_TIMELINE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_epoch.hpp"
+
+namespace metafsimple {
+
+// Apply forecast change to conditions: each group of data reported in change
+// (wind, visibility, sky condition, weather, pressure, wind shear) replaces
+// the same group in base conditions, groups not reported in change are kept
+inline Essentials overlay(const Essentials &base, const Essentials &change);
+
+// Minutes from time 'from' to time 't'. If day is not specified in 't', the
+// nearest time not earlier than 'from' is assumed. Day less than 'from' day
+// is treated as day of next month, daysInMonth is the length of the month of
+// 'from'. Reports with known release date are better resolved with
+// resolveTimes() (see metafsimple_epoch.hpp).
+inline std::optional<int> minutesSince(const Time &from,
+                                       const Time &t,
+                                       int daysInMonth);
+
+// Index of conditions forecast in TAF. Validity period is split into
+// segments with constant governing conditions and constant set of temporary
+// conditions; conditions at any time are found by binary search over
+// segments. Time is measured in minutes since start of validity period;
+// validity period and trend times are resolved with resolveTimes(), so that
+// periods which span the end of month have correct length.
+class TafTimeline {
+   public:
+    // Temporary (TEMPO, INTER, PROB) or transitional (BECMG) conditions
+    struct Temporary {
+        Trend::Type type = Trend::Type::TEMPO;
+        std::optional<int> probability;
+        int from = 0;   // Start of trend period
+        int until = 0;  // End of trend period
+        Essentials change;      // Conditions as reported in trend
+        Essentials conditions;  // Governing conditions with change applied
+    };
+    struct Segment {
+        int begin = 0;
+        int end = 0;
+        Essentials governing;
+        std::vector<Temporary> temporary;
+    };
+
+    TafTimeline() = default;
+    TafTimeline(const Simple &taf, std::int64_t referenceTime) {
+        build(taf, referenceTime);
+    }
+    // Build index from simplified TAF; reference time in seconds since
+    // epoch is close to the report release time (see resolveTimes()). Index
+    // is empty if the report is not a TAF or its validity period is not
+    // specified.
+    inline void build(const Simple &taf, std::int64_t referenceTime);
+    bool empty() const { return segments.empty(); }
+    // Start of validity period in seconds since epoch
+    std::int64_t start() const { return validFrom; }
+    // Length of validity period in minutes
+    int length() const { return segments.empty() ? 0 : segments.back().end; }
+    // Segment which contains given time, or nullptr if time is outside of
+    // validity period
+    inline const Segment *at(int minute) const;
+    // Time in seconds since epoch
+    inline const Segment *atTime(std::int64_t epochTime) const;
+    // Time nearest to the start of validity period is assumed
+    inline const Segment *at(const Time &t) const;
+    const std::vector<Segment> &data() const { return segments; }
+
+   private:
+    std::int64_t validFrom = 0;
+    std::vector<Segment> segments;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+Essentials overlay(const Essentials &base, const Essentials &change) {
+    Essentials result = base;
+    if (change.windDirectionDegrees.has_value() ||
+        change.windDirectionVariable || change.windCalm ||
+        change.windSpeed.speed.has_value()) {
+        result.windDirectionDegrees = change.windDirectionDegrees;
+        result.windDirectionVariable = change.windDirectionVariable;
+        result.windDirectionVarFromDegrees = change.windDirectionVarFromDegrees;
+        result.windDirectionVarToDegrees = change.windDirectionVarToDegrees;
+        result.windSpeed = change.windSpeed;
+        result.gustSpeed = change.gustSpeed;
+        result.windCalm = change.windCalm;
+    }
+    if (change.cavok) {
+        result.cavok = true;
+        result.visibility = change.visibility;
+        result.skyCondition = change.skyCondition;
+        result.cloudLayers.clear();
+        result.verticalVisibility = Height();
+        result.weather.clear();
+    } else {
+        if (change.visibility.distance.has_value()) {
+            result.cavok = false;
+            result.visibility = change.visibility;
+        }
+        if (change.skyCondition != Essentials::SkyCondition::UNKNOWN ||
+            !change.cloudLayers.empty() ||
+            change.verticalVisibility.height.has_value()) {
+            if (result.cavok) {
+                result.cavok = false;
+                if (!change.visibility.distance.has_value())
+                    result.visibility = Distance();
+            }
+            result.skyCondition = change.skyCondition;
+            result.cloudLayers = change.cloudLayers;
+            result.verticalVisibility = change.verticalVisibility;
+        }
+        if (!change.weather.empty()) {
+            result.weather.clear();
+            for (const auto &w : change.weather) {
+                if (w.phenomena != Weather::Phenomena::NO_SIGNIFICANT_WEATHER)
+                    result.weather.push_back(w);
+            }
+        }
+    }
+    if (change.seaLevelPressure.pressure.has_value())
+        result.seaLevelPressure = change.seaLevelPressure;
+    if (!change.windShear.empty()) result.windShear = change.windShear;
+    result.summary = result.computeSummary();
+    return result;
+}
+
+std::optional<int> minutesSince(const Time &from,
+                                const Time &t,
+                                int daysInMonth) {
+    if (!from.hour.has_value() || !t.hour.has_value())
+        return std::optional<int>();
+    const auto fromMinutes = *from.hour * 60 + from.minute.value_or(0);
+    auto minutes = *t.hour * 60 + t.minute.value_or(0) - fromMinutes;
+    if (!t.day.has_value() || !from.day.has_value()) {
+        if (minutes < 0) minutes += 24 * 60;
+        return minutes;
+    }
+    auto days = *t.day - *from.day;
+    if (days < 0) days += daysInMonth;
+    return days * 24 * 60 + minutes;
+}
+
+void TafTimeline::build(const Simple &taf, std::int64_t referenceTime) {
+    segments.clear();
+    validFrom = 0;
+    if (taf.report.type != Report::Type::TAF) return;
+    const auto times = resolveTimes(taf, referenceTime);
+    if (!times.applicableFrom.has_value()) return;
+    validFrom = *times.applicableFrom;
+    const auto minutes = [this](EpochTime t) {
+        if (!t.has_value()) return std::optional<int>();
+        return std::optional<int>(detail::epochFloorDiv(*t - validFrom, 60));
+    };
+    const auto validity = minutes(times.applicableUntil);
+    if (!validity.has_value() || *validity <= 0) return;
+    const auto clip = [&](int m) { return std::clamp(m, 0, *validity); };
+
+    struct Change {
+        int time;
+        bool replace;  // FM replaces all conditions, BECMG only reported ones
+        const Essentials *conditions;
+    };
+    struct Interval {
+        int from;
+        int until;
+        const Trend *trend;
+    };
+    std::vector<Change> changes;
+    std::vector<Interval> intervals;
+    std::vector<int> breakpoints = {0, *validity};
+
+    for (auto i = 0u; i < taf.forecast.trends.size(); i++) {
+        const auto &trend = taf.forecast.trends[i];
+        const auto from = minutes(times.trends[i].from);
+        const auto until = minutes(times.trends[i].until);
+        if (!from.has_value()) continue;
+        const bool fm = trend.type == Trend::Type::TIMED &&
+                        !trend.probability.has_value() && !until.has_value();
+        if (fm) {
+            changes.push_back(Change{clip(*from), true, &trend.forecast});
+            breakpoints.push_back(clip(*from));
+            continue;
+        }
+        if (!until.has_value() || *until <= *from) continue;
+        if (trend.type == Trend::Type::BECMG)
+            changes.push_back(Change{clip(*until), false, &trend.forecast});
+        intervals.push_back(Interval{clip(*from), clip(*until), &trend});
+        breakpoints.push_back(clip(*from));
+        breakpoints.push_back(clip(*until));
+    }
+    std::stable_sort(changes.begin(),
+                     changes.end(),
+                     [](const Change &l, const Change &r) {
+                         return l.time < r.time;
+                     });
+    std::sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()),
+                      breakpoints.end());
+
+    // Sweep over breakpoints applying permanent changes in time order
+    Essentials governing = taf.forecast.prevailing;
+    auto nextChange = changes.begin();
+    for (auto i = 0u; i + 1 < breakpoints.size(); i++) {
+        Segment s;
+        s.begin = breakpoints[i];
+        s.end = breakpoints[i + 1];
+        for (; nextChange != changes.end() && nextChange->time <= s.begin;
+             ++nextChange) {
+            governing = nextChange->replace
+                            ? *nextChange->conditions
+                            : overlay(governing, *nextChange->conditions);
+        }
+        s.governing = governing;
+        for (const auto &interval : intervals) {
+            if (interval.from > s.begin || interval.until < s.end) continue;
+            const auto &trend = *interval.trend;
+            s.temporary.push_back(Temporary{trend.type,
+                                            trend.probability,
+                                            interval.from,
+                                            interval.until,
+                                            trend.forecast,
+                                            overlay(governing,
+                                                    trend.forecast)});
+        }
+        segments.push_back(std::move(s));
+    }
+}
+
+const TafTimeline::Segment *TafTimeline::at(int minute) const {
+    if (segments.empty() || minute < 0 || minute >= segments.back().end)
+        return nullptr;
+    const auto it = std::upper_bound(
+        segments.begin(),
+        segments.end(),
+        minute,
+        [](int m, const Segment &s) { return m < s.begin; });
+    return &*(it - 1);
+}
+
+const TafTimeline::Segment *TafTimeline::atTime(std::int64_t epochTime) const {
+    const auto minute = detail::epochFloorDiv(epochTime - validFrom, 60);
+    if (minute < 0 || minute >= length()) return nullptr;
+    return at(static_cast<int>(minute));
+}
+
+const TafTimeline::Segment *TafTimeline::at(const Time &t) const {
+    if (segments.empty()) return nullptr;
+    const auto resolved = resolveTime(t, validFrom);
+    if (!resolved.has_value()) return nullptr;
+    return atTime(*resolved);
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_TIMELINE_HPP
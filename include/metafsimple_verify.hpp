@@ -0,0 +1,407 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_VERIFY_HPP
+#define METAFSIMPLE_VERIFY_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_epoch.hpp"
+#include "metafsimple_timeline.hpp"
+
+// Verification of TAFs against METARs/SPECIs observed during TAF validity
+// period. Each hour of validity period is scored by event categories: event
+// is forecast (or observed) if conditions are worse than threshold at any
+// time during the hour. Hours with no observation or where the category was
+// not observed are not scored.
+//
+// Reports of each station must be added in chronological order, as they are
+// stored in archives; reports of different stations may be interleaved in
+// any way. TAF is scored when an observation after its validity period
+// arrives, when too many TAFs for the station are pending, or at finish().
+// Each report is added with reference time in seconds since epoch close to
+// its release time (e.g. date of the archive it comes from); report times
+// are resolved with resolveTimes(), so that observations are matched to
+// TAF validity periods which span the end of month.
+
+namespace metafsimple {
+
+struct VerificationThresholds {
+    int visibilityMeters = 5000;  // Visibility below this value is an event
+    int ceilingFeet = 1500;       // Ceiling below this value is an event
+    int windKnots = 25;  // Wind or gust speed at least this value is an event
+};
+
+enum class VerificationCategory { VISIBILITY, CEILING, WIND, WEATHER };
+
+// Number of hours in each cell of 2x2 contingency table
+struct Contingency {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t falseAlarms = 0;
+    std::uint64_t correctNegatives = 0;
+    inline void add(bool forecast, bool observed);
+    inline Contingency &operator+=(const Contingency &other);
+};
+
+struct VerificationScore {
+    static const std::size_t categoryCount = 4;
+    std::array<Contingency, categoryCount> categories;
+    Contingency &operator[](VerificationCategory c) {
+        return categories[static_cast<std::size_t>(c)];
+    }
+    const Contingency &operator[](VerificationCategory c) const {
+        return categories[static_cast<std::size_t>(c)];
+    }
+    inline VerificationScore &operator+=(const VerificationScore &other);
+};
+
+// Verification results of single station
+struct StationVerification {
+    static const std::size_t trendTypeCount = 5;
+    std::uint64_t tafs = 0;   // Number of TAFs scored
+    std::uint64_t hours = 0;  // Number of hours with observations
+    // Governing or any temporary conditions
+    VerificationScore overall;
+    // Governing conditions only (prevailing, FM and completed BECMG)
+    VerificationScore prevailing;
+    // Conditions of each trend type during trend periods only
+    std::array<VerificationScore, trendTypeCount> trends;
+    VerificationScore &trend(Trend::Type t) {
+        return trends[static_cast<std::size_t>(t)];
+    }
+    const VerificationScore &trend(Trend::Type t) const {
+        return trends[static_cast<std::size_t>(t)];
+    }
+    inline StationVerification &operator+=(const StationVerification &other);
+};
+
+using VerificationResults = std::unordered_map<IcaoCode, StationVerification>;
+
+// Single-threaded verifier
+class TafVerifier {
+   public:
+    explicit TafVerifier(VerificationThresholds t = VerificationThresholds(),
+                         std::size_t maxPendingPerStation = 4)
+        : thresholds(t), maxPending(maxPendingPerStation) {}
+    // Add TAF, METAR or SPECI; other reports and reports with errors are
+    // ignored
+    inline void add(const Simple &report, std::int64_t referenceTime);
+    // Score all pending TAFs; reports added after that are verified against
+    // TAFs added after that only
+    inline void finish();
+    const VerificationResults &results() const { return stationResults; }
+
+    // Bit for each VerificationCategory
+    using EventMask = std::uint8_t;
+    inline EventMask events(const Essentials &e) const;
+    static inline EventMask known(const Essentials &e);
+
+   private:
+    struct Pending {
+        TafTimeline timeline;
+        std::vector<EventMask> observed;  // Per hour
+        std::vector<EventMask> known;     // Per hour
+    };
+    inline void score(const Pending &taf, StationVerification &result) const;
+
+    VerificationThresholds thresholds;
+    std::size_t maxPending;
+    std::unordered_map<IcaoCode, std::deque<Pending>> pending;
+    VerificationResults stationResults;
+};
+
+// Parallel verifier: stations are sharded by hash of ICAO code over worker
+// threads, each running its own TafVerifier. Reports are passed to workers
+// via bounded queues, so add() blocks if a worker falls behind and memory
+// use does not depend on the size of archive.
+class VerificationEngine {
+   public:
+    inline explicit VerificationEngine(
+        unsigned int threads,
+        VerificationThresholds t = VerificationThresholds(),
+        std::size_t queueDepth = 4096);
+    VerificationEngine(const VerificationEngine &) = delete;
+    VerificationEngine &operator=(const VerificationEngine &) = delete;
+    ~VerificationEngine() { finish(); }
+    // Returns false and ignores the report if finish() was already called
+    inline bool add(Simple report, std::int64_t referenceTime);
+    // Wait until all reports are processed, score pending TAFs and return
+    // results of all stations; no reports can be added after that
+    inline VerificationResults finish();
+
+   private:
+    struct Shard {
+        explicit Shard(VerificationThresholds t) : verifier(t) {}
+        TafVerifier verifier;
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::vector<std::pair<Simple, std::int64_t>> queue;
+        bool done = false;
+        std::thread worker;
+    };
+    inline static void run(Shard &shard);
+
+    std::size_t depth;
+    std::vector<std::unique_ptr<Shard>> shards;
+    bool finished = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Contingency::add(bool forecast, bool observed) {
+    if (forecast && observed) hits++;
+    if (!forecast && observed) misses++;
+    if (forecast && !observed) falseAlarms++;
+    if (!forecast && !observed) correctNegatives++;
+}
+
+Contingency &Contingency::operator+=(const Contingency &other) {
+    hits += other.hits;
+    misses += other.misses;
+    falseAlarms += other.falseAlarms;
+    correctNegatives += other.correctNegatives;
+    return *this;
+}
+
+VerificationScore &VerificationScore::operator+=(
+    const VerificationScore &other) {
+    for (auto i = 0u; i < categoryCount; i++)
+        categories[i] += other.categories[i];
+    return *this;
+}
+
+StationVerification &StationVerification::operator+=(
+    const StationVerification &other) {
+    tafs += other.tafs;
+    hours += other.hours;
+    overall += other.overall;
+    prevailing += other.prevailing;
+    for (auto i = 0u; i < trendTypeCount; i++) trends[i] += other.trends[i];
+    return *this;
+}
+
+namespace detail {
+
+inline TafVerifier::EventMask eventBit(VerificationCategory c) {
+    return 1u << static_cast<unsigned int>(c);
+}
+
+}  // namespace detail
+
+TafVerifier::EventMask TafVerifier::events(const Essentials &e) const {
+    using detail::eventBit;
+    EventMask result = 0;
+    const auto vis = e.visibility.toUnit(Distance::Unit::METERS);
+    if (vis.has_value() && *vis < thresholds.visibilityMeters)
+        result |= eventBit(VerificationCategory::VISIBILITY);
+    const auto ceiling = e.ceilingHeight().toUnit(Height::Unit::FEET);
+    if (ceiling.has_value() && *ceiling < thresholds.ceilingFeet)
+        result |= eventBit(VerificationCategory::CEILING);
+    const auto wind = e.windSpeed.toUnit(Speed::Unit::KT);
+    const auto gust = e.gustSpeed.toUnit(Speed::Unit::KT);
+    if ((wind.has_value() && *wind >= thresholds.windKnots) ||
+        (gust.has_value() && *gust >= thresholds.windKnots))
+        result |= eventBit(VerificationCategory::WIND);
+    for (const auto &w : e.weather) {
+        if (w.phenomena != Weather::Phenomena::NO_SIGNIFICANT_WEATHER)
+            result |= eventBit(VerificationCategory::WEATHER);
+    }
+    return result;
+}
+
+TafVerifier::EventMask TafVerifier::known(const Essentials &e) {
+    using detail::eventBit;
+    // Absence of weather phenomena in observation means no weather
+    EventMask result = eventBit(VerificationCategory::WEATHER);
+    if (e.visibility.distance.has_value())
+        result |= eventBit(VerificationCategory::VISIBILITY);
+    if (e.skyCondition != Essentials::SkyCondition::UNKNOWN ||
+        e.verticalVisibility.height.has_value())
+        result |= eventBit(VerificationCategory::CEILING);
+    if (e.windSpeed.speed.has_value() || e.windCalm)
+        result |= eventBit(VerificationCategory::WIND);
+    return result;
+}
+
+void TafVerifier::add(const Simple &report, std::int64_t referenceTime) {
+    if (report.report.error != Report::Error::NO_ERROR) return;
+    const auto icao = report.station.icao();
+    if (icao.empty()) return;
+
+    if (report.report.type == Report::Type::TAF) {
+        Pending p;
+        p.timeline.build(report, referenceTime);
+        if (p.timeline.empty()) return;
+        const auto hours = (p.timeline.length() + 59) / 60;
+        p.observed.resize(hours);
+        p.known.resize(hours);
+        auto &station = pending[icao];
+        if (station.size() >= maxPending) {
+            score(station.front(), stationResults[icao]);
+            station.pop_front();
+        }
+        station.push_back(std::move(p));
+        return;
+    }
+    if (report.report.type != Report::Type::METAR &&
+        report.report.type != Report::Type::SPECI)
+        return;
+    const auto it = pending.find(icao);
+    if (it == pending.end()) return;
+    const auto observed = resolveTime(report.report.reportTime, referenceTime);
+    if (!observed.has_value()) return;
+    // Minutes since start of validity period
+    const auto minutes = [&](const Pending &p) {
+        return detail::epochFloorDiv(*observed - p.timeline.start(), 60);
+    };
+    auto &station = it->second;
+    const auto &obs = report.current.weatherData;
+    const auto obsEvents = events(obs);
+    const auto obsKnown = known(obs);
+    for (auto &p : station) {
+        const auto m = minutes(p);
+        if (m < 0 || m >= p.timeline.length()) continue;
+        p.observed[m / 60] |= obsEvents;
+        p.known[m / 60] |= obsKnown;
+    }
+    // TAFs are issued in chronological order and their validity periods
+    // end in the same order: score the ones already ended
+    while (!station.empty()) {
+        const auto &p = station.front();
+        if (minutes(p) < p.timeline.length()) break;
+        score(p, stationResults[icao]);
+        station.pop_front();
+    }
+    if (station.empty()) pending.erase(it);
+}
+
+void TafVerifier::finish() {
+    for (const auto &station : pending) {
+        for (const auto &p : station.second)
+            score(p, stationResults[station.first]);
+    }
+    pending.clear();
+}
+
+void TafVerifier::score(const Pending &taf, StationVerification &result) const {
+    static const auto categories = VerificationScore::categoryCount;
+    result.tafs++;
+    const auto &segments = taf.timeline.data();
+    auto seg = segments.begin();
+    for (auto h = 0u; h < taf.observed.size(); h++) {
+        const int hourBegin = h * 60, hourEnd = hourBegin + 60;
+        while (seg != segments.end() && seg->end <= hourBegin) ++seg;
+        if (!taf.known[h]) continue;
+        result.hours++;
+        EventMask governing = 0, any = 0;
+        std::array<EventMask, StationVerification::trendTypeCount> trend{};
+        std::array<bool, StationVerification::trendTypeCount> inEffect{};
+        for (auto s = seg; s != segments.end() && s->begin < hourEnd; ++s) {
+            governing |= events(s->governing);
+            for (const auto &t : s->temporary) {
+                const auto i = static_cast<std::size_t>(t.type);
+                trend[i] |= events(t.conditions);
+                inEffect[i] = true;
+            }
+        }
+        any = governing;
+        for (const auto t : trend) any |= t;
+        const auto observed = taf.observed[h];
+        for (auto c = 0u; c < categories; c++) {
+            const EventMask bit = 1u << c;
+            if (!(taf.known[h] & bit)) continue;
+            const bool obs = observed & bit;
+            result.overall.categories[c].add(any & bit, obs);
+            result.prevailing.categories[c].add(governing & bit, obs);
+            for (auto i = 0u; i < trend.size(); i++) {
+                if (inEffect[i])
+                    result.trends[i].categories[c].add(trend[i] & bit, obs);
+            }
+        }
+    }
+}
+
+inline VerificationEngine::VerificationEngine(unsigned int threads,
+                                              VerificationThresholds t,
+                                              std::size_t queueDepth)
+    : depth(std::max<std::size_t>(queueDepth, 1)) {
+    for (auto i = 0u; i < std::max(threads, 1u); i++) {
+        shards.push_back(std::make_unique<Shard>(t));
+        shards.back()->queue.reserve(depth);
+    }
+    for (auto &s : shards) s->worker = std::thread(run, std::ref(*s));
+}
+
+void VerificationEngine::run(Shard &shard) {
+    std::vector<std::pair<Simple, std::int64_t>> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            shard.notEmpty.wait(
+                lock, [&]() { return shard.done || !shard.queue.empty(); });
+            if (shard.queue.empty()) break;
+            // Take all queued reports at once to keep lock contention low
+            batch.swap(shard.queue);
+        }
+        shard.notFull.notify_all();
+        for (const auto &r : batch) shard.verifier.add(r.first, r.second);
+        batch.clear();
+    }
+    shard.verifier.finish();
+}
+
+bool VerificationEngine::add(Simple report, std::int64_t referenceTime) {
+    if (finished) return false;
+    const auto icao = report.station.icao();
+    auto &shard = *shards[std::hash<IcaoCode>()(icao) % shards.size()];
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.notFull.wait(lock,
+                           [&]() { return shard.queue.size() < depth; });
+        shard.queue.emplace_back(std::move(report), referenceTime);
+    }
+    shard.notEmpty.notify_one();
+    return true;
+}
+
+VerificationResults VerificationEngine::finish() {
+    VerificationResults results;
+    if (finished) return results;
+    finished = true;
+    for (auto &s : shards) {
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->done = true;
+        }
+        s->notEmpty.notify_one();
+    }
+    for (auto &s : shards) {
+        s->worker.join();
+        // Stations are not shared between shards
+        for (const auto &r : s->verifier.results())
+            results[r.first] += r.second;
+    }
+    return results;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_VERIFY_HPP
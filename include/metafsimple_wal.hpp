@@ -0,0 +1,468 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef METAFSIMPLE_WAL_HPP
+#define METAFSIMPLE_WAL_HPP
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "metafsimple.hpp"
+#include "metafsimple_serialize.hpp"
+
+// Write-ahead log of raw reports, so that reports received but not yet
+// simplified and stored are not lost if the process crashes.
+//
+// Each appended report is assigned a sequence number (consecutive, starting
+// from zero). Log is a directory of segment files; segment is named after
+// the sequence number of its first record (16 hexadecimal digits and .wal)
+// and a new segment is started when the current one exceeds the segment
+// size. Each record carries CRC-32 of its contents; a record which is
+// incomplete or corrupted (e.g. written partially before crash) ends the
+// segment.
+//
+// Group commit: append() only adds the record to in-memory buffer; a
+// committer thread writes all records accumulated so far in a single write
+// followed by a single fdatasync(), while new records accumulate for the
+// next batch. Callers wait for durability of their records with sync(), so
+// the number of disk syncs depends on the disk latency rather than on the
+// number of reports.
+//
+// Segment layout (all integers in native byte order):
+//   segment header
+//   record*: record header, raw report
+
+namespace metafsimple::detail {
+
+struct WalSegmentHeader {
+    static const std::uint32_t magicValue = 0x4D465357;  // "MFSW"
+    static const std::uint32_t versionValue = 1;
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t firstSequence;
+};
+
+struct WalRecordHeader {
+    std::uint32_t crc;     // Of the rest of record
+    std::uint32_t length;  // Length of raw report
+    std::int64_t receiveTime;
+};
+
+static_assert(sizeof(WalSegmentHeader) == 16);
+static_assert(sizeof(WalRecordHeader) == 16);
+
+inline std::string walSegmentPath(const std::string &directory,
+                                  std::uint64_t firstSequence) {
+    char name[32];
+    std::snprintf(name,
+                  sizeof(name),
+                  "%016llx.wal",
+                  static_cast<unsigned long long>(firstSequence));
+    return directory + '/' + name;
+}
+
+// First sequence numbers of segments in directory, in ascending order
+inline std::vector<std::uint64_t> walSegments(const std::string &directory) {
+    std::vector<std::uint64_t> result;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) return result;
+    static const std::size_t digits = 16;
+    static const std::string_view extension(".wal");
+    while (const auto *entry = readdir(dir)) {
+        const auto name = std::string_view(entry->d_name);
+        if (name.length() != digits + extension.length() ||
+            name.substr(digits) != extension)
+            continue;
+        std::uint64_t value = 0;
+        bool valid = true;
+        for (const auto c : name.substr(0, digits)) {
+            const auto h = (c >= '0' && c <= '9') ? c - '0'
+                         : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+            if (h < 0) valid = false;
+            value = (value << 4) | static_cast<std::uint64_t>(h & 0xF);
+        }
+        if (valid) result.push_back(value);
+    }
+    closedir(dir);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+inline bool walWrite(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto written = write(fd, data.data(), data.length());
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+// Data only; metadata are synced when the segment is created
+inline bool walSync(int fd) {
+#ifdef __APPLE__
+    return !fsync(fd);
+#else
+    return !fdatasync(fd);
+#endif
+}
+
+inline bool walSyncDirectory(const std::string &directory) {
+    const int fd = open(directory.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    const bool result = !fsync(fd);
+    close(fd);
+    return result;
+}
+
+inline bool walReadFile(const std::string &path, std::string &out) {
+    out.clear();
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    char buffer[65536];
+    for (;;) {
+        const auto n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(fd);
+            return !n;
+        }
+        out.append(buffer, n);
+    }
+}
+
+// Calls f(sequence, receive time, report) for each valid record of segment;
+// returns length of the valid part of segment, zero if segment header is
+// not valid
+template <typename F>
+std::size_t walParse(std::string_view data, F &&f) {
+    WalSegmentHeader h;
+    if (data.length() < sizeof(h)) return 0;
+    std::memcpy(&h, data.data(), sizeof(h));
+    if (h.magic != WalSegmentHeader::magicValue ||
+        h.version != WalSegmentHeader::versionValue)
+        return 0;
+    auto offset = sizeof(h);
+    auto sequence = h.firstSequence;
+    WalRecordHeader r;
+    while (data.length() - offset >= sizeof(r)) {
+        std::memcpy(&r, data.data() + offset, sizeof(r));
+        if (r.length > data.length() - offset - sizeof(r)) break;
+        const auto checked = data.substr(offset + sizeof(r.crc),
+                                         sizeof(r) - sizeof(r.crc) + r.length);
+        if (crc32(checked) != r.crc) break;
+        f(sequence++, r.receiveTime, data.substr(offset + sizeof(r), r.length));
+        offset += sizeof(r) + r.length;
+    }
+    return offset;
+}
+
+}  // namespace metafsimple::detail
+
+namespace metafsimple {
+
+class WriteAheadLog {
+   public:
+    WriteAheadLog() = default;
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+    ~WriteAheadLog() { close(); }
+
+    // Open log in existing directory; sequence numbering continues after the
+    // last valid record, anything after it is discarded. New segment is
+    // started each time the log is opened.
+    inline bool open(const std::string &directory,
+                     std::size_t segmentSize = 64 * 1024 * 1024);
+    // Commit pending records and close log
+    inline void close();
+    bool isOpen() const { return committer.joinable(); }
+
+    // Add report received at given time; returns sequence number of the
+    // record, or empty optional if log is not open or writing has failed.
+    // Record is durable once sync() covering it returns true. May be called
+    // from multiple threads.
+    inline std::optional<std::uint64_t> append(std::string_view report,
+                                               std::int64_t receiveTime);
+    // Wait until records up to and including given sequence number are on
+    // disk; returns false if writing has failed
+    inline bool sync(std::uint64_t sequence);
+    // Wait until all records appended so far are on disk
+    inline bool sync();
+    // Number of disk syncs of records made so far
+    std::uint64_t commits() const {
+        return commitCount.load(std::memory_order_relaxed);
+    }
+    // Remove segments which contain only records before given sequence
+    // number (e.g. records already stored elsewhere)
+    inline void removeBefore(std::uint64_t sequence);
+
+   private:
+    inline void run();
+    inline bool startSegment(std::uint64_t firstSequence);
+
+    std::string directory;
+    std::size_t segmentSize = 0;
+    // Used by committer thread only while it runs
+    int fd = -1;
+    std::size_t segmentLength = 0;
+    std::string batch;
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable committed;
+    std::string pending;  // Records of the next batch
+    std::uint64_t pendingFirst = 0;
+    std::uint64_t nextSequence = 0;
+    std::uint64_t durableSequence = 0;  // Records before it are on disk
+    bool failed = false;
+    bool stopping = false;
+    std::atomic<std::uint64_t> commitCount = 0;
+    std::thread committer;
+};
+
+// Record read from log
+struct WalRecord {
+    std::uint64_t sequence = 0;
+    std::int64_t receiveTime = 0;
+    std::string report;
+};
+
+// Report simplified during replay
+struct ReplayedReport {
+    std::uint64_t sequence = 0;
+    std::int64_t receiveTime = 0;
+    Simple simple;
+};
+
+// Read valid records of log starting from given sequence number, in order
+// of sequence numbers
+inline std::vector<WalRecord> readLog(const std::string &directory,
+                                      std::uint64_t fromSequence = 0);
+
+// Read records of log starting from given sequence number and simplify them
+// using given number of threads; results are in order of sequence numbers
+inline std::vector<ReplayedReport> replayLog(const std::string &directory,
+                                             std::uint64_t fromSequence = 0,
+                                             unsigned int threads = 1);
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool WriteAheadLog::open(const std::string &dir, std::size_t size) {
+    close();
+    directory = dir;
+    segmentSize = size;
+    nextSequence = 0;
+    const auto segments = detail::walSegments(directory);
+    if (!segments.empty()) {
+        // Only the last segment may have been written when the process
+        // crashed
+        const auto path = detail::walSegmentPath(directory, segments.back());
+        std::string data;
+        if (!detail::walReadFile(path, data)) return false;
+        std::uint64_t count = 0;
+        const auto valid = detail::walParse(
+            data, [&](std::uint64_t, std::int64_t, std::string_view) {
+                count++;
+            });
+        nextSequence = segments.back() + count;
+        if (!valid) {
+            // Creation of segment was interrupted
+            if (unlink(path.c_str())) return false;
+        } else if (valid < data.length()) {
+            if (truncate(path.c_str(), valid)) return false;
+        }
+    }
+    durableSequence = nextSequence;
+    pending.clear();
+    failed = false;
+    stopping = false;
+    if (!startSegment(nextSequence)) {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        return false;
+    }
+    committer = std::thread([this]() { run(); });
+    return true;
+}
+
+void WriteAheadLog::close() {
+    if (!committer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    committer.join();
+    ::close(fd);
+    fd = -1;
+}
+
+std::optional<std::uint64_t> WriteAheadLog::append(std::string_view report,
+                                                   std::int64_t receiveTime) {
+    detail::WalRecordHeader h;
+    h.length = report.length();
+    h.receiveTime = receiveTime;
+    std::string record(sizeof(h), '\0');
+    std::memcpy(&record[0], &h, sizeof(h));
+    record.append(report);
+    h.crc = crc32(std::string_view(record).substr(sizeof(h.crc)));
+    std::memcpy(&record[0], &h.crc, sizeof(h.crc));
+
+    std::uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!committer.joinable() || stopping || failed)
+            return std::optional<std::uint64_t>();
+        if (pending.empty()) pendingFirst = nextSequence;
+        pending.append(record);
+        sequence = nextSequence++;
+    }
+    notEmpty.notify_one();
+    return sequence;
+}
+
+bool WriteAheadLog::sync(std::uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (sequence >= nextSequence) return false;
+    committed.wait(lock,
+                   [&]() { return durableSequence > sequence || failed; });
+    return durableSequence > sequence;
+}
+
+bool WriteAheadLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    const auto end = nextSequence;
+    committed.wait(lock, [&]() { return durableSequence >= end || failed; });
+    return durableSequence >= end;
+}
+
+void WriteAheadLog::removeBefore(std::uint64_t sequence) {
+    const auto segments = detail::walSegments(directory);
+    // Segment ends where the next one starts; the last segment is current
+    for (auto i = 0u; i + 1 < segments.size(); i++) {
+        if (segments[i + 1] > sequence) break;
+        unlink(detail::walSegmentPath(directory, segments[i]).c_str());
+    }
+}
+
+void WriteAheadLog::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        notEmpty.wait(lock, [this]() { return !pending.empty() || stopping; });
+        if (pending.empty()) return;
+        batch.swap(pending);
+        pending.clear();
+        const auto first = pendingFirst;
+        const auto end = nextSequence;
+        lock.unlock();
+
+        auto written = true;
+        if (segmentLength >= segmentSize) written = startSegment(first);
+        written = written && detail::walWrite(fd, batch) && detail::walSync(fd);
+        segmentLength += batch.length();
+        commitCount.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+        if (written) {
+            durableSequence = end;
+        } else {
+            failed = true;
+            pending.clear();
+        }
+        committed.notify_all();
+    }
+}
+
+bool WriteAheadLog::startSegment(std::uint64_t firstSequence) {
+    if (fd >= 0) ::close(fd);
+    const auto path = detail::walSegmentPath(directory, firstSequence);
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    detail::WalSegmentHeader h;
+    h.magic = detail::WalSegmentHeader::magicValue;
+    h.version = detail::WalSegmentHeader::versionValue;
+    h.firstSequence = firstSequence;
+    segmentLength = sizeof(h);
+    // New file must be in the directory before records are durable
+    const auto header =
+        std::string_view(reinterpret_cast<const char *>(&h), sizeof(h));
+    return detail::walWrite(fd, header) && !fsync(fd) &&
+           detail::walSyncDirectory(directory);
+}
+
+std::vector<WalRecord> readLog(const std::string &directory,
+                               std::uint64_t fromSequence) {
+    std::vector<WalRecord> result;
+    const auto segments = detail::walSegments(directory);
+    std::string data;
+    for (auto i = 0u; i < segments.size(); i++) {
+        if (i + 1 < segments.size() && segments[i + 1] <= fromSequence)
+            continue;
+        const auto path = detail::walSegmentPath(directory, segments[i]);
+        if (!detail::walReadFile(path, data)) continue;
+        detail::walParse(data,
+                         [&](std::uint64_t sequence,
+                             std::int64_t receiveTime,
+                             std::string_view report) {
+                             if (sequence < fromSequence) return;
+                             result.push_back(WalRecord{
+                                 sequence, receiveTime, std::string(report)});
+                         });
+    }
+    return result;
+}
+
+std::vector<ReplayedReport> replayLog(const std::string &directory,
+                                      std::uint64_t fromSequence,
+                                      unsigned int threads) {
+    const auto records = readLog(directory, fromSequence);
+    std::vector<ReplayedReport> result(records.size());
+    // Reports are handed out in small blocks, as in fillGrid()
+    static const std::size_t blockSize = 64;
+    std::atomic<std::size_t> nextBlock(0);
+    const auto worker = [&]() {
+        for (auto b = nextBlock++; b * blockSize < records.size();
+             b = nextBlock++) {
+            const auto end = std::min((b + 1) * blockSize, records.size());
+            for (auto i = b * blockSize; i < end; i++) {
+                result[i].sequence = records[i].sequence;
+                result[i].receiveTime = records[i].receiveTime;
+                result[i].simple = simplify(records[i].report);
+            }
+        }
+    };
+    const auto blocks = (records.size() + blockSize - 1) / blockSize;
+    const auto threadCount =
+        std::max<std::size_t>(1, std::min<std::size_t>(threads, blocks));
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < threadCount; i++) pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool) t.join();
+    return result;
+}
+
+}  // namespace metafsimple
+
+#endif  // #ifndef METAFSIMPLE_WAL_HPP
@@ -0,0 +1,140 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "metafsimple_c.h"
+
+#include <string>
+
+#include "metafsimple.hpp"
+#include "metafsimple_flat.hpp"
+
+// Reusable state: station filter and buffer for the report being simplified
+struct metafsimple_simplifier {
+    metafsimple::StationFilter filter;
+    std::string report;
+};
+
+namespace {
+
+// Simplify a single report; exceptions must not cross C API boundary
+int simplifyRecord(metafsimple_simplifier &s,
+                   const char *report,
+                   size_t length,
+                   metafsimple_record &out) {
+    try {
+        s.report.assign(report, length);
+        // Same as simplify(report, filter), but header obtained by triage is
+        // reused for the record of filtered report
+        const auto t = s.filter.empty() ? metafsimple::Triage()
+                                        : metafsimple::triage(s.report);
+        if (!s.filter.empty() &&
+            (t.icaoCode.empty() || !s.filter.allows(t.icaoCode))) {
+            // Only report header data are available for filtered report
+            metafsimple::Simple header;
+            header.station.icaoCode = t.icaoCode.toString();
+            header.report.type = t.type;
+            header.report.error = t.error;
+            header.report.reportTime = t.reportTime;
+            header.report.correctional = t.correctional;
+            header.report.amended = t.amended;
+            metafsimple::flatten(header, out);
+            out.flags |= METAFSIMPLE_FLAG_FILTERED;
+            return METAFSIMPLE_FILTERED;
+        }
+        metafsimple::flatten(metafsimple::simplify(s.report), out);
+        return METAFSIMPLE_OK;
+    } catch (...) {
+        return METAFSIMPLE_ERROR_INTERNAL;
+    }
+}
+
+}  // namespace
+
+uint32_t metafsimple_abi_version(void) { return METAFSIMPLE_C_ABI_VERSION; }
+
+metafsimple_simplifier *metafsimple_create(void) {
+    try {
+        return new metafsimple_simplifier;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void metafsimple_destroy(metafsimple_simplifier *s) { delete s; }
+
+int metafsimple_set_station_filter(metafsimple_simplifier *s,
+                                   const char *icao_codes,
+                                   size_t count) {
+    if (!s || (count && !icao_codes)) return METAFSIMPLE_ERROR_ARGUMENT;
+    try {
+        metafsimple::StationFilter filter;
+        for (size_t i = 0; i < count; i++) {
+            const auto code =
+                metafsimple::IcaoCode(std::string_view(icao_codes + i * 4, 4));
+            if (code.empty()) return METAFSIMPLE_ERROR_ARGUMENT;
+            filter.add(code);
+        }
+        s->filter = std::move(filter);
+        return METAFSIMPLE_OK;
+    } catch (...) {
+        return METAFSIMPLE_ERROR_INTERNAL;
+    }
+}
+
+int metafsimple_simplify(metafsimple_simplifier *s,
+                         const char *report,
+                         size_t length,
+                         metafsimple_record *out) {
+    if (!s || !out || (length && !report)) return METAFSIMPLE_ERROR_ARGUMENT;
+    return simplifyRecord(*s, report, length, *out);
+}
+
+size_t metafsimple_simplify_batch(metafsimple_simplifier *s,
+                                  const char *const *reports,
+                                  const size_t *lengths,
+                                  size_t count,
+                                  metafsimple_record *out) {
+    if (!s || !reports || !lengths || !out) return 0;
+    for (size_t i = 0; i < count; i++) {
+        if (lengths[i] && !reports[i]) return i;
+        if (simplifyRecord(*s, reports[i], lengths[i], out[i]) < 0) return i;
+    }
+    return count;
+}
+
+size_t metafsimple_simplify_buffer(metafsimple_simplifier *s,
+                                   const char *buffer,
+                                   size_t length,
+                                   metafsimple_record *out,
+                                   size_t capacity,
+                                   size_t *consumed) {
+    size_t position = 0, written = 0;
+    if (s && buffer && out) {
+        while (position < length && written < capacity) {
+            const char *begin = buffer + position;
+            size_t lineLength = 0;
+            while (position + lineLength < length &&
+                   begin[lineLength] != '\n' && begin[lineLength] != '\r')
+                lineLength++;
+            size_t next = position + lineLength;
+            // Last line may be incomplete if input is streamed in chunks
+            if (next == length) break;
+            while (next < length &&
+                   (buffer[next] == '\n' || buffer[next] == '\r'))
+                next++;
+            if (lineLength) {
+                if (simplifyRecord(*s, begin, lineLength, out[written]) < 0)
+                    break;
+                written++;
+            }
+            position = next;
+        }
+    }
+    if (consumed) *consumed = position;
+    return written;
+}
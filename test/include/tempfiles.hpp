@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#ifndef TEMPFILES_HPP
+#define TEMPFILES_HPP
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "gtest/gtest.h"
+
+// Path in temporary directory, unique for the test process
+static inline std::string tempPath(const std::string &name) {
+    return ::testing::TempDir() + "metafsimple_test_" +
+           std::to_string(getpid()) + "_" + name;
+}
+
+static inline std::string readFile(const std::string &path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f),
+                       std::istreambuf_iterator<char>());
+}
+
+static inline void writeFile(const std::string &path, const std::string &data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f << data;
+}
+
+// File which is removed when the test ends
+class TempFile {
+   public:
+    explicit TempFile(const std::string &name) : path(tempPath(name)) {
+        unlink(path.c_str());
+    }
+    TempFile(const TempFile &) = delete;
+    TempFile &operator=(const TempFile &) = delete;
+    ~TempFile() { unlink(path.c_str()); }
+
+    const std::string path;
+};
+
+// Empty directory which is removed with its files when the test ends
+class TempDirectory {
+   public:
+    explicit TempDirectory(const std::string &name) : path(tempPath(name)) {
+        remove();
+        mkdir(path.c_str(), 0755);
+    }
+    TempDirectory(const TempDirectory &) = delete;
+    TempDirectory &operator=(const TempDirectory &) = delete;
+    ~TempDirectory() { remove(); }
+
+    std::string file(const std::string &name) const {
+        return path + '/' + name;
+    }
+
+    const std::string path;
+
+   private:
+    void remove() const {
+        if (DIR *d = opendir(path.c_str())) {
+            while (const auto *e = readdir(d)) {
+                const std::string name = e->d_name;
+                if (name != "." && name != "..") unlink(file(name).c_str());
+            }
+            closedir(d);
+        }
+        rmdir(path.c_str());
+    }
+};
+
+#endif  // #ifndef TEMPFILES_HPP
@@ -0,0 +1,105 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+
+using namespace metafsimple;
+
+////////////////////////////////////////////////////////////////////////////////
+// Flight category and hazard summary computed when the report is collated,
+// for current weather, TAF prevailing conditions and trends
+////////////////////////////////////////////////////////////////////////////////
+
+using Category = Essentials::FlightCategory;
+using Hazard = Essentials::Hazard;
+
+TEST(IntegrationSummary, vfr) {
+    static const auto rawReport =
+        "METAR ZZZZ 181753Z 27010KT 9999 SKC 18/07 Q1015=";
+    //fake report created for this test
+
+    const auto result = metafsimple::simplify(rawReport);
+    ASSERT_EQ(result.report.error, Report::Error::NO_ERROR);
+
+    const auto &e = result.current.weatherData;
+    EXPECT_EQ(e.summary, Essentials::summaryBit(Category::VFR));
+    EXPECT_EQ(e.flightCategory(), Category::VFR);
+    EXPECT_EQ(e.summary, e.computeSummary());
+}
+
+TEST(IntegrationSummary, lifrAndHazards) {
+    static const auto rawReport =
+        "METAR ZZZZ 181753Z 27015G25KT 1/2SM +TSRA BKN004CB 18/17 A2990"
+        " WS RWY27=";
+    //fake report created for this test
+
+    const auto result = metafsimple::simplify(rawReport);
+    ASSERT_EQ(result.report.error, Report::Error::NO_ERROR);
+
+    const auto &e = result.current.weatherData;
+    EXPECT_EQ(e.flightCategory(), Category::LIFR);
+    EXPECT_TRUE(e.hasHazard(Hazard::THUNDERSTORM));
+    EXPECT_TRUE(e.hasHazard(Hazard::HEAVY_PRECIPITATION));
+    EXPECT_TRUE(e.hasHazard(Hazard::CONVECTIVE_CLOUD));
+    EXPECT_TRUE(e.hasHazard(Hazard::LOW_VISIBILITY));
+    EXPECT_FALSE(e.hasHazard(Hazard::FREEZING_PRECIPITATION));
+    // Runway wind shear is reported outside of weather data
+    EXPECT_TRUE(e.hasHazard(Hazard::WIND_SHEAR));
+    EXPECT_FALSE(e.computeSummary() &
+                 Essentials::summaryBit(Hazard::WIND_SHEAR));
+}
+
+TEST(IntegrationSummary, tafPrevailingAndTrends) {
+    static const auto rawReport =
+        "TAF ZZZZ 1823/1923 25020KT 9999 SKC WSCONDS"
+        " TEMPO 1900/1906 2SM -FZDZ OVC008=";
+    //fake report created for this test
+
+    const auto result = metafsimple::simplify(rawReport);
+    ASSERT_EQ(result.report.error, Report::Error::NO_ERROR);
+
+    EXPECT_EQ(result.current.weatherData.summary, 0u);
+
+    const auto &prevailing = result.forecast.prevailing;
+    EXPECT_EQ(prevailing.summary,
+              Essentials::summaryBit(Category::VFR) |
+                  Essentials::summaryBit(Hazard::WIND_SHEAR));
+
+    ASSERT_EQ(result.forecast.trends.size(), 1u);
+    const auto &tempo = result.forecast.trends.front().forecast;
+    EXPECT_EQ(tempo.summary,
+              Essentials::summaryBit(Category::IFR) |
+                  Essentials::summaryBit(Hazard::FREEZING_PRECIPITATION));
+}
+
+TEST(IntegrationSummary, metarTrend) {
+    static const auto rawReport =
+        "METAR ZZZZ 181753Z 27010KT 6000 BKN025 18/07 Q1015"
+        " TEMPO 0800 +SHSN VV003=";
+    //fake report created for this test
+
+    const auto result = metafsimple::simplify(rawReport);
+    ASSERT_EQ(result.report.error, Report::Error::NO_ERROR);
+
+    EXPECT_EQ(result.current.weatherData.flightCategory(), Category::MVFR);
+    ASSERT_EQ(result.forecast.trends.size(), 1u);
+    const auto &tempo = result.forecast.trends.front().forecast;
+    EXPECT_EQ(tempo.flightCategory(), Category::LIFR);
+    EXPECT_TRUE(tempo.hasHazard(Hazard::HEAVY_PRECIPITATION));
+    EXPECT_TRUE(tempo.hasHazard(Hazard::LOW_VISIBILITY));
+}
+
+TEST(IntegrationSummary, error) {
+    static const auto rawReport = "METAR ZZZZ=";
+    //fake report created for this test
+
+    const auto result = metafsimple::simplify(rawReport);
+    EXPECT_NE(result.report.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(result.current.weatherData.summary, 0u);
+}
@@ -0,0 +1,160 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_archive.hpp"
+#include "metafsimple_serialize.hpp"
+
+using namespace metafsimple;
+
+// Half-hourly METARs of a station with slowly changing weather
+static std::vector<Simple> reports(std::size_t count) {
+    std::vector<Simple> result;
+    for (auto i = 0u; i < count; i++) {
+        Simple s;
+        s.report.type = Report::Type::METAR;
+        s.report.error = Report::Error::NO_ERROR;
+        s.report.reportTime =
+            Time{1 + static_cast<int>(i / 48),
+                 static_cast<int>(i / 2 % 24),
+                 i % 2 ? 50 : 20};
+        s.station.icaoCode = "EGLL";
+        s.station.autoType = Station::AutoType::AO2;
+        auto &e = s.current.weatherData;
+        e.windDirectionDegrees = 240 + static_cast<int>(i % 3) * 10;
+        e.windSpeed = Speed{12, Speed::Unit::KT};
+        e.visibility = Distance{
+            Distance::Details::MORE_THAN, 10000, Distance::Unit::METERS};
+        e.skyCondition = Essentials::SkyCondition::CLOUDS;
+        e.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::BROKEN,
+                                           Height{2500, Height::Unit::FEET},
+                                           CloudLayer::Details::UNKNOWN,
+                                           std::optional<int>()});
+        if (i % 7 == 3)
+            e.weather.push_back(
+                Weather{Weather::Phenomena::PRECIPITATION_LIGHT,
+                        {Weather::Precipitation::RAIN}});
+        e.seaLevelPressure =
+            Pressure{1013 - static_cast<int>(i / 6), Pressure::Unit::HPA};
+        e.summary = e.computeSummary();
+        s.current.airTemperature =
+            Temperature{10 + static_cast<int>(i / 4 % 5), Temperature::Unit::C};
+        s.current.dewPoint = Temperature{7, Temperature::Unit::C};
+        s.forecast.noSignificantChanges = true;
+        result.push_back(s);
+    }
+    return result;
+}
+
+TEST(Archive, roundtrip) {
+    const auto source = reports(100);
+    std::string data;
+    ArchiveWriter writer(data, 16);
+    for (const auto &r : source) writer.append(r);
+    EXPECT_EQ(writer.size(), 100u);
+
+    ArchiveReader reader(data);
+    ASSERT_TRUE(reader.valid());
+    ASSERT_EQ(reader.size(), 100u);
+    for (const auto &r : source) {
+        const auto decoded = reader.next();
+        ASSERT_TRUE(decoded.has_value());
+        EXPECT_EQ(*decoded, r);
+        EXPECT_EQ(decoded->current.weatherData.summary,
+                  r.current.weatherData.summary);
+    }
+    EXPECT_FALSE(reader.next().has_value());
+}
+
+TEST(Archive, size) {
+    const auto source = reports(200);
+    std::size_t fullSize = 0;
+    for (const auto &r : source) fullSize += serialize(r).length();
+    std::string data;
+    ArchiveWriter writer(data, 64);
+    for (const auto &r : source) writer.append(r);
+    EXPECT_LT(data.length() * 10, fullSize);
+}
+
+TEST(Archive, randomAccess) {
+    const auto source = reports(50);
+    std::string data;
+    ArchiveWriter writer(data, 8);
+    for (const auto &r : source) writer.append(r);
+
+    ArchiveReader reader(data);
+    const std::size_t order[] = {37, 5, 6, 0, 49, 16, 15, 23, 8, 7};
+    for (const auto i : order) {
+        const auto decoded = reader.at(i);
+        ASSERT_TRUE(decoded.has_value()) << i;
+        EXPECT_EQ(*decoded, source[i]) << i;
+    }
+    // Sequential reading continues after the last report decoded by index
+    reader.at(20);
+    const auto decoded = reader.next();
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(*decoded, source[21]);
+    EXPECT_FALSE(reader.at(50).has_value());
+}
+
+TEST(Archive, keyframeOnly) {
+    const auto source = reports(5);
+    std::string data;
+    ArchiveWriter writer(data, 1);
+    for (const auto &r : source) writer.append(r);
+    std::size_t fullSize = 0;
+    for (const auto &r : source) fullSize += serialize(r).length();
+    // Each keyframe is a serialized report with two-byte record header
+    // instead of version, plus version of the archive
+    EXPECT_EQ(data.length(), fullSize + source.size() + 1);
+    ArchiveReader reader(data);
+    EXPECT_EQ(*reader.at(3), source[3]);
+}
+
+TEST(Archive, empty) {
+    std::string data;
+    ArchiveWriter writer(data);
+    ArchiveReader reader(data);
+    EXPECT_TRUE(reader.valid());
+    EXPECT_EQ(reader.size(), 0u);
+    EXPECT_FALSE(reader.next().has_value());
+
+    EXPECT_FALSE(ArchiveReader(std::string_view()).valid());
+}
+
+TEST(Archive, malformed) {
+    const auto source = reports(10);
+    std::string data;
+    ArchiveWriter writer(data, 4);
+    for (const auto &r : source) writer.append(r);
+
+    // Truncated data break record framing
+    EXPECT_FALSE(ArchiveReader(data.substr(0, data.length() - 1)).valid());
+
+    // Wrong version
+    auto wrongVersion = data;
+    wrongVersion[0]++;
+    EXPECT_FALSE(ArchiveReader(wrongVersion).valid());
+
+    // Corrupted payload fails to decode, following deltas are not decoded
+    ArchiveReader reader(data);
+    ASSERT_TRUE(reader.at(1).has_value());
+    auto corrupted = data;
+    // Header of the first record is two bytes, corrupt the first leaf
+    corrupted[3] = static_cast<char>(0xFF);
+    ArchiveReader corruptedReader(corrupted);
+    ASSERT_TRUE(corruptedReader.valid());
+    EXPECT_FALSE(corruptedReader.next().has_value());
+    EXPECT_FALSE(corruptedReader.next().has_value());
+    // Reports after the next keyframe are still available
+    const auto decoded = corruptedReader.at(5);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(*decoded, source[5]);
+}
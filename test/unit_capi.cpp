@@ -0,0 +1,213 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_c.h"
+#include "metafsimple_flat.hpp"
+
+using namespace metafsimple;
+
+TEST(Flatten, metar) {
+    Simple s;
+    s.station.icaoCode = "UKLI";
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    s.report.reportTime = Time{7, 16, 0};
+    s.current.weatherData.windDirectionDegrees = 280;
+    s.current.weatherData.windDirectionVarFromDegrees = 250;
+    s.current.weatherData.windDirectionVarToDegrees = 330;
+    s.current.weatherData.windSpeed = Speed{3, Speed::Unit::MPS};
+    s.current.weatherData.visibility = Distance{
+        Distance::Details::MORE_THAN, 9999, Distance::Unit::METERS};
+    s.current.weatherData.skyCondition = Essentials::SkyCondition::CLOUDS;
+    s.current.weatherData.cloudLayers = {
+        CloudLayer{CloudLayer::Amount::BROKEN,
+                   Height{2800, Height::Unit::FEET},
+                   CloudLayer::Details::UNKNOWN,
+                   std::optional<int>()},
+        CloudLayer{CloudLayer::Amount::BROKEN,
+                   Height{1900, Height::Unit::FEET},
+                   CloudLayer::Details::CUMULONIMBUS,
+                   std::optional<int>()}};
+    s.current.weatherData.weather = {
+        Weather{Weather::Phenomena::SHOWERY_PRECIPITATION_LIGHT,
+                {Weather::Precipitation::RAIN}}};
+    s.current.weatherData.seaLevelPressure =
+        Pressure{1015, Pressure::Unit::HPA};
+    s.current.airTemperature = Temperature{13, Temperature::Unit::C};
+    s.current.dewPoint = Temperature{12, Temperature::Unit::C};
+    s.forecast.noSignificantChanges = true;
+
+    metafsimple_record r;
+    flatten(s, r);
+    EXPECT_STREQ(r.icao, "UKLI");
+    EXPECT_EQ(r.report_type, METAFSIMPLE_REPORT_METAR);
+    EXPECT_EQ(r.error, 0);
+    EXPECT_EQ(r.flags,
+              uint32_t(METAFSIMPLE_FLAG_NOSIG |
+                       METAFSIMPLE_FLAG_VIS_MORE_THAN));
+    EXPECT_EQ(r.report_day, 7);
+    EXPECT_EQ(r.report_hour, 16);
+    EXPECT_EQ(r.report_minute, 0);
+    EXPECT_EQ(r.applicable_from_day, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.wind_direction_deg, 280);
+    EXPECT_EQ(r.wind_var_from_deg, 250);
+    EXPECT_EQ(r.wind_var_to_deg, 330);
+    EXPECT_EQ(r.wind_speed_kt, 6);
+    EXPECT_EQ(r.gust_speed_kt, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.visibility_m, 9999);
+    EXPECT_EQ(r.ceiling_ft, 1900);
+    EXPECT_EQ(r.vertical_visibility_ft, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.sky_condition,
+              static_cast<int32_t>(Essentials::SkyCondition::CLOUDS));
+    EXPECT_EQ(r.temperature_tenth_c, 130);
+    EXPECT_EQ(r.dew_point_tenth_c, 120);
+    EXPECT_EQ(r.relative_humidity, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.pressure_tenth_hpa, 10150);
+    EXPECT_EQ(r.weather_mask,
+              uint64_t(1) << static_cast<int>(
+                  Weather::Phenomena::SHOWERY_PRECIPITATION_LIGHT));
+    EXPECT_EQ(r.precipitation_mask,
+              1u << static_cast<int>(Weather::Precipitation::RAIN));
+    EXPECT_EQ(r.trend_count, 0u);
+    EXPECT_EQ(r.warning_count, 0u);
+}
+
+TEST(Flatten, tafUsesPrevailing) {
+    Simple s;
+    s.station.icaoCode = "CYGL";
+    s.report.type = Report::Type::TAF;
+    s.report.applicableFrom = Time{8, 20, std::optional<int>()};
+    s.report.applicableUntil = Time{9, 18, std::optional<int>()};
+    s.forecast.prevailing.windCalm = true;
+    s.forecast.prevailing.cavok = true;
+    s.forecast.trends.resize(2);
+    s.current.weatherData.windDirectionDegrees = 100;
+
+    metafsimple_record r;
+    flatten(s, r);
+    EXPECT_EQ(r.report_type, METAFSIMPLE_REPORT_TAF);
+    EXPECT_EQ(r.flags,
+              uint32_t(METAFSIMPLE_FLAG_WIND_CALM | METAFSIMPLE_FLAG_CAVOK));
+    EXPECT_EQ(r.applicable_from_day, 8);
+    EXPECT_EQ(r.applicable_from_hour, 20);
+    EXPECT_EQ(r.applicable_until_day, 9);
+    EXPECT_EQ(r.applicable_until_hour, 18);
+    EXPECT_EQ(r.wind_direction_deg, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.ceiling_ft, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.trend_count, 2u);
+}
+
+TEST(CApi, abiVersion) {
+    EXPECT_EQ(metafsimple_abi_version(), uint32_t(METAFSIMPLE_C_ABI_VERSION));
+}
+
+TEST(CApi, invalidArguments) {
+    metafsimple_record r;
+    EXPECT_EQ(metafsimple_simplify(nullptr, "", 0, &r),
+              METAFSIMPLE_ERROR_ARGUMENT);
+    auto s = metafsimple_create();
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(metafsimple_simplify(s, "METAR", 5, nullptr),
+              METAFSIMPLE_ERROR_ARGUMENT);
+    EXPECT_EQ(metafsimple_set_station_filter(s, "UKL", 1),
+              METAFSIMPLE_ERROR_ARGUMENT);
+    EXPECT_EQ(metafsimple_set_station_filter(s, nullptr, 1),
+              METAFSIMPLE_ERROR_ARGUMENT);
+    metafsimple_destroy(s);
+    metafsimple_destroy(nullptr);
+}
+
+TEST(CApi, stationFilter) {
+    auto s = metafsimple_create();
+    ASSERT_NE(s, nullptr);
+    ASSERT_EQ(metafsimple_set_station_filter(s, "UKLISCCH", 2), METAFSIMPLE_OK);
+    const char report[] = "METAR ZZZZ 041115Z 24010KT CAVOK 20/10 Q1020=";
+    metafsimple_record r;
+    EXPECT_EQ(metafsimple_simplify(s, report, std::strlen(report), &r),
+              METAFSIMPLE_FILTERED);
+    EXPECT_STREQ(r.icao, "ZZZZ");
+    EXPECT_EQ(r.report_type, METAFSIMPLE_REPORT_METAR);
+    EXPECT_EQ(r.flags, uint32_t(METAFSIMPLE_FLAG_FILTERED));
+    EXPECT_EQ(r.report_day, 4);
+    EXPECT_EQ(r.report_hour, 11);
+    EXPECT_EQ(r.report_minute, 15);
+    EXPECT_EQ(r.wind_direction_deg, METAFSIMPLE_NO_VALUE);
+    metafsimple_destroy(s);
+}
+
+TEST(CApi, simplify) {
+    auto s = metafsimple_create();
+    ASSERT_NE(s, nullptr);
+    const char report[] = "METAR SCCH 061700Z 23007KT CAVOK 07/03 Q1016=";
+    metafsimple_record r;
+    ASSERT_EQ(metafsimple_simplify(s, report, std::strlen(report), &r),
+              METAFSIMPLE_OK);
+    EXPECT_STREQ(r.icao, "SCCH");
+    EXPECT_EQ(r.report_type, METAFSIMPLE_REPORT_METAR);
+    EXPECT_EQ(r.wind_direction_deg, 230);
+    EXPECT_EQ(r.wind_speed_kt, 7);
+    EXPECT_EQ(r.temperature_tenth_c, 70);
+    EXPECT_EQ(r.pressure_tenth_hpa, 10160);
+    EXPECT_TRUE(r.flags & METAFSIMPLE_FLAG_CAVOK);
+    metafsimple_destroy(s);
+}
+
+TEST(CApi, batch) {
+    auto s = metafsimple_create();
+    ASSERT_NE(s, nullptr);
+    ASSERT_EQ(metafsimple_set_station_filter(s, "SCCH", 1), METAFSIMPLE_OK);
+    const char *reports[] = {
+        "METAR ZZZZ 041115Z 24010KT CAVOK 20/10 Q1020=",
+        "METAR SCCH 061700Z 23007KT CAVOK 07/03 Q1016="};
+    const size_t lengths[] = {std::strlen(reports[0]), std::strlen(reports[1])};
+    metafsimple_record r[2];
+    EXPECT_EQ(metafsimple_simplify_batch(s, reports, lengths, 2, r), 2u);
+    EXPECT_STREQ(r[0].icao, "ZZZZ");
+    EXPECT_EQ(r[0].flags, uint32_t(METAFSIMPLE_FLAG_FILTERED));
+    EXPECT_STREQ(r[1].icao, "SCCH");
+    EXPECT_FALSE(r[1].flags & METAFSIMPLE_FLAG_FILTERED);
+    metafsimple_destroy(s);
+}
+
+TEST(CApi, buffer) {
+    auto s = metafsimple_create();
+    ASSERT_NE(s, nullptr);
+    ASSERT_EQ(metafsimple_set_station_filter(s, "UKLI", 1), METAFSIMPLE_OK);
+    const char buffer[] =
+        "METAR ZZZZ 041115Z 24010KT CAVOK 20/10 Q1020=\n"
+        "\r\n"
+        "METAR SCCH 061700Z 23007KT CAVOK 07/03 Q1016=\n"
+        "METAR EGLL 061720Z 23007KT CAVOK 07/03 Q1016=";
+    const size_t length = std::strlen(buffer);
+    metafsimple_record r[2];
+    size_t consumed = 0;
+    EXPECT_EQ(metafsimple_simplify_buffer(s, buffer, length, r, 2, &consumed),
+              2u);
+    EXPECT_STREQ(r[0].icao, "ZZZZ");
+    EXPECT_STREQ(r[1].icao, "SCCH");
+    EXPECT_STREQ(buffer + consumed,
+                 "METAR EGLL 061720Z 23007KT CAVOK 07/03 Q1016=");
+    // Unterminated last line may be incomplete and is not consumed
+    const auto rest = buffer + consumed;
+    const auto restLength = length - consumed;
+    EXPECT_EQ(metafsimple_simplify_buffer(s, rest, restLength, r, 2, &consumed),
+              0u);
+    EXPECT_EQ(consumed, 0u);
+    const char last[] = "METAR EGLL 061720Z 23007KT CAVOK 07/03 Q1016=\r\n";
+    const size_t lastLength = std::strlen(last);
+    EXPECT_EQ(metafsimple_simplify_buffer(s, last, lastLength, r, 2, &consumed),
+              1u);
+    EXPECT_STREQ(r[0].icao, "EGLL");
+    EXPECT_EQ(r[0].report_hour, 17);
+    EXPECT_EQ(consumed, lastLength);
+    metafsimple_destroy(s);
+}
@@ -0,0 +1,175 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <cmath>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_crosswind.hpp"
+
+using namespace metafsimple;
+
+static const auto margin = 1e-4;
+
+static Simple makeMetar(const std::string &icao,
+                        std::optional<int> direction,
+                        int speed,
+                        std::optional<int> gust = std::optional<int>()) {
+    Simple s;
+    s.station.icaoCode = icao;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    auto &e = s.current.weatherData;
+    e.windDirectionDegrees = direction;
+    e.windSpeed = Speed{speed, Speed::Unit::KT};
+    if (gust.has_value()) e.gustSpeed = Speed{*gust, Speed::Unit::KT};
+    return s;
+}
+
+static Runway runway(int number,
+                     Runway::Designator d = Runway::Designator::NONE) {
+    return Runway{number, d};
+}
+
+TEST(RunwayWind, runwayHeading) {
+    EXPECT_EQ(runwayHeading(runway(27, Runway::Designator::LEFT)), 270);
+    EXPECT_EQ(runwayHeading(runway(36)), 360);
+    EXPECT_EQ(runwayHeading(runway(1)), 10);
+    EXPECT_EQ(runwayHeading(runway(0)), METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(runwayHeading(runway(88)), METAFSIMPLE_NO_VALUE);
+}
+
+TEST(RunwayWind, components) {
+    RunwayWindColumns c;
+    // 27020G30KT
+    EXPECT_EQ(c.add(makeMetar("EGLL", 270, 20, 30),
+                    {runway(27), runway(36), runway(9), runway(88)}),
+              3u);
+    computeRunwayWinds(c);
+    ASSERT_EQ(c.size(), 3u);
+    EXPECT_NEAR(c.crosswindKt[0], 0.0, margin);
+    EXPECT_NEAR(c.headwindKt[0], 20.0, margin);
+    EXPECT_NEAR(c.gustHeadwindKt[0], 30.0, margin);
+    EXPECT_NEAR(c.maxCrosswindKt[0], 0.0, margin);
+    EXPECT_NEAR(c.minHeadwindKt[0], 30.0, margin);
+    // Wind from the left
+    EXPECT_NEAR(c.crosswindKt[1], -20.0, margin);
+    EXPECT_NEAR(c.headwindKt[1], 0.0, margin);
+    EXPECT_NEAR(c.gustCrosswindKt[1], -30.0, margin);
+    EXPECT_NEAR(c.maxCrosswindKt[1], 30.0, margin);
+    // Tailwind
+    EXPECT_NEAR(c.headwindKt[2], -20.0, margin);
+    EXPECT_NEAR(c.minHeadwindKt[2], -30.0, margin);
+}
+
+TEST(RunwayWind, oblique) {
+    RunwayWindColumns c;
+    // 30010KT on runway 27: 30 degrees from the right
+    c.add(makeMetar("EGLL", 300, 10), {runway(27)});
+    computeRunwayWinds(c);
+    EXPECT_NEAR(c.crosswindKt[0], 5.0, margin);
+    EXPECT_NEAR(c.headwindKt[0], 8.6603, margin);
+    EXPECT_TRUE(std::isnan(c.gustCrosswindKt[0]));
+    EXPECT_NEAR(c.maxCrosswindKt[0], 5.0, margin);
+}
+
+TEST(RunwayWind, variableSector) {
+    RunwayWindColumns c;
+    // 27020KT 240V300
+    auto m = makeMetar("EGLL", 270, 20);
+    m.current.weatherData.windDirectionVarFromDegrees = 240;
+    m.current.weatherData.windDirectionVarToDegrees = 300;
+    c.add(m, {runway(36), runway(27), runway(6)});
+    computeRunwayWinds(c);
+    EXPECT_NEAR(c.crosswindKt[0], -20.0, margin);
+    EXPECT_NEAR(c.maxCrosswindKt[0], 20.0, margin);
+    EXPECT_NEAR(c.minHeadwindKt[0], -10.0, margin);
+    EXPECT_NEAR(c.maxCrosswindKt[1], 10.0, margin);
+    EXPECT_NEAR(c.minHeadwindKt[1], 17.3205, margin);
+    // Sector includes direct tailwind
+    EXPECT_NEAR(c.minHeadwindKt[2], -20.0, margin);
+    EXPECT_NEAR(c.maxCrosswindKt[2], 17.3205, margin);
+}
+
+TEST(RunwayWind, variableAndCalm) {
+    RunwayWindColumns c;
+    auto vrb = makeMetar("EGLL", std::optional<int>(), 5);
+    vrb.current.weatherData.windDirectionVariable = true;
+    c.add(vrb, {runway(27)});
+    auto calm = makeMetar("EGKK", std::optional<int>(), 0);
+    calm.current.weatherData.windCalm = true;
+    c.add(calm, {runway(26)});
+    auto unknown = makeMetar("EGSS", std::optional<int>(), 10);
+    c.add(unknown, {runway(22)});
+    computeRunwayWinds(c);
+    EXPECT_TRUE(std::isnan(c.crosswindKt[0]));
+    EXPECT_TRUE(std::isnan(c.headwindKt[0]));
+    EXPECT_NEAR(c.maxCrosswindKt[0], 5.0, margin);
+    EXPECT_NEAR(c.minHeadwindKt[0], -5.0, margin);
+    EXPECT_NEAR(c.crosswindKt[1], 0.0, margin);
+    EXPECT_NEAR(c.headwindKt[1], 0.0, margin);
+    EXPECT_NEAR(c.maxCrosswindKt[1], 0.0, margin);
+    EXPECT_TRUE(std::isnan(c.crosswindKt[2]));
+    EXPECT_TRUE(std::isnan(c.maxCrosswindKt[2]));
+}
+
+TEST(RunwayWind, unknownHeading) {
+    RunwayWindColumns c;
+    c.add(makeMetar("EGLL", 270, 20, 30), {runway(27)});
+    auto sector = makeMetar("EGKK", 250, 10);
+    sector.current.weatherData.windDirectionVarFromDegrees = 210;
+    sector.current.weatherData.windDirectionVarToDegrees = 290;
+    c.add(sector, {runway(26)});
+    auto vrb = makeMetar("EGSS", std::optional<int>(), 5);
+    vrb.current.weatherData.windDirectionVariable = true;
+    c.add(vrb, {runway(22)});
+    for (auto &h : c.headingDeg) h = METAFSIMPLE_NO_VALUE;
+    computeRunwayWinds(c);
+    for (auto i = 0u; i < c.size(); i++) {
+        EXPECT_TRUE(std::isnan(c.crosswindKt[i]));
+        EXPECT_TRUE(std::isnan(c.headwindKt[i]));
+        EXPECT_TRUE(std::isnan(c.gustCrosswindKt[i]));
+        EXPECT_TRUE(std::isnan(c.gustHeadwindKt[i]));
+        EXPECT_TRUE(std::isnan(c.maxCrosswindKt[i]));
+        EXPECT_TRUE(std::isnan(c.minHeadwindKt[i]));
+    }
+}
+
+TEST(RunwayWind, reportRunways) {
+    auto m = makeMetar("EGLL", 270, 20);
+    Aerodrome::RunwayData rd;
+    rd.runway = runway(27, Runway::Designator::LEFT);
+    m.aerodrome.runways.push_back(rd);
+    m.aerodrome.runways.push_back(rd);
+    rd.runway = runway(27, Runway::Designator::RIGHT);
+    m.aerodrome.runways.push_back(rd);
+    rd.runway = runway(88);
+    m.aerodrome.runways.push_back(rd);
+    RunwayWindColumns c;
+    EXPECT_EQ(c.add(m), 2u);
+    EXPECT_EQ(c.runway[1].designator, Runway::Designator::RIGHT);
+    EXPECT_EQ(c.icao[1], IcaoCode("EGLL"));
+    c.clear();
+    EXPECT_EQ(c.size(), 0u);
+}
+
+TEST(RunwayWind, batch) {
+    RunwayWindColumns c;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dir(1, 360), num(1, 36), kt(0, 60);
+    for (auto i = 0; i < 5000; i++)
+        c.add(makeMetar("EGLL", dir(gen), kt(gen)), {runway(num(gen))});
+    computeRunwayWinds(c);
+    const auto pi = std::acos(-1.0);
+    for (auto i = 0u; i < c.size(); i++) {
+        const auto r = (c.windDirectionDeg[i] - c.headingDeg[i]) * pi / 180;
+        EXPECT_NEAR(c.crosswindKt[i], c.windSpeedKt[i] * std::sin(r), 1e-4);
+        EXPECT_NEAR(c.headwindKt[i], c.windSpeedKt[i] * std::cos(r), 1e-4);
+    }
+}
@@ -846,4 +846,174 @@ TEST_F(DataTypes, brakingAction) {
     rd.coefficient = 40;
     EXPECT_EQ(rd.brakingAction(),
               metafsimple::Aerodrome::BrakingAction::UNRELIABLE);
-}
\ No newline at end of file
+}
+
+TEST_F(DataTypes, summaryFlightCategory) {
+    using metafsimple::Essentials;
+    using Category = Essentials::FlightCategory;
+    const auto category = [](const Essentials &e) {
+        Essentials result = e;
+        result.summary = e.computeSummary();
+        return result.flightCategory();
+    };
+    const auto visibility = [](int sm) {
+        return metafsimple::Distance{
+            metafsimple::Distance::Details::EXACTLY,
+            sm,
+            metafsimple::Distance::Unit::STATUTE_MILES};
+    };
+    const auto layer = [](metafsimple::CloudLayer::Amount a, int ft) {
+        return metafsimple::CloudLayer{
+            a,
+            metafsimple::Height{ft, metafsimple::Height::Unit::FEET},
+            metafsimple::CloudLayer::Details::UNKNOWN,
+            std::optional<int>()};
+    };
+
+    Essentials e;
+    EXPECT_EQ(category(e), Category::UNKNOWN);
+    EXPECT_EQ(e.summary, 0u);
+
+    e.visibility = visibility(6);
+    EXPECT_EQ(category(e), Category::UNKNOWN);
+    e.skyCondition = Essentials::SkyCondition::CLEAR_SKC;
+    EXPECT_EQ(category(e), Category::VFR);
+    e.visibility = visibility(5);
+    EXPECT_EQ(category(e), Category::MVFR);
+    e.visibility = visibility(2);
+    EXPECT_EQ(category(e), Category::IFR);
+    e.visibility = d_4800m;
+    EXPECT_EQ(category(e), Category::IFR);
+
+    e.visibility = visibility(10);
+    e.skyCondition = Essentials::SkyCondition::CLOUDS;
+    e.cloudLayers.push_back(layer(metafsimple::CloudLayer::Amount::FEW, 400));
+    EXPECT_EQ(category(e), Category::VFR);
+    e.cloudLayers.push_back(
+        layer(metafsimple::CloudLayer::Amount::BROKEN, 3000));
+    EXPECT_EQ(category(e), Category::MVFR);
+    e.cloudLayers.push_back(
+        layer(metafsimple::CloudLayer::Amount::OVERCAST, 900));
+    EXPECT_EQ(category(e), Category::IFR);
+
+    // Visibility unknown, ceiling alone is below VFR
+    e.visibility = metafsimple::Distance();
+    EXPECT_EQ(category(e), Category::IFR);
+
+    e = Essentials();
+    e.visibility = visibility(3);
+    e.skyCondition = Essentials::SkyCondition::OBSCURED;
+    e.verticalVisibility = metafsimple::Height{
+        200, metafsimple::Height::Unit::FEET};
+    EXPECT_EQ(category(e), Category::LIFR);
+
+    e = Essentials();
+    e.cavok = true;
+    e.visibility = metafsimple::Distance{
+        metafsimple::Distance::Details::MORE_THAN,
+        10000,
+        metafsimple::Distance::Unit::METERS};
+    e.skyCondition = Essentials::SkyCondition::CAVOK;
+    EXPECT_EQ(category(e), Category::VFR);
+}
+
+TEST_F(DataTypes, summaryHazards) {
+    using metafsimple::Essentials;
+    using metafsimple::Weather;
+    using Hazard = Essentials::Hazard;
+
+    Essentials e;
+    e.weather.push_back(
+        Weather{Weather::Phenomena::THUNDERSTORM_PRECIPITATION_HEAVY,
+                {Weather::Precipitation::RAIN}});
+    e.summary = e.computeSummary();
+    EXPECT_TRUE(e.hasHazard(Hazard::THUNDERSTORM));
+    EXPECT_TRUE(e.hasHazard(Hazard::HEAVY_PRECIPITATION));
+    EXPECT_FALSE(e.hasHazard(Hazard::FREEZING_PRECIPITATION));
+    EXPECT_FALSE(e.hasHazard(Hazard::CONVECTIVE_CLOUD));
+    EXPECT_FALSE(e.hasHazard(Hazard::WIND_SHEAR));
+    EXPECT_FALSE(e.hasHazard(Hazard::LOW_VISIBILITY));
+
+    e = Essentials();
+    e.weather.push_back(
+        Weather{Weather::Phenomena::FREEZING_PRECIPITATION_LIGHT,
+                {Weather::Precipitation::DRIZZLE}});
+    e.cloudLayers.push_back(metafsimple::CloudLayer{
+        metafsimple::CloudLayer::Amount::SCATTERED,
+        metafsimple::Height{2500, metafsimple::Height::Unit::FEET},
+        metafsimple::CloudLayer::Details::TOWERING_CUMULUS,
+        std::optional<int>()});
+    e.windShear.push_back(metafsimple::WindShear());
+    e.visibility = metafsimple::Distance{
+        metafsimple::Distance::Details::EXACTLY,
+        800,
+        metafsimple::Distance::Unit::METERS};
+    e.summary = e.computeSummary();
+    EXPECT_FALSE(e.hasHazard(Hazard::THUNDERSTORM));
+    EXPECT_FALSE(e.hasHazard(Hazard::HEAVY_PRECIPITATION));
+    EXPECT_TRUE(e.hasHazard(Hazard::FREEZING_PRECIPITATION));
+    EXPECT_TRUE(e.hasHazard(Hazard::CONVECTIVE_CLOUD));
+    EXPECT_TRUE(e.hasHazard(Hazard::WIND_SHEAR));
+    EXPECT_TRUE(e.hasHazard(Hazard::LOW_VISIBILITY));
+    EXPECT_EQ(e.flightCategory(), Essentials::FlightCategory::LIFR);
+
+    // Single test for low IFR conditions or freezing precipitation
+    const auto mask =
+        Essentials::summaryBit(Essentials::FlightCategory::LIFR) |
+        Essentials::summaryBit(Hazard::FREEZING_PRECIPITATION);
+    EXPECT_EQ(e.summary & mask, mask);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+TEST_F(DataTypes, icaoCode_pack) {
+    static constexpr auto code = metafsimple::IcaoCode("UKLI");
+    static_assert(code.packed() == 0x554B4C49u);
+    static_assert(!code.empty());
+    static_assert(std::is_trivially_copyable_v<metafsimple::IcaoCode>);
+    static_assert(sizeof(metafsimple::IcaoCode) == sizeof(std::uint32_t));
+    EXPECT_EQ(code.toString(), "UKLI");
+    EXPECT_EQ(metafsimple::IcaoCode::fromPacked(code.packed()), code);
+}
+
+TEST_F(DataTypes, icaoCode_empty) {
+    EXPECT_TRUE(metafsimple::IcaoCode().empty());
+    EXPECT_TRUE(metafsimple::IcaoCode("").empty());
+    EXPECT_TRUE(metafsimple::IcaoCode("UKL").empty());
+    EXPECT_TRUE(metafsimple::IcaoCode("UKLII").empty());
+    EXPECT_EQ(metafsimple::IcaoCode().toString(), "");
+}
+
+TEST_F(DataTypes, icaoCode_ordering) {
+    const std::vector<std::string> codes = {"AAAA", "EGLL", "K1G4", "KJFK",
+                                            "UKLI", "ZZZZ"};
+    for (auto i = 0u; i < codes.size(); i++) {
+        for (auto j = 0u; j < codes.size(); j++) {
+            const auto l = metafsimple::IcaoCode(codes[i]);
+            const auto r = metafsimple::IcaoCode(codes[j]);
+            EXPECT_EQ(l < r, codes[i] < codes[j]);
+            EXPECT_EQ(l == r, codes[i] == codes[j]);
+            EXPECT_EQ(l != r, codes[i] != codes[j]);
+        }
+    }
+}
+
+TEST_F(DataTypes, icaoCode_hash) {
+    const auto h = std::hash<metafsimple::IcaoCode>();
+    EXPECT_EQ(h(metafsimple::IcaoCode("UKLI")),
+              h(metafsimple::IcaoCode("UKLI")));
+    EXPECT_NE(h(metafsimple::IcaoCode("UKLI")),
+              h(metafsimple::IcaoCode("UKLL")));
+    std::unordered_set<metafsimple::IcaoCode> s;
+    s.insert(metafsimple::IcaoCode("UKLI"));
+    s.insert(metafsimple::IcaoCode("EGLL"));
+    s.insert(metafsimple::IcaoCode("UKLI"));
+    EXPECT_EQ(s.size(), 2u);
+    EXPECT_TRUE(s.count(metafsimple::IcaoCode("EGLL")));
+}
+
+TEST_F(DataTypes, station_icao) {
+    metafsimple::Station s;
+    EXPECT_TRUE(s.icao().empty());
+    s.icaoCode = "EGLL";
+    EXPECT_EQ(s.icao(), metafsimple::IcaoCode("EGLL"));
+}
@@ -0,0 +1,157 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_derived.hpp"
+
+using namespace metafsimple;
+
+static const auto noValue = std::numeric_limits<float>::quiet_NaN();
+
+static double relativeHumidity(double t, double td) {
+    const auto svp = [](double c) {
+        return 6.11 * std::pow(10.0, 7.5 * c / (237.7 + c));
+    };
+    return 100.0 * svp(td) / svp(t);
+}
+
+TEST(DerivedColumns, relativeHumidity) {
+    DerivedColumns c;
+    c.resize(2000);
+    for (auto i = 0u; i < c.size(); i++) {
+        c.temperatureC[i] = -50.0f + (i % 100) * 0.9f;
+        c.dewPointC[i] = c.temperatureC[i] - (i / 100) * 1.3f;
+    }
+    computeDerived(c);
+    for (auto i = 0u; i < c.size(); i++) {
+        const auto expected =
+            relativeHumidity(c.temperatureC[i], c.dewPointC[i]);
+        EXPECT_NEAR(c.relativeHumidity[i], expected, expected * 1e-3)
+            << c.temperatureC[i] << " " << c.dewPointC[i];
+        EXPECT_NEAR(c.dewPointDepressionC[i], (i / 100) * 1.3f, 1e-3);
+    }
+}
+
+TEST(DerivedColumns, windChill) {
+    DerivedColumns c;
+    c.resize(4);
+    c.temperatureC = {-10.0f, -10.0f, 15.0f, -10.0f};
+    c.windSpeedKt = {20.0f, 1.0f, 20.0f, 12.5f};
+    computeDerived(c);
+    const auto expected = [](double t, double kt) {
+        const auto v = std::pow(kt * 1.852, 0.16);
+        return 13.12 + 0.6215 * t - 11.37 * v + 0.3965 * t * v;
+    };
+    EXPECT_NEAR(c.windChillC[0], expected(-10.0, 20.0), 1e-3);
+    EXPECT_NEAR(c.windChillC[0], -20.4, 0.1);
+    EXPECT_TRUE(std::isnan(c.windChillC[1]));
+    EXPECT_TRUE(std::isnan(c.windChillC[2]));
+    EXPECT_NEAR(c.windChillC[3], expected(-10.0, 12.5), 0.05);
+}
+
+TEST(DerivedColumns, heatIndex) {
+    DerivedColumns c;
+    c.resize(2);
+    // 90F and 25C
+    c.temperatureC = {32.2222f, 25.0f};
+    c.dewPointC = {18.5f, 20.0f};
+    computeDerived(c);
+    ASSERT_NEAR(c.relativeHumidity[0], 44.7, 0.5);
+    // About 93F
+    EXPECT_NEAR(c.heatIndexC[0], 33.9, 0.5);
+    EXPECT_TRUE(std::isnan(c.heatIndexC[1]));
+}
+
+TEST(DerivedColumns, altitude) {
+    DerivedColumns c;
+    c.resize(4);
+    c.temperatureC = {15.0f, 35.0f, 15.0f, 15.0f};
+    c.stationPressureHpa = {1013.25f, 1013.25f, noValue, noValue};
+    c.qnhHpa = {noValue, noValue, 1003.25f, noValue};
+    c.elevationFt = {noValue, noValue, 1000.0f, noValue};
+    computeDerived(c);
+    EXPECT_NEAR(c.pressureAltitudeFt[0], 0.0, 1.0);
+    EXPECT_NEAR(c.densityAltitudeFt[0], 0.0, 1.0);
+    EXPECT_NEAR(c.densityAltitudeFt[1], 2376.0, 1.0);
+    EXPECT_NEAR(c.pressureAltitudeFt[2], 1000.0 + 275.0, 2.0);
+    EXPECT_TRUE(std::isnan(c.pressureAltitudeFt[3]));
+    EXPECT_TRUE(std::isnan(c.densityAltitudeFt[3]));
+}
+
+TEST(DerivedColumns, approximations) {
+    EXPECT_EQ(detail::derivedFloor(0.0f), 0);
+    EXPECT_EQ(detail::derivedFloor(0.5f), 0);
+    EXPECT_EQ(detail::derivedFloor(2.5f), 2);
+    EXPECT_EQ(detail::derivedFloor(2.99999f), 2);
+    EXPECT_EQ(detail::derivedFloor(3.0f), 3);
+    EXPECT_EQ(detail::derivedFloor(6000.0f), 6000);
+    for (auto x = -30.0f; x < 30.0f; x += 0.37f)
+        EXPECT_NEAR(detail::derivedExp2(x), std::exp2(x), std::exp2(x) * 1e-6);
+    for (auto x = 1e-3f; x < 1e5f; x *= 1.37f)
+        EXPECT_NEAR(detail::derivedLog2(x), std::log2(x), 1e-6);
+}
+
+TEST(DerivedColumns, outsideOfTables) {
+    DerivedColumns c;
+    c.resize(4);
+    c.temperatureC = {-95.0f, 75.0f, -20.0f, 10.0f};
+    c.dewPointC = {-99.0f, 60.0f, -30.0f, 5.0f};
+    c.windSpeedKt = {10.0f, 10.0f, 300.0f, 10.0f};
+    c.stationPressureHpa = {300.0f, 1150.0f, 0.0f, -5.0f};
+    computeDerived(c);
+    for (auto i = 0; i < 2; i++) {
+        const auto expected =
+            relativeHumidity(c.temperatureC[i], c.dewPointC[i]);
+        EXPECT_NEAR(c.relativeHumidity[i], expected, expected * 1e-3);
+    }
+    const auto v = std::pow(300.0 * 1.852, 0.16);
+    EXPECT_NEAR(c.windChillC[2], 13.12 - 0.6215 * 20 - 11.37 * v - 7.93 * v,
+                1e-3);
+    const auto altitude = [](double hpa) {
+        return 145366.45 * (1.0 - std::pow(hpa / 1013.25, 0.190284));
+    };
+    EXPECT_NEAR(c.pressureAltitudeFt[0], altitude(300.0), 1.0);
+    EXPECT_NEAR(c.pressureAltitudeFt[1], altitude(1150.0), 1.0);
+    EXPECT_TRUE(std::isnan(c.pressureAltitudeFt[2]));
+    EXPECT_TRUE(std::isnan(c.pressureAltitudeFt[3]));
+}
+
+TEST(DerivedColumns, cloudBase) {
+    DerivedColumns c;
+    c.resize(3);
+    c.temperatureC = {20.0f, 20.0f, noValue};
+    c.dewPointC = {10.0f, noValue, 10.0f};
+    computeDerived(c);
+    EXPECT_NEAR(c.cloudBaseFt[0], 4000.0, 1e-3);
+    EXPECT_TRUE(std::isnan(c.cloudBaseFt[1]));
+    EXPECT_TRUE(std::isnan(c.cloudBaseFt[2]));
+    EXPECT_TRUE(std::isnan(c.relativeHumidity[1]));
+    EXPECT_TRUE(std::isnan(c.relativeHumidity[2]));
+}
+
+TEST(DerivedColumns, setDerivedInput) {
+    Simple s;
+    s.current.airTemperature = Temperature{-5, Temperature::Unit::C};
+    s.current.dewPoint = Temperature{-8, Temperature::Unit::C};
+    s.current.weatherData.windSpeed = Speed{10, Speed::Unit::MPS};
+    s.current.weatherData.seaLevelPressure =
+        Pressure{2992, Pressure::Unit::HUNDREDTHS_IN_HG};
+    DerivedColumns c;
+    c.resize(2);
+    setDerivedInput(c, 1, s, 500.0);
+    EXPECT_NEAR(c.temperatureC[1], -5.0, 1e-4);
+    EXPECT_NEAR(c.dewPointC[1], -8.0, 1e-4);
+    EXPECT_NEAR(c.windSpeedKt[1], 19.44, 0.01);
+    EXPECT_NEAR(c.qnhHpa[1], 1013.2, 0.1);
+    EXPECT_NEAR(c.elevationFt[1], 500.0, 1e-4);
+    EXPECT_TRUE(std::isnan(c.stationPressureHpa[1]));
+    EXPECT_TRUE(std::isnan(c.temperatureC[0]));
+}
@@ -0,0 +1,162 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_epoch.hpp"
+
+using namespace metafsimple;
+
+static const auto noValue = std::optional<int>();
+
+// Seconds since epoch of the date and time
+static std::int64_t epoch(int year, int month, int day, int hour, int min) {
+    return detail::daysFromCivil(year, month, day) * 86400 + hour * 3600 +
+           min * 60;
+}
+
+TEST(Epoch, civil) {
+    EXPECT_EQ(detail::daysFromCivil(1970, 1, 1), 0);
+    EXPECT_EQ(detail::daysFromCivil(2000, 3, 1), 11017);
+    EXPECT_EQ(detail::daysFromCivil(1969, 12, 31), -1);
+    EXPECT_EQ(epoch(2020, 2, 29, 12, 0), 1582977600);
+    for (auto d = -800000; d <= 800000; d += 997) {
+        const auto date = detail::civilFromDays(d);
+        EXPECT_EQ(detail::daysFromCivil(date.year, date.month, date.day), d);
+    }
+    const auto leap = detail::civilFromDays(detail::daysFromCivil(2020, 2, 29));
+    EXPECT_EQ(leap.year, 2020);
+    EXPECT_EQ(leap.month, 2);
+    EXPECT_EQ(leap.day, 29);
+    EXPECT_EQ(detail::daysInMonth(2020, 2), 29);
+    EXPECT_EQ(detail::daysInMonth(2100, 2), 28);
+    EXPECT_EQ(detail::daysInMonth(2000, 2), 29);
+    EXPECT_EQ(detail::daysInMonth(2021, 4), 30);
+}
+
+TEST(Epoch, resolveDay) {
+    const auto anchor = epoch(2020, 6, 15, 10, 0);
+    EXPECT_EQ(resolveTime(Time{15, 9, 50}, anchor), epoch(2020, 6, 15, 9, 50));
+    EXPECT_EQ(resolveTime(Time{2, 0, 0}, anchor), epoch(2020, 6, 2, 0, 0));
+    // Hour 24 is the end of the day
+    EXPECT_EQ(resolveTime(Time{15, 24, 0}, anchor), epoch(2020, 6, 16, 0, 0));
+}
+
+TEST(Epoch, resolveMonthRollover) {
+    // Report of the last day of the month received on the first day of the
+    // next month
+    const auto newYear = epoch(2021, 1, 1, 0, 5);
+    EXPECT_EQ(resolveTime(Time{31, 23, 50}, newYear),
+              epoch(2020, 12, 31, 23, 50));
+    // TAF valid until the first day of the next month
+    const auto endOfFebruary = epoch(2021, 2, 28, 18, 0);
+    EXPECT_EQ(resolveTime(Time{1, 6, 0}, endOfFebruary),
+              epoch(2021, 3, 1, 6, 0));
+    // No day 30 in February
+    EXPECT_EQ(resolveTime(Time{30, 12, 0},
+                          epoch(2021, 3, 1, 0, 0),
+                          TimeResolution::NOT_AFTER),
+              epoch(2021, 1, 30, 12, 0));
+    EXPECT_EQ(resolveTime(Time{30, 12, 0},
+                          epoch(2021, 1, 31, 0, 0),
+                          TimeResolution::NOT_BEFORE),
+              epoch(2021, 3, 30, 12, 0));
+}
+
+TEST(Epoch, resolveNoDay) {
+    const auto anchor = epoch(2020, 6, 30, 23, 53);
+    EXPECT_EQ(resolveTime(Time{noValue, 1, 0}, anchor, TimeResolution::NEAREST),
+              epoch(2020, 7, 1, 1, 0));
+    EXPECT_EQ(resolveTime(Time{noValue, 1, 0},
+                          anchor,
+                          TimeResolution::NOT_AFTER),
+              epoch(2020, 6, 30, 1, 0));
+    EXPECT_EQ(resolveTime(Time{noValue, 23, 0},
+                          anchor,
+                          TimeResolution::NOT_BEFORE),
+              epoch(2020, 7, 1, 23, 0));
+    // Minute only
+    EXPECT_EQ(resolveTime(Time{noValue, noValue, 58},
+                          anchor,
+                          TimeResolution::NOT_AFTER),
+              epoch(2020, 6, 30, 22, 58));
+    EXPECT_EQ(resolveTime(Time{noValue, noValue, 15},
+                          anchor,
+                          TimeResolution::NOT_BEFORE),
+              epoch(2020, 7, 1, 0, 15));
+}
+
+TEST(Epoch, resolveInvalid) {
+    const auto anchor = epoch(2020, 6, 15, 10, 0);
+    EXPECT_FALSE(resolveTime(Time(), anchor).has_value());
+    EXPECT_FALSE(resolveTime(Time{15, noValue, noValue}, anchor).has_value());
+    EXPECT_FALSE(resolveTime(Time{32, 0, 0}, anchor).has_value());
+    EXPECT_FALSE(resolveTime(Time{15, 25, 0}, anchor).has_value());
+    EXPECT_FALSE(resolveTime(Time{15, 10, 60}, anchor).has_value());
+}
+
+TEST(Epoch, resolveMetar) {
+    Simple metar;
+    metar.report.type = Report::Type::METAR;
+    metar.report.reportTime = Time{31, 23, 53};
+    metar.historical.peakWindObserved = Time{noValue, 23, 15};
+    metar.historical.recentWeather.push_back(Historical::WeatherEvent{
+        Historical::Event::ENDED,
+        Weather{Weather::Phenomena::THUNDERSTORM, {}},
+        Time{noValue, noValue, 58}});
+    Trend trend;
+    trend.type = Trend::Type::TEMPO;
+    trend.timeFrom = Time{noValue, 0, 30};
+    trend.timeUntil = Time{noValue, 1, 30};
+    metar.forecast.trends.push_back(trend);
+
+    const auto r = resolveTimes(metar, epoch(2020, 8, 1, 0, 2));
+    EXPECT_EQ(r.reportTime, epoch(2020, 7, 31, 23, 53));
+    EXPECT_FALSE(r.applicableFrom.has_value());
+    EXPECT_FALSE(r.applicableUntil.has_value());
+    EXPECT_EQ(r.peakWindObserved, epoch(2020, 7, 31, 23, 15));
+    EXPECT_FALSE(r.windShiftBegan.has_value());
+    ASSERT_EQ(r.recentWeather.size(), 1u);
+    EXPECT_EQ(r.recentWeather[0], epoch(2020, 7, 31, 22, 58));
+    ASSERT_EQ(r.trends.size(), 1u);
+    EXPECT_EQ(r.trends[0].from, epoch(2020, 8, 1, 0, 30));
+    EXPECT_EQ(r.trends[0].until, epoch(2020, 8, 1, 1, 30));
+    EXPECT_FALSE(r.trends[0].at.has_value());
+}
+
+TEST(Epoch, resolveTaf) {
+    Simple taf;
+    taf.report.type = Report::Type::TAF;
+    // No release time
+    taf.report.applicableFrom = Time{31, 18, 0};
+    taf.report.applicableUntil = Time{1, 24, 0};
+    Trend fm;
+    fm.type = Trend::Type::TIMED;
+    fm.timeFrom = Time{1, 3, 0};
+    taf.forecast.trends.push_back(fm);
+    Trend tempo;
+    tempo.type = Trend::Type::TEMPO;
+    tempo.timeFrom = Time{31, 20, 0};
+    tempo.timeUntil = Time{1, 2, 0};
+    taf.forecast.trends.push_back(tempo);
+    taf.forecast.maxTemperature.push_back(TemperatureForecast{
+        Temperature{30, Temperature::Unit::C}, Time{1, 15, 0}});
+
+    const auto r = resolveTimes(taf, epoch(2020, 12, 31, 17, 40));
+    EXPECT_FALSE(r.reportTime.has_value());
+    EXPECT_EQ(r.applicableFrom, epoch(2020, 12, 31, 18, 0));
+    EXPECT_EQ(r.applicableUntil, epoch(2021, 1, 2, 0, 0));
+    ASSERT_EQ(r.trends.size(), 2u);
+    EXPECT_EQ(r.trends[0].from, epoch(2021, 1, 1, 3, 0));
+    EXPECT_FALSE(r.trends[0].until.has_value());
+    EXPECT_EQ(r.trends[1].from, epoch(2020, 12, 31, 20, 0));
+    EXPECT_EQ(r.trends[1].until, epoch(2021, 1, 1, 2, 0));
+    ASSERT_EQ(r.maxTemperature.size(), 1u);
+    EXPECT_EQ(r.maxTemperature[0], epoch(2021, 1, 1, 15, 0));
+    EXPECT_TRUE(r.minTemperature.empty());
+}
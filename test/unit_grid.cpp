@@ -0,0 +1,188 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_grid.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+static const std::int64_t january2021 = 1609459200;
+static const std::int64_t april2021 = 1617235200;
+// Reports are from January 2021 unless specified otherwise
+static const std::int64_t reference = january2021 + (7 * 24 + 17) * 3600;
+
+// TAF ZZZZ 081720Z 0818/0906 24010G20KT 9999 SCT030
+//   TEMPO 0820/0822 3000 SHRA BKN008
+//   FM090000 30005KT 6000 BKN010
+static Simple makeTaf(const std::string &icao) {
+    Simple taf;
+    taf.station.icaoCode = icao;
+    taf.report.type = Report::Type::TAF;
+    taf.report.applicableFrom = Time{8, 18, noValue};
+    taf.report.applicableUntil = Time{9, 6, noValue};
+    auto &p = taf.forecast.prevailing;
+    p.windDirectionDegrees = 240;
+    p.windSpeed = Speed{10, Speed::Unit::KT};
+    p.gustSpeed = Speed{20, Speed::Unit::KT};
+    p.visibility =
+        Distance{Distance::Details::EXACTLY, 9999, Distance::Unit::METERS};
+    p.skyCondition = Essentials::SkyCondition::CLOUDS;
+    p.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::SCATTERED,
+                                       Height{3000, Height::Unit::FEET},
+                                       CloudLayer::Details::UNKNOWN,
+                                       noValue});
+
+    Trend tempo;
+    tempo.type = Trend::Type::TEMPO;
+    tempo.timeFrom = Time{8, 20, noValue};
+    tempo.timeUntil = Time{8, 22, noValue};
+    tempo.forecast.visibility =
+        Distance{Distance::Details::EXACTLY, 3000, Distance::Unit::METERS};
+    tempo.forecast.weather.push_back(
+        Weather{Weather::Phenomena::SHOWERY_PRECIPITATION_MODERATE,
+                {Weather::Precipitation::RAIN}});
+    tempo.forecast.skyCondition = Essentials::SkyCondition::CLOUDS;
+    tempo.forecast.cloudLayers.push_back(
+        CloudLayer{CloudLayer::Amount::BROKEN,
+                   Height{800, Height::Unit::FEET},
+                   CloudLayer::Details::UNKNOWN,
+                   noValue});
+    taf.forecast.trends.push_back(tempo);
+
+    Trend fm;
+    fm.type = Trend::Type::TIMED;
+    fm.timeFrom = Time{9, 0, 0};
+    fm.forecast.windDirectionDegrees = 300;
+    fm.forecast.windSpeed = Speed{5, Speed::Unit::KT};
+    fm.forecast.visibility =
+        Distance{Distance::Details::EXACTLY, 6000, Distance::Unit::METERS};
+    fm.forecast.skyCondition = Essentials::SkyCondition::CLOUDS;
+    fm.forecast.cloudLayers.push_back(
+        CloudLayer{CloudLayer::Amount::BROKEN,
+                   Height{1000, Height::Unit::FEET},
+                   CloudLayer::Details::UNKNOWN,
+                   noValue});
+    fm.forecast.weather.push_back(Weather{Weather::Phenomena::MIST, {}});
+    taf.forecast.trends.push_back(fm);
+    return taf;
+}
+
+TEST(ForecastGrid, resize) {
+    ForecastGrid grid;
+    grid.resize(3, 30);
+    EXPECT_EQ(grid.stations(), 3u);
+    EXPECT_EQ(grid.hours(), 30u);
+    EXPECT_EQ(grid.index(2, 5), 65u);
+    EXPECT_EQ(grid.visibilityM.size(), 90u);
+    EXPECT_EQ(grid.weatherMask.size(), 90u);
+    EXPECT_EQ(grid.ceilingFt[89], ForecastGrid::noValue);
+}
+
+TEST(ForecastGrid, fillRow) {
+    ForecastGrid grid;
+    grid.resize(2, 30);
+    fillGridRow(makeTaf("UKLI"), grid, 1, reference);
+    EXPECT_EQ(grid.icao[1], IcaoCode("UKLI"));
+    EXPECT_EQ(grid.startDay[1], 8);
+    EXPECT_EQ(grid.startHour[1], 18);
+    EXPECT_EQ(grid.validHours[1], 12);
+
+    const auto prevailing = grid.index(1, 0);
+    EXPECT_EQ(grid.windDirectionDeg[prevailing], 240);
+    EXPECT_EQ(grid.windSpeedKt[prevailing], 10);
+    EXPECT_EQ(grid.gustSpeedKt[prevailing], 20);
+    EXPECT_EQ(grid.visibilityM[prevailing], 9999);
+    EXPECT_EQ(grid.ceilingFt[prevailing], ForecastGrid::noValue);
+    EXPECT_EQ(grid.weatherMask[prevailing], 0u);
+    EXPECT_EQ(grid.minVisibilityM[prevailing], 9999);
+
+    // TEMPO does not change governing conditions, only minimum values
+    const auto tempo = grid.index(1, 3);
+    EXPECT_EQ(grid.visibilityM[tempo], 9999);
+    EXPECT_EQ(grid.ceilingFt[tempo], ForecastGrid::noValue);
+    EXPECT_EQ(grid.minVisibilityM[tempo], 3000);
+    EXPECT_EQ(grid.minCeilingFt[tempo], 800);
+    EXPECT_EQ(grid.minVisibilityM[grid.index(1, 4)], 9999);
+
+    const auto fm = grid.index(1, 6);
+    EXPECT_EQ(grid.windDirectionDeg[fm], 300);
+    EXPECT_EQ(grid.gustSpeedKt[fm], ForecastGrid::noValue);
+    EXPECT_EQ(grid.visibilityM[fm], 6000);
+    EXPECT_EQ(grid.ceilingFt[fm], 1000);
+    const auto mist = std::uint64_t(1)
+                      << static_cast<unsigned int>(Weather::Phenomena::MIST);
+    EXPECT_EQ(grid.weatherMask[fm], mist);
+    EXPECT_EQ(grid.weatherMask[grid.index(1, 11)], mist);
+
+    // Beyond validity period and other rows are not filled
+    EXPECT_EQ(grid.visibilityM[grid.index(1, 12)], ForecastGrid::noValue);
+    EXPECT_EQ(grid.visibilityM[grid.index(0, 0)], ForecastGrid::noValue);
+}
+
+TEST(ForecastGrid, truncatedRow) {
+    ForecastGrid grid;
+    grid.resize(1, 4);
+    fillGridRow(makeTaf("UKLI"), grid, 0, reference);
+    EXPECT_EQ(grid.validHours[0], 12);
+    EXPECT_EQ(grid.minVisibilityM[grid.index(0, 3)], 3000);
+}
+
+TEST(ForecastGrid, notTaf) {
+    ForecastGrid grid;
+    grid.resize(1, 30);
+    fillGridRow(makeTaf("UKLI"), grid, 0, reference);
+    auto metar = makeTaf("UKLI");
+    metar.report.type = Report::Type::METAR;
+    fillGridRow(metar, grid, 0, reference);
+    EXPECT_EQ(grid.validHours[0], 0);
+    EXPECT_EQ(grid.visibilityM[grid.index(0, 0)], ForecastGrid::noValue);
+}
+
+TEST(ForecastGrid, parallelMatchesSequential) {
+    std::vector<Simple> tafs;
+    for (auto i = 0; i < 100; i++) {
+        auto taf = makeTaf("K" + std::to_string(100 + i));
+        taf.forecast.prevailing.windDirectionDegrees = i;
+        tafs.push_back(taf);
+    }
+    ForecastGrid sequential, parallel;
+    sequential.resize(tafs.size(), 30);
+    parallel.resize(tafs.size(), 30);
+    fillGrid(tafs, sequential, reference);
+#ifndef __EMSCRIPTEN__
+    fillGrid(tafs, parallel, reference, 4);
+#else
+    fillGrid(tafs, parallel, reference);
+#endif
+    EXPECT_EQ(sequential.icao, parallel.icao);
+    EXPECT_EQ(sequential.windDirectionDeg, parallel.windDirectionDeg);
+    EXPECT_EQ(sequential.minCeilingFt, parallel.minCeilingFt);
+    EXPECT_EQ(parallel.windDirectionDeg[parallel.index(42, 0)], 42);
+    EXPECT_EQ(parallel.icao[99], IcaoCode("K199"));
+}
+
+TEST(ForecastGrid, monthEnd) {
+    // Validity period 3018/0106 spans the end of month
+    auto taf = makeTaf("UKLI");
+    taf.report.applicableFrom = Time{30, 18, noValue};
+    taf.report.applicableUntil = Time{1, 6, noValue};
+    taf.forecast.trends.clear();
+    ForecastGrid grid;
+    grid.resize(1, 48);
+    // April has 30 days
+    fillGrid({taf}, grid, april2021 + 29 * 24 * 3600);
+    EXPECT_EQ(grid.validHours[0], 12);
+    // January has 31 days
+    fillGrid({taf}, grid, january2021 + 29 * 24 * 3600);
+    EXPECT_EQ(grid.validHours[0], 36);
+    EXPECT_EQ(grid.windDirectionDeg[grid.index(0, 35)], 240);
+    EXPECT_EQ(grid.windDirectionDeg[grid.index(0, 36)], ForecastGrid::noValue);
+}
@@ -0,0 +1,176 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_hazards.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+static Simple makeReport(const std::string &icao, Report::Type type) {
+    Simple s;
+    s.station.icaoCode = icao;
+    s.report.type = type;
+    s.report.error = Report::Error::NO_ERROR;
+    return s;
+}
+
+static Simple thunderstorm(const std::string &icao) {
+    auto s = makeReport(icao, Report::Type::METAR);
+    s.current.weatherData.weather.push_back(
+        Weather{Weather::Phenomena::THUNDERSTORM_PRECIPITATION_MODERATE,
+                {Weather::Precipitation::RAIN}});
+    s.current.weatherData.cloudLayers.push_back(
+        CloudLayer{CloudLayer::Amount::BROKEN,
+                   Height{2000, Height::Unit::FEET},
+                   CloudLayer::Details::CUMULONIMBUS,
+                   noValue});
+    return s;
+}
+
+static const auto observed = HazardIndex::Source::OBSERVED;
+static const auto forecast = HazardIndex::Source::FORECAST;
+
+TEST(HazardKey, unique) {
+    std::bitset<hazardKeyCount> used;
+    const auto use = [&](std::size_t key) {
+        ASSERT_LT(key, hazardKeyCount);
+        EXPECT_FALSE(used.test(key));
+        used.set(key);
+    };
+    for (auto i = 0u; i < detail::hazardPhenomenaCount; i++)
+        use(hazardKey(static_cast<Weather::Phenomena>(i)));
+    for (auto i = 0u; i < detail::hazardPrecipitationCount; i++)
+        use(hazardKey(static_cast<Weather::Precipitation>(i)));
+    for (auto i = 0u; i < detail::hazardVicinityCount; i++)
+        use(hazardKey(static_cast<ObservedPhenomena>(i)));
+    for (auto i = 0u; i < detail::hazardFlagCount; i++)
+        use(hazardKey(static_cast<HazardFlag>(i)));
+    EXPECT_TRUE(used.all());
+}
+
+TEST(Hazards, observed) {
+    auto s = thunderstorm("UKLI");
+    s.current.phenomenaInVicinity.push_back(
+        Vicinity{ObservedPhenomena::FOG, DistanceRange(),
+                 CardinalDirection::NOT_SPECIFIED, {}});
+    s.current.lightningStrikes.push_back(LightningStrikes());
+    const auto h = observedHazards(s);
+    EXPECT_TRUE(h.test(
+        hazardKey(Weather::Phenomena::THUNDERSTORM_PRECIPITATION_MODERATE)));
+    EXPECT_TRUE(h.test(hazardKey(Weather::Precipitation::RAIN)));
+    EXPECT_TRUE(h.test(hazardKey(HazardFlag::CUMULONIMBUS)));
+    EXPECT_TRUE(h.test(hazardKey(ObservedPhenomena::FOG)));
+    EXPECT_TRUE(h.test(hazardKey(HazardFlag::LIGHTNING)));
+    EXPECT_FALSE(h.test(hazardKey(HazardFlag::WIND_SHEAR)));
+    EXPECT_EQ(h.count(), 5u);
+}
+
+TEST(Hazards, forecast) {
+    auto s = makeReport("UKLI", Report::Type::TAF);
+    s.forecast.prevailingWsConds = true;
+    Trend t;
+    t.forecast.weather.push_back(
+        Weather{Weather::Phenomena::FREEZING_PRECIPITATION_LIGHT,
+                {Weather::Precipitation::RAIN}});
+    t.vicinity.insert(ObservedPhenomena::THUNDERSTORM);
+    s.forecast.trends.push_back(t);
+    const auto h = forecastHazards(s);
+    EXPECT_TRUE(h.test(hazardKey(HazardFlag::WIND_SHEAR)));
+    EXPECT_TRUE(
+        h.test(hazardKey(Weather::Phenomena::FREEZING_PRECIPITATION_LIGHT)));
+    EXPECT_TRUE(h.test(hazardKey(Weather::Precipitation::RAIN)));
+    EXPECT_TRUE(h.test(hazardKey(ObservedPhenomena::THUNDERSTORM)));
+    EXPECT_EQ(h.count(), 4u);
+}
+
+TEST(HazardIndex, update) {
+    HazardIndex index;
+    EXPECT_TRUE(index.update(thunderstorm("UKLI")));
+    EXPECT_TRUE(index.update(makeReport("UKLL", Report::Type::METAR)));
+    EXPECT_TRUE(index.update(thunderstorm("UKLR")));
+    EXPECT_EQ(index.stationCount(), 3u);
+    EXPECT_EQ(index.number(IcaoCode("UKLR")), 2u);
+    EXPECT_EQ(index.station(1), IcaoCode("UKLL"));
+
+    const auto cb = hazardKey(HazardFlag::CUMULONIMBUS);
+    EXPECT_EQ(index.stationCodes(observed, cb),
+              (std::vector<IcaoCode>{IcaoCode("UKLI"), IcaoCode("UKLR")}));
+    EXPECT_TRUE(index.stations(forecast, cb).empty());
+
+    // Thunderstorm ended at UKLI
+    EXPECT_TRUE(index.update(makeReport("UKLI", Report::Type::SPECI)));
+    EXPECT_EQ(index.stationCodes(observed, cb),
+              (std::vector<IcaoCode>{IcaoCode("UKLR")}));
+    EXPECT_TRUE(index.hazards(IcaoCode("UKLI"), observed).none());
+    EXPECT_TRUE(index.hazards(IcaoCode("UKLR"), observed).test(cb));
+
+    index.clear(IcaoCode("UKLR"), observed);
+    EXPECT_TRUE(index.stations(observed, cb).empty());
+    EXPECT_EQ(index.stationCount(), 3u);
+}
+
+TEST(HazardIndex, sourcesAreSeparate) {
+    HazardIndex index;
+    auto taf = makeReport("UKLI", Report::Type::TAF);
+    taf.forecast.prevailing.weather.push_back(
+        Weather{Weather::Phenomena::FREEZING_PRECIPITATION_MODERATE,
+                {Weather::Precipitation::RAIN}});
+    index.update(taf);
+    index.update(makeReport("UKLI", Report::Type::METAR));
+    const auto fzra =
+        hazardKey(Weather::Phenomena::FREEZING_PRECIPITATION_MODERATE);
+    EXPECT_TRUE(index.stations(forecast, fzra).test(0));
+    EXPECT_FALSE(index.stations(observed, fzra).test(0));
+    EXPECT_EQ(index.stationCount(), 1u);
+}
+
+TEST(HazardIndex, ignored) {
+    HazardIndex index;
+    auto s = thunderstorm("UKLI");
+    s.report.error = Report::Error::EMPTY_REPORT;
+    EXPECT_FALSE(index.update(s));
+    EXPECT_FALSE(index.update(thunderstorm("")));
+    EXPECT_FALSE(index.update(makeReport("UKLI", Report::Type::ERROR)));
+    EXPECT_EQ(index.stationCount(), 0u);
+}
+
+TEST(StationBitmap, operations) {
+    StationBitmap a, b;
+    for (std::uint32_t i = 0; i < 200; i += 3) a.set(i);
+    for (std::uint32_t i = 0; i < 100; i += 2) b.set(i);
+    EXPECT_EQ(a.count(), 67u);
+    EXPECT_TRUE(a.test(198));
+    EXPECT_FALSE(a.test(199));
+    EXPECT_FALSE(a.test(100000));
+
+    auto both = a;
+    both &= b;
+    std::vector<std::uint32_t> stations;
+    both.forEach([&](std::uint32_t s) { stations.push_back(s); });
+    ASSERT_EQ(stations.size(), 17u);
+    EXPECT_EQ(stations.front(), 0u);
+    EXPECT_EQ(stations.back(), 96u);
+
+    auto any = a;
+    any |= b;
+    EXPECT_EQ(any.count(), 67u + 50u - 17u);
+
+    auto onlyA = a;
+    onlyA.subtract(b);
+    EXPECT_EQ(onlyA.count(), 50u);
+    EXPECT_FALSE(onlyA.test(6));
+    EXPECT_TRUE(onlyA.test(3));
+    EXPECT_TRUE(onlyA.test(198));
+
+    a.set(198, false);
+    a.set(100000, false);
+    EXPECT_FALSE(a.test(198));
+}
@@ -0,0 +1,311 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <unistd.h>
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_history.hpp"
+#include "tempfiles.hpp"
+
+using namespace metafsimple;
+
+static Simple metar(int i) {
+    Simple s;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    s.report.reportTime = Time{1 + i / 48, i / 2 % 24, i % 2 ? 50 : 20};
+    s.station.icaoCode = "EDDF";
+    s.current.airTemperature = Temperature{i, Temperature::Unit::C};
+    return s;
+}
+
+static std::int64_t time(int i) { return i * 1800; }
+
+TEST(StationHistory, appendAndQuery) {
+    const TempFile file("history.mfsh");
+    StationHistoryWriter writer;
+    ASSERT_TRUE(writer.open(file.path, 4));
+    for (auto i = 0; i < 20; i++) EXPECT_TRUE(writer.append(metar(i), time(i)));
+    EXPECT_EQ(writer.size(), 20u);
+    writer.close();
+
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 20u);
+    EXPECT_TRUE(reader.verify());
+    const auto r = reader.records(time(5), time(11));
+    ASSERT_EQ(r.size(), 6u);
+    for (auto i = 0u; i < r.size(); i++) {
+        EXPECT_EQ(r[i].time, time(5 + i));
+        EXPECT_STREQ(r[i].record->icao, "EDDF");
+        EXPECT_EQ(r[i].record->temperature_tenth_c, (5 + i) * 10);
+        const auto report = r[i].report();
+        ASSERT_TRUE(report.has_value());
+        EXPECT_EQ(*report, metar(5 + i));
+    }
+    EXPECT_EQ(reader.records(-time(10), time(1)).size(), 1u);
+    EXPECT_EQ(reader.records(time(19), time(100)).size(), 1u);
+    EXPECT_TRUE(reader.records(time(20), time(30)).empty());
+    EXPECT_TRUE(reader.records(time(5), time(5)).empty());
+    ASSERT_TRUE(reader.latest().has_value());
+    EXPECT_EQ(reader.latest()->time, time(19));
+}
+
+TEST(StationHistory, order) {
+    const TempFile file("history.mfsh");
+    StationHistoryWriter writer;
+    ASSERT_TRUE(writer.open(file.path));
+    EXPECT_TRUE(writer.append(metar(2), time(2)));
+    EXPECT_FALSE(writer.append(metar(1), time(1)));
+    // Reports with the same time (e.g. corrected report) are kept
+    EXPECT_TRUE(writer.append(metar(3), time(2)));
+    writer.close();
+
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    const auto r = reader.records(time(2), time(3));
+    ASSERT_EQ(r.size(), 2u);
+    EXPECT_EQ(r[1].record->temperature_tenth_c, 30);
+}
+
+TEST(StationHistory, reopen) {
+    const TempFile file("history.mfsh");
+    StationHistoryWriter writer;
+    ASSERT_TRUE(writer.open(file.path, 8));
+    for (auto i = 0; i < 10; i++) writer.append(metar(i), time(i));
+    writer.close();
+    // Index interval of existing file is used
+    ASSERT_TRUE(writer.open(file.path, 2));
+    EXPECT_EQ(writer.size(), 10u);
+    EXPECT_FALSE(writer.append(metar(8), time(8)));
+    for (auto i = 10; i < 30; i++) writer.append(metar(i), time(i));
+    writer.close();
+
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 30u);
+    EXPECT_TRUE(reader.verify());
+    const auto r = reader.records(time(7), time(25));
+    ASSERT_EQ(r.size(), 18u);
+    EXPECT_EQ(r.front().time, time(7));
+    EXPECT_EQ(r.back().time, time(24));
+}
+
+TEST(StationHistory, crashRecovery) {
+    const TempFile file("history.mfsh");
+    std::string data;
+    {
+        StationHistoryWriter writer;
+        ASSERT_TRUE(writer.open(file.path, 4));
+        for (auto i = 0; i < 10; i++) writer.append(metar(i), time(i));
+        writer.flush();
+        for (auto i = 10; i < 15; i++) writer.append(metar(i), time(i));
+        // File as left by writer crashed before the footer was written, with
+        // the next record partially written
+        data = readFile(file.path);
+        writer.append(metar(15), time(15));
+        const auto complete = readFile(file.path);
+        data += complete.substr(data.length(), 40);
+    }
+    writeFile(file.path, data);
+
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 15u);
+    EXPECT_TRUE(reader.verify());
+    EXPECT_FALSE(reader.damaged());
+    EXPECT_EQ(reader.records(time(3), time(20)).size(), 12u);
+    reader.close();
+
+    StationHistoryWriter writer;
+    ASSERT_TRUE(writer.open(file.path));
+    EXPECT_EQ(writer.size(), 15u);
+    EXPECT_TRUE(writer.append(metar(15), time(15)));
+    writer.close();
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 16u);
+    EXPECT_TRUE(reader.verify());
+}
+
+TEST(StationHistory, fileIsNotTruncated) {
+    const TempFile file("history.mfsh");
+    StationHistoryWriter writer;
+    ASSERT_TRUE(writer.open(file.path, 1));
+    for (auto i = 0; i < 10; i++) writer.append(metar(i), time(i));
+    ASSERT_TRUE(writer.flush());
+    auto size = readFile(file.path).length();
+
+    // Reader opened before the footer is overwritten keeps its records
+    StationHistoryReader before;
+    ASSERT_TRUE(before.open(file.path));
+    for (auto i = 10; i < 15; i++) {
+        ASSERT_TRUE(writer.append(metar(i), time(i)));
+        EXPECT_GE(readFile(file.path).length(), size);
+        size = readFile(file.path).length();
+        // Trailer of the overwritten footer is not used
+        StationHistoryReader reader;
+        ASSERT_TRUE(reader.open(file.path));
+        EXPECT_EQ(reader.size(), static_cast<std::size_t>(i + 1));
+        EXPECT_TRUE(reader.verify());
+    }
+    EXPECT_EQ(before.size(), 10u);
+    EXPECT_TRUE(before.verify());
+    EXPECT_EQ(*before.latest()->report(), metar(9));
+    writer.close();
+    EXPECT_GE(readFile(file.path).length(), size);
+
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 15u);
+    EXPECT_TRUE(reader.verify());
+    EXPECT_EQ(reader.records(time(0), time(15)).size(), 15u);
+}
+
+TEST(StationHistory, footerAfterUnusedSpace) {
+    const TempFile file("history.mfsh");
+    {
+        StationHistoryWriter writer;
+        ASSERT_TRUE(writer.open(file.path, 4));
+        for (auto i = 0; i < 10; i++) writer.append(metar(i), time(i));
+    }
+    // Space left by a large incomplete record is followed by the footer
+    writeFile(file.path, readFile(file.path) + std::string(4096, '\0'));
+    StationHistoryWriter writer;
+    ASSERT_TRUE(writer.open(file.path));
+    EXPECT_EQ(writer.size(), 10u);
+    EXPECT_TRUE(writer.append(metar(10), time(10)));
+    EXPECT_TRUE(writer.flush());
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 11u);
+    EXPECT_TRUE(reader.verify());
+    EXPECT_EQ(reader.latest()->time, time(10));
+    EXPECT_EQ(reader.records(time(3), time(20)).size(), 8u);
+
+    // Record written into unused space does not overwrite the footer, which
+    // must no longer be used
+    EXPECT_TRUE(writer.append(metar(11), time(11)));
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 12u);
+    EXPECT_EQ(reader.latest()->time, time(11));
+}
+
+TEST(StationHistory, corrupted) {
+    const TempFile file("history.mfsh");
+    {
+        StationHistoryWriter writer;
+        ASSERT_TRUE(writer.open(file.path, 4));
+        for (auto i = 0; i < 10; i++) writer.append(metar(i), time(i));
+    }
+    auto data = readFile(file.path);
+    std::size_t offset = 0;
+    {
+        StationHistoryReader reader;
+        ASSERT_TRUE(reader.open(file.path));
+        const auto r = reader.records(time(0), time(7));
+        ASSERT_EQ(r.size(), 7u);
+        // The first record follows file header
+        const auto *file = reinterpret_cast<const char *>(r[0].record) -
+                           sizeof(detail::HistoryRecordHeader) -
+                           sizeof(detail::HistoryFileHeader);
+        offset = r[6].data.data() - file;
+    }
+    ASSERT_LT(offset, data.length());
+    data[offset] ^= 0x01;
+    writeFile(file.path, data);
+
+    // Footer is valid, records are checked only on request
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 10u);
+    EXPECT_FALSE(reader.verify());
+    reader.close();
+
+    // Without footer, records from the corrupted one onwards are ignored
+    const auto footerSize =
+        3 * sizeof(detail::HistoryIndexEntry) + sizeof(detail::HistoryTrailer);
+    const auto noFooter = data.substr(0, data.length() - footerSize);
+    writeFile(file.path, noFooter);
+    ASSERT_TRUE(reader.open(file.path));
+    EXPECT_EQ(reader.size(), 6u);
+    EXPECT_TRUE(reader.verify());
+    EXPECT_TRUE(reader.damaged());
+    reader.close();
+
+    // Records after the corrupted one are not overwritten
+    StationHistoryWriter writer;
+    EXPECT_FALSE(writer.open(file.path));
+    EXPECT_EQ(readFile(file.path), noFooter);
+}
+
+TEST(StationHistory, wrongFormat) {
+    const TempFile file("history.mfsh");
+    writeFile(file.path, std::string(100, 'x'));
+    StationHistoryReader reader;
+    EXPECT_FALSE(reader.open(file.path));
+    StationHistoryWriter writer;
+    EXPECT_FALSE(writer.open(file.path));
+    EXPECT_EQ(readFile(file.path), std::string(100, 'x'));
+    unlink(file.path.c_str());
+    EXPECT_FALSE(reader.open(file.path));
+}
+
+TEST(StationHistory, store) {
+    const TempDirectory directory("history");
+    {
+        StationHistoryStore store(directory.path);
+        for (auto i = 0; i < 10; i++) {
+            auto s = metar(i);
+            if (i % 3) s.station.icaoCode = "EGLL";
+            EXPECT_TRUE(store.append(s, time(i)));
+        }
+        auto noStation = metar(10);
+        noStation.station.icaoCode.clear();
+        EXPECT_FALSE(store.append(noStation, time(10)));
+        EXPECT_TRUE(store.flush());
+    }
+    StationHistoryReader reader;
+    ASSERT_TRUE(reader.open(
+        StationHistoryStore::path(directory.path, IcaoCode("EDDF"))));
+    EXPECT_EQ(reader.size(), 4u);
+    ASSERT_TRUE(reader.open(
+        StationHistoryStore::path(directory.path, IcaoCode("EGLL"))));
+    EXPECT_EQ(reader.size(), 6u);
+    EXPECT_STREQ(reader.latest()->record->icao, "EGLL");
+}
+
+TEST(StationHistory, storeOpenFiles) {
+    const TempDirectory directory("history");
+    const char *stations[] = {"EDDF", "EGLL", "LFPG"};
+    {
+        StationHistoryStore store(directory.path, 64, 2);
+        for (auto i = 0; i < 12; i++) {
+            auto s = metar(i);
+            s.station.icaoCode = stations[i % 3];
+            EXPECT_TRUE(store.append(s, time(i)));
+            EXPECT_LE(store.openFiles(), 2u);
+        }
+        // File of the least recently used station is closed
+        auto s = metar(12);
+        s.station.icaoCode = "EGLL";
+        EXPECT_TRUE(store.append(s, time(12)));
+        s.station.icaoCode = "EDDF";
+        EXPECT_TRUE(store.append(s, time(12)));
+        EXPECT_EQ(store.openFiles(), 2u);
+    }
+    StationHistoryReader reader;
+    for (const auto s : stations) {
+        ASSERT_TRUE(reader.open(
+            StationHistoryStore::path(directory.path, IcaoCode(s))));
+        EXPECT_EQ(reader.size(), std::string(s) == "LFPG" ? 4u : 5u);
+        EXPECT_TRUE(reader.verify());
+        EXPECT_STREQ(reader.latest()->record->icao, s);
+    }
+}
@@ -0,0 +1,222 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_layers.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+static IcingForecast icing(IcingForecast::Severity s, int minFt, int maxFt) {
+    IcingForecast i;
+    i.severity = s;
+    i.minHeight = Height{minFt, Height::Unit::FEET};
+    i.maxHeight = Height{maxFt, Height::Unit::FEET};
+    return i;
+}
+
+static TurbulenceForecast turbulence(TurbulenceForecast::Severity s,
+                                     int minFt,
+                                     int maxFt) {
+    TurbulenceForecast t;
+    t.severity = s;
+    t.minHeight = Height{minFt, Height::Unit::FEET};
+    t.maxHeight = Height{maxFt, Height::Unit::FEET};
+    return t;
+}
+
+// TAF valid 0812/0912 with light icing 2000-6000 ft all the time and
+// TEMPO 0818/0822 moderate icing 3000-9000 ft and severe turbulence below
+// 5000 ft
+static Simple makeTaf(const std::string &icao) {
+    Simple taf;
+    taf.station.icaoCode = icao;
+    taf.report.type = Report::Type::TAF;
+    taf.report.error = Report::Error::NO_ERROR;
+    taf.report.applicableFrom = Time{8, 12, noValue};
+    taf.report.applicableUntil = Time{9, 12, noValue};
+    taf.forecast.prevailingIcing.push_back(
+        icing(IcingForecast::Severity::LIGHT, 2000, 6000));
+    Trend tempo;
+    tempo.type = Trend::Type::TEMPO;
+    tempo.timeFrom = Time{8, 18, noValue};
+    tempo.timeUntil = Time{8, 22, noValue};
+    tempo.icing.push_back(icing(IcingForecast::Severity::MODERATE, 3000, 9000));
+    tempo.turbulence.push_back(
+        turbulence(TurbulenceForecast::Severity::SEVERE, 0, 5000));
+    taf.forecast.trends.push_back(tempo);
+    return taf;
+}
+
+// Reports are from January 2021; days after 31 are in February
+static const std::int64_t january2021 = 1609459200;
+static const std::int64_t reference = january2021 + (7 * 24 + 12) * 3600;
+
+static int at(int day, int hour) {
+    return LayerIndex::minute(january2021 + ((day - 1) * 24 + hour) * 3600);
+}
+
+TEST(LayerIndex, minute) {
+    EXPECT_EQ(LayerIndex::minute(january2021 + 90), january2021 / 60 + 1);
+    EXPECT_EQ(LayerIndex::minute(-30), -1);
+}
+
+TEST(LayerIndex, add) {
+    LayerIndex index;
+    EXPECT_TRUE(index.add(makeTaf("UKLI"), reference));
+    EXPECT_EQ(index.size(), 3u);
+    auto metar = makeTaf("UKLL");
+    metar.report.type = Report::Type::METAR;
+    EXPECT_FALSE(index.add(metar, reference));
+    auto noValidity = makeTaf("UKLL");
+    noValidity.report.applicableUntil = Time();
+    EXPECT_FALSE(index.add(noValidity, reference));
+    EXPECT_EQ(index.size(), 3u);
+}
+
+TEST(LayerIndex, query) {
+    LayerIndex index;
+    index.add(makeTaf("UKLI"), reference);
+    index.add(makeTaf("UKLL"), reference);
+    const auto both =
+        std::vector<IcaoCode>{IcaoCode("UKLI"), IcaoCode("UKLL")};
+    const auto light = IcingForecast::Severity::LIGHT;
+    const auto moderate = IcingForecast::Severity::MODERATE;
+
+    EXPECT_EQ(index.stations(light, 0, 3000, at(8, 12), at(8, 13)), both);
+    // Moderate icing only during TEMPO period
+    EXPECT_TRUE(index.stations(moderate, 0, 30000, at(8, 12), at(8, 18))
+                    .empty());
+    EXPECT_EQ(index.stations(moderate, 0, 30000, at(8, 17), at(8, 19)), both);
+    // Moderate icing is also 'light or worse'
+    EXPECT_EQ(index.stations(light, 7000, 8000, at(8, 20), at(8, 21)), both);
+    EXPECT_TRUE(
+        index.stations(light, 7000, 8000, at(8, 22), at(9, 12)).empty());
+    // Above all layers
+    EXPECT_TRUE(
+        index.stations(light, 9500, 40000, at(8, 12), at(9, 12)).empty());
+    // Outside validity period
+    EXPECT_TRUE(index.stations(light, 0, 40000, at(9, 12), at(9, 18)).empty());
+
+    const auto severe = TurbulenceForecast::Severity::SEVERE;
+    EXPECT_EQ(index.stations(severe, 4500, 4600, at(8, 21), at(8, 22)), both);
+    EXPECT_TRUE(index.stations(TurbulenceForecast::Severity::EXTREME,
+                               0,
+                               40000,
+                               at(8, 12),
+                               at(9, 12))
+                    .empty());
+}
+
+TEST(LayerIndex, forEachReportsLayerOnce) {
+    LayerIndex index;
+    index.add(makeTaf("UKLI"), reference);
+    int count = 0;
+    index.forEach(LayerKind::ICING,
+                  0,
+                  0,
+                  50000,
+                  at(8, 0),
+                  at(10, 0),
+                  [&](const LayerEntry &e) {
+                      EXPECT_EQ(e.icao, IcaoCode("UKLI"));
+                      count++;
+                  });
+    EXPECT_EQ(count, 2);
+}
+
+TEST(LayerIndex, replaceAndRemove) {
+    LayerIndex index;
+    index.add(makeTaf("UKLI"), reference);
+    index.add(makeTaf("UKLL"), reference);
+    auto taf = makeTaf("UKLI");
+    taf.forecast.trends.clear();
+    index.add(taf, reference);
+    EXPECT_EQ(index.size(), 4u);
+    const auto moderate = IcingForecast::Severity::MODERATE;
+    EXPECT_EQ(index.stations(moderate, 0, 30000, at(8, 12), at(9, 12)),
+              std::vector<IcaoCode>{IcaoCode("UKLL")});
+
+    index.remove(IcaoCode("UKLL"));
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_TRUE(
+        index.stations(moderate, 0, 30000, at(8, 12), at(9, 12)).empty());
+    EXPECT_EQ(index.stations(IcingForecast::Severity::NONE_OR_TRACE,
+                             0,
+                             30000,
+                             at(8, 12),
+                             at(9, 12)),
+              std::vector<IcaoCode>{IcaoCode("UKLI")});
+}
+
+TEST(LayerIndex, unknownHeights) {
+    LayerIndex index;
+    auto taf = makeTaf("UKLI");
+    taf.forecast.trends.clear();
+    taf.forecast.prevailingIcing[0].maxHeight = Height();
+    index.add(taf, reference);
+    EXPECT_EQ(index.stations(IcingForecast::Severity::LIGHT,
+                             45000,
+                             50000,
+                             at(8, 12),
+                             at(8, 13)),
+              std::vector<IcaoCode>{IcaoCode("UKLI")});
+}
+
+TEST(LayerIndex, fmReplacesLayers) {
+    LayerIndex index;
+    // FM081800 with no icing and FM090000 with moderate turbulence below
+    // 3000 ft
+    auto taf = makeTaf("UKLI");
+    Trend fm;
+    fm.type = Trend::Type::TIMED;
+    fm.timeFrom = Time{8, 18, 0};
+    taf.forecast.trends.push_back(fm);
+    fm.timeFrom = Time{9, 0, 0};
+    fm.turbulence.push_back(
+        turbulence(TurbulenceForecast::Severity::MODERATE, 0, 3000));
+    taf.forecast.trends.push_back(fm);
+    ASSERT_TRUE(index.add(taf, reference));
+
+    const auto light = IcingForecast::Severity::LIGHT;
+    const auto ukli = std::vector<IcaoCode>{IcaoCode("UKLI")};
+    EXPECT_EQ(index.stations(light, 2000, 2500, at(8, 17), at(8, 18)), ukli);
+    // TEMPO is not affected by FM
+    EXPECT_EQ(index.stations(light, 3000, 3500, at(8, 21), at(8, 22)), ukli);
+    EXPECT_TRUE(
+        index.stations(light, 2000, 2500, at(8, 22), at(9, 12)).empty());
+
+    const auto moderate = TurbulenceForecast::Severity::MODERATE;
+    EXPECT_TRUE(
+        index.stations(moderate, 0, 1000, at(8, 22), at(9, 0)).empty());
+    EXPECT_EQ(index.stations(moderate, 0, 1000, at(9, 11), at(9, 12)), ukli);
+}
+
+TEST(LayerIndex, monthChange) {
+    LayerIndex index;
+    // TAF valid 3118/0118 with TEMPO 0100/0106
+    auto taf = makeTaf("UKLI");
+    taf.report.applicableFrom = Time{31, 18, noValue};
+    taf.report.applicableUntil = Time{1, 18, noValue};
+    taf.forecast.trends[0].timeFrom = Time{1, 0, noValue};
+    taf.forecast.trends[0].timeUntil = Time{1, 6, noValue};
+    ASSERT_TRUE(index.add(taf, january2021 + 30 * 24 * 3600));
+
+    const auto ukli = std::vector<IcaoCode>{IcaoCode("UKLI")};
+    const auto light = IcingForecast::Severity::LIGHT;
+    EXPECT_EQ(index.stations(light, 2000, 2500, at(31, 20), at(31, 21)), ukli);
+    EXPECT_EQ(index.stations(light, 2000, 2500, at(32, 17), at(32, 18)), ukli);
+    EXPECT_TRUE(
+        index.stations(light, 2000, 2500, at(32, 18), at(32, 19)).empty());
+    const auto moderate = IcingForecast::Severity::MODERATE;
+    EXPECT_EQ(index.stations(moderate, 0, 30000, at(32, 2), at(32, 3)), ukli);
+    EXPECT_TRUE(
+        index.stations(moderate, 0, 30000, at(31, 18), at(32, 0)).empty());
+}
@@ -0,0 +1,164 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_leaderboard.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+static Simple makeMetar(const std::string &icao,
+                        int visibility,
+                        std::optional<int> gust = noValue) {
+    Simple s;
+    s.station.icaoCode = icao;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    s.current.weatherData.visibility = Distance{
+        Distance::Details::EXACTLY, visibility, Distance::Unit::METERS};
+    if (gust.has_value())
+        s.current.weatherData.gustSpeed = Speed{*gust, Speed::Unit::KT};
+    return s;
+}
+
+static Aerodrome::RunwayData runway(std::optional<int> coefficient) {
+    Aerodrome::RunwayData r;
+    r.coefficient = coefficient;
+    return r;
+}
+
+static std::vector<std::string> icaos(
+    const std::vector<Leaderboard::Entry> &entries) {
+    std::vector<std::string> result;
+    for (const auto &e : entries) result.push_back(e.icao.toString());
+    return result;
+}
+
+using Strings = std::vector<std::string>;
+static const auto visibility = Leaderboard::Ranking::LOWEST_VISIBILITY;
+static const auto gust = Leaderboard::Ranking::HIGHEST_GUST;
+
+TEST(IndexedHeap, matchesSort) {
+    IndexedHeap heap;
+    std::vector<std::optional<double>> keys(500);
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<int> id(0, 499), key(0, 1000), op(0, 9);
+    for (auto i = 0; i < 20000; i++) {
+        const auto n = static_cast<std::uint32_t>(id(gen));
+        if (!op(gen)) {
+            heap.erase(n);
+            keys[n].reset();
+        } else {
+            const double k = key(gen);
+            heap.update(n, k);
+            keys[n] = k;
+        }
+    }
+    std::vector<IndexedHeap::Item> expected;
+    for (auto i = 0u; i < keys.size(); i++) {
+        if (keys[i].has_value())
+            expected.push_back(IndexedHeap::Item{*keys[i], i});
+    }
+    std::sort(expected.begin(), expected.end(), [](auto a, auto b) {
+        return a.key < b.key || (a.key == b.key && a.id < b.id);
+    });
+    ASSERT_EQ(heap.size(), expected.size());
+    std::vector<IndexedHeap::Item> actual;
+    heap.forEachSmallest(heap.size() + 10, [&](const IndexedHeap::Item &i) {
+        actual.push_back(i);
+    });
+    ASSERT_EQ(actual.size(), expected.size());
+    for (auto i = 0u; i < actual.size(); i++) {
+        EXPECT_EQ(actual[i].id, expected[i].id);
+        EXPECT_EQ(actual[i].key, expected[i].key);
+    }
+    EXPECT_EQ(heap.top().id, expected.front().id);
+}
+
+TEST(Leaderboard, top) {
+    Leaderboard board;
+    board.update(makeMetar("UKLI", 3000, 35));
+    board.update(makeMetar("UKLL", 800));
+    board.update(makeMetar("UKLR", 9999, 50));
+    board.update(makeMetar("UKLN", 1500, 20));
+    EXPECT_EQ(icaos(board.top(visibility, 3)),
+              (Strings{"UKLL", "UKLN", "UKLI"}));
+    EXPECT_EQ(icaos(board.top(gust, 10)), (Strings{"UKLR", "UKLI", "UKLN"}));
+    EXPECT_EQ(board.top(gust, 1).front().value, 50.0);
+    EXPECT_EQ(*board.value(IcaoCode("UKLI"), gust), 35.0);
+    EXPECT_FALSE(board.value(IcaoCode("UKLL"), gust).has_value());
+    EXPECT_TRUE(board.top(visibility, 0).empty());
+}
+
+TEST(Leaderboard, updateReplacesStation) {
+    Leaderboard board;
+    board.update(makeMetar("UKLI", 3000, 35));
+    board.update(makeMetar("UKLL", 800));
+    board.update(makeMetar("UKLR", 9999, 50));
+
+    // Visibility improved, gusts ended
+    board.update(makeMetar("UKLL", 9000));
+    board.update(makeMetar("UKLR", 500));
+    EXPECT_EQ(icaos(board.top(visibility, 3)),
+              (Strings{"UKLR", "UKLI", "UKLL"}));
+    EXPECT_EQ(icaos(board.top(gust, 3)), (Strings{"UKLI"}));
+    EXPECT_EQ(board.size(visibility), 3u);
+
+    board.remove(IcaoCode("UKLR"));
+    EXPECT_EQ(icaos(board.top(visibility, 3)), (Strings{"UKLI", "UKLL"}));
+}
+
+TEST(Leaderboard, runways) {
+    Leaderboard board;
+    auto m = makeMetar("UKLI", 3000);
+    m.aerodrome.runways.push_back(runway(45));
+    m.aerodrome.runways.push_back(runway(28));
+    m.aerodrome.runways.push_back(runway(noValue));
+    board.update(m);
+    auto unreliable = makeMetar("UKLL", 3000);
+    unreliable.aerodrome.runways.push_back(runway(noValue));
+    unreliable.aerodrome.runways.back().surfaceFrictionUnreliable = true;
+    board.update(unreliable);
+    auto good = makeMetar("UKLR", 3000);
+    good.aerodrome.runways.push_back(runway(50));
+    board.update(good);
+    // Coefficient reported with unreliable reading or out of range
+    auto invalid = makeMetar("UKLO", 3000);
+    invalid.aerodrome.runways.push_back(runway(10));
+    invalid.aerodrome.runways.back().surfaceFrictionUnreliable = true;
+    invalid.aerodrome.runways.push_back(runway(-5));
+    invalid.aerodrome.runways.push_back(runway(101));
+    board.update(invalid);
+
+    const auto coefficient = Leaderboard::Ranking::LOWEST_RUNWAY_COEFFICIENT;
+    const auto braking = Leaderboard::Ranking::WORST_BRAKING_ACTION;
+    const auto top = board.top(coefficient, 5);
+    EXPECT_EQ(icaos(top), (Strings{"UKLI", "UKLR"}));
+    EXPECT_EQ(top.front().value, 28.0);
+    EXPECT_EQ(icaos(board.top(braking, 5)), (Strings{"UKLI", "UKLR"}));
+    EXPECT_EQ(*board.value(IcaoCode("UKLI"), braking),
+              static_cast<double>(Aerodrome::BrakingAction::MEDIUM_POOR));
+}
+
+TEST(Leaderboard, ignored) {
+    Leaderboard board;
+    auto taf = makeMetar("UKLI", 500);
+    taf.report.type = Report::Type::TAF;
+    EXPECT_FALSE(board.update(taf));
+    auto error = makeMetar("UKLI", 500);
+    error.report.error = Report::Error::EMPTY_REPORT;
+    EXPECT_FALSE(board.update(error));
+    EXPECT_FALSE(board.update(makeMetar("", 500)));
+    EXPECT_TRUE(board.top(visibility, 5).empty());
+}
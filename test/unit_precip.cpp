@@ -0,0 +1,248 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_precip.hpp"
+
+using namespace metafsimple;
+
+static const auto margin = 1e-4;
+
+using Kind = PrecipitationSeries::Kind;
+using Source = PrecipitationSeries::Source;
+
+static Simple makeMetar(const std::string &icao) {
+    Simple s;
+    s.station.icaoCode = icao;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    return s;
+}
+
+static Precipitation tenthsMm(int amount) {
+    return Precipitation{amount, Precipitation::Unit::TENTHS_MM};
+}
+
+// Minute of the routine report at hh53
+static int routine(int hour) { return hour * 60 + 53; }
+
+TEST(PrecipitationSeries, hour) {
+    EXPECT_EQ(PrecipitationSeries::hour(routine(12)), 12);
+    EXPECT_EQ(PrecipitationSeries::hour(13 * 60), 12);
+    EXPECT_EQ(PrecipitationSeries::hour(13 * 60 + 20), 12);
+    EXPECT_EQ(PrecipitationSeries::hour(13 * 60 + 31), 13);
+    EXPECT_EQ(PrecipitationSeries::hour(10), -1);
+}
+
+TEST(PrecipitationSeries, hourlyTotals) {
+    PrecipitationSeries series;
+    auto m = makeMetar("KLAX");
+    m.historical.precipitationTotal1h =
+        Precipitation{5, Precipitation::Unit::HUNDREDTHS_IN};
+    EXPECT_TRUE(series.update(m, routine(100)));
+    m.historical.precipitationTotal1h = tenthsMm(0);
+    EXPECT_TRUE(series.update(m, routine(101)));
+
+    const auto h = series.hourly(IcaoCode("KLAX"), Kind::PRECIPITATION, 99,
+                                 103);
+    ASSERT_EQ(h.size(), 4u);
+    EXPECT_EQ(h[0].hour, 99);
+    EXPECT_FALSE(h[0].amount.has_value());
+    EXPECT_EQ(h[0].source, Source::MISSING);
+    EXPECT_NEAR(*h[1].amount, 1.27, margin);
+    EXPECT_EQ(h[1].source, Source::HOURLY_TOTAL);
+    EXPECT_NEAR(*h[2].amount, 0.0, margin);
+    EXPECT_FALSE(h[3].amount.has_value());
+}
+
+TEST(PrecipitationSeries, periodTotals) {
+    PrecipitationSeries series;
+    const auto icao = IcaoCode("KLAX");
+    // Hourly totals for hours 95..100 except the missing report of hour 97
+    for (auto hour = 95; hour <= 100; hour++) {
+        if (hour == 97) continue;
+        auto m = makeMetar("KLAX");
+        m.historical.precipitationTotal1h = tenthsMm(10);
+        if (hour == 100) m.historical.precipitationFrozen6h = tenthsMm(80);
+        series.update(m, routine(hour));
+    }
+    const auto h = series.hourly(icao, Kind::PRECIPITATION, 95, 101);
+    EXPECT_NEAR(*h[2].amount, 3.0, margin);
+    EXPECT_EQ(h[2].source, Source::PERIOD_TOTAL);
+    for (auto i : {0, 1, 3, 4, 5}) {
+        EXPECT_NEAR(*h[i].amount, 1.0, margin);
+        EXPECT_EQ(h[i].source, Source::HOURLY_TOTAL);
+    }
+
+    // 24-hour total does not override the share of the 6-hour total; the
+    // remainder is split between the hours with no reports
+    auto m = makeMetar("KLAX");
+    m.historical.precipitationFrozen24h = tenthsMm(260);
+    series.update(m, routine(101));
+    const auto day = series.hourly(icao, Kind::PRECIPITATION, 78, 102);
+    double total = 0.0;
+    for (const auto &a : day) total += a.amount.value_or(0.0);
+    EXPECT_NEAR(total, 26.0, margin);
+    EXPECT_NEAR(*day[97 - 78].amount, 3.0, margin);
+    EXPECT_NEAR(*day[0].amount, 1.0, margin);
+    EXPECT_EQ(day[0].source, Source::PERIOD_TOTAL);
+}
+
+TEST(PrecipitationSeries, hourlyTotalsTakePrecedence) {
+    PrecipitationSeries series;
+    for (auto hour = 98; hour <= 100; hour++) {
+        auto m = makeMetar("KLAX");
+        m.historical.precipitationTotal1h = tenthsMm(10);
+        if (hour == 100) m.historical.precipitationFrozen3h = tenthsMm(50);
+        series.update(m, routine(hour));
+    }
+    const auto h =
+        series.hourly(IcaoCode("KLAX"), Kind::PRECIPITATION, 98, 101);
+    for (const auto &a : h) {
+        EXPECT_NEAR(*a.amount, 1.0, margin);
+        EXPECT_EQ(a.source, Source::HOURLY_TOTAL);
+    }
+}
+
+TEST(PrecipitationSeries, sinceLastReport) {
+    PrecipitationSeries series;
+    auto m = makeMetar("RJTT");
+    series.update(m, 600);
+    m.historical.precipitationSinceLastReport = tenthsMm(10);
+    series.update(m, 630);
+    m.historical.precipitationSinceLastReport = tenthsMm(20);
+    series.update(m, 710);
+    const auto h =
+        series.hourly(IcaoCode("RJTT"), Kind::PRECIPITATION, 10, 12);
+    // Interval 630..710 is split at 650, an hour before its end
+    EXPECT_NEAR(*h[0].amount, 1.0 + 2.0 * 20 / 80, margin);
+    EXPECT_EQ(h[0].source, Source::ACCUMULATED);
+    EXPECT_NEAR(*h[1].amount, 2.0 * 60 / 80, margin);
+
+    // Previous report is too old
+    m.historical.precipitationSinceLastReport = tenthsMm(10);
+    series.update(m, 710 + PrecipitationSeries::maxGapMinutes + 1);
+    const auto later = series.hourly(IcaoCode("RJTT"),
+                                     Kind::PRECIPITATION,
+                                     11,
+                                     18);
+    for (auto i = 1u; i < later.size(); i++)
+        EXPECT_FALSE(later[i].amount.has_value());
+}
+
+TEST(PrecipitationSeries, sinceLastReportAfterHourlyTotal) {
+    PrecipitationSeries series;
+    auto m = makeMetar("KLAX");
+    m.historical.precipitationTotal1h = tenthsMm(10);
+    series.update(m, routine(11));
+    // Amount since the report at 1153 is for the same hour as the 1-hour
+    // total reported at 1253 would be
+    m.historical.precipitationTotal1h = Precipitation();
+    m.historical.precipitationSinceLastReport = tenthsMm(20);
+    series.update(m, routine(12));
+    m.historical.precipitationSinceLastReport = tenthsMm(40);
+    series.update(m, routine(14));
+    const auto h =
+        series.hourly(IcaoCode("KLAX"), Kind::PRECIPITATION, 11, 15);
+    EXPECT_NEAR(*h[0].amount, 1.0, margin);
+    EXPECT_EQ(h[0].source, Source::HOURLY_TOTAL);
+    for (auto i = 1u; i < h.size(); i++) {
+        EXPECT_NEAR(*h[i].amount, 2.0, margin);
+        EXPECT_EQ(h[i].source, Source::ACCUMULATED);
+    }
+}
+
+TEST(PrecipitationSeries, rainfall) {
+    PrecipitationSeries series;
+    auto m = makeMetar("YSSY");
+    m.historical.rainfallSince0900LocalTime = tenthsMm(100);
+    m.historical.rainfall10m = tenthsMm(5);
+    series.update(m, 600);
+    m.historical.rainfallSince0900LocalTime = tenthsMm(130);
+    series.update(m, 630);
+    // Accumulation restarted
+    m.historical.rainfallSince0900LocalTime = tenthsMm(4);
+    series.update(m, 680);
+    const auto h =
+        series.hourly(IcaoCode("YSSY"), Kind::PRECIPITATION, 9, 12);
+    // 10-minute rainfall for 590..600, then the difference for 600..630
+    // and 0.4 mm over 630..680, which are shorter than an hour and go to
+    // the hour of their middle
+    EXPECT_NEAR(*h[0].amount, 0.5, margin);
+    EXPECT_EQ(h[0].source, Source::SAMPLED);
+    EXPECT_NEAR(*h[1].amount, 3.0 + 0.4, margin);
+    EXPECT_EQ(h[1].source, Source::ACCUMULATED);
+    EXPECT_FALSE(h[2].amount.has_value());
+}
+
+TEST(PrecipitationSeries, rainfall10mOnlyCoversPartOfHour) {
+    PrecipitationSeries series;
+    auto m = makeMetar("YSSY");
+    m.historical.rainfall10m = tenthsMm(5);
+    series.update(m, routine(10));
+    m.historical.rainfall10m = Precipitation();
+    m.historical.precipitationFrozen3h = tenthsMm(30);
+    series.update(m, routine(11));
+    // Period total is split evenly, ignoring 10 minutes of rainfall
+    const auto h = series.hourly(IcaoCode("YSSY"), Kind::PRECIPITATION, 9, 12);
+    for (const auto &a : h) {
+        EXPECT_NEAR(*a.amount, 1.0, margin);
+        EXPECT_EQ(a.source, Source::PERIOD_TOTAL);
+    }
+}
+
+TEST(PrecipitationSeries, snowfallAndIcing) {
+    PrecipitationSeries series;
+    auto m = makeMetar("KBOS");
+    m.historical.snowfallIncrease1h = tenthsMm(20);
+    m.historical.icing1h = tenthsMm(1);
+    series.update(m, routine(99));
+    m = makeMetar("KBOS");
+    m.historical.snow6h = tenthsMm(120);
+    m.historical.icing3h = tenthsMm(5);
+    series.update(m, routine(100));
+    const auto snow = series.hourly(IcaoCode("KBOS"), Kind::SNOWFALL, 95, 101);
+    EXPECT_NEAR(*snow[4].amount, 2.0, margin);
+    EXPECT_NEAR(*snow[5].amount, 2.0, margin);
+    EXPECT_EQ(snow[5].source, Source::PERIOD_TOTAL);
+    const auto ice = series.hourly(IcaoCode("KBOS"), Kind::ICING, 98, 101);
+    EXPECT_NEAR(*ice[0].amount, 0.2, margin);
+    EXPECT_NEAR(*ice[1].amount, 0.1, margin);
+    EXPECT_NEAR(*ice[2].amount, 0.2, margin);
+    EXPECT_TRUE(series.hourly(IcaoCode("KBOS"), Kind::PRECIPITATION, 95, 101)
+                    .at(5)
+                    .source == Source::MISSING);
+}
+
+TEST(PrecipitationSeries, expired) {
+    PrecipitationSeries series;
+    auto m = makeMetar("KLAX");
+    m.historical.precipitationTotal1h = tenthsMm(10);
+    series.update(m, routine(100));
+    series.update(m, routine(100 + PrecipitationSeries::hourCount));
+    const auto h = series.hourly(IcaoCode("KLAX"), Kind::PRECIPITATION, 100,
+                                 101);
+    EXPECT_FALSE(h[0].amount.has_value());
+}
+
+TEST(PrecipitationSeries, ignored) {
+    PrecipitationSeries series;
+    auto m = makeMetar("KLAX");
+    m.historical.precipitationTotal1h = tenthsMm(10);
+    EXPECT_TRUE(series.update(m, routine(100)));
+    // Older than the latest report
+    EXPECT_FALSE(series.update(m, routine(99)));
+    auto taf = m;
+    taf.report.type = Report::Type::TAF;
+    EXPECT_FALSE(series.update(taf, routine(101)));
+    EXPECT_FALSE(series.update(makeMetar(""), routine(101)));
+    EXPECT_EQ(series.size(), 1u);
+    series.remove(IcaoCode("KLAX"));
+    EXPECT_EQ(series.size(), 0u);
+}
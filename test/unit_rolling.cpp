@@ -0,0 +1,178 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_rolling.hpp"
+
+using namespace metafsimple;
+
+static const auto margin = 1e-4;
+
+static Simple makeMetar(const std::string &icao, int temperature, int wind) {
+    Simple s;
+    s.station.icaoCode = icao;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    s.current.airTemperature = Temperature{temperature, Temperature::Unit::C};
+    s.current.weatherData.windSpeed = Speed{wind, Speed::Unit::KT};
+    return s;
+}
+
+using Quantity = RollingStats::Quantity;
+using Window = RollingStats::Window;
+static const auto temperature = Quantity::AIR_TEMPERATURE;
+
+TEST(RollingStats, values) {
+    auto s = makeMetar("UKLI", 15, 10);
+    s.current.weatherData.visibility =
+        Distance{Distance::Details::EXACTLY, 3, Distance::Unit::STATUTE_MILES};
+    s.current.weatherData.seaLevelPressure =
+        Pressure{2992, Pressure::Unit::HUNDREDTHS_IN_HG};
+    const auto v = RollingStats::values(s);
+    EXPECT_NEAR(*v[static_cast<int>(Quantity::AIR_TEMPERATURE)], 15, margin);
+    EXPECT_NEAR(*v[static_cast<int>(Quantity::WIND_SPEED)], 10, margin);
+    EXPECT_FALSE(v[static_cast<int>(Quantity::GUST_SPEED)].has_value());
+    EXPECT_NEAR(*v[static_cast<int>(Quantity::VISIBILITY)], 4828.03, 0.01);
+    EXPECT_NEAR(*v[static_cast<int>(Quantity::SEA_LEVEL_PRESSURE)],
+                1013.2,
+                0.1);
+    s.current.weatherData.cavok = true;
+    EXPECT_FALSE(RollingStats::values(s)[static_cast<int>(Quantity::VISIBILITY)]
+                     .has_value());
+}
+
+TEST(RollingStats, windows) {
+    RollingStats stats;
+    // Half-hourly reports over 30 hours, temperature rising 1 degree each
+    for (auto i = 0; i <= 60; i++)
+        stats.update(makeMetar("UKLI", i, 10), 1000 + i * 30);
+    const auto now = 1000 + 60 * 30;
+    const auto icao = IcaoCode("UKLI");
+
+    const auto hour = stats.stats(icao, temperature, Window::HOUR, now);
+    EXPECT_EQ(hour.count, 2u);
+    EXPECT_NEAR(hour.min, 59, margin);
+    EXPECT_NEAR(hour.max, 60, margin);
+    EXPECT_NEAR(hour.mean, 59.5, margin);
+
+    const auto day = stats.stats(icao, temperature, Window::HOURS_24, now);
+    EXPECT_EQ(day.count, 48u);
+    EXPECT_NEAR(day.min, 13, margin);
+    EXPECT_NEAR(day.max, 60, margin);
+    EXPECT_NEAR(day.mean, 36.5, margin);
+
+    const auto wind = stats.stats(icao, Quantity::WIND_SPEED, Window::HOURS_6,
+                                  now);
+    EXPECT_EQ(wind.count, 12u);
+    EXPECT_NEAR(wind.mean, 10, margin);
+
+    // Window in the past
+    const auto earlier =
+        stats.stats(icao, temperature, Window::HOUR, now - 5 * 60);
+    EXPECT_EQ(earlier.count, 2u);
+    EXPECT_NEAR(earlier.max, 50, margin);
+
+    // No reports for more than 24 hours
+    EXPECT_TRUE(stats.stats(icao, temperature, Window::HOURS_24, now + 24 * 60)
+                    .empty());
+    EXPECT_TRUE(stats.stats(icao, Quantity::DEW_POINT, Window::HOURS_24, now)
+                    .empty());
+    EXPECT_TRUE(stats.stats(IcaoCode("UKLL"), temperature, Window::HOUR, now)
+                    .empty());
+}
+
+TEST(RollingStats, sameBucket) {
+    RollingStats stats;
+    stats.update(makeMetar("UKLI", 10, 5), 600);
+    stats.update(makeMetar("UKLI", 12, 5), 605);
+    stats.update(makeMetar("UKLI", 8, 5), 609);
+    const auto s =
+        stats.stats(IcaoCode("UKLI"), temperature, Window::HOUR, 609);
+    EXPECT_EQ(s.count, 3u);
+    EXPECT_NEAR(s.min, 8, margin);
+    EXPECT_NEAR(s.max, 12, margin);
+    EXPECT_NEAR(s.mean, 10, margin);
+}
+
+TEST(RollingStats, outOfOrder) {
+    RollingStats stats;
+    stats.update(makeMetar("UKLI", 20, 5), 3000);
+    // Late report is still added to its bucket
+    stats.update(makeMetar("UKLI", 10, 5), 2950);
+    // Report older than 24 hours is dropped
+    stats.update(makeMetar("UKLI", -10, 5), 3000 - 24 * 60);
+    const auto s =
+        stats.stats(IcaoCode("UKLI"), temperature, Window::HOURS_24, 3000);
+    EXPECT_EQ(s.count, 2u);
+    EXPECT_NEAR(s.min, 10, margin);
+}
+
+TEST(RollingStats, historical) {
+    RollingStats stats;
+    stats.update(makeMetar("UKLI", 10, 5), 6000);
+    auto m = makeMetar("UKLI", 12, 5);
+    m.historical.temperatureMin6h = Temperature{4, Temperature::Unit::C};
+    m.historical.temperatureMax24h = Temperature{25, Temperature::Unit::C};
+    m.historical.peakWindSpeed = Speed{40, Speed::Unit::KT};
+    stats.update(m, 6060);
+    const auto icao = IcaoCode("UKLI");
+
+    const auto hour = stats.stats(icao, temperature, Window::HOUR, 6060);
+    EXPECT_NEAR(hour.min, 12, margin);
+    EXPECT_NEAR(hour.max, 12, margin);
+    const auto six = stats.stats(icao, temperature, Window::HOURS_6, 6060);
+    EXPECT_EQ(six.count, 2u);
+    EXPECT_NEAR(six.min, 4, margin);
+    EXPECT_NEAR(six.max, 12, margin);
+    EXPECT_NEAR(six.mean, 11, margin);
+    const auto day = stats.stats(icao, temperature, Window::HOURS_24, 6060);
+    EXPECT_NEAR(day.min, 4, margin);
+    EXPECT_NEAR(day.max, 25, margin);
+    const auto wind = stats.stats(icao, Quantity::WIND_SPEED, Window::HOUR,
+                                  6060);
+    EXPECT_NEAR(wind.max, 40, margin);
+    EXPECT_NEAR(wind.mean, 5, margin);
+}
+
+TEST(RollingStats, historicalExtremesAreKept) {
+    RollingStats stats;
+    const auto icao = IcaoCode("UKLI");
+    auto m = makeMetar("UKLI", 12, 5);
+    m.historical.temperatureMax6h = Temperature{20, Temperature::Unit::C};
+    m.historical.peakWindSpeed = Speed{40, Speed::Unit::KT};
+    stats.update(m, 6000);
+    m.historical.peakWindSpeed = Speed{30, Speed::Unit::KT};
+    stats.update(m, 6005);
+    // Later report with lower extreme does not hide the earlier one
+    m.historical.temperatureMax6h = Temperature{15, Temperature::Unit::C};
+    m.historical.peakWindSpeed = Speed{25, Speed::Unit::KT};
+    stats.update(m, 6120);
+
+    const auto six = stats.stats(icao, temperature, Window::HOURS_6, 6120);
+    EXPECT_NEAR(six.max, 20, margin);
+    const auto wind = Quantity::WIND_SPEED;
+    EXPECT_NEAR(stats.stats(icao, wind, Window::HOURS_6, 6120).max,
+                40,
+                margin);
+    // Earlier extremes are outside of the window
+    EXPECT_NEAR(stats.stats(icao, wind, Window::HOUR, 6120).max, 25, margin);
+}
+
+TEST(RollingStats, ignored) {
+    RollingStats stats;
+    auto taf = makeMetar("UKLI", 10, 5);
+    taf.report.type = Report::Type::TAF;
+    EXPECT_FALSE(stats.update(taf, 100));
+    EXPECT_FALSE(stats.update(makeMetar("", 10, 5), 100));
+    EXPECT_FALSE(stats.update(makeMetar("UKLI", 10, 5), -1));
+    EXPECT_EQ(stats.size(), 0u);
+    EXPECT_TRUE(stats.update(makeMetar("UKLI", 10, 5), 100));
+    stats.remove(IcaoCode("UKLI"));
+    EXPECT_EQ(stats.size(), 0u);
+}
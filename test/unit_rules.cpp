@@ -0,0 +1,222 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_rules.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+// UKLI 081800Z 24035G45KT 3000 -RA BR VV004 12/10 Q1012
+static Simple makeMetar(const std::string &icao) {
+    Simple s;
+    s.station.icaoCode = icao;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    auto &e = s.current.weatherData;
+    e.windDirectionDegrees = 240;
+    e.windSpeed = Speed{35, Speed::Unit::KT};
+    e.gustSpeed = Speed{45, Speed::Unit::KT};
+    e.visibility =
+        Distance{Distance::Details::EXACTLY, 3000, Distance::Unit::METERS};
+    e.skyCondition = Essentials::SkyCondition::OBSCURED;
+    e.verticalVisibility = Height{400, Height::Unit::FEET};
+    e.weather.push_back(Weather{Weather::Phenomena::PRECIPITATION_LIGHT,
+                                {Weather::Precipitation::RAIN}});
+    e.weather.push_back(Weather{Weather::Phenomena::MIST, {}});
+    e.seaLevelPressure = Pressure{1012, Pressure::Unit::HPA};
+    s.current.airTemperature = Temperature{12, Temperature::Unit::C};
+    s.current.dewPoint = Temperature{10, Temperature::Unit::C};
+    return s;
+}
+
+static bool check(const std::string &rule, const Simple &report) {
+    RuleEngine engine;
+    std::string error;
+    const auto id = engine.add(rule, &error);
+    EXPECT_TRUE(id.has_value()) << rule << ": " << error;
+    if (!id.has_value()) return false;
+    RuleValues values;
+    extractRuleValues(report, values);
+    return engine.evaluate(*id, values);
+}
+
+TEST(RuleEngine, comparisons) {
+    const auto m = makeMetar("UKLI");
+    EXPECT_TRUE(check("current.weatherData.windSpeed > 30 KT", m));
+    EXPECT_TRUE(check("windSpeed > 30", m));
+    EXPECT_FALSE(check("windSpeed > 20 MPS", m));
+    EXPECT_TRUE(check("windSpeed >= 17 MPS", m));
+    EXPECT_TRUE(check("gustSpeed == 45", m));
+    EXPECT_TRUE(check("visibility < 2 SM", m));
+    EXPECT_FALSE(check("visibility <= 1 SM", m));
+    EXPECT_TRUE(check("ceilingHeight < 150 M", m));
+    EXPECT_TRUE(check("airTemperature > 50 F", m));
+    EXPECT_TRUE(check("airTemperature > -5.5 C", m));
+    EXPECT_TRUE(check("airTemperature < +12.5", m));
+    EXPECT_TRUE(check("gustSpeed < 45.5" + std::string(400, '0'), m));
+    EXPECT_TRUE(check("seaLevelPressure < 29.92 INHG", m));
+    EXPECT_TRUE(check("skyCondition == OBSCURED", m));
+    EXPECT_TRUE(check("type != TAF", m));
+    EXPECT_TRUE(check("cavok == FALSE", m));
+    EXPECT_TRUE(check("weather == MIST", m));
+    EXPECT_TRUE(check("weather != FOG", m));
+    EXPECT_FALSE(check("weather == FOG", m));
+}
+
+TEST(RuleEngine, logic) {
+    const auto m = makeMetar("UKLI");
+    EXPECT_TRUE(check("windSpeed > 30 KT AND skyCondition == OBSCURED", m));
+    EXPECT_FALSE(check("windSpeed > 40 KT AND skyCondition == OBSCURED", m));
+    EXPECT_TRUE(check("windSpeed > 40 KT OR skyCondition == OBSCURED", m));
+    EXPECT_FALSE(check("NOT skyCondition == OBSCURED", m));
+    EXPECT_TRUE(check("NOT NOT skyCondition == OBSCURED", m));
+    EXPECT_TRUE(check("weather == FOG OR weather == MIST AND cavok == FALSE",
+                      m));
+    EXPECT_FALSE(check("(weather == FOG OR weather == MIST) AND cavok == TRUE",
+                       m));
+    EXPECT_TRUE(
+        check("((windSpeed<10) OR (dewPoint>=10 AND (gustSpeed>40)))", m));
+}
+
+TEST(RuleEngine, missingValues) {
+    auto m = makeMetar("UKLI");
+    m.current.relativeHumidity = std::optional<int>();
+    EXPECT_FALSE(check("relativeHumidity < 100", m));
+    EXPECT_FALSE(check("relativeHumidity != 100", m));
+    EXPECT_TRUE(check("NOT relativeHumidity >= 0", m));
+}
+
+TEST(RuleEngine, errors) {
+    RuleEngine engine;
+    std::string error;
+    EXPECT_FALSE(engine.add("", &error).has_value());
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(engine.add("pressure > 1000", &error).has_value());
+    EXPECT_NE(error.find("Unknown field"), std::string::npos);
+    EXPECT_FALSE(engine.add("windSpeed > 10 FT", &error).has_value());
+    EXPECT_NE(error.find("Unknown unit"), std::string::npos);
+    EXPECT_FALSE(engine.add("windSpeed => 10", &error).has_value());
+    EXPECT_FALSE(engine.add("skyCondition == FOG", &error).has_value());
+    EXPECT_FALSE(engine.add("skyCondition < CLOUDS", &error).has_value());
+    EXPECT_FALSE(engine.add("(windSpeed > 10", &error).has_value());
+    EXPECT_FALSE(engine.add("windSpeed > 10 windSpeed", &error).has_value());
+    EXPECT_FALSE(engine.add("windSpeed > KT", &error).has_value());
+    // Only finite decimal numbers are accepted
+    EXPECT_FALSE(engine.add("windSpeed > inf", &error).has_value());
+    EXPECT_NE(error.find("Expected number"), std::string::npos);
+    EXPECT_FALSE(engine.add("windSpeed > nan", &error).has_value());
+    EXPECT_FALSE(engine.add("windSpeed > 1e3", &error).has_value());
+    EXPECT_FALSE(engine.add("windSpeed > -", &error).has_value());
+    EXPECT_FALSE(
+        engine.add("windSpeed > " + std::string(400, '9'), &error).has_value());
+    EXPECT_EQ(engine.size(), 0u);
+    EXPECT_TRUE(engine.add("windSpeed > 10").has_value());
+    EXPECT_EQ(engine.size(), 1u);
+}
+
+TEST(RuleEngine, tooComplex) {
+    std::string rule = "windSpeed > 10";
+    for (auto i = 0; i < 70; i++) rule = "(" + rule + " OR windSpeed > 10)";
+    RuleEngine engine;
+    EXPECT_TRUE(engine.add(rule).has_value());
+    // Right-nested expression needs evaluation stack deeper than 64
+    rule = "windSpeed > 10";
+    for (auto i = 0; i < 70; i++) rule = "windSpeed > 10 OR (" + rule + ")";
+    std::string error;
+    EXPECT_FALSE(engine.add(rule, &error).has_value());
+    EXPECT_NE(error.find("too complex"), std::string::npos);
+}
+
+TEST(RuleEngine, fields) {
+    RuleEngine engine;
+    const auto id = engine.add("windSpeed > 30 AND NOT weather == FOG");
+    ASSERT_TRUE(id.has_value());
+    const auto expected =
+        (1u << static_cast<int>(RuleField::WIND_SPEED)) |
+        (1u << static_cast<int>(RuleField::WEATHER));
+    EXPECT_EQ(engine.fields(*id), expected);
+}
+
+struct Change {
+    IcaoCode icao;
+    std::size_t rule;
+    bool state;
+};
+
+TEST(RuleEngine, update) {
+    RuleEngine engine;
+    const auto wind = *engine.add("windSpeed > 30 KT");
+    const auto fog = *engine.add("weather == FOG");
+    std::vector<Change> changes;
+    const auto record = [&](IcaoCode icao, std::size_t rule, bool state) {
+        changes.push_back(Change{icao, rule, state});
+    };
+
+    auto m = makeMetar("UKLI");
+    engine.update(m, record);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].icao, IcaoCode("UKLI"));
+    EXPECT_EQ(changes[0].rule, wind);
+    EXPECT_TRUE(changes[0].state);
+    EXPECT_TRUE(engine.state(IcaoCode("UKLI"), wind));
+    EXPECT_FALSE(engine.state(IcaoCode("UKLI"), fog));
+
+    // Same report, nothing changed
+    changes.clear();
+    engine.update(m, record);
+    EXPECT_TRUE(changes.empty());
+
+    m.current.weatherData.windSpeed = Speed{10, Speed::Unit::KT};
+    m.current.weatherData.weather.push_back(
+        Weather{Weather::Phenomena::FOG, {}});
+    engine.update(m, record);
+    ASSERT_EQ(changes.size(), 2u);
+    EXPECT_EQ(changes[0].rule, wind);
+    EXPECT_FALSE(changes[0].state);
+    EXPECT_EQ(changes[1].rule, fog);
+    EXPECT_TRUE(changes[1].state);
+
+    // Other station has its own state
+    changes.clear();
+    engine.update(makeMetar("UKLL"), record);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].icao, IcaoCode("UKLL"));
+    EXPECT_FALSE(engine.state(IcaoCode("UKLL"), fog));
+    EXPECT_TRUE(engine.state(IcaoCode("UKLI"), fog));
+
+    // Rule added later is evaluated with the next report
+    changes.clear();
+    const auto mist = *engine.add("weather == MIST");
+    engine.update(m, record);
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].rule, mist);
+    EXPECT_TRUE(changes[0].state);
+}
+
+TEST(RuleEngine, manyRules) {
+    RuleEngine engine;
+    for (auto i = 0; i < 1000; i++)
+        engine.add("windSpeed > " + std::to_string(i));
+    auto m = makeMetar("UKLI");
+    std::size_t active = 0;
+    const auto count = [&](IcaoCode, std::size_t, bool state) {
+        active += state ? 1 : -1;
+    };
+    engine.update(m, count);
+    EXPECT_EQ(active, 35u);
+    m.current.weatherData.windSpeed = Speed{100, Speed::Unit::KT};
+    engine.update(m, count);
+    EXPECT_EQ(active, 100u);
+    EXPECT_TRUE(engine.state(IcaoCode("UKLI"), 99));
+    EXPECT_FALSE(engine.state(IcaoCode("UKLI"), 100));
+}
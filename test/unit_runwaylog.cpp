@@ -0,0 +1,168 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_runwaylog.hpp"
+
+using namespace metafsimple;
+
+static const auto rwy27L = Runway{27, Runway::Designator::LEFT};
+static const auto rwy09R = Runway{9, Runway::Designator::RIGHT};
+static const auto hour = std::int64_t(3600);
+
+static Simple metar(const std::string &icao) {
+    Simple result;
+    result.report.type = Report::Type::METAR;
+    result.report.error = Report::Error::NO_ERROR;
+    result.station.icaoCode = icao;
+    return result;
+}
+
+static Aerodrome::RunwayData runwayState(Runway runway,
+                                         std::optional<int> coefficient) {
+    Aerodrome::RunwayData rd;
+    rd.runway = runway;
+    rd.deposits = Aerodrome::RunwayDeposits::WET_SNOW;
+    rd.contaminationExtent =
+        Aerodrome::RunwayContamExtent::FROM_26_TO_50_PERCENT;
+    rd.depositDepth = Precipitation{3, Precipitation::Unit::MM};
+    rd.coefficient = coefficient;
+    return rd;
+}
+
+TEST(RunwayConditionLog, record) {
+    auto rd = runwayState(rwy27L, 28);
+    rd.snoclo = true;
+    rd.visualRange.prevailing =
+        Distance{Distance::Details::MORE_THAN, 1500, Distance::Unit::METERS};
+    rd.visualRangeTrend = Aerodrome::RvrTrend::UPWARD;
+    const auto r = runwayConditionRecord(rd, 1000);
+    EXPECT_EQ(r.time, 1000);
+    EXPECT_EQ(r.depositDepthTenthsMm, 30);
+    EXPECT_EQ(r.coefficient, 28);
+    EXPECT_EQ(r.braking(), Aerodrome::BrakingAction::MEDIUM_POOR);
+    EXPECT_EQ(r.runwayDeposits(), Aerodrome::RunwayDeposits::WET_SNOW);
+    EXPECT_EQ(r.extent(),
+              Aerodrome::RunwayContamExtent::FROM_26_TO_50_PERCENT);
+    EXPECT_EQ(r.rvrMeters, 1500);
+    EXPECT_EQ(r.rvrMinMeters, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(r.visualRangeTrend(), Aerodrome::RvrTrend::UPWARD);
+    EXPECT_EQ(r.flags,
+              RunwayConditionRecord::SNOCLO |
+                  RunwayConditionRecord::RVR_MORE_THAN);
+
+    const auto empty = runwayConditionRecord(Aerodrome::RunwayData(), 0);
+    EXPECT_EQ(empty.coefficient, -1);
+    EXPECT_EQ(empty.depositDepthTenthsMm, METAFSIMPLE_NO_VALUE);
+    EXPECT_EQ(empty.braking(), Aerodrome::BrakingAction::UNKNOWN);
+    EXPECT_EQ(empty.flags, 0);
+}
+
+TEST(RunwayConditionLog, series) {
+    RunwayConditionLog log;
+    for (auto i = 0; i < 10; i++) {
+        auto report = metar("UUEE");
+        report.aerodrome.runways.push_back(runwayState(rwy27L, 20 + i * 2));
+        if (i % 2) report.aerodrome.runways.push_back(runwayState(rwy09R, 50));
+        EXPECT_EQ(log.update(report, i * hour), i % 2 ? 2u : 1u);
+    }
+    EXPECT_EQ(log.size(), 2u);
+
+    const auto icao = IcaoCode("UUEE");
+    // Last 4 hours
+    const auto range = log.records(icao, rwy27L, 6 * hour, 10 * hour);
+    ASSERT_EQ(range.size(), 4u);
+    EXPECT_EQ(range.begin()->time, 6 * hour);
+    EXPECT_EQ(range.begin()->coefficient, 32);
+    EXPECT_EQ((range.end() - 1)->time, 9 * hour);
+    for (const auto &r : range)
+        EXPECT_NE(r.braking(), Aerodrome::BrakingAction::UNKNOWN);
+
+    EXPECT_EQ(log.records(icao, rwy09R, 0, 10 * hour).size(), 5u);
+    EXPECT_TRUE(log.records(icao, rwy27L, 20 * hour, 30 * hour).empty());
+    EXPECT_TRUE(log.records(icao, rwy27L, 5 * hour, 5 * hour).empty());
+    EXPECT_TRUE(log.records(IcaoCode("UUDD"), rwy27L, 0, hour).empty());
+
+    const auto runways = log.runways(icao);
+    ASSERT_EQ(runways.size(), 2u);
+    EXPECT_EQ(runways[0].number, 27);
+    EXPECT_EQ(runways[1].number, 9);
+}
+
+TEST(RunwayConditionLog, order) {
+    RunwayConditionLog log;
+    const auto icao = IcaoCode("ESSA");
+    auto report = metar("ESSA");
+    report.aerodrome.runways.push_back(runwayState(rwy27L, 40));
+    EXPECT_EQ(log.update(report, 2 * hour), 1u);
+    // Older report is not used
+    report.aerodrome.runways.back().coefficient = 10;
+    EXPECT_EQ(log.update(report, hour), 0u);
+    EXPECT_EQ(log.latest(icao, rwy27L)->coefficient, 40);
+    // Report with the same time replaces the record
+    report.aerodrome.runways.back().coefficient = 35;
+    EXPECT_EQ(log.update(report, 2 * hour), 1u);
+    EXPECT_EQ(log.records(icao, rwy27L, 0, 3 * hour).size(), 1u);
+    EXPECT_EQ(log.latest(icao, rwy27L)->coefficient, 35);
+    EXPECT_EQ(log.latest(icao, rwy09R), nullptr);
+}
+
+TEST(RunwayConditionLog, aerodromeSnoclo) {
+    RunwayConditionLog log;
+    const auto icao = IcaoCode("ENGM");
+    auto report = metar("ENGM");
+    report.aerodrome.runways.push_back(runwayState(rwy27L, 40));
+    report.aerodrome.runways.push_back(runwayState(rwy09R, 45));
+    log.update(report, 0);
+
+    auto closed = metar("ENGM");
+    closed.aerodrome.snoclo = true;
+    closed.aerodrome.runways.push_back(runwayState(rwy27L, 25));
+    EXPECT_EQ(log.update(closed, hour), 2u);
+    const auto *r27 = log.latest(icao, rwy27L);
+    const auto *r09 = log.latest(icao, rwy09R);
+    EXPECT_EQ(r27->time, hour);
+    EXPECT_EQ(r27->coefficient, 25);
+    EXPECT_TRUE(r27->flags & RunwayConditionRecord::AERODROME_SNOCLO);
+    EXPECT_EQ(r09->time, hour);
+    EXPECT_EQ(r09->coefficient, 45);
+    EXPECT_TRUE(r09->flags & RunwayConditionRecord::AERODROME_SNOCLO);
+}
+
+TEST(RunwayConditionLog, notUsed) {
+    RunwayConditionLog log;
+    auto taf = metar("ZZZZ");
+    taf.report.type = Report::Type::TAF;
+    taf.aerodrome.runways.push_back(runwayState(rwy27L, 40));
+    EXPECT_EQ(log.update(taf, 0), 0u);
+    auto error = metar("ZZZZ");
+    error.report.error = Report::Error::UNEXPECTED_REPORT_END;
+    error.aerodrome.runways.push_back(runwayState(rwy27L, 40));
+    EXPECT_EQ(log.update(error, 0), 0u);
+    EXPECT_EQ(log.size(), 0u);
+}
+
+TEST(RunwayConditionLog, expire) {
+    RunwayConditionLog log;
+    const auto icao = IcaoCode("UUEE");
+    for (auto i = 0; i < 5; i++) {
+        auto report = metar("UUEE");
+        report.aerodrome.runways.push_back(runwayState(rwy27L, 40));
+        if (!i) report.aerodrome.runways.push_back(runwayState(rwy09R, 40));
+        log.update(report, i * hour);
+    }
+    log.expire(3 * hour);
+    EXPECT_EQ(log.records(icao, rwy27L, 0, 10 * hour).size(), 2u);
+    EXPECT_EQ(log.latest(icao, rwy09R), nullptr);
+    EXPECT_EQ(log.size(), 1u);
+    EXPECT_EQ(log.runways(icao).size(), 1u);
+    log.expire(10 * hour);
+    EXPECT_EQ(log.size(), 0u);
+    EXPECT_TRUE(log.runways(icao).empty());
+}
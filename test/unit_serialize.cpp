@@ -0,0 +1,240 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_serialize.hpp"
+
+using namespace metafsimple;
+
+class Serialize : public ::testing::Test {
+   protected:
+    Serialize() {
+        auto &r = simple.report;
+        r.type = Report::Type::TAF;
+        r.amended = true;
+        r.correctionNumber = 2;
+        r.reportTime = Time{8, 20, 48};
+        r.applicableFrom = Time{8, 21, std::optional<int>()};
+        r.applicableUntil = Time{9, 18, std::optional<int>()};
+        r.error = Report::Error::NO_ERROR;
+        r.warnings.push_back(Report::Warning{
+            Report::Warning::Message::DUPLICATED_DATA, "FM090300"});
+        r.plainText.push_back("TEST ONLY");
+
+        auto &s = simple.station;
+        s.icaoCode = "CYGL";
+        s.autoType = Station::AutoType::AO2;
+        s.missingData.insert(Station::MissingData::RVR_MISG);
+        s.runwaysNoVisData.insert(Runway{27, Runway::Designator::LEFT});
+        s.directionsNoCeilingData.insert(CardinalDirection::NE);
+
+        auto &a = simple.aerodrome;
+        Aerodrome::RunwayData rd;
+        rd.runway = Runway{9, Runway::Designator::NONE};
+        rd.deposits = Aerodrome::RunwayDeposits::WET_AND_WATER_PATCHES;
+        rd.coefficient = 45;
+        rd.visualRange.prevailing =
+            Distance{Distance::Details::MORE_THAN, 1500,
+                     Distance::Unit::METERS};
+        a.runways.push_back(rd);
+        a.colourCode = Aerodrome::ColourCode::AMBER;
+
+        auto &c = simple.current;
+        c.weatherData.windDirectionDegrees = 240;
+        c.weatherData.windSpeed = Speed{10, Speed::Unit::KT};
+        c.weatherData.gustSpeed = Speed{20, Speed::Unit::KT};
+        c.weatherData.visibility = Distance{
+            Distance::Details::EXACTLY, 6, Distance::Unit::STATUTE_MILES};
+        c.weatherData.skyCondition = Essentials::SkyCondition::CLOUDS;
+        c.weatherData.cloudLayers.push_back(
+            CloudLayer{CloudLayer::Amount::FEW,
+                       Height{1500, Height::Unit::FEET},
+                       CloudLayer::Details::TOWERING_CUMULUS,
+                       std::optional<int>()});
+        c.weatherData.weather.push_back(
+            Weather{Weather::Phenomena::SHOWERY_PRECIPITATION_LIGHT,
+                    {Weather::Precipitation::RAIN,
+                     Weather::Precipitation::SNOW}});
+        c.weatherData.windShear.push_back(WindShear{
+            Height{2000, Height::Unit::FEET}, 310, Speed{45, Speed::Unit::KT}});
+        c.airTemperature = Temperature{-15, Temperature::Unit::C};
+        c.dewPoint = Temperature{-171, Temperature::Unit::TENTH_C};
+        c.relativeHumidity = 82;
+        c.lightningStrikes.push_back(LightningStrikes{
+            LightningStrikes::Frequency::FREQUENT,
+            {LightningStrikes::Type::IN_CLOUD,
+             LightningStrikes::Type::CLOUD_GROUND},
+            DistanceRange(),
+            {CardinalDirection::SW, CardinalDirection::W}});
+
+        auto &h = simple.historical;
+        h.peakWindDirectionDegrees = 250;
+        h.peakWindSpeed = Speed{32, Speed::Unit::KT};
+        h.peakWindObserved = Time{std::optional<int>(), 15, 45};
+        h.recentWeather.push_back(Historical::WeatherEvent{
+            Historical::Event::ENDED,
+            Weather{Weather::Phenomena::THUNDERSTORM, {}},
+            Time{std::optional<int>(), 16, 10}});
+        h.precipitationTotal1h =
+            Precipitation{12, Precipitation::Unit::HUNDREDTHS_IN};
+
+        c.weatherData.summary = c.weatherData.computeSummary();
+
+        auto &f = simple.forecast;
+        f.prevailing = c.weatherData;
+        f.prevailingIcing.push_back(
+            IcingForecast{IcingForecast::Severity::LIGHT,
+                          IcingForecast::Type::RIME_IN_CLOUD,
+                          Height{3000, Height::Unit::FEET},
+                          Height{6000, Height::Unit::FEET}});
+        Trend t;
+        t.type = Trend::Type::TIMED;
+        t.probability = 30;
+        t.timeFrom = Time{8, 22, std::optional<int>()};
+        t.timeUntil = Time{9, 2, std::optional<int>()};
+        t.forecast.visibility =
+            Distance{Distance::Details::LESS_THAN, 800, Distance::Unit::METERS};
+        t.vicinity.insert(ObservedPhenomena::FOG);
+        f.trends.push_back(t);
+        f.maxTemperature.push_back(TemperatureForecast{
+            Temperature{-2, Temperature::Unit::C}, Time{9, 15, 0}});
+    }
+
+    Simple simple;
+};
+
+TEST_F(Serialize, roundtrip) {
+    const auto data = serialize(simple);
+    const auto result = deserialize(data);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, simple);
+    // Summary is not compared by equality operator
+    EXPECT_EQ(result->current.weatherData.summary,
+              simple.current.weatherData.summary);
+    EXPECT_NE(result->current.weatherData.summary, 0u);
+}
+
+TEST_F(Serialize, roundtripEmpty) {
+    const auto result = deserialize(serialize(Simple()));
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(*result, Simple());
+}
+
+TEST_F(Serialize, append) {
+    std::string data = "prefix";
+    serialize(simple, data);
+    EXPECT_EQ(data.substr(0, 6), "prefix");
+    EXPECT_EQ(data.substr(6), serialize(simple));
+}
+
+TEST_F(Serialize, truncated) {
+    const auto data = serialize(simple);
+    for (auto i = 0u; i < data.length(); i++)
+        EXPECT_FALSE(deserialize(std::string_view(data.data(), i)).has_value());
+}
+
+TEST_F(Serialize, trailingData) {
+    EXPECT_FALSE(deserialize(serialize(simple) + '\0').has_value());
+}
+
+TEST_F(Serialize, version) {
+    auto data = serialize(simple);
+    ASSERT_EQ(data[0], static_cast<char>(serializationVersion));
+    data[0]++;
+    EXPECT_FALSE(deserialize(data).has_value());
+}
+
+TEST(Encoder, varint) {
+    std::string data;
+    Encoder e(data);
+    e.writeUnsigned(0);
+    e.writeUnsigned(127);
+    e.writeUnsigned(128);
+    e.writeUnsigned(UINT64_MAX);
+    EXPECT_EQ(data.length(), 1u + 1u + 2u + 10u);
+    Decoder d(data);
+    EXPECT_EQ(d.readUnsigned(), 0u);
+    EXPECT_EQ(d.readUnsigned(), 127u);
+    EXPECT_EQ(d.readUnsigned(), 128u);
+    EXPECT_EQ(d.readUnsigned(), UINT64_MAX);
+    EXPECT_TRUE(d.finished());
+    d.readUnsigned();
+    EXPECT_TRUE(d.failed());
+}
+
+TEST(Encoder, values) {
+    std::string data;
+    Encoder e(data);
+    const int i1 = -1, i2 = INT32_MAX, i3 = INT32_MIN;
+    const std::optional<int> o1, o2(-300);
+    const std::string s = "TEST";
+    const std::vector<int> v = {1, -2, 3};
+    e(i1, i2, i3, o1, o2, s, v, Report::Type::SPECI);
+    EXPECT_EQ(data.front(), 1);  // zigzag(-1)
+
+    Decoder d(data);
+    int r1 = 0, r2 = 0, r3 = 0;
+    std::optional<int> ro1(5), ro2;
+    std::string rs;
+    std::vector<int> rv;
+    Report::Type rt = Report::Type::ERROR;
+    d(r1, r2, r3, ro1, ro2, rs, rv, rt);
+    EXPECT_TRUE(d.finished());
+    EXPECT_EQ(r1, i1);
+    EXPECT_EQ(r2, i2);
+    EXPECT_EQ(r3, i3);
+    EXPECT_EQ(ro1, o1);
+    EXPECT_EQ(ro2, o2);
+    EXPECT_EQ(rs, s);
+    EXPECT_EQ(rv, v);
+    EXPECT_EQ(rt, Report::Type::SPECI);
+}
+
+TEST(Decoder, hugeCount) {
+    std::string data;
+    Encoder(data).writeUnsigned(1000000);
+    std::vector<int> v;
+    Decoder d(data);
+    d(v);
+    EXPECT_TRUE(d.failed());
+    EXPECT_TRUE(v.empty());
+}
+
+TEST(Decoder, enumOutOfRange) {
+    std::string data;
+    Encoder e(data);
+    e.writeUnsigned(3);
+    e.writeUnsigned(4);
+    Report::Type rt = Report::Type::ERROR;
+    Decoder d(data);
+    d(rt);
+    EXPECT_EQ(rt, Report::Type::TAF);
+    d(rt);
+    EXPECT_TRUE(d.failed());
+    EXPECT_EQ(rt, Report::Type::TAF);
+
+    // Weather phenomena are used as shift count in flat records
+    data.clear();
+    Encoder(data).writeUnsigned(64);
+    auto phenomena = Weather::Phenomena::UNKNOWN;
+    Decoder dw(data);
+    dw(phenomena);
+    EXPECT_TRUE(dw.failed());
+    EXPECT_EQ(phenomena, Weather::Phenomena::UNKNOWN);
+}
+
+TEST(Crc32, values) {
+    EXPECT_EQ(crc32(""), 0u);
+    EXPECT_EQ(crc32("123456789"), 0xCBF43926u);
+    EXPECT_EQ(crc32("The quick brown fox jumps over the lazy dog"),
+              0x414FA339u);
+    // Calculation continued over parts gives the same result
+    EXPECT_EQ(crc32("6789", crc32("12345")), 0xCBF43926u);
+}
@@ -0,0 +1,187 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_shm.hpp"
+
+using namespace metafsimple;
+
+class StationState : public ::testing::Test {
+   protected:
+    StationState() : name("/metafsimple_test_" + std::to_string(getpid())) {}
+    ~StationState() { StationStatePublisher::remove(name); }
+
+    static metafsimple_record makeRecord(const char *icao, int32_t value) {
+        metafsimple_record r;
+        std::memset(&r, 0, sizeof(r));
+        std::strncpy(r.icao, icao, sizeof(r.icao) - 1);
+        r.report_day = value;
+        r.report_hour = value;
+        r.temperature_tenth_c = value;
+        r.reserved[3] = value;
+        return r;
+    }
+
+    const std::string name;
+};
+
+TEST_F(StationState, publishAndRead) {
+    StationStatePublisher publisher;
+    ASSERT_TRUE(publisher.open(name, 16));
+    EXPECT_TRUE(publisher.publish(IcaoCode("UKLI"), makeRecord("UKLI", 1)));
+    EXPECT_TRUE(publisher.publish(IcaoCode("SCCH"), makeRecord("SCCH", 2)));
+
+    StationStateReader reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(reader.capacity(), 16u);
+    metafsimple_record r;
+    ASSERT_TRUE(reader.read(IcaoCode("UKLI"), r));
+    EXPECT_STREQ(r.icao, "UKLI");
+    EXPECT_EQ(r.temperature_tenth_c, 1);
+    ASSERT_TRUE(reader.read(IcaoCode("SCCH"), r));
+    EXPECT_STREQ(r.icao, "SCCH");
+    EXPECT_EQ(r.temperature_tenth_c, 2);
+    EXPECT_FALSE(reader.read(IcaoCode("ZZZZ"), r));
+    EXPECT_FALSE(reader.read(IcaoCode(), r));
+
+    EXPECT_TRUE(publisher.publish(IcaoCode("UKLI"), makeRecord("UKLI", 3)));
+    ASSERT_TRUE(reader.read(IcaoCode("UKLI"), r));
+    EXPECT_EQ(r.temperature_tenth_c, 3);
+}
+
+TEST_F(StationState, publishSimple) {
+    StationStatePublisher publisher;
+    ASSERT_TRUE(publisher.open(name, 4));
+    Simple s;
+    s.station.icaoCode = "EGLL";
+    s.report.type = Report::Type::METAR;
+    s.current.airTemperature = Temperature{12, Temperature::Unit::C};
+    EXPECT_TRUE(publisher.publish(s));
+    s.station.icaoCode = "";
+    EXPECT_FALSE(publisher.publish(s));
+
+    StationStateReader reader;
+    ASSERT_TRUE(reader.open(name));
+    metafsimple_record r;
+    ASSERT_TRUE(reader.read(IcaoCode("EGLL"), r));
+    EXPECT_EQ(r.report_type, METAFSIMPLE_REPORT_METAR);
+    EXPECT_EQ(r.temperature_tenth_c, 120);
+}
+
+TEST_F(StationState, tableFull) {
+    StationStatePublisher publisher;
+    ASSERT_TRUE(publisher.open(name, 2));
+    EXPECT_TRUE(publisher.publish(IcaoCode("AAAA"), makeRecord("AAAA", 1)));
+    EXPECT_TRUE(publisher.publish(IcaoCode("BBBB"), makeRecord("BBBB", 2)));
+    EXPECT_FALSE(publisher.publish(IcaoCode("CCCC"), makeRecord("CCCC", 3)));
+    EXPECT_TRUE(publisher.publish(IcaoCode("AAAA"), makeRecord("AAAA", 4)));
+
+    StationStateReader reader;
+    ASSERT_TRUE(reader.open(name));
+    metafsimple_record r;
+    EXPECT_TRUE(reader.read(IcaoCode("AAAA"), r));
+    EXPECT_EQ(r.temperature_tenth_c, 4);
+    EXPECT_TRUE(reader.read(IcaoCode("BBBB"), r));
+    EXPECT_FALSE(reader.read(IcaoCode("CCCC"), r));
+}
+
+TEST_F(StationState, openMissing) {
+    StationStateReader reader;
+    EXPECT_FALSE(reader.open(name));
+    EXPECT_FALSE(reader.isOpen());
+    metafsimple_record r;
+    EXPECT_FALSE(reader.read(IcaoCode("UKLI"), r));
+}
+
+TEST_F(StationState, concurrentReadsAreConsistent) {
+    StationStatePublisher publisher;
+    ASSERT_TRUE(publisher.open(name, 8));
+    ASSERT_TRUE(publisher.publish(IcaoCode("UKLI"), makeRecord("UKLI", 0)));
+    StationStateReader reader;
+    ASSERT_TRUE(reader.open(name));
+
+    static const int updates = 100000;
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (auto i = 1; i <= updates; i++)
+            publisher.publish(IcaoCode("UKLI"), makeRecord("UKLI", i));
+        done = true;
+    });
+    int inconsistent = 0, last = 0, backwards = 0;
+    metafsimple_record r;
+    while (!done) {
+        if (!reader.read(IcaoCode("UKLI"), r)) continue;
+        const auto v = r.report_day;
+        if (r.report_hour != v || r.temperature_tenth_c != v ||
+            static_cast<int32_t>(r.reserved[3]) != v)
+            inconsistent++;
+        if (v < last) backwards++;
+        last = v;
+    }
+    writer.join();
+    EXPECT_EQ(inconsistent, 0);
+    EXPECT_EQ(backwards, 0);
+    ASSERT_TRUE(reader.read(IcaoCode("UKLI"), r));
+    EXPECT_EQ(r.report_day, updates);
+}
+
+TEST_F(StationState, replaced) {
+    StationStatePublisher publisher;
+    ASSERT_TRUE(publisher.open(name, 4));
+    ASSERT_TRUE(publisher.publish(IcaoCode("UKLI"), makeRecord("UKLI", 1)));
+    StationStateReader reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_FALSE(reader.retired());
+
+    // Re-created segment is new; previous one is marked for the readers
+    StationStatePublisher next;
+    ASSERT_TRUE(next.open(name, 4));
+    ASSERT_TRUE(next.publish(IcaoCode("UKLI"), makeRecord("UKLI", 2)));
+    EXPECT_TRUE(reader.retired());
+    metafsimple_record r;
+    ASSERT_TRUE(reader.read(IcaoCode("UKLI"), r));
+    EXPECT_EQ(r.temperature_tenth_c, 1);
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_FALSE(reader.retired());
+    ASSERT_TRUE(reader.read(IcaoCode("UKLI"), r));
+    EXPECT_EQ(r.temperature_tenth_c, 2);
+
+    EXPECT_TRUE(StationStatePublisher::remove(name));
+    EXPECT_TRUE(reader.retired());
+    EXPECT_FALSE(StationStateReader().open(name));
+}
+
+TEST_F(StationState, writerStopsDuringUpdate) {
+    StationStatePublisher publisher;
+    ASSERT_TRUE(publisher.open(name, 4));
+    ASSERT_TRUE(publisher.publish(IcaoCode("UKLI"), makeRecord("UKLI", 1)));
+    StationStateReader reader;
+    ASSERT_TRUE(reader.open(name));
+
+    // Record is left locked as if publisher process died while updating it
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    detail::ShmMapping mapping;
+    ASSERT_TRUE(mapping.map(fd, detail::shmSize(4), true));
+    close(fd);
+    const auto slot = detail::shmFirstSlot(IcaoCode("UKLI"), 4);
+    mapping.slots[slot].sequence++;
+
+    metafsimple_record r;
+    EXPECT_FALSE(reader.read(IcaoCode("UKLI"), r));
+    mapping.slots[slot].sequence++;
+    EXPECT_TRUE(reader.read(IcaoCode("UKLI"), r));
+}
@@ -0,0 +1,161 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <unistd.h>
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_snapshot.hpp"
+#include "tempfiles.hpp"
+
+using namespace metafsimple;
+
+static Simple metar(const std::string &icao, int temperature) {
+    Simple s;
+    s.report.type = Report::Type::METAR;
+    s.report.error = Report::Error::NO_ERROR;
+    s.report.reportTime = Time{12, 10, 50};
+    s.station.icaoCode = icao;
+    s.current.airTemperature = Temperature{temperature, Temperature::Unit::C};
+    return s;
+}
+
+static StationStates states() {
+    StationStates result;
+    const char *stations[] = {"UKLI", "EGLL", "SCCH", "KJFK", "RJTT"};
+    auto temperature = 0;
+    for (const auto s : stations)
+        result[IcaoCode(s)] = metar(s, temperature++);
+    return result;
+}
+
+TEST(Snapshot, writeAndLoad) {
+    const TempFile file("snapshot.mfss");
+    const auto source = states();
+    SnapshotWriter writer;
+    writer.start(file.path, source);
+    EXPECT_TRUE(writer.wait());
+    EXPECT_FALSE(writer.busy());
+
+    StationSnapshot snapshot;
+    ASSERT_TRUE(snapshot.open(file.path));
+    ASSERT_EQ(snapshot.size(), 5u);
+    for (auto i = 1u; i < snapshot.size(); i++)
+        EXPECT_LT(snapshot.station(i - 1).packed(),
+                  snapshot.station(i).packed());
+    const auto n = snapshot.find(IcaoCode("SCCH"));
+    ASSERT_TRUE(n.has_value());
+    EXPECT_EQ(snapshot.station(*n), IcaoCode("SCCH"));
+    EXPECT_STREQ(snapshot.record(*n).icao, "SCCH");
+    EXPECT_EQ(snapshot.record(*n).temperature_tenth_c, 20);
+    const auto report = snapshot.report(*n);
+    ASSERT_TRUE(report.has_value());
+    EXPECT_EQ(*report, source.at(IcaoCode("SCCH")));
+    EXPECT_FALSE(snapshot.find(IcaoCode("ZZZZ")).has_value());
+    EXPECT_FALSE(snapshot.find(IcaoCode("AAAA")).has_value());
+
+    StationStates restored;
+    EXPECT_TRUE(snapshot.restore(restored));
+    ASSERT_EQ(restored.size(), source.size());
+    for (const auto &s : source) EXPECT_EQ(restored.at(s.first), s.second);
+}
+
+TEST(Snapshot, stateModifiedDuringWrite) {
+    const TempFile file("snapshot.mfss");
+    auto source = states();
+    const auto original = source.at(IcaoCode("EGLL"));
+    SnapshotWriter writer;
+    writer.start(file.path, source);
+    source[IcaoCode("EGLL")] = metar("EGLL", 30);
+    source.erase(IcaoCode("UKLI"));
+    ASSERT_TRUE(writer.wait());
+
+    StationSnapshot snapshot;
+    ASSERT_TRUE(snapshot.open(file.path));
+    EXPECT_EQ(snapshot.size(), 5u);
+    EXPECT_EQ(*snapshot.report(*snapshot.find(IcaoCode("EGLL"))), original);
+    EXPECT_TRUE(snapshot.find(IcaoCode("UKLI")).has_value());
+}
+
+TEST(Snapshot, replace) {
+    const TempFile file("snapshot.mfss");
+    SnapshotWriter writer;
+    writer.start(file.path, states());
+    ASSERT_TRUE(writer.wait());
+    StationSnapshot previous;
+    ASSERT_TRUE(previous.open(file.path));
+
+    StationStates next;
+    next[IcaoCode("LFPG")] = metar("LFPG", 15);
+    // Stations with no ICAO code are not included
+    next[IcaoCode()] = metar("", 0);
+    writer.start(file.path, next);
+    ASSERT_TRUE(writer.wait());
+
+    StationSnapshot snapshot;
+    ASSERT_TRUE(snapshot.open(file.path));
+    ASSERT_EQ(snapshot.size(), 1u);
+    EXPECT_EQ(snapshot.station(0), IcaoCode("LFPG"));
+    // Snapshot which was open before is still available
+    EXPECT_EQ(previous.size(), 5u);
+    EXPECT_TRUE(previous.report(*previous.find(IcaoCode("KJFK"))).has_value());
+    EXPECT_NE(access((file.path + ".tmp").c_str(), F_OK), 0);
+}
+
+TEST(Snapshot, empty) {
+    const TempFile file("snapshot.mfss");
+    SnapshotWriter writer;
+    EXPECT_FALSE(writer.wait());
+    writer.start(file.path, StationStates());
+    ASSERT_TRUE(writer.wait());
+    StationSnapshot snapshot;
+    ASSERT_TRUE(snapshot.open(file.path));
+    EXPECT_EQ(snapshot.size(), 0u);
+    EXPECT_FALSE(snapshot.find(IcaoCode("EGLL")).has_value());
+    StationStates restored;
+    EXPECT_TRUE(snapshot.restore(restored));
+    EXPECT_TRUE(restored.empty());
+}
+
+TEST(Snapshot, malformed) {
+    const TempFile file("snapshot.mfss");
+    ASSERT_TRUE(writeSnapshot(file.path, snapshotImage(states())));
+    const auto data = readFile(file.path);
+    StationSnapshot snapshot;
+
+    auto corrupted = data;
+    corrupted[data.length() - 10] ^= 0x01;
+    writeFile(file.path, corrupted);
+    EXPECT_FALSE(snapshot.open(file.path));
+
+    writeFile(file.path, data.substr(0, data.length() - 1));
+    EXPECT_FALSE(snapshot.open(file.path));
+
+    writeFile(file.path, data.substr(0, 16));
+    EXPECT_FALSE(snapshot.open(file.path));
+
+    writeFile(file.path, data);
+    EXPECT_TRUE(snapshot.open(file.path));
+
+    unlink(file.path.c_str());
+    EXPECT_FALSE(snapshot.open(file.path));
+    EXPECT_FALSE(snapshot.isOpen());
+    EXPECT_EQ(snapshot.size(), 0u);
+}
+
+TEST(Snapshot, syncDirectory) {
+    const TempDirectory directory("snapshot");
+    EXPECT_TRUE(detail::snapshotSyncDirectory(directory.file("snapshot")));
+    EXPECT_TRUE(detail::snapshotSyncDirectory("snapshot.mfss"));
+    EXPECT_FALSE(
+        detail::snapshotSyncDirectory(directory.file("missing/snapshot")));
+    // Snapshot is not written if its directory does not exist
+    EXPECT_FALSE(writeSnapshot(directory.file("missing/snapshot"),
+                               snapshotImage(states())));
+}
@@ -0,0 +1,210 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_speci.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+// 24010KT 9999 FEW030
+static Essentials baseline() {
+    Essentials e;
+    e.windDirectionDegrees = 240;
+    e.windSpeed = Speed{10, Speed::Unit::KT};
+    e.visibility =
+        Distance{Distance::Details::EXACTLY, 9999, Distance::Unit::METERS};
+    e.skyCondition = Essentials::SkyCondition::CLOUDS;
+    e.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::FEW,
+                                       Height{3000, Height::Unit::FEET},
+                                       CloudLayer::Details::UNKNOWN,
+                                       noValue});
+    return e;
+}
+
+static SpeciChanges changes(const Essentials &previous,
+                            const Essentials &current) {
+    return speciChanges(SpeciState::make(previous),
+                        SpeciState::make(current));
+}
+
+static SpeciChanges only(SpeciCriterion c) {
+    return 1u << static_cast<unsigned int>(c);
+}
+
+static Distance meters(int m) {
+    return Distance{Distance::Details::EXACTLY, m, Distance::Unit::METERS};
+}
+
+TEST(SpeciState, make) {
+    auto e = baseline();
+    e.weather.push_back(Weather{Weather::Phenomena::MIST, {}});
+    e.weather.push_back(Weather{Weather::Phenomena::PRECIPITATION_HEAVY,
+                                {Weather::Precipitation::RAIN}});
+    const auto s = SpeciState::make(e);
+    EXPECT_EQ(s.windDirection, 240);
+    EXPECT_EQ(s.windSpeed, 10);
+    EXPECT_EQ(s.gustSpeed, SpeciState::unknownValue);
+    EXPECT_EQ(s.visibilityBand, 4);
+    EXPECT_EQ(s.ceilingBand, 5);
+    EXPECT_EQ(s.lowBrokenLayer, 0);
+    EXPECT_EQ(s.rvrBand, SpeciState::unknownBand);
+    EXPECT_EQ(s.verticalVisibilityBand, SpeciState::unknownBand);
+    const auto heavyRain = std::uint64_t(1) << static_cast<unsigned int>(
+                               Weather::Phenomena::PRECIPITATION_HEAVY);
+    EXPECT_EQ(s.weather, heavyRain);
+}
+
+TEST(SpeciState, noChanges) {
+    auto e = baseline();
+    EXPECT_EQ(changes(baseline(), e), 0);
+    // Changes within the same band are not significant
+    e.visibility = meters(6000);
+    e.windSpeed = Speed{15, Speed::Unit::KT};
+    e.weather.push_back(Weather{Weather::Phenomena::MIST, {}});
+    EXPECT_EQ(changes(baseline(), e), 0);
+}
+
+TEST(SpeciState, visibility) {
+    auto previous = baseline(), current = baseline();
+    previous.visibility = meters(2000);
+    current.visibility = meters(1400);
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::VISIBILITY));
+    // Improving and changes to threshold
+    current.visibility = meters(3000);
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::VISIBILITY));
+    // Deteriorating to threshold does not pass through it
+    previous.visibility = meters(2000);
+    current.visibility = meters(1500);
+    EXPECT_EQ(changes(previous, current), 0);
+    // Unknown visibility
+    current.visibility = Distance();
+    EXPECT_EQ(changes(previous, current), 0);
+}
+
+TEST(SpeciState, ceiling) {
+    auto previous = baseline(), current = baseline();
+    current.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::BROKEN,
+                                             Height{800, Height::Unit::FEET},
+                                             CloudLayer::Details::UNKNOWN,
+                                             noValue});
+    EXPECT_EQ(changes(previous, current),
+              only(SpeciCriterion::CEILING) |
+                  only(SpeciCriterion::CLOUD_AMOUNT));
+    previous = current;
+    current.cloudLayers.back().height = Height{400, Height::Unit::FEET};
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::CEILING));
+}
+
+TEST(SpeciState, verticalVisibility) {
+    auto previous = baseline(), current = baseline();
+    previous.skyCondition = Essentials::SkyCondition::OBSCURED;
+    previous.cloudLayers.clear();
+    previous.verticalVisibility = Height{300, Height::Unit::FEET};
+    current = previous;
+    current.verticalVisibility = Height{100, Height::Unit::FEET};
+    const auto c = changes(previous, current);
+    EXPECT_TRUE(hasChange(c, SpeciCriterion::VERTICAL_VISIBILITY));
+    EXPECT_TRUE(hasChange(c, SpeciCriterion::CEILING));
+    EXPECT_FALSE(hasChange(c, SpeciCriterion::VISIBILITY));
+}
+
+TEST(SpeciState, rvr) {
+    Aerodrome previous, current;
+    previous.runways.resize(2);
+    previous.runways[0].visualRange.prevailing = meters(1000);
+    previous.runways[1].visualRange.prevailing = meters(700);
+    current = previous;
+    current.runways[0].visualRange.prevailing = meters(500);
+    EXPECT_EQ(speciChanges(SpeciState::make(baseline(), previous),
+                           SpeciState::make(baseline(), current)),
+              only(SpeciCriterion::RVR));
+}
+
+TEST(SpeciState, wind) {
+    auto previous = baseline(), current = baseline();
+    current.windDirectionDegrees = 300;
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::WIND_DIRECTION));
+    // Direction change across north
+    previous.windDirectionDegrees = 340;
+    current.windDirectionDegrees = 30;
+    EXPECT_EQ(changes(previous, current), 0);
+    current.windDirectionDegrees = 50;
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::WIND_DIRECTION));
+    // Direction change with low wind speed is not significant
+    previous.windSpeed = Speed{5, Speed::Unit::KT};
+    current.windSpeed = Speed{5, Speed::Unit::KT};
+    EXPECT_EQ(changes(previous, current), 0);
+    current.windDirectionDegrees = previous.windDirectionDegrees;
+    current.windSpeed = Speed{15, Speed::Unit::KT};
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::WIND_SPEED));
+}
+
+TEST(SpeciState, gust) {
+    auto previous = baseline(), current = baseline();
+    previous.windSpeed = Speed{15, Speed::Unit::KT};
+    current.windSpeed = Speed{15, Speed::Unit::KT};
+    current.gustSpeed = Speed{25, Speed::Unit::KT};
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::GUST));
+    // Gust decrease is not significant
+    EXPECT_EQ(changes(current, previous), 0);
+    // Mean speed too low
+    previous.windSpeed = Speed{10, Speed::Unit::KT};
+    current.windSpeed = Speed{10, Speed::Unit::KT};
+    current.gustSpeed = Speed{20, Speed::Unit::KT};
+    EXPECT_EQ(changes(previous, current), 0);
+}
+
+TEST(SpeciState, weather) {
+    auto previous = baseline(), current = baseline();
+    current.weather.push_back(
+        Weather{Weather::Phenomena::PRECIPITATION_MODERATE,
+                {Weather::Precipitation::RAIN}});
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::WEATHER));
+    // Change of intensity
+    previous = current;
+    current.weather.back().phenomena = Weather::Phenomena::PRECIPITATION_HEAVY;
+    EXPECT_EQ(changes(previous, current), only(SpeciCriterion::WEATHER));
+    // Cessation
+    EXPECT_EQ(changes(current, baseline()), only(SpeciCriterion::WEATHER));
+    // Light precipitation onset is not significant
+    current = baseline();
+    current.weather.push_back(Weather{Weather::Phenomena::PRECIPITATION_LIGHT,
+                                      {Weather::Precipitation::RAIN}});
+    EXPECT_EQ(changes(baseline(), current), 0);
+}
+
+TEST(SpeciEvaluator, update) {
+    SpeciEvaluator evaluator;
+    Simple metar;
+    metar.report.type = Report::Type::METAR;
+    metar.report.error = Report::Error::NO_ERROR;
+    metar.station.icaoCode = "UKLI";
+    metar.current.weatherData = baseline();
+    EXPECT_EQ(evaluator.update(metar), 0);
+    EXPECT_EQ(evaluator.stations(), 1u);
+    EXPECT_EQ(evaluator.update(metar), 0);
+
+    metar.current.weatherData.visibility = meters(700);
+    EXPECT_EQ(evaluator.update(metar), only(SpeciCriterion::VISIBILITY));
+    EXPECT_EQ(evaluator.update(metar), 0);
+
+    // Other stations are tracked separately
+    metar.station.icaoCode = "UKLL";
+    EXPECT_EQ(evaluator.update(metar), 0);
+    EXPECT_EQ(evaluator.stations(), 2u);
+
+    // TAFs are ignored
+    metar.report.type = Report::Type::TAF;
+    metar.current.weatherData = baseline();
+    EXPECT_EQ(evaluator.update(metar), 0);
+    metar.report.type = Report::Type::SPECI;
+    EXPECT_EQ(evaluator.update(metar), only(SpeciCriterion::VISIBILITY));
+}
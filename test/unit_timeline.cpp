@@ -0,0 +1,261 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_timeline.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+// Reports are from January 2021
+static const std::int64_t january2021 = 1609459200;
+static const std::int64_t reference = january2021 + (7 * 24 + 17) * 3600;
+
+static std::int64_t epochTime(int day, int hour) {
+    return january2021 + ((day - 1) * 24 + hour) * 3600;
+}
+
+static Essentials visibility(int meters) {
+    Essentials e;
+    e.visibility =
+        Distance{Distance::Details::EXACTLY, meters, Distance::Unit::METERS};
+    return e;
+}
+
+static Trend trend(Trend::Type type,
+                   std::optional<int> probability,
+                   Time from,
+                   Time until,
+                   Essentials e) {
+    Trend t;
+    t.type = type;
+    t.probability = probability;
+    t.timeFrom = from;
+    t.timeUntil = until;
+    t.forecast = e;
+    return t;
+}
+
+// TAF ZZZZ 081720Z 0818/0918 24010KT 9999 SCT030
+//   TEMPO 0820/0824 3000 SHRA
+//   BECMG 0902/0904 27015KT
+//   FM090600 30005KT 6000 BKN010
+//   PROB30 0910/0914 0800 FG
+class Timeline : public ::testing::Test {
+   protected:
+    Timeline() {
+        taf.report.type = Report::Type::TAF;
+        taf.report.applicableFrom = Time{8, 18, noValue};
+        taf.report.applicableUntil = Time{9, 18, noValue};
+        auto &p = taf.forecast.prevailing;
+        p.windDirectionDegrees = 240;
+        p.windSpeed = Speed{10, Speed::Unit::KT};
+        p.visibility = visibility(9999).visibility;
+        p.skyCondition = Essentials::SkyCondition::CLOUDS;
+        p.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::SCATTERED,
+                                           Height{3000, Height::Unit::FEET},
+                                           CloudLayer::Details::UNKNOWN,
+                                           noValue});
+
+        auto tempo = visibility(3000);
+        tempo.weather.push_back(
+            Weather{Weather::Phenomena::SHOWERY_PRECIPITATION_MODERATE,
+                    {Weather::Precipitation::RAIN}});
+        taf.forecast.trends.push_back(trend(Trend::Type::TEMPO,
+                                            noValue,
+                                            Time{8, 20, noValue},
+                                            Time{8, 24, noValue},
+                                            tempo));
+        Essentials becmg;
+        becmg.windDirectionDegrees = 270;
+        becmg.windSpeed = Speed{15, Speed::Unit::KT};
+        taf.forecast.trends.push_back(trend(Trend::Type::BECMG,
+                                            noValue,
+                                            Time{9, 2, noValue},
+                                            Time{9, 4, noValue},
+                                            becmg));
+        auto fm = visibility(6000);
+        fm.windDirectionDegrees = 300;
+        fm.windSpeed = Speed{5, Speed::Unit::KT};
+        fm.skyCondition = Essentials::SkyCondition::CLOUDS;
+        fm.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::BROKEN,
+                                            Height{1000, Height::Unit::FEET},
+                                            CloudLayer::Details::UNKNOWN,
+                                            noValue});
+        taf.forecast.trends.push_back(trend(Trend::Type::TIMED,
+                                            noValue,
+                                            Time{9, 6, 0},
+                                            Time(),
+                                            fm));
+        auto prob = visibility(800);
+        prob.weather.push_back(Weather{Weather::Phenomena::FOG, {}});
+        taf.forecast.trends.push_back(trend(Trend::Type::TIMED,
+                                            30,
+                                            Time{9, 10, noValue},
+                                            Time{9, 14, noValue},
+                                            prob));
+    }
+    Simple taf;
+};
+
+TEST_F(Timeline, segments) {
+    const TafTimeline tl(taf, reference);
+    ASSERT_FALSE(tl.empty());
+    EXPECT_EQ(tl.length(), 24 * 60);
+    // Breakpoints: 0, 2h, 6h, 8h, 10h, 12h, 16h, 20h, 24h
+    EXPECT_EQ(tl.data().size(), 8u);
+}
+
+TEST_F(Timeline, prevailing) {
+    const TafTimeline tl(taf, reference);
+    const auto s = tl.at(Time{8, 19, 30});
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->governing, taf.forecast.prevailing);
+    EXPECT_TRUE(s->temporary.empty());
+}
+
+TEST_F(Timeline, tempo) {
+    const TafTimeline tl(taf, reference);
+    const auto s = tl.at(Time{8, 23, 59});
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->governing, taf.forecast.prevailing);
+    ASSERT_EQ(s->temporary.size(), 1u);
+    const auto &t = s->temporary[0];
+    EXPECT_EQ(t.type, Trend::Type::TEMPO);
+    EXPECT_EQ(t.from, 120);
+    EXPECT_EQ(t.until, 360);
+    EXPECT_EQ(t.conditions.visibility.distance, 3000);
+    EXPECT_EQ(t.conditions.windDirectionDegrees, 240);
+    EXPECT_EQ(t.conditions.cloudLayers, taf.forecast.prevailing.cloudLayers);
+    ASSERT_EQ(t.conditions.weather.size(), 1u);
+    // End of TEMPO period is not included
+    const auto after = tl.at(Time{9, 0, 0});
+    ASSERT_NE(after, nullptr);
+    EXPECT_TRUE(after->temporary.empty());
+}
+
+TEST_F(Timeline, becmg) {
+    const TafTimeline tl(taf, reference);
+    const auto during = tl.at(Time{9, 3, 0});
+    ASSERT_NE(during, nullptr);
+    EXPECT_EQ(during->governing.windDirectionDegrees, 240);
+    ASSERT_EQ(during->temporary.size(), 1u);
+    EXPECT_EQ(during->temporary[0].type, Trend::Type::BECMG);
+    EXPECT_EQ(during->temporary[0].conditions.windDirectionDegrees, 270);
+
+    const auto after = tl.at(Time{9, 4, 0});
+    ASSERT_NE(after, nullptr);
+    EXPECT_EQ(after->governing.windDirectionDegrees, 270);
+    EXPECT_EQ(after->governing.windSpeed.speed, 15);
+    EXPECT_EQ(after->governing.visibility.distance, 9999);
+    EXPECT_EQ(after->governing.cloudLayers,
+              taf.forecast.prevailing.cloudLayers);
+    EXPECT_TRUE(after->temporary.empty());
+}
+
+TEST_F(Timeline, fromReplacesConditions) {
+    const TafTimeline tl(taf, reference);
+    const auto s = tl.at(Time{9, 7, 0});
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->governing, taf.forecast.trends[2].forecast);
+}
+
+TEST_F(Timeline, probability) {
+    const TafTimeline tl(taf, reference);
+    const auto s = tl.at(Time{9, 12, 0});
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(s->governing.windDirectionDegrees, 300);
+    ASSERT_EQ(s->temporary.size(), 1u);
+    EXPECT_EQ(s->temporary[0].probability, 30);
+    EXPECT_EQ(s->temporary[0].conditions.visibility.distance, 800);
+    EXPECT_EQ(s->temporary[0].conditions.windDirectionDegrees, 300);
+}
+
+TEST_F(Timeline, outsideValidity) {
+    const TafTimeline tl(taf, reference);
+    EXPECT_EQ(tl.at(-1), nullptr);
+    EXPECT_EQ(tl.at(24 * 60), nullptr);
+    EXPECT_EQ(tl.at(Time{9, 18, 0}), nullptr);
+    EXPECT_EQ(tl.at(Time{8, 17, 0}), nullptr);
+    EXPECT_NE(tl.at(0), nullptr);
+    EXPECT_NE(tl.at(24 * 60 - 1), nullptr);
+}
+
+TEST_F(Timeline, epochTime) {
+    const TafTimeline tl(taf, reference);
+    EXPECT_EQ(tl.start(), epochTime(8, 18));
+    EXPECT_EQ(tl.atTime(epochTime(8, 19) + 30 * 60), tl.at(Time{8, 19, 30}));
+    EXPECT_EQ(tl.atTime(epochTime(9, 7)), tl.at(13 * 60));
+    EXPECT_EQ(tl.atTime(epochTime(8, 18) - 1), nullptr);
+    EXPECT_EQ(tl.atTime(epochTime(9, 18)), nullptr);
+}
+
+TEST_F(Timeline, monthEnd) {
+    // TAF ZZZZ 301720Z 3018/0100 24010KT 9999 SCT030
+    //   TEMPO 3120/0100 3000 SHRA
+    taf.report.applicableFrom = Time{30, 18, noValue};
+    taf.report.applicableUntil = Time{1, 0, noValue};
+    auto tempo = taf.forecast.trends[0];
+    tempo.timeFrom = Time{31, 20, noValue};
+    tempo.timeUntil = Time{1, 0, noValue};
+    taf.forecast.trends = {tempo};
+    const TafTimeline tl(taf, epochTime(30, 17));
+    EXPECT_EQ(tl.start(), epochTime(30, 18));
+    EXPECT_EQ(tl.length(), 30 * 60);
+    const auto s = tl.at(Time{31, 23, 0});
+    ASSERT_NE(s, nullptr);
+    ASSERT_EQ(s->temporary.size(), 1u);
+    EXPECT_EQ(s->temporary[0].from, 26 * 60);
+    EXPECT_EQ(s->temporary[0].until, 30 * 60);
+    EXPECT_EQ(tl.at(Time{1, 0, 0}), nullptr);
+}
+
+TEST_F(Timeline, notTaf) {
+    taf.report.type = Report::Type::METAR;
+    EXPECT_TRUE(TafTimeline(taf, reference).empty());
+    taf.report.type = Report::Type::TAF;
+    taf.report.applicableUntil = Time();
+    EXPECT_TRUE(TafTimeline(taf, reference).empty());
+}
+
+TEST(MinutesSince, monthChange) {
+    const Time from{31, 18, noValue};
+    EXPECT_EQ(minutesSince(from, Time{1, 6, 0}, 31), 12 * 60);
+    EXPECT_EQ(minutesSince(from, Time{31, 24, 0}, 31), 6 * 60);
+    EXPECT_EQ(minutesSince(Time{30, 18, noValue}, Time{1, 6, 0}, 30),
+              12 * 60);
+    EXPECT_EQ(minutesSince(Time{30, 18, noValue}, Time{1, 0, 0}, 31),
+              30 * 60);
+    EXPECT_EQ(minutesSince(from, Time{noValue, 2, 30}, 31), 8 * 60 + 30);
+    EXPECT_FALSE(minutesSince(Time(), Time{1, 6, 0}, 31).has_value());
+}
+
+TEST(Overlay, cavok) {
+    Essentials base = visibility(3000);
+    base.weather.push_back(Weather{Weather::Phenomena::MIST, {}});
+    base.windDirectionDegrees = 180;
+    Essentials change;
+    change.cavok = true;
+    change.skyCondition = Essentials::SkyCondition::CAVOK;
+    const auto result = overlay(base, change);
+    EXPECT_TRUE(result.cavok);
+    EXPECT_TRUE(result.weather.empty());
+    EXPECT_EQ(result.windDirectionDegrees, 180);
+}
+
+TEST(Overlay, nsw) {
+    Essentials base;
+    base.weather.push_back(Weather{Weather::Phenomena::MIST, {}});
+    Essentials change;
+    change.weather.push_back(
+        Weather{Weather::Phenomena::NO_SIGNIFICANT_WEATHER, {}});
+    EXPECT_TRUE(overlay(base, change).weather.empty());
+}
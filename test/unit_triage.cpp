@@ -0,0 +1,153 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+
+using namespace metafsimple;
+
+TEST(Triage, metar) {
+    const auto t = triage("METAR UKLI 071600Z 28003MPS 250V330 9999 -SHRA"
+                          " BKN019CB BKN028 13/12 Q1015 NOSIG=");
+    EXPECT_EQ(t.type, Report::Type::METAR);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("UKLI"));
+    EXPECT_EQ(t.reportTime, (Time{7, 16, 0}));
+    EXPECT_FALSE(t.correctional);
+    EXPECT_FALSE(t.amended);
+}
+
+TEST(Triage, speci) {
+    const auto t = triage("SPECI KBHB 141253Z AUTO 00000KT 1/4SM FG VV002");
+    EXPECT_EQ(t.type, Report::Type::SPECI);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("KBHB"));
+    EXPECT_EQ(t.reportTime, (Time{14, 12, 53}));
+}
+
+TEST(Triage, metarCor) {
+    const auto t = triage("METAR COR LFPG 231030Z 24010KT CAVOK 20/10 Q1020=");
+    EXPECT_EQ(t.type, Report::Type::METAR);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("LFPG"));
+    EXPECT_EQ(t.reportTime, (Time{23, 10, 30}));
+    EXPECT_TRUE(t.correctional);
+    EXPECT_FALSE(t.amended);
+}
+
+TEST(Triage, tafAmd) {
+    const auto t = triage("TAF AMD CYGL 082048Z 0820/0918 24010G20KT P6SM"
+                          " FEW015 BKN090=");
+    EXPECT_EQ(t.type, Report::Type::TAF);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("CYGL"));
+    EXPECT_EQ(t.reportTime, (Time{8, 20, 48}));
+    EXPECT_FALSE(t.correctional);
+    EXPECT_TRUE(t.amended);
+}
+
+TEST(Triage, tafNoReportTime) {
+    const auto t = triage("TAF EGYP 0821/0915 35015G25KT 9999 BKN010=");
+    EXPECT_EQ(t.type, Report::Type::TAF);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("EGYP"));
+    EXPECT_EQ(t.reportTime, Time());
+}
+
+TEST(Triage, noReportTypeMetar) {
+    const auto t = triage("SCCH 061700Z 23007KT CAVOK 07/03 Q1016=");
+    EXPECT_EQ(t.type, Report::Type::METAR);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("SCCH"));
+    EXPECT_EQ(t.reportTime, (Time{6, 17, 0}));
+}
+
+TEST(Triage, noReportTypeTaf) {
+    const auto t = triage("ZZZZ 091750Z 0918/1018 27014KT CAVOK=");
+    EXPECT_EQ(t.type, Report::Type::TAF);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("ZZZZ"));
+    EXPECT_EQ(t.reportTime, (Time{9, 17, 50}));
+}
+
+TEST(Triage, nil) {
+    const auto t = triage("METAR ZZZZ 041115Z NIL=");
+    EXPECT_EQ(t.type, Report::Type::METAR);
+    EXPECT_EQ(t.error, Report::Error::NO_ERROR);
+    EXPECT_EQ(t.icaoCode, IcaoCode("ZZZZ"));
+    EXPECT_EQ(t.reportTime, (Time{4, 11, 15}));
+}
+
+TEST(Triage, emptyReport) {
+    EXPECT_EQ(triage("").error, Report::Error::EMPTY_REPORT);
+    EXPECT_EQ(triage("  =").error, Report::Error::EMPTY_REPORT);
+    EXPECT_EQ(triage("").type, Report::Type::ERROR);
+}
+
+TEST(Triage, unexpectedReportEnd) {
+    const auto t = triage("METAR ZZZZ");
+    EXPECT_EQ(t.type, Report::Type::ERROR);
+    EXPECT_EQ(t.error, Report::Error::UNEXPECTED_REPORT_END);
+    EXPECT_EQ(t.icaoCode, IcaoCode("ZZZZ"));
+}
+
+TEST(Triage, headerFormat) {
+    EXPECT_EQ(triage("METAR 1234 041115Z").error,
+              Report::Error::REPORT_HEADER_FORMAT);
+    EXPECT_EQ(triage("METAR ZZZZ 24010KT").error,
+              Report::Error::REPORT_HEADER_FORMAT);
+    EXPECT_EQ(triage("TAF ZZZZ 091750Z 27014KT").error,
+              Report::Error::REPORT_HEADER_FORMAT);
+    EXPECT_EQ(triage("METAR ZZZZ 321115Z").error,
+              Report::Error::REPORT_HEADER_FORMAT);
+}
+
+TEST(Triage, amdInMetar) {
+    const auto t = triage("METAR AMD ZZZZ 041115Z 24010KT");
+    EXPECT_EQ(t.type, Report::Type::ERROR);
+    EXPECT_EQ(t.error, Report::Error::GROUP_NOT_ALLOWED);
+}
+
+TEST(StationFilter, allows) {
+    const StationFilter f{IcaoCode("UKLI"), IcaoCode("SCCH")};
+    EXPECT_FALSE(f.empty());
+    EXPECT_TRUE(f.allows(IcaoCode("UKLI")));
+    EXPECT_TRUE(f.allows(IcaoCode("SCCH")));
+    EXPECT_FALSE(f.allows(IcaoCode("ZZZZ")));
+    EXPECT_FALSE(f.allows(IcaoCode("")));
+}
+
+TEST(StationFilter, emptyAllowsAll) {
+    const StationFilter f;
+    EXPECT_TRUE(f.empty());
+    EXPECT_TRUE(f.allows(IcaoCode("UKLI")));
+    EXPECT_TRUE(f.allows(IcaoCode("ZZZZ")));
+}
+
+TEST(StationFilter, simplifyAllowed) {
+    const auto result =
+        simplify("METAR SCCH 061700Z 23007KT CAVOK 07/03 Q1016=",
+                 StationFilter{IcaoCode("SCCH")});
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->report.type, Report::Type::METAR);
+    EXPECT_EQ(result->station.icaoCode, "SCCH");
+}
+
+TEST(StationFilter, simplifyNotAllowed) {
+    const auto result =
+        simplify("METAR SCCH 061700Z 23007KT CAVOK 07/03 Q1016=",
+                 StationFilter{IcaoCode("UKLI")});
+    EXPECT_FALSE(result.has_value());
+}
+
+TEST(StationFilter, simplifyHeaderError) {
+    const auto result =
+        simplify("METAR 1234 061700Z", StationFilter{IcaoCode("UKLI")});
+    EXPECT_FALSE(result.has_value());
+}
@@ -374,6 +374,11 @@ TEST(ValidateComparisons, essentials) {
     test = ref;
     test.windShear.push_back(WindShear());
     EXPECT_FALSE(ref == test);
+
+    // Summary is derived data and is not compared
+    test = ref;
+    test.summary = Essentials::summaryBit(Essentials::Hazard::THUNDERSTORM);
+    EXPECT_TRUE(ref == test);
 }
 
 TEST(ValidateComparisons, trend) {
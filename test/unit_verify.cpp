@@ -0,0 +1,265 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_verify.hpp"
+
+using namespace metafsimple;
+
+static const std::optional<int> noValue;
+
+// Reports are from January 2021 unless specified otherwise
+static const std::int64_t january2021 = 1609459200;
+static const std::int64_t reference = january2021 + (7 * 24 + 17) * 3600;
+static const std::int64_t january31 = january2021 + 30 * 24 * 3600;
+
+static Distance meters(int m) {
+    return Distance{Distance::Details::EXACTLY, m, Distance::Unit::METERS};
+}
+
+// TAF ZZZZ 081720Z 0818/0906 24010KT 9999 SCT030
+//   TEMPO 0820/0822 3000 SHRA
+static Simple makeTaf(const std::string &icao) {
+    Simple taf;
+    taf.station.icaoCode = icao;
+    taf.report.type = Report::Type::TAF;
+    taf.report.error = Report::Error::NO_ERROR;
+    taf.report.applicableFrom = Time{8, 18, noValue};
+    taf.report.applicableUntil = Time{9, 6, noValue};
+    auto &p = taf.forecast.prevailing;
+    p.windDirectionDegrees = 240;
+    p.windSpeed = Speed{10, Speed::Unit::KT};
+    p.visibility = meters(9999);
+    p.skyCondition = Essentials::SkyCondition::CLOUDS;
+    p.cloudLayers.push_back(CloudLayer{CloudLayer::Amount::SCATTERED,
+                                       Height{3000, Height::Unit::FEET},
+                                       CloudLayer::Details::UNKNOWN,
+                                       noValue});
+    Trend tempo;
+    tempo.type = Trend::Type::TEMPO;
+    tempo.timeFrom = Time{8, 20, noValue};
+    tempo.timeUntil = Time{8, 22, noValue};
+    tempo.forecast.visibility = meters(3000);
+    tempo.forecast.weather.push_back(
+        Weather{Weather::Phenomena::SHOWERY_PRECIPITATION_MODERATE,
+                {Weather::Precipitation::RAIN}});
+    taf.forecast.trends.push_back(tempo);
+    return taf;
+}
+
+static Simple makeMetar(const std::string &icao,
+                        int day,
+                        int hour,
+                        int visibility) {
+    Simple metar;
+    metar.station.icaoCode = icao;
+    metar.report.type = Report::Type::METAR;
+    metar.report.error = Report::Error::NO_ERROR;
+    metar.report.reportTime = Time{day, hour, 0};
+    auto &w = metar.current.weatherData;
+    w.windDirectionDegrees = 240;
+    w.windSpeed = Speed{8, Speed::Unit::KT};
+    w.visibility = meters(visibility);
+    w.skyCondition = Essentials::SkyCondition::NO_SIGNIFICANT_CLOUD;
+    return metar;
+}
+
+// Hourly METARs 0818..0905, visibility is low at 0820, 0821 and 0823
+static void addMetars(TafVerifier &v, const std::string &icao) {
+    for (auto i = 0; i < 12; i++) {
+        const auto hour = (18 + i) % 24;
+        const auto day = (18 + i) < 24 ? 8 : 9;
+        const bool low = hour == 20 || hour == 21 || hour == 23;
+        v.add(makeMetar(icao, day, hour, low ? 2000 : 9999), reference);
+    }
+}
+
+TEST(TafVerifier, events) {
+    const TafVerifier v;
+    Essentials e;
+    EXPECT_EQ(v.events(e), 0u);
+    EXPECT_EQ(TafVerifier::known(e), 0x08u);
+    e.visibility = meters(4000);
+    e.gustSpeed = Speed{30, Speed::Unit::KT};
+    e.verticalVisibility = Height{500, Height::Unit::FEET};
+    e.weather.push_back(
+        Weather{Weather::Phenomena::NO_SIGNIFICANT_WEATHER, {}});
+    EXPECT_EQ(v.events(e), 0x07u);
+    e.weather.push_back(Weather{Weather::Phenomena::FOG, {}});
+    EXPECT_EQ(v.events(e), 0x0Fu);
+    EXPECT_EQ(TafVerifier::known(e), 0x0Bu);
+}
+
+TEST(TafVerifier, score) {
+    TafVerifier v;
+    v.add(makeTaf("UKLI"), reference);
+    addMetars(v, "UKLI");
+    // Not scored until validity period ends
+    EXPECT_TRUE(v.results().empty());
+    v.add(makeMetar("UKLI", 9, 6, 9999), reference);
+    ASSERT_EQ(v.results().size(), 1u);
+    const auto &r = v.results().at(IcaoCode("UKLI"));
+    EXPECT_EQ(r.tafs, 1u);
+    EXPECT_EQ(r.hours, 12u);
+
+    const auto &overall = r.overall[VerificationCategory::VISIBILITY];
+    EXPECT_EQ(overall.hits, 2u);
+    EXPECT_EQ(overall.misses, 1u);
+    EXPECT_EQ(overall.falseAlarms, 0u);
+    EXPECT_EQ(overall.correctNegatives, 9u);
+
+    const auto &prevailing = r.prevailing[VerificationCategory::VISIBILITY];
+    EXPECT_EQ(prevailing.hits, 0u);
+    EXPECT_EQ(prevailing.misses, 3u);
+    EXPECT_EQ(prevailing.correctNegatives, 9u);
+
+    const auto &tempo =
+        r.trend(Trend::Type::TEMPO)[VerificationCategory::VISIBILITY];
+    EXPECT_EQ(tempo.hits, 2u);
+    EXPECT_EQ(tempo.misses, 0u);
+    EXPECT_EQ(tempo.falseAlarms, 0u);
+    EXPECT_EQ(tempo.correctNegatives, 0u);
+
+    // Weather forecast in TEMPO but not observed
+    const auto &weather = r.overall[VerificationCategory::WEATHER];
+    EXPECT_EQ(weather.falseAlarms, 2u);
+    EXPECT_EQ(weather.correctNegatives, 10u);
+    // Ceiling is known in observations, not forecast and not observed
+    EXPECT_EQ(r.overall[VerificationCategory::CEILING].correctNegatives, 12u);
+}
+
+TEST(TafVerifier, missingObservations) {
+    TafVerifier v;
+    v.add(makeTaf("UKLI"), reference);
+    v.add(makeMetar("UKLI", 8, 20, 2000), reference);
+    v.finish();
+    const auto &r = v.results().at(IcaoCode("UKLI"));
+    EXPECT_EQ(r.hours, 1u);
+    EXPECT_EQ(r.overall[VerificationCategory::VISIBILITY].hits, 1u);
+}
+
+TEST(TafVerifier, ignoredReports) {
+    TafVerifier v;
+    v.add(makeMetar("UKLI", 8, 20, 2000), reference);
+    auto error = makeTaf("UKLI");
+    error.report.error = Report::Error::EMPTY_REPORT;
+    v.add(error, reference);
+    v.add(makeTaf(""), reference);
+    v.finish();
+    EXPECT_TRUE(v.results().empty());
+}
+
+TEST(TafVerifier, maxPending) {
+    TafVerifier v(VerificationThresholds(), 2);
+    v.add(makeTaf("UKLI"), reference);
+    v.add(makeTaf("UKLI"), reference);
+    EXPECT_TRUE(v.results().empty());
+    v.add(makeTaf("UKLI"), reference);
+    ASSERT_EQ(v.results().size(), 1u);
+    EXPECT_EQ(v.results().at(IcaoCode("UKLI")).tafs, 1u);
+    v.finish();
+    EXPECT_EQ(v.results().at(IcaoCode("UKLI")).tafs, 3u);
+}
+
+TEST(TafVerifier, observationBeforeValidity) {
+    // TAF ZZZZ 082320Z 0900/1006 24010KT 9999 SCT030
+    auto taf = makeTaf("UKLI");
+    taf.report.applicableFrom = Time{9, 0, noValue};
+    taf.report.applicableUntil = Time{10, 6, noValue};
+    taf.forecast.trends.clear();
+    TafVerifier v;
+    v.add(taf, reference);
+    // Observation made the day before validity period is not scored and
+    // does not end the validity period
+    auto metar = makeMetar("UKLI", 8, 23, 2000);
+    metar.report.reportTime.minute = 53;
+    v.add(metar, reference);
+    EXPECT_TRUE(v.results().empty());
+    v.add(makeMetar("UKLI", 9, 0, 2000), reference);
+    v.finish();
+    const auto &r = v.results().at(IcaoCode("UKLI"));
+    EXPECT_EQ(r.tafs, 1u);
+    EXPECT_EQ(r.hours, 1u);
+    EXPECT_EQ(r.overall[VerificationCategory::VISIBILITY].misses, 1u);
+}
+
+TEST(TafVerifier, monthChange) {
+    // TAF ZZZZ 311720Z 3118/0124 24010KT 9999 SCT030
+    auto taf = makeTaf("UKLI");
+    taf.report.applicableFrom = Time{31, 18, noValue};
+    taf.report.applicableUntil = Time{1, 24, noValue};
+    taf.forecast.trends.clear();
+    TafVerifier v;
+    v.add(taf, january31);
+    v.add(makeMetar("UKLI", 1, 6, 2000), january31);
+    EXPECT_TRUE(v.results().empty());
+    v.add(makeMetar("UKLI", 2, 0, 9999), january31);
+    ASSERT_EQ(v.results().size(), 1u);
+    const auto &r = v.results().at(IcaoCode("UKLI"));
+    EXPECT_EQ(r.hours, 1u);
+    EXPECT_EQ(r.overall[VerificationCategory::VISIBILITY].misses, 1u);
+}
+
+TEST(TafVerifier, validityStartsBeforeLastDayOfMonth) {
+    // TAF ZZZZ 301720Z 3018/0100 24010KT 9999 SCT030
+    auto taf = makeTaf("UKLI");
+    taf.report.applicableFrom = Time{30, 18, noValue};
+    taf.report.applicableUntil = Time{1, 0, noValue};
+    taf.forecast.trends.clear();
+    TafVerifier v;
+    v.add(taf, january31);
+    // Validity period is 30 hours long and includes the whole of 31st
+    v.add(makeMetar("UKLI", 31, 23, 2000), january31);
+    EXPECT_TRUE(v.results().empty());
+    v.add(makeMetar("UKLI", 1, 0, 9999), january31);
+    ASSERT_EQ(v.results().size(), 1u);
+    const auto &r = v.results().at(IcaoCode("UKLI"));
+    EXPECT_EQ(r.hours, 1u);
+    EXPECT_EQ(r.overall[VerificationCategory::VISIBILITY].misses, 1u);
+}
+
+#ifndef __EMSCRIPTEN__
+
+TEST(VerificationEngine, matchesSingleThreaded) {
+    std::vector<std::string> stations;
+    for (auto i = 0; i < 50; i++)
+        stations.push_back("K" + std::to_string(100 + i));
+    TafVerifier single;
+    VerificationEngine engine(4, VerificationThresholds(), 16);
+    for (const auto &s : stations) {
+        single.add(makeTaf(s), reference);
+        engine.add(makeTaf(s), reference);
+    }
+    for (auto i = 0; i < 12; i++) {
+        for (const auto &s : stations) {
+            const auto hour = (18 + i) % 24;
+            const auto day = (18 + i) < 24 ? 8 : 9;
+            const auto m = makeMetar(s, day, hour, hour == 20 ? 2000 : 9999);
+            single.add(m, reference);
+            engine.add(m, reference);
+        }
+    }
+    single.finish();
+    const auto results = engine.finish();
+    ASSERT_EQ(results.size(), stations.size());
+    for (const auto &s : stations) {
+        const auto &expected = single.results().at(IcaoCode(s));
+        const auto &actual = results.at(IcaoCode(s));
+        EXPECT_EQ(actual.tafs, 1u);
+        EXPECT_EQ(actual.hours, expected.hours);
+        const auto &e = expected.overall[VerificationCategory::VISIBILITY];
+        const auto &a = actual.overall[VerificationCategory::VISIBILITY];
+        EXPECT_EQ(a.hits, e.hits);
+        EXPECT_EQ(a.correctNegatives, e.correctNegatives);
+    }
+    EXPECT_TRUE(engine.finish().empty());
+    EXPECT_FALSE(engine.add(makeTaf(stations[0]), reference));
+}
+
+#endif  // #ifndef __EMSCRIPTEN__
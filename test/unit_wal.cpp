@@ -0,0 +1,180 @@
+/*
+* Copyright (C) 2020 Nick Naumenko (https://gitlab.com/nnaumenko,
+* https:://github.com/nnaumenko)
+* All rights reserved.
+* This software may be modified and distributed under the terms
+* of the MIT license. See the LICENSE file for details.
+*/
+
+#include <thread>
+
+#include "comparisons.hpp"
+#include "gtest/gtest.h"
+#include "metafsimple.hpp"
+#include "metafsimple_wal.hpp"
+#include "tempfiles.hpp"
+
+using namespace metafsimple;
+
+static std::string report(int i) {
+    return "METAR EGLL 0" + std::to_string(1 + i % 9) +
+           "1050Z 24012KT 9999 BKN025 " + std::to_string(10 + i % 20) +
+           "/07 Q1013";
+}
+
+TEST(WriteAheadLog, appendAndRead) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path));
+    for (auto i = 0; i < 10; i++) {
+        const auto sequence = log.append(report(i), 1000 + i);
+        ASSERT_TRUE(sequence.has_value());
+        EXPECT_EQ(*sequence, static_cast<std::uint64_t>(i));
+    }
+    EXPECT_TRUE(log.sync(9));
+    EXPECT_FALSE(log.sync(10));
+    EXPECT_TRUE(log.sync());
+
+    const auto records = readLog(directory.path);
+    ASSERT_EQ(records.size(), 10u);
+    for (auto i = 0u; i < records.size(); i++) {
+        EXPECT_EQ(records[i].sequence, i);
+        EXPECT_EQ(records[i].receiveTime, 1000 + static_cast<int>(i));
+        EXPECT_EQ(records[i].report, report(i));
+    }
+    EXPECT_EQ(readLog(directory.path, 7).size(), 3u);
+    EXPECT_TRUE(readLog(directory.path, 10).empty());
+    log.close();
+    EXPECT_FALSE(log.append(report(0), 0).has_value());
+}
+
+TEST(WriteAheadLog, groupCommit) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path));
+    static const auto threadCount = 4;
+    static const auto perThread = 200;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < threadCount; t++) {
+        threads.emplace_back([&log, t]() {
+            for (auto i = 0; i < perThread; i++) {
+                const auto sequence = log.append(report(i), t);
+                if (sequence.has_value()) log.sync(*sequence);
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    EXPECT_TRUE(log.sync());
+    EXPECT_GT(log.commits(), 0u);
+    log.close();
+
+    const auto records = readLog(directory.path);
+    ASSERT_EQ(records.size(),
+              static_cast<std::size_t>(threadCount * perThread));
+    for (auto i = 0u; i < records.size(); i++)
+        EXPECT_EQ(records[i].sequence, i);
+}
+
+TEST(WriteAheadLog, segments) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path, 256));
+    for (auto i = 0; i < 20; i++) {
+        log.append(report(i), i);
+        log.sync();
+    }
+    log.close();
+    const auto segments = detail::walSegments(directory.path);
+    ASSERT_GT(segments.size(), 2u);
+    EXPECT_EQ(segments.front(), 0u);
+    EXPECT_EQ(readLog(directory.path).size(), 20u);
+    const auto fromSegment = readLog(directory.path, segments[2]);
+    ASSERT_EQ(fromSegment.size(), 20u - segments[2]);
+    EXPECT_EQ(fromSegment.front().report, report(segments[2]));
+
+    // Files other than segments are ignored
+    writeFile(directory.file("other.txt"), "text");
+    EXPECT_EQ(readLog(directory.path).size(), 20u);
+
+    ASSERT_TRUE(log.open(directory.path, 256));
+    log.removeBefore(segments[2]);
+    EXPECT_EQ(detail::walSegments(directory.path).front(), segments[2]);
+    log.removeBefore(1000);
+    EXPECT_EQ(detail::walSegments(directory.path).size(), 1u);
+    EXPECT_EQ(*log.append(report(0), 0), 20u);
+}
+
+TEST(WriteAheadLog, reopen) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path));
+    for (auto i = 0; i < 5; i++) log.append(report(i), i);
+    log.close();
+    ASSERT_TRUE(log.open(directory.path));
+    EXPECT_EQ(*log.append(report(5), 5), 5u);
+    log.close();
+    EXPECT_EQ(detail::walSegments(directory.path).size(), 2u);
+    const auto records = readLog(directory.path);
+    ASSERT_EQ(records.size(), 6u);
+    EXPECT_EQ(records[5].report, report(5));
+}
+
+TEST(WriteAheadLog, crashRecovery) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path));
+    for (auto i = 0; i < 5; i++) log.append(report(i), i);
+    log.close();
+    // Last record written partially
+    const auto segment = detail::walSegmentPath(directory.path, 0);
+    const auto data = readFile(segment);
+    writeFile(segment, data.substr(0, data.length() - 3));
+    EXPECT_EQ(readLog(directory.path).size(), 4u);
+
+    ASSERT_TRUE(log.open(directory.path));
+    EXPECT_EQ(*log.append(report(10), 10), 4u);
+    log.close();
+    const auto records = readLog(directory.path);
+    ASSERT_EQ(records.size(), 5u);
+    EXPECT_EQ(records[4].report, report(10));
+    EXPECT_EQ(readFile(segment).length(),
+              data.length() - sizeof(detail::WalRecordHeader) -
+                  report(4).length());
+}
+
+TEST(WriteAheadLog, corrupted) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path));
+    for (auto i = 0; i < 5; i++) log.append(report(i), i);
+    log.close();
+    const auto segment = detail::walSegmentPath(directory.path, 0);
+    auto data = readFile(segment);
+    // Corrupt report of the third record; the rest of segment is not used
+    const auto recordSize =
+        sizeof(detail::WalRecordHeader) + report(0).length();
+    data[sizeof(detail::WalSegmentHeader) + 2 * recordSize + 20] ^= 1;
+    writeFile(segment, data);
+    EXPECT_EQ(readLog(directory.path).size(), 2u);
+
+    // Segment with corrupted header
+    writeFile(segment, "MFSW");
+    EXPECT_TRUE(readLog(directory.path).empty());
+}
+
+TEST(WriteAheadLog, replay) {
+    const TempDirectory directory("wal");
+    WriteAheadLog log;
+    ASSERT_TRUE(log.open(directory.path, 4096));
+    for (auto i = 0; i < 300; i++) log.append(report(i), 100 * i);
+    log.close();
+
+    const auto replayed = replayLog(directory.path, 10, 4);
+    ASSERT_EQ(replayed.size(), 290u);
+    for (auto i = 0u; i < replayed.size(); i++) {
+        EXPECT_EQ(replayed[i].sequence, 10 + i);
+        EXPECT_EQ(replayed[i].receiveTime, 100 * (10 + static_cast<int>(i)));
+        EXPECT_EQ(replayed[i].simple, simplify(report(10 + i)));
+    }
+    EXPECT_EQ(replayLog(directory.path, 0, 1).size(), 300u);
+}